@@ -0,0 +1,71 @@
+/*
+Allolib Example: OSC Benchmark
+
+Description:
+Measures the cost of building and parsing OSC messages on the paths used by
+ParameterServer and OSCNotifier: encoding a parameter value into a reused
+packet, parsing it reading the address through std::string accessors and
+parsing it reading the address in place.
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "al/protocol/al_OSC.hpp"
+
+using namespace al;
+
+static const int ITERATIONS = 1000000;
+
+template <class Function>
+double nanosecondsPerMessage(Function function) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    function(i);
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / ITERATIONS;
+}
+
+int main() {
+  const std::string address = "/synth/voices/12/filterCutoffFrequency";
+  osc::Packet packet(1024);
+  float sum = 0.0f;
+
+  double encode = nanosecondsPerMessage([&](int i) {
+    packet.clear();
+    packet.addMessage(address, float(i));
+  });
+
+  packet.clear();
+  packet.addMessage(address, 440.0f);
+
+  double parseStrings = nanosecondsPerMessage([&](int) {
+    osc::Message m(packet.data(), int(packet.size()));
+    if (m.addressPattern() == address && m.typeTags() == "f") {
+      float value;
+      m >> value;
+      sum += value;
+    }
+  });
+
+  double parseInPlace = nanosecondsPerMessage([&](int) {
+    osc::Message m(packet.data(), int(packet.size()));
+    if (m.addressPatternSize() == address.size() &&
+        memcmp(m.addressPatternData(), address.data(), address.size()) == 0 &&
+        strcmp(m.typeTagsData(), "f") == 0) {
+      float value;
+      m >> value;
+      sum += value;
+    }
+  });
+
+  printf("encode                 %7.1f ns/message\n", encode);
+  printf("parse, string access   %7.1f ns/message\n", parseStrings);
+  printf("parse, in place access %7.1f ns/message\n", parseInPlace);
+  printf("(checksum %g)\n", sum);
+  return 0;
+}
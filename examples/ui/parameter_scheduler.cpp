@@ -0,0 +1,75 @@
+#include "al/app/al_App.hpp"
+#include "al/graphics/al_Shapes.hpp"
+#include "al/ui/al_ParameterGUI.hpp"
+#include "al/ui/al_ParameterScheduler.hpp"
+
+using namespace al;
+
+// A chain of dependent parameters: 'brightness' and 'hue' are set from the
+// GUI, their callbacks set 'color', and the callback of 'color' updates the
+// mesh. With a ParameterScheduler, dragging a slider runs each callback once
+// per frame, and the mesh is updated once even when both sliders change.
+
+struct MyApp : public App {
+  Parameter brightness{"Brightness", "", 1.0, "", 0.0, 1.0};
+  Parameter hue{"Hue", "", 0.0, "", 0.0, 1.0};
+  ParameterColor color{"Color"};
+
+  ParameterScheduler scheduler;
+  Mesh mesh;
+  int meshUpdates{0};
+
+  void onInit() override {
+    brightness.registerChangeCallback(
+        [&](float value) { color.set(HSV(hue.get(), 1.0, value)); });
+    hue.registerChangeCallback(
+        [&](float value) { color.set(HSV(value, 1.0, brightness.get())); });
+    color.registerChangeCallback([&](Color value) {
+      mesh.colors().clear();
+      for (size_t i = 0; i < mesh.vertices().size(); i++) {
+        mesh.color(value);
+      }
+      meshUpdates++;
+    });
+
+    scheduler.addDependency(brightness, color);
+    scheduler.addDependency(hue, color);
+  }
+
+  void onCreate() override {
+    addSphere(mesh, 0.5);
+    nav().pos(0, 0, 4);
+    color.set(HSV(hue.get(), 1.0, brightness.get()));
+    imguiInit();
+    navControl().useMouse(false);
+  }
+
+  void onAnimate(double /*dt*/) override {
+    // Callbacks of the parameters changed since the last frame run here,
+    // from the graphics thread
+    scheduler.flush();
+
+    imguiBeginFrame();
+    ParameterGUI::beginPanel("Scheduler");
+    ParameterGUI::drawParameter(&brightness);
+    ParameterGUI::drawParameter(&hue);
+    ImGui::Text("Mesh updates: %i", meshUpdates);
+    ParameterGUI::endPanel();
+    imguiEndFrame();
+  }
+
+  void onDraw(Graphics &g) override {
+    g.clear(0);
+    g.meshColor();
+    g.draw(mesh);
+    imguiDraw();
+  }
+
+  void onExit() override { imguiShutdown(); }
+};
+
+int main() {
+  MyApp app;
+  app.start();
+  return 0;
+}
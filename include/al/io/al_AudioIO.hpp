@@ -44,12 +44,16 @@
         Andres Cabrera, 2017 mantaraya36@gmail.com
 */
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "al/io/al_AudioIOData.hpp"
+#include "al/io/al_AudioTelemetry.hpp"
+#include "al/system/al_Thread.hpp"
 
 namespace al {
 
@@ -209,6 +213,9 @@ class AudioIO : public AudioIOData {
       const;  ///< Get number of channels opened on output device
   bool clipOut() const { return mClipOut; }  ///< Returns clipOut setting
   double cpu() const;  ///< Returns current CPU usage of audio thread
+
+  /// Callback load, xrun and span statistics of this stream
+  AudioTelemetry &callbackTelemetry() { return mTelemetryData; }
   bool supportsFPS(
       double fps);  ///< Return true if fps supported, otherwise false
   bool zeroNANs()
@@ -235,6 +242,15 @@ class AudioIO : public AudioIOData {
     mZeroNANs = v;
   }  ///< Set whether to zero NANs in output buffer going to DAC
 
+  /// Set scheduling, affinity and denormal settings for the audio callback
+  /// thread. Applied from within the next callback and whenever the stream is
+  /// started. Memory is locked here, on the calling thread. A default
+  /// configuration does not undo the settings of an earlier one.
+  void threadConfig(const ThreadConfig &v);
+  ThreadConfig threadConfig();  ///< Get audio callback thread settings
+  /// false if the audio callback could not apply some of threadConfig()
+  bool threadConfigApplied() const { return mThreadConfigApplied; }
+
   void print() const;  ///< Prints info about current i/o devices to stdout.
   static const char *errorText(int errNum);  ///< Returns error string.
 
@@ -265,6 +281,11 @@ class AudioIO : public AudioIOData {
   bool mClipOut;      // whether to clip output between -1 and 1
   bool mAutoZeroOut;  // whether to automatically zero output buffers each block
   std::vector<AudioCallback *> mAudioCallbacks;
+  AudioTelemetry mTelemetryData;
+  ThreadConfig mThreadConfig;
+  std::mutex mThreadConfigLock;
+  std::atomic<bool> mThreadConfigPending{false};
+  std::atomic<bool> mThreadConfigApplied{true};
 
   //	void init(int outChannels, int inChannels);			//
   void reopen();  // reopen stream (restarts stream if needed)
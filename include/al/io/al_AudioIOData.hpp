@@ -71,6 +71,76 @@ static void zero(T* buf, unsigned int n) {
   memset(buf, 0, n * sizeof(T));
 }
 
+/// Copy n samples from src to dst. Buffers must not overlap
+inline void copyBlock(float *__restrict dst, const float *__restrict src,
+                      unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    dst[i] = src[i];
+  }
+}
+
+/// Add n samples from src into dst. Buffers must not overlap
+inline void mixBlock(float *__restrict dst, const float *__restrict src,
+                     unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    dst[i] += src[i];
+  }
+}
+
+/// Add n samples from src scaled by gain into dst. Buffers must not overlap
+inline void mixBlock(float *__restrict dst, const float *__restrict src,
+                     float gain, unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    dst[i] += gain * src[i];
+  }
+}
+
+/// Scale n samples in buf by gain
+inline void gainBlock(float *buf, float gain, unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    buf[i] *= gain;
+  }
+}
+
+/// Scale n samples in buf by a gain ramping linearly from startGain towards
+/// endGain. endGain is reached on the sample following the block
+inline void rampGainBlock(float *buf, float startGain, float endGain,
+                          unsigned int n) {
+  const float inc = (endGain - startGain) / n;
+  for (unsigned int i = 0; i < n; i++) {
+    buf[i] *= startGain + inc * i;
+  }
+}
+
+/// Non-owning view of a block of samples from a single channel
+///
+/// @ingroup IO
+template <class T>
+class AudioBlock {
+ public:
+  AudioBlock(T *data = nullptr, unsigned int size = 0)
+      : mData(data), mSize(size) {}
+
+  T *data() const { return mData; }
+  unsigned int size() const { return mSize; }
+  T *begin() const { return mData; }
+  T *end() const { return mData + mSize; }
+  T &operator[](unsigned int i) const {
+    assert(i < mSize);
+    return mData[i];
+  }
+
+  /// Get view of the samples from offset to the end of this block
+  AudioBlock<T> from(unsigned int offset) const {
+    return offset < mSize ? AudioBlock<T>(mData + offset, mSize - offset)
+                          : AudioBlock<T>(mData + mSize, 0);
+  }
+
+ private:
+  T *mData;
+  unsigned int mSize;
+};
+
 /// Utility function to deinterleave samples
 template <class T>
 static void deinterleave(T* dst, const T* src, int numFrames, int numChannels) {
@@ -154,13 +224,21 @@ inline AudioDeviceInfo::StreamMode operator|(
   return static_cast<AudioDeviceInfo::StreamMode>(+a | +b);
 }
 
+class AudioTelemetry;
+
 /// Audio data to be sent to callback
-/// Audio buffers are guaranteed to be stored in a contiguous non-interleaved
-/// format, i.e., frames are tightly packed per channel.
+/// Audio buffers are stored in a non-interleaved format. Each channel buffer
+/// is aligned to BUFFER_ALIGNMENT bytes and channels are channelStride()
+/// samples apart, i.e. framesPerBuffer() rounded up to a whole number of
+/// alignment blocks. Padding samples are always zero after zeroOut() or
+/// zeroBus() and must not be relied on otherwise.
 ///
 /// @ingroup IO
 class AudioIOData {
  public:
+  /// Alignment in bytes of every channel buffer
+  static const unsigned int BUFFER_ALIGNMENT = 64;
+
   /// Constructor
   AudioIOData(void* user = nullptr);
 
@@ -214,7 +292,30 @@ class AudioIOData {
   float& temp(unsigned int frame) const;
 
   /// Get non-interleaved temporary buffer on specified channel
-  float* tempBuffer() const { return &temp(0); }
+  float* tempBuffer() const { return mBufT; }
+
+  /// Get view of a whole block of bus samples for channel
+  AudioBlock<float> busBlock(unsigned int chan) const {
+    return AudioBlock<float>(busBuffer(chan), mFramesPerBuffer);
+  }
+
+  /// Get view of a whole block of input samples for channel
+  AudioBlock<const float> inBlock(unsigned int chan) const {
+    return AudioBlock<const float>(inBuffer(chan), mFramesPerBuffer);
+  }
+
+  /// Get view of a whole block of output samples for channel
+  AudioBlock<float> outBlock(unsigned int chan) const {
+    return AudioBlock<float>(outBuffer(chan), mFramesPerBuffer);
+  }
+
+  /// Get view of the temporary buffer
+  AudioBlock<float> tempBlock() const {
+    return AudioBlock<float>(mBufT, mFramesPerBuffer);
+  }
+
+  /// Number of samples between the start of consecutive channel buffers
+  unsigned int channelStride() const { return mChannelStride; }
 
   void* user() const { return mUser; }  ///< Get pointer to user data
 
@@ -234,6 +335,12 @@ class AudioIOData {
   double secondsPerBuffer() const;  ///< Get seconds/buffer of audio I/O stream
 
   void user(void* v) { mUser = v; }  ///< Set user data
+
+  /// Get callback telemetry of the audio stream, nullptr if not available
+  AudioTelemetry* telemetry() const { return mTelemetry; }
+  /// Set callback telemetry that processing code can add timing spans to
+  void telemetry(AudioTelemetry* v) { mTelemetry = v; }
+
   void frame(unsigned int v) {
     assert(v >= 0);
     mFrame = v - 1;
@@ -267,8 +374,10 @@ class AudioIOData {
 
  protected:
   void* mUser;  // User specified data
+  AudioTelemetry* mTelemetry{nullptr};
   mutable unsigned int mFrame;
   unsigned int mFramesPerBuffer;
+  unsigned int mChannelStride;  // framesPerBuffer padded to BUFFER_ALIGNMENT
   double mFramesPerSecond;
   float *mBufI, *mBufO, *mBufB;      // input, output, and aux buffers
   float* mBufT;                      // temporary one channel buffer
@@ -276,6 +385,10 @@ class AudioIOData {
 
   void resizeBuffer(bool forOutput);
 
+  /// Allocate zeroed and aligned buffer for numChannels channels
+  float* allocateChannels(unsigned int numChannels);
+  static void freeChannels(float*& buf);
+
  private:
   void operator=(const AudioIOData&);  // Disallow copy
 };
@@ -293,19 +406,19 @@ class AudioCallback {
 inline float& AudioIOData::bus(unsigned int c, unsigned int f) const {
   assert(c < mNumB);
   assert(f < framesPerBuffer());
-  return mBufB[c * framesPerBuffer() + f];
+  return mBufB[c * mChannelStride + f];
 }
 
 inline const float& AudioIOData::in(unsigned int c, unsigned int f) const {
   assert(c < mNumI);
   assert(f < framesPerBuffer());
-  return mBufI[c * framesPerBuffer() + f];
+  return mBufI[c * mChannelStride + f];
 }
 
 inline float& AudioIOData::out(unsigned int c, unsigned int f) const {
   assert(c < mNumO);
   assert(f < framesPerBuffer());
-  return mBufO[c * framesPerBuffer() + f];
+  return mBufO[c * mChannelStride + f];
 }
 inline float& AudioIOData::temp(unsigned int f) const { return mBufT[f]; }
 
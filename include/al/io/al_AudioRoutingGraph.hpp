@@ -0,0 +1,183 @@
+#ifndef INCLUDE_AL_AUDIOROUTINGGRAPH_HPP
+#define INCLUDE_AL_AUDIOROUTINGGRAPH_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Declarative bus routing for AudioIOData, compiled to a block mix
+        schedule that can be replaced while audio is running.
+*/
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "al/io/al_AudioIOData.hpp"
+#include "al/types/al_SingleRWRingBuffer.hpp"
+
+namespace al {
+
+/**
+ * @brief Routing graph for voice outputs, buses and output channels
+ * @ingroup IO
+ *
+ * Routes are described declaratively through send(), busToBus() and
+ * busToOutput() and become active once commit() is called. commit() compiles
+ * the routes into a flat list of block mixes, with bus to bus routes sorted so
+ * that a bus is complete before it is read. Routes can be edited and committed
+ * from any thread while audio is running.
+ *
+ * On the audio thread, call acquire() once at the start of each block to pick
+ * up the most recent committed schedule, then processSends() for each voice
+ * and processBuses() once all voices have been mixed. Neither of these
+ * functions lock or allocate.
+ */
+class AudioRoutingGraph {
+ public:
+  /// Processing function for bus to bus routes. Must write numFrames samples
+  /// to out. in and out never alias.
+  typedef std::function<void(const float *in, float *out,
+                             unsigned int numFrames)>
+      BusProcessor;
+
+  AudioRoutingGraph();
+
+  ~AudioRoutingGraph();
+
+  /**
+   * @brief Route a voice output channel to a bus
+   * @param voiceOutChan output channel of the voice's AudioIOData
+   * @param bus destination bus
+   * @param gain send gain
+   */
+  AudioRoutingGraph &send(unsigned int voiceOutChan, unsigned int bus,
+                          float gain = 1.0f);
+
+  /**
+   * @brief Route a bus into another bus
+   * @param srcBus source bus
+   * @param dstBus destination bus
+   * @param gain gain applied after processing
+   * @param processor optional effect applied to the source bus signal
+   */
+  AudioRoutingGraph &busToBus(unsigned int srcBus, unsigned int dstBus,
+                              float gain = 1.0f,
+                              BusProcessor processor = nullptr);
+
+  /**
+   * @brief Route a bus to an output channel
+   * @param bus source bus
+   * @param outChan destination output channel
+   * @param gain gain for the route
+   */
+  AudioRoutingGraph &busToOutput(unsigned int bus, unsigned int outChan,
+                                 float gain = 1.0f);
+
+  /// Remove all routes. Takes effect on the next commit()
+  void clear();
+
+  /**
+   * @brief Compile current routes and publish them to the audio thread
+   * @return false if bus routes contain a cycle. The previous schedule is kept
+   */
+  bool commit();
+
+  /// Pick up the latest committed schedule. Call from the audio thread only
+  void acquire();
+
+  /**
+   * @brief Mix voice outputs into the buses of io
+   * @param voiceIO the voice's AudioIOData
+   * @param io the destination AudioIOData
+   * @param offset first frame to process
+   *
+   * Call from the audio thread only, after acquire().
+   */
+  void processSends(const AudioIOData &voiceIO, AudioIOData &io,
+                    unsigned int offset = 0) const;
+
+  /**
+   * @brief Run bus to bus and bus to output routes on io
+   *
+   * Call from the audio thread only, after acquire(). Uses io's temporary
+   * buffer for bus processors.
+   */
+  void processBuses(AudioIOData &io) const;
+
+  /// Returns true if the audio thread has a schedule to run
+  bool active() const { return mActive != nullptr; }
+
+ private:
+  enum RouteType { SEND, BUS_TO_BUS, BUS_TO_OUTPUT };
+
+  struct Route {
+    RouteType type;
+    unsigned int src;
+    unsigned int dst;
+    float gain;
+    BusProcessor processor;
+  };
+
+  struct MixOp {
+    unsigned int src;
+    unsigned int dst;
+    float gain;
+    int processor;  // Index into Schedule::processors or -1
+  };
+
+  struct Schedule {
+    std::vector<MixOp> sends;
+    std::vector<MixOp> busOps;  // Bus to bus, topologically sorted
+    std::vector<MixOp> outOps;
+    std::vector<BusProcessor> processors;
+  };
+
+  void collectRetired();
+
+  std::mutex mRouteLock;  // Protects mRoutes and publishing
+  std::vector<Route> mRoutes;
+
+  std::atomic<Schedule *> mPending{nullptr};
+  Schedule *mActive{nullptr};  // Owned by the audio thread
+  // Schedules replaced on the audio thread, freed by editing thread
+  SingleRWRingBuffer mRetired{64 * sizeof(Schedule *)};
+};
+
+}  // namespace al
+
+#endif  // INCLUDE_AL_AUDIOROUTINGGRAPH_HPP
@@ -0,0 +1,182 @@
+#ifndef INCLUDE_AL_AUDIOTELEMETRY_HPP
+#define INCLUDE_AL_AUDIOTELEMETRY_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Lock-free timing statistics for the audio callback.
+*/
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace al {
+
+/**
+ * @brief Callback load, xrun and sub-span statistics for an audio stream
+ * @ingroup IO
+ *
+ * Load is the time spent in the callback as a fraction of the buffer period
+ * (framesPerBuffer / framesPerSecond). A load above 1 is a deadline miss.
+ *
+ * beginCallback(), endCallback() and reportXrun() are called by AudioIO from
+ * the audio thread. Named spans can be timed from the audio thread or its
+ * worker threads through ScopedSpan. None of these lock or allocate.
+ * snapshot() and reset() can be called from any other thread.
+ */
+class AudioTelemetry {
+ public:
+  /// Number of histogram bins. Each bin covers 1/16 of the buffer period, the
+  /// last bin also counts all loads above its lower edge.
+  static const unsigned int HISTOGRAM_BINS = 32;
+  static const unsigned int BINS_PER_PERIOD = 16;
+  /// Maximum number of named spans
+  static const unsigned int MAX_SPANS = 16;
+
+  typedef std::chrono::steady_clock Clock;
+
+  /// Statistics for a named span. Loads are fractions of the buffer period
+  struct SpanStats {
+    const char *name;
+    float lastLoad;
+    float maxLoad;
+    float meanLoad;
+  };
+
+  /// Copy of the statistics at a point in time
+  struct Snapshot {
+    uint64_t callbacks{0};
+    uint64_t xruns{0};
+    uint64_t deadlineMisses{0};
+    double period{0.0};  ///< Buffer period in seconds
+    float lastLoad{0.0f};
+    float maxLoad{0.0f};
+    float meanLoad{0.0f};
+    float smoothedLoad{0.0f};
+    std::array<uint64_t, HISTOGRAM_BINS> histogram{};
+    std::vector<SpanStats> spans;
+  };
+
+  /**
+   * @brief Times a named span for the lifetime of the object
+   *
+   * The name must outlive the telemetry object (use string literals). Spans
+   * with the same name that run on several threads during a callback are
+   * added together. Does nothing if telemetry is nullptr.
+   */
+  class ScopedSpan {
+   public:
+    ScopedSpan(AudioTelemetry *telemetry, const char *name);
+    ~ScopedSpan() { stop(); }
+
+    /// End the span before the object goes out of scope
+    void stop();
+
+   private:
+    AudioTelemetry *mTelemetry;
+    int mId;
+    Clock::time_point mStart;
+  };
+
+  AudioTelemetry();
+
+  /// Mark the start of an audio callback. Call from the audio thread only
+  void beginCallback();
+
+  /**
+   * @brief Mark the end of an audio callback. Call from the audio thread only
+   * @param period buffer period in seconds
+   */
+  void endCallback(double period);
+
+  /// Count a buffer underflow or overflow reported by the audio backend
+  void reportXrun() { mXruns.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Get index for a span name, registering it if needed
+   * @return index or -1 if MAX_SPANS names are already registered
+   */
+  int spanId(const char *name);
+
+  /// Add time to a span during the current callback
+  void addSpanTime(int id, Clock::duration duration);
+
+  /// Exponentially smoothed callback load
+  float load() const { return mSmoothedLoad.load(std::memory_order_relaxed); }
+
+  /// Number of callbacks measured
+  uint64_t callbacks() const {
+    return mCallbacks.load(std::memory_order_relaxed);
+  }
+
+  /// Copy current statistics. Safe to call from any thread
+  Snapshot snapshot() const;
+
+  /// Clear all statistics. Applied by the audio thread on the next callback
+  void reset() { mResetRequested.store(true, std::memory_order_release); }
+
+ private:
+  struct Span {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<int64_t> pendingNs{0};  // Accumulated during current callback
+    std::atomic<float> lastLoad{0.0f};
+    std::atomic<float> maxLoad{0.0f};
+    std::atomic<double> loadSum{0.0};
+  };
+
+  void clear();
+
+  Clock::time_point mCallbackStart;  // Audio thread only
+  std::atomic<bool> mResetRequested{false};
+
+  std::atomic<uint64_t> mCallbacks{0};
+  std::atomic<uint64_t> mXruns{0};
+  std::atomic<uint64_t> mDeadlineMisses{0};
+  std::atomic<double> mPeriod{0.0};
+  std::atomic<float> mLastLoad{0.0f};
+  std::atomic<float> mMaxLoad{0.0f};
+  std::atomic<float> mSmoothedLoad{0.0f};
+  std::atomic<double> mLoadSum{0.0};
+  std::array<std::atomic<uint64_t>, HISTOGRAM_BINS> mHistogram;
+  std::array<Span, MAX_SPANS> mSpans;
+};
+
+}  // namespace al
+
+#endif  // INCLUDE_AL_AUDIOTELEMETRY_HPP
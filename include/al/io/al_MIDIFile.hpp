@@ -0,0 +1,222 @@
+#ifndef INCLUDE_AL_MIDIFILE_HPP
+#define INCLUDE_AL_MIDIFILE_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Standard MIDI File (SMF) reader and writer
+*/
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace al {
+
+/**
+ * @brief Event read from a Standard MIDI File
+ * @ingroup IO
+ *
+ * For sysex and meta events, data points into the file buffer and is valid
+ * only during the MIDIFile::read() callback.
+ */
+struct MIDIFileEvent {
+  static const uint8_t META = 0xFF;
+  static const uint8_t SYSEX = 0xF0;
+  static const uint8_t SYSEX_ESCAPE = 0xF7;
+
+  // Meta event types
+  static const uint8_t META_TRACK_NAME = 0x03;
+  static const uint8_t META_END_OF_TRACK = 0x2F;
+  static const uint8_t META_TEMPO = 0x51;
+  static const uint8_t META_TIME_SIGNATURE = 0x58;
+
+  uint16_t track;
+  uint64_t tick;    ///< Absolute time in ticks since the start of the track
+  double beat;      ///< Absolute time in beats (seconds for SMPTE files)
+  uint8_t status;   ///< Status byte (running status resolved)
+  uint8_t data1;    ///< First data byte, or meta event type
+  uint8_t data2;    ///< Second data byte
+  const uint8_t *data;  ///< Sysex or meta payload
+  uint32_t size;        ///< Size of data
+
+  bool isMeta() const { return status == META; }
+  bool isSysex() const { return status == SYSEX || status == SYSEX_ESCAPE; }
+  bool isChannelMessage() const { return status >= 0x80 && status < 0xF0; }
+  /// Message type for channel messages (status without channel)
+  uint8_t type() const { return status & 0xF0; }
+  uint8_t channel() const { return status & 0x0F; }
+  uint8_t metaType() const { return data1; }
+  bool isNoteOn() const { return type() == 0x90 && data2 > 0; }
+  /// True for note off messages and note on messages with velocity 0
+  bool isNoteOff() const {
+    return type() == 0x80 || (type() == 0x90 && data2 == 0);
+  }
+  /// Tempo in bpm for META_TEMPO events
+  double tempo() const;
+};
+
+/**
+ * @brief Reads Standard MIDI Files (format 0, 1 and 2)
+ * @ingroup IO
+ *
+ * The file is loaded into a single buffer by open(). read() then parses all
+ * tracks in one pass, one track after the other, calling the handler for
+ * every event in time order within its track. Parsing does not allocate
+ * memory, so large multi track files can be read quickly.
+ *
+ * @code
+ * MIDIFile file;
+ * if (file.open("song.mid")) {
+ *   file.read([](const MIDIFileEvent &e) {
+ *     if (e.isNoteOn()) {
+ *       std::cout << e.beat << " " << int(e.data1) << std::endl;
+ *     }
+ *   });
+ * }
+ * @endcode
+ */
+class MIDIFile {
+ public:
+  typedef std::function<void(const MIDIFileEvent &)> EventHandler;
+
+  MIDIFile() {}
+  MIDIFile(const std::string &fileName) { open(fileName); }
+
+  /// Load file and parse its header. Returns false on error
+  bool open(const std::string &fileName);
+
+  /// Use data already in memory. The data is copied
+  bool open(const uint8_t *data, size_t size);
+
+  bool isOpen() const { return mTracks.size() > 0; }
+
+  /**
+   * @brief Parse all tracks
+   * @return false if a track is malformed. Events parsed before the error
+   * have been passed to the handler
+   */
+  bool read(const EventHandler &handler) const;
+
+  uint16_t format() const { return mFormat; }
+  uint16_t numTracks() const { return uint16_t(mTracks.size()); }
+
+  /// True if the time division is in SMPTE frames instead of beats
+  bool isSMPTE() const { return mTicksPerSecond > 0.0; }
+
+  /// Ticks per beat (quarter note). 0 for SMPTE files
+  uint16_t ticksPerBeat() const { return mTicksPerBeat; }
+
+  /// Ticks per second for SMPTE files, 0 otherwise
+  double ticksPerSecond() const { return mTicksPerSecond; }
+
+ private:
+  struct Track {
+    size_t offset;
+    size_t size;
+  };
+
+  std::vector<uint8_t> mData;
+  std::vector<Track> mTracks;
+  uint16_t mFormat{0};
+  uint16_t mTicksPerBeat{0};
+  double mTicksPerSecond{0.0};
+};
+
+/**
+ * @brief Writes Standard MIDI Files
+ * @ingroup IO
+ *
+ * Events can be added to any track in any order. They are sorted by tick
+ * when the file is written, with note offs before other events at the same
+ * tick so repeated notes are not cut.
+ */
+class MIDIFileWriter {
+ public:
+  MIDIFileWriter(uint16_t ticksPerBeat = 480) : mTicksPerBeat(ticksPerBeat) {}
+
+  /// Add a track and return its index
+  int addTrack(std::string name = "");
+
+  /// Number of ticks for a time in beats
+  uint64_t ticks(double beat) const {
+    return beat > 0.0 ? uint64_t(beat * mTicksPerBeat + 0.5) : 0;
+  }
+
+  void noteOn(int track, uint64_t tick, int channel, int noteNumber,
+              int velocity);
+  void noteOff(int track, uint64_t tick, int channel, int noteNumber,
+               int velocity = 0);
+  void controlChange(int track, uint64_t tick, int channel, int controlNumber,
+                     int value);
+  void programChange(int track, uint64_t tick, int channel, int program);
+
+  /// Tempo in beats per minute
+  void tempo(int track, uint64_t tick, double bpm);
+  void timeSignature(int track, uint64_t tick, int numerator,
+                     int denominator);
+
+  size_t numTracks() const { return mTracks.size(); }
+
+  void clear() { mTracks.clear(); }
+
+  /// Write file. Format 0 is used for a single track, format 1 otherwise
+  bool write(const std::string &fileName) const;
+
+ private:
+  struct Event {
+    uint64_t tick;
+    uint32_t order;  // Insertion order, keeps sort stable
+    uint8_t size;
+    uint8_t bytes[7];
+  };
+
+  struct Track {
+    std::string name;
+    std::vector<Event> events;
+  };
+
+  void add(int track, uint64_t tick, const uint8_t *bytes, uint8_t size);
+
+  uint16_t mTicksPerBeat;
+  uint32_t mOrder{0};
+  std::vector<Track> mTracks;
+};
+
+}  // namespace al
+
+#endif  // INCLUDE_AL_MIDIFILE_HPP
@@ -46,6 +46,7 @@
         Keehong Youn, 2017, younkeehong@gmail.com
 */
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -203,6 +204,11 @@ class Packet {
 
 /// Inbound OSC message
 ///
+/// The message reads its address, type tags and arguments in place from the
+/// raw bytes, which must outlive it. Constructing and reading a message does
+/// not allocate. addressPattern() and typeTags() build their std::string on
+/// first use; use addressPatternData() and typeTagsData() in hot paths.
+///
 /// @ingroup allocore
 class Message {
  public:
@@ -225,12 +231,25 @@ class Message {
   const TimeTag& timeTag() const { return mTimeTag; }
 
   /// Get address pattern
-  const std::string& addressPattern() const { return mAddressPattern; }
+  const std::string& addressPattern() const;
+
+  /// Address pattern as a null terminated string inside the message bytes
+  const char* addressPatternData() const { return mAddress; }
+  size_t addressPatternSize() const { return mAddressSize; }
+
+  /// Raw message bytes, starting at the address pattern
+  const char* data() const { return mAddress; }
+  size_t size() const { return mEnd ? size_t(mEnd - mAddress) : 0; }
 
   const std::string senderAddress() const { return std::string(mSenderAddr); }
 
   /// Get type tags
-  const std::string& typeTags() const { return mTypeTags; }
+  const std::string& typeTags() const;
+
+  /// Type tags (without the leading ',') as a null terminated string inside
+  /// the message bytes
+  const char* typeTagsData() const { return mTags; }
+  size_t typeTagsSize() const { return mTagsSize; }
 
   /// Reset stream for converting from raw message bytes to types
   Message& resetStream();
@@ -246,10 +265,23 @@ class Message {
   Message& operator>>(Blob& v);  ///< Extract next stream element as Blob
 
  protected:
-  class Impl;
-  Impl* mImpl;
-  std::string mAddressPattern;
-  std::string mTypeTags;
+  // Returns the next argument if its type tag is tag and size bytes fit in
+  // the message, nullptr otherwise
+  const char* nextArgument(char tag, size_t size, const char* what);
+
+  const char* mAddress{""};
+  size_t mAddressSize{0};
+  const char* mTags{""};
+  size_t mTagsSize{0};
+  const char* mArguments{nullptr};
+  const char* mEnd{nullptr};
+  const char* mReadPosition{nullptr};
+  size_t mReadTag{0};
+
+  mutable std::string mAddressPattern;
+  mutable std::string mTypeTags;
+  mutable bool mAddressPatternCached{false};
+  mutable bool mTypeTagsCached{false};
   TimeTag mTimeTag;
   char mSenderAddr[32];
 };
@@ -384,7 +416,14 @@ class Send : public Packet {
 
 /// Socket for receiving OSC packets
 
-/// Supports explicit polling or implicit background thread polling
+/// Supports explicit polling or implicit background thread polling.
+///
+/// On Linux, started sockets are served by one receive thread shared by all
+/// Recv instances. It waits on every socket with epoll and reads many
+/// datagrams per system call. Handlers of all shared sockets run on that
+/// thread, so a handler that blocks for long delays every other socket and
+/// should use sharedThread(false). The sockets of ParameterServer,
+/// PresetServer and SequenceServer use the shared thread.
 ///
 /// @ingroup allocore
 class Recv {
@@ -442,6 +481,18 @@ class Recv {
   /// Returns whether the thread was started successfully.
   bool start();
 
+  /// Set whether start() uses the receive thread shared by all Recv
+  /// instances (the default) or a thread of its own.
+  /// Takes effect on the next start(). The shared thread is only available on
+  /// Linux, other platforms always use a thread per socket.
+  Recv& sharedThread(bool shared) {
+    mSharedThread = shared;
+    return *this;
+  }
+
+  /// Whether start() uses the receive thread shared by all Recv instances
+  bool sharedThread() const { return mSharedThread; }
+
   /// Stop the background polling
   void stop();
 
@@ -455,6 +506,7 @@ class Recv {
   std::vector<char> mBuffer;
   al::Thread mThread;
   bool mBackground;
+  bool mSharedThread{true};
   std::string mAddress = "";
   uint16_t mPort = 0;
   bool mOpen{false};
@@ -265,6 +265,19 @@ class DynamicScene : public PolySynth {
   void setUpdateThreaded(bool threaded) { mThreadedUpdate = threaded; }
   void setAudioThreaded(bool threaded) { mThreadedAudio = threaded; }
 
+  /**
+   * @brief Set scheduling, affinity and denormal settings for the audio
+   * worker threads
+   *
+   * If config lists more than one CPU, worker threads are pinned one per CPU
+   * in turn. Applied by each worker on its next block.
+   */
+  void setAudioThreadConfig(const ThreadConfig &config) {
+    std::unique_lock<std::mutex> lk(mThreadTriggerLock);
+    mAudioThreadConfig = config;
+    mAudioThreadConfigVersion++;
+  }
+
   DistAtten<> &distanceAttenuation() { return mDistAtten; }
 
   void print(std::ostream &stream = std::cout);
@@ -313,8 +326,13 @@ class DynamicScene : public PolySynth {
       *externalAudioIO;  // This is captured by the audio callback and passed to
                          // the audio threads. Protected by mSpatializerLock
   std::mutex mThreadTriggerLock;
+  ThreadConfig mAudioThreadConfig;  // Protected by mThreadTriggerLock
+  unsigned int mAudioThreadConfigVersion{0};
   bool mSynthRunning{true};
   unsigned int mAudioBusy = 0;
+  // Routing graph of the block being rendered. Set by the audio callback
+  // before the audio threads are triggered
+  std::shared_ptr<AudioRoutingGraph> mBlockRoutingGraph;
 
   static void updateThreadFunc(UpdateThreadFuncData data);
 
@@ -50,6 +50,9 @@
 
 #include "al/graphics/al_Graphics.hpp"
 #include "al/io/al_AudioIOData.hpp"
+#include "al/io/al_AudioRoutingGraph.hpp"
+#include "al/io/al_AudioTelemetry.hpp"
+#include "al/system/al_Thread.hpp"
 #include "al/types/al_SingleRWRingBuffer.hpp"
 #include "al/ui/al_Parameter.hpp"
 
@@ -325,6 +328,7 @@ the other
    */
   virtual SynthVoice &registerTriggerParameter(ParameterMeta &param) {
     mTriggerParams.push_back(&param);
+    mTriggerParamKinds.push_back(triggerParameterKind(&param));
     return *this;
   }
 
@@ -344,7 +348,34 @@ the other
     return registerTriggerParameter(param);
   }
 
-  std::vector<ParameterMeta *> triggerParameters() { return mTriggerParams; }
+  const std::vector<ParameterMeta *> &triggerParameters() {
+    return mTriggerParams;
+  }
+
+  /// How the value of a trigger parameter is read
+  enum TriggerParameterKind : uint8_t {
+    TRIGGER_NUMBER,  ///< Through toFloat()
+    TRIGGER_MENU,    ///< ParameterMenu, by index
+    TRIGGER_STRING   ///< ParameterString
+  };
+
+  static TriggerParameterKind triggerParameterKind(ParameterMeta *param) {
+    if (dynamic_cast<ParameterString *>(param)) {
+      return TRIGGER_STRING;
+    } else if (dynamic_cast<ParameterMenu *>(param)) {
+      return TRIGGER_MENU;
+    }
+    return TRIGGER_NUMBER;
+  }
+
+  /**
+   * @brief Kinds of the trigger parameters, resolved when they are registered
+   *
+   * Matches triggerParameters() unless mTriggerParams was changed directly.
+   */
+  const std::vector<TriggerParameterKind> &triggerParameterKinds() {
+    return mTriggerParamKinds;
+  }
 
   /**
    * @brief registerParameter
@@ -410,6 +441,7 @@ the other
   }
 
   std::vector<ParameterMeta *> mTriggerParams;
+  std::vector<TriggerParameterKind> mTriggerParamKinds;
 
   std::vector<ParameterMeta *> mContinuousParameters;
 
@@ -778,6 +810,24 @@ class PolySynth {
     mBusRoutingCallback = std::make_shared<BusRoutingCallback>(cb);
   }
 
+  /**
+   * @brief Set a routing graph for voice sends, buses and outputs
+   * @param graph the routing graph. Pass nullptr to disable.
+   *
+   * Voice outputs are mixed into buses according to the graph's sends after
+   * each voice renders. Bus to bus and bus to output routes are run once all
+   * voices have been rendered. The graph can be edited and committed while
+   * audio is running, and can be replaced from any thread. The audio thread
+   * keeps the graph it started a block with until the block ends.
+   */
+  void setRoutingGraph(std::shared_ptr<AudioRoutingGraph> graph) {
+    std::atomic_store(&mRoutingGraph, graph);
+  }
+
+  std::shared_ptr<AudioRoutingGraph> routingGraph() {
+    return std::atomic_load(&mRoutingGraph);
+  }
+
   /**
    * @brief Set the time in seconds to wait between sequencer updates when time
    * master is CPU.
@@ -788,6 +838,15 @@ class PolySynth {
     mCpuGranularitySec = timeSecs;
   }
 
+  /**
+   * @brief Set scheduling, affinity and denormal settings for the CPU clock
+   * thread.
+   *
+   * Applied when the thread starts or on its next update if it is running.
+   * This has no effect if time master mode is not TIME_MASTER_CPU
+   */
+  void setCpuClockThreadConfig(const ThreadConfig &config);
+
  protected:
   void startCpuClockThread();
 
@@ -915,14 +974,13 @@ class PolySynth {
 
   inline void processGain(AudioIOData &io) {
     io.frame(0);
-    if (mAudioGain != 1.0f) {
+    if (mAudioGain != 1.0f || mAudioGainPrev != 1.0f) {
+      // Ramp over the block to avoid zipper noise on gain changes
       for (unsigned int i = 0; i < io.channelsOut(); i++) {
-        float *buffer = io.outBuffer(i);
-        uint64_t samps = io.framesPerBuffer();
-        while (samps--) {
-          *buffer++ *= mAudioGain;
-        }
+        rampGainBlock(io.outBuffer(i), mAudioGainPrev, mAudioGain,
+                      (unsigned int)io.framesPerBuffer());
       }
+      mAudioGainPrev = mAudioGain;
     }
   }
 
@@ -947,6 +1005,7 @@ class PolySynth {
   uint16_t mVoiceMaxInputChannels = 0;
   uint16_t mVoiceBusChannels = 0;
   std::shared_ptr<BusRoutingCallback> mBusRoutingCallback;
+  std::shared_ptr<AudioRoutingGraph> mRoutingGraph;
   AudioIOData internalAudioIO;
 
   SingleRWRingBuffer mVoiceIdsToTurnOff{64 * sizeof(int)};
@@ -974,6 +1033,7 @@ class PolySynth {
   std::vector<AllocationCallback> mAllocationCallbacks;
 
   float mAudioGain{1.0f};
+  float mAudioGainPrev{1.0f};  // Gain at the end of the previous block
 
   int mIdCounter{1000};
 
@@ -992,6 +1052,9 @@ class PolySynth {
   bool mRunCPUClock{true};
   double mCpuGranularitySec = 0.001;  // 1ms
   std::unique_ptr<std::thread> mCpuClockThread;
+  ThreadConfig mCpuClockThreadConfig;
+  std::mutex mCpuClockThreadConfigLock;
+  std::atomic<bool> mCpuClockThreadConfigPending{false};
 
   bool mVerbose{false};
 };
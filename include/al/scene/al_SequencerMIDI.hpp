@@ -42,26 +42,39 @@
         Andrés Cabrera mantaraya36@gmail.com
 */
 
+#include <array>
+
 #include "al/io/al_MIDI.hpp"
+#include "al/io/al_MIDIFile.hpp"
 #include "al/scene/al_SynthSequencer.hpp"
 
 namespace al {
 
 /**
- * @brief The PresetMIDI class connects PresetHandler objects to MIDI messages
+ * @brief The SequencerMIDI class connects MIDI notes to PolySynth voices
  * @ingroup Scene
  *
+ * Voices are mapped to MIDI channels with mapChannel(). The mapping is used
+ * both for live MIDI input, triggering voices on the PolySynth set with
+ * setSynthSequencer(), and to load Standard MIDI Files into a SynthSequencer
+ * with loadMIDIFile().
  *
 @code
-
+SequencerMIDI midi;
+midi.mapChannel(0, "SineEnv",
+                [](int note, int velocity, std::vector<ParameterField> &f) {
+                  f = {0.5f, float(noteToHz(note)), velocity / 127.0f};
+                });
+midi.loadMIDIFile("song.mid", sequencer);
 @endcode
  *
  */
 class SequencerMIDI : public MIDIMessageHandler {
  public:
-  SequencerMIDI() {}
+  SequencerMIDI() { resetLiveVoiceIds(); }
 
   SequencerMIDI(int deviceIndex) : mSynth(nullptr) {
+    resetLiveVoiceIds();
     MIDIMessageHandler::bindTo(mRtMidiIn);
     try {
       mRtMidiIn.openPort(deviceIndex);
@@ -122,7 +135,39 @@ class SequencerMIDI : public MIDIMessageHandler {
     mNoteOffFunctions.push_back(function);
   }
 
+  /// Fill trigger parameters of a voice from note number and velocity
+  typedef std::function<void(int noteNumber, int velocity,
+                             std::vector<ParameterField> &pFields)>
+      FieldMapping;
+
+  /**
+   * @brief Map a MIDI channel to a voice class
+   * @param channel MIDI channel (0-15)
+   * @param voiceName voice name registered with the PolySynth
+   * @param mapping sets the trigger parameters of the voice for each note. If
+   * not set, voices are triggered with their current parameters
+   */
+  void mapChannel(int channel, std::string voiceName,
+                  FieldMapping mapping = nullptr);
+
+  /**
+   * @brief Load a Standard MIDI File into a sequencer
+   * @param fileName .mid file
+   * @param sequencer notes on mapped channels are added as events
+   * @param timeOffset offset in beats added to all events
+   * @return false if the file could not be read
+   *
+   * Event times are in beats and the file's tempo and time signature changes
+   * replace the tempo map of the sequencer. Notes on channels that have not
+   * been mapped are ignored.
+   */
+  bool loadMIDIFile(std::string fileName, SynthSequencer &sequencer,
+                    double timeOffset = 0.0);
+
   virtual void onMIDIMessage(const MIDIMessage &m) override {
+    if (mSynth) {
+      triggerMappedVoice(m);
+    }
     if (m.type() == MIDIByte::NOTE_ON && m.velocity() > 0) {
       for (auto function : mNoteOnFunctions) {
         //				std::cout << binding.channel << " " <<
@@ -164,7 +209,23 @@ class SequencerMIDI : public MIDIMessageHandler {
   }
 
  private:
-  PolySynth *mSynth;
+  struct ChannelMapping {
+    std::string voiceName;
+    FieldMapping mapping;
+  };
+
+  void triggerMappedVoice(const MIDIMessage &m);
+  void resetLiveVoiceIds() {
+    for (auto &channel : mLiveVoiceIds) {
+      channel.fill(-1);
+    }
+  }
+
+  PolySynth *mSynth{nullptr};
+  std::array<ChannelMapping, 16> mChannelMappings;
+  // Voice ids of notes triggered from live input, per channel and note
+  std::array<std::array<int, 128>, 16> mLiveVoiceIds;
+  std::vector<ParameterField> mLiveFields;
 
   RtMidiIn mRtMidiIn;
   std::vector<std::function<void(int, int, int)>> mNoteOnFunctions;
@@ -43,11 +43,16 @@
         Andrés Cabrera mantaraya36@gmail.com
 */
 
+#include <atomic>
 #include <chrono>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
 
 #include "al/io/al_File.hpp"
 #include "al/scene/al_SynthSequencer.hpp"
+#include "al/types/al_MultiWriterRingBuffer.hpp"
 
 namespace al {
 
@@ -73,7 +78,17 @@ namespace al {
  * connect the 'trigger off' to a previous 'trigger on'.
  *
  * Alternatively, the sequence can be recorded in CPP_FORMAT that produces C++
- * code that can be pasted to deliver the sequence.
+ * code that can be pasted to deliver the sequence, in BINARY_SEQUENCE that
+ * writes a compiled sequence that SynthSequencer loads without parsing, or in
+ * MIDI_FILE that writes a Standard MIDI File (see setMIDIExportMapping()).
+ *
+ * Trigger callbacks only copy the event into a preallocated lock-free log of
+ * fixed size records, so recording does not allocate or lock on the thread
+ * that triggers voices, apart from the short pointer lock taken to read
+ * string trigger parameters (see ParameterValue). A background thread
+ * started by startRecord() drains the log and the file is written by
+ * stopRecord(). Events that arrive while the log is full are counted in
+ * droppedEvents(). String trigger parameters are truncated to fit the record.
  *
  * The sequences stored in the text file can be played back using SynthSequencer
  * You must make sre that the synthesizers referenced in the sequence have
@@ -97,11 +112,15 @@ class SynthRecorder {
                          // trigger off can be separate entries (uses '+' and
                          // '-' text commands)
     CPP_FORMAT,          // Saves code that can be copy-pasted into C++
+    BINARY_SEQUENCE,     // Compiled ".synthSequenceBin" (see SynthSequenceFile)
+    MIDI_FILE,           // Standard MIDI File (".mid")
     NONE
   } TextFormat;
 
   SynthRecorder(TextFormat format = SEQUENCER_EVENT) { mFormat = format; }
 
+  ~SynthRecorder();
+
   void setDirectory(std::string path) {
     if (!File::exists(path)) {
       if (!Dir::make(path)) {
@@ -118,7 +137,24 @@ class SynthRecorder {
 
   void setMaxRecordTime(al_sec maxTime) { mMaxRecordTime = maxTime; }
 
-  void verbose(bool verbose) { mVerbose = true; }
+  /// Map a recorded trigger on event to a MIDI note. Return false to leave
+  /// the event out of the MIDI file
+  typedef std::function<bool(const SynthEvent &event, int &channel,
+                             int &noteNumber, int &velocity)>
+      MIDIExportMapping;
+
+  /**
+   * @brief Set how events are converted for the MIDI_FILE format
+   *
+   * By default each voice class gets its own channel, the note number is
+   * taken from a trigger parameter with "freq" in its name (in Hz) and the
+   * velocity from a parameter with "amp" in its name (0-1).
+   */
+  void setMIDIExportMapping(MIDIExportMapping mapping) {
+    mMIDIExportMapping = mapping;
+  }
+
+  void verbose(bool verbose) { mVerbose = verbose; }
   bool verbose() { return mVerbose; }
 
   //	std::string lastSequenceName();
@@ -143,30 +179,9 @@ class SynthRecorder {
    */
   static bool onTriggerOn(SynthVoice *voice, int offsetFrames, int id,
                           void *userData) {
-    std::chrono::high_resolution_clock::time_point now =
-        std::chrono::high_resolution_clock::now();
     SynthRecorder *rec = static_cast<SynthRecorder *>(userData);
-    if (rec->mRecording) {
-      std::unique_lock<std::mutex> lk(rec->mSequenceLock);
-      if (rec->mStartOnEvent) {
-        rec->mSequenceStart = now;
-        rec->mStartOnEvent = false;
-      }
-      std::chrono::duration<double> diff = now - rec->mSequenceStart;
-      std::vector<ParameterField> pFields = voice->getTriggerParams();
-
-      SynthEvent event;
-      event.type = SynthEventType::TRIGGER_ON;
-      event.id = voice->id();
-      event.time = diff.count();
-      event.synthName = demangle(typeid(*voice).name());
-      event.duration = -1;
-      event.pFields = pFields;
-      rec->mSequence.push_back(event);
-      if (rec->verbose()) {
-        std::cout << "trigger at " << event.time << ":" << event.synthName
-                  << ":" << voice->id() << std::endl;
-      }
+    if (rec->mRecording.load(std::memory_order_acquire)) {
+      rec->captureTriggerOn(voice);
     }
     return true;
   }
@@ -177,52 +192,76 @@ class SynthRecorder {
    * @param userData
    */
   static bool onTriggerOff(int id, void *userData) {
-    std::chrono::high_resolution_clock::time_point now =
-        std::chrono::high_resolution_clock::now();
     SynthRecorder *rec = static_cast<SynthRecorder *>(userData);
-    if (rec->mRecording) {
-      std::unique_lock<std::mutex> lk(rec->mSequenceLock);
-      //            if (rec->mStartOnEvent) {
-      //                rec->mSequenceStart = now;
-      //                rec->mStartOnEvent = false;
-      //            }
-      std::chrono::duration<double> diff = now - rec->mSequenceStart;
-
-      SynthEvent event;
-      event.type = SynthEventType::TRIGGER_OFF;
-      event.id = id;
-      event.time = diff.count();
-      //            event.synthName = demangle(typeid (*voice).name() );
-      event.duration = -1;
-      //            for (int i = 0; i < numFields; i++) {
-      //                event.pFields.push_back(pFields[i]);
-      //            }
-      rec->mSequence.push_back(event);
-      if (rec->verbose()) {
-        std::cout << "trigger OFF at " << event.time << ":" << event.synthName
-                  << ":" << id << std::endl;
-      }
+    if (rec->mRecording.load(std::memory_order_acquire)) {
+      rec->captureTriggerOff(id);
     }
     return true;
   }
 
+  /// Number of events lost during the last recording because the event log
+  /// was full
+  uint64_t droppedEvents() const { return mDroppedEvents.load(); }
+
  private:
+  // Fixed size event record written from the trigger callbacks. Fields use
+  // the same packing as SynthSequenceFile: float bits, or an offset into
+  // strings for string fields. Menu fields hold the element index and the
+  // next entry of menus, resolved to the menu text by the writer thread.
+  // Menus belong to the voice, which the PolySynth keeps until it is
+  // destroyed, so they outlive the voice being freed or reused
+  struct Record {
+    static const unsigned int MAX_FIELDS = 32;
+    static const unsigned int MAX_MENUS = 8;
+    static const unsigned int STRING_BYTES = 128;
+
+    int64_t timeNs;
+    const char *typeName;  // From typeid, demangled by the writer thread
+    int32_t id;
+    uint8_t type;
+    uint8_t numFields;
+    uint8_t fieldTypes[MAX_FIELDS];
+    uint32_t fields[MAX_FIELDS];
+    ParameterMenu *menus[MAX_MENUS];
+    char strings[STRING_BYTES];
+  };
+
+  static const size_t EVENT_LOG_SIZE = 4096;
+
+  static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::high_resolution_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void captureTriggerOn(SynthVoice *voice);
+  void captureTriggerOff(int id);
+
+  void writerThreadFunction();
+  // Move records from the event log into mSequence. Writer thread only
+  void drainEventLog();
+  void writeSequence();
+  bool writeMIDIFile(std::string fileName);
+
   std::string mDirectory;
   PolySynth *mPolySynth{nullptr};
   TextFormat mFormat;
-  bool mVerbose;
+  bool mVerbose{false};
 
   bool mOverwrite;
   std::string mSequenceName;
 
-  std::mutex mSequenceLock;
-
-  bool mRecording{false};
+  std::atomic<bool> mRecording{false};
   bool mStartOnEvent{true};
 
   al_sec mMaxRecordTime;
-  std::chrono::high_resolution_clock::time_point mSequenceStart;
-  std::vector<SynthEvent> mSequence;
+  int64_t mSequenceStartNs{0};
+  std::vector<SynthEvent> mSequence;  // Owned by the writer thread
+
+  MultiWriterRingBuffer<Record> mEventLog{EVENT_LOG_SIZE};
+  std::atomic<uint64_t> mDroppedEvents{0};
+  std::unique_ptr<std::thread> mWriterThread;
+  MIDIExportMapping mMIDIExportMapping;
 };
 
 // Implementation
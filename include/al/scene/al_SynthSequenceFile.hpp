@@ -0,0 +1,209 @@
+#ifndef AL_SYNTHSEQUENCEFILE_HPP
+#define AL_SYNTHSEQUENCEFILE_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Compiled binary format for synth sequences
+*/
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "al/ui/al_Parameter.hpp"
+
+namespace al {
+
+/**
+ * @brief Read only, memory mapped compiled synth sequence
+ * @ingroup Scene
+ *
+ * Compiled sequences (".synthSequenceBin") hold the same events as text
+ * ".synthSequence" files after offsets, tempo changes and inserted sequences
+ * have been resolved. Voice class names and string fields are interned in a
+ * string table and all fields are packed in a single 32 bit array, so a
+ * sequence can be mapped and walked without parsing or allocating.
+ *
+ * Layout (native little endian, 8 byte aligned):
+ * @code
+ * Header
+ * Event     events[numEvents]       sorted by time
+ * uint32_t  fields[numFields]       float or int32 bits, or string index
+ * uint8_t   fieldTypes[numFields]   FieldType, padded to 4 bytes
+ * uint32_t  stringOffsets[numStrings + 1]
+ * char      strings[stringDataSize] null terminated
+ * @endcode
+ *
+ * Files are written with SynthSequenceFileWriter, by
+ * SynthSequencer::compileSequence() or by SynthRecorder using the
+ * BINARY_SEQUENCE format.
+ */
+class SynthSequenceFile {
+ public:
+  enum EventType : uint8_t {
+    EVENT = 0,       ///< Event with duration ('@' in text sequences)
+    TRIGGER_ON = 1,  ///< Trigger on with id ('+')
+    TRIGGER_OFF = 2  ///< Trigger off for id ('-')
+  };
+
+  enum FieldType : uint8_t { FIELD_FLOAT = 0, FIELD_INT32 = 1, FIELD_STRING = 2 };
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numEvents;
+    uint32_t numFields;
+    uint32_t numStrings;
+    uint32_t stringDataSize;
+    uint32_t reserved;
+  };
+
+  struct Event {
+    double time;
+    double duration;  ///< -1 if undetermined
+    int32_t id;       ///< Trigger id for TRIGGER_ON and TRIGGER_OFF
+    uint32_t synthName;
+    uint32_t firstField;
+    uint16_t numFields;
+    uint8_t type;
+    uint8_t reserved;
+  };
+
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+
+  SynthSequenceFile() {}
+  SynthSequenceFile(const std::string &fileName) { open(fileName); }
+  ~SynthSequenceFile() { close(); }
+
+  SynthSequenceFile(const SynthSequenceFile &) = delete;
+  SynthSequenceFile &operator=(const SynthSequenceFile &) = delete;
+
+  /// Map file. Returns false and prints the reason if the file is not a valid
+  /// compiled sequence
+  bool open(const std::string &fileName);
+
+  void close();
+
+  bool isOpen() const { return mHeader != nullptr; }
+
+  /// Number of events
+  uint32_t size() const { return mHeader ? mHeader->numEvents : 0; }
+
+  const Event &event(uint32_t index) const { return mEvents[index]; }
+
+  /// Interned string. Returns nullptr for invalid index
+  const char *string(uint32_t index) const;
+
+  const char *synthName(const Event &event) const {
+    return string(event.synthName);
+  }
+
+  FieldType fieldType(const Event &event, unsigned int field) const {
+    return FieldType(mFieldTypes[event.firstField + field]);
+  }
+
+  /// Field value as float. Integer fields are converted
+  float fieldFloat(const Event &event, unsigned int field) const;
+
+  /// Field value as string. Returns nullptr for non string fields
+  const char *fieldString(const Event &event, unsigned int field) const;
+
+  /// Copy all fields of event
+  std::vector<ParameterField> fields(const Event &event) const;
+
+  /// Returns true if fileName has the compiled sequence extension
+  static bool isCompiledSequence(const std::string &fileName);
+
+ private:
+  const Header *mHeader{nullptr};
+  const Event *mEvents{nullptr};
+  const uint32_t *mFields{nullptr};
+  const uint8_t *mFieldTypes{nullptr};
+  const uint32_t *mStringOffsets{nullptr};
+  const char *mStrings{nullptr};
+
+  void *mMapping{nullptr};
+  size_t mMappingSize{0};
+#ifdef AL_WINDOWS
+  void *mFileHandle{nullptr};
+  void *mMappingHandle{nullptr};
+#endif
+};
+
+/**
+ * @brief Builds compiled synth sequences
+ * @ingroup Scene
+ *
+ * Events can be added in any order, they are sorted by time (keeping the
+ * order of events with equal time) when written.
+ */
+class SynthSequenceFileWriter {
+ public:
+  void addEvent(double time, double duration, const std::string &synthName,
+                const std::vector<ParameterField> &fields);
+
+  void addTriggerOn(double time, int id, const std::string &synthName,
+                    const std::vector<ParameterField> &fields);
+
+  void addTriggerOff(double time, int id);
+
+  size_t size() const { return mEvents.size(); }
+
+  void clear();
+
+  /// Write compiled sequence. Returns false on error
+  bool write(const std::string &fileName);
+
+ private:
+  uint32_t intern(const std::string &text);
+  void add(SynthSequenceFile::EventType type, double time, double duration,
+           int id, const std::string &synthName,
+           const std::vector<ParameterField> &fields);
+
+  std::vector<SynthSequenceFile::Event> mEvents;
+  std::vector<uint32_t> mFields;
+  std::vector<uint8_t> mFieldTypes;
+  std::vector<uint32_t> mStringOffsets;
+  std::string mStrings;
+  std::unordered_map<std::string, uint32_t> mStringIndex;
+};
+
+}  // namespace al
+
+#endif  // AL_SYNTHSEQUENCEFILE_HPP
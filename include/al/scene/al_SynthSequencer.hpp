@@ -47,7 +47,6 @@
 #include <atomic>
 #include <cassert>
 #include <functional>
-#include <list>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -58,6 +57,8 @@
 #include "al/io/al_AudioIOData.hpp"
 #include "al/io/al_File.hpp"
 #include "al/scene/al_PolySynth.hpp"
+#include "al/scene/al_TempoMap.hpp"
+#include "al/types/al_SingleRWRingBuffer.hpp"
 #include "al/ui/al_Parameter.hpp"
 
 //#include "Gamma/Domain.h"
@@ -78,7 +79,6 @@ class SynthSequencerEvent {
 
   double startTime{0};
   double duration{-1};
-  int offsetCounter{0};  // To offset event within audio buffer
 
   EventType type{EVENT_VOICE};
 
@@ -87,10 +87,24 @@ class SynthSequencerEvent {
     std::vector<ParameterField> pFields;
   } ParamFields;
 
-  SynthVoice *voice{nullptr};
   ParamFields fields;
   float tempo;
-  int voiceId;
+
+  /// Set preallocated voice for EVENT_VOICE events
+  void setVoice(SynthVoice *v) {
+    voice = std::make_shared<std::atomic<SynthVoice *>>(v);
+  }
+
+  /// Take the preallocated voice. Copies of an event share the voice, so only
+  /// the first call on any copy returns it, later calls return nullptr
+  SynthVoice *takeVoice() const {
+    return voice ? voice->exchange(nullptr) : nullptr;
+  }
+
+  /// Get the preallocated voice without taking it
+  SynthVoice *peekVoice() const { return voice ? voice->load() : nullptr; }
+
+  std::shared_ptr<std::atomic<SynthVoice *>> voice;
 };
 
 enum SynthEventType { TRIGGER_ON, TRIGGER_OFF, PARAMETER_CHANGE };
@@ -104,6 +118,86 @@ struct SynthEvent {
   SynthEventType type;
 };
 
+/**
+ * @brief Time sorted event array shared between an editing thread and the
+ * rendering thread
+ * @ingroup Scene
+ *
+ * Events are edited on a private copy from any non rendering thread and
+ * published with a lock-free pointer swap. The rendering thread calls
+ * acquire() once per block to pick up the latest published events and then
+ * reads them through active() with an index cursor, using seek() to find the
+ * first event at a time in O(log n). Neither acquire() nor active() lock or
+ * free memory; buffers replaced on the rendering thread are freed by the
+ * editing thread on its next publish().
+ */
+class SynthSequencerTimeline {
+ public:
+  typedef std::vector<SynthSequencerEvent> Events;
+
+  SynthSequencerTimeline() {}
+
+  ~SynthSequencerTimeline();
+
+  /**
+   * @brief Insert event after all events with the same or earlier start time
+   * @param publishNow publish the change immediately. Pass false when
+   * inserting many events and call publish() when done.
+   *
+   * While the rendering thread has not picked up the previous publication,
+   * the event is added to it instead of publishing a new copy, so building
+   * a sequence one event at a time doesn't copy it for every event.
+   */
+  void insert(const SynthSequencerEvent &event, bool publishNow = true);
+
+  /// Insert many events, keeping the order of events with the same start
+  /// time. Events are added after existing events with the same start time
+  void insert(Events events, bool publishNow = true);
+
+  /// Replace all events. Events are sorted by start time and published
+  void assign(Events events);
+
+  /// Remove all events and publish. Returns the removed events
+  Events clear();
+
+  /// Make current edits visible to the rendering thread
+  void publish();
+
+  /// Copy of the events as currently edited
+  Events events();
+
+  /// Number of events as currently edited
+  size_t size();
+
+  /// Pick up the latest published events. Call from the rendering thread
+  /// only. Returns true if the active events changed.
+  bool acquire();
+
+  /// Published events in use by the rendering thread
+  const Events &active() const { return mActive ? *mActive : mEmpty; }
+
+  /// Index of the first active event starting at or after time
+  size_t seek(double time) const;
+
+  /// Index of the first active event starting after time
+  size_t seekAfter(double time) const;
+
+ private:
+  void collectRetired();
+  // Must hold mEditLock
+  void publishLocked();
+
+  std::mutex mEditLock;
+  Events mEdit;
+  bool mUnpublished{false};  // mEdit has changes not in mPending
+
+  std::atomic<Events *> mPending{nullptr};
+  Events *mActive{nullptr};  // Owned by the rendering thread
+  const Events mEmpty;
+  // Buffers replaced on the rendering thread, freed by the editing thread
+  SingleRWRingBuffer mRetired{64 * sizeof(Events *)};
+};
+
 /**
  * @brief Event Sequencer triggering audio visual "notes"
  * @ingroup Scene
@@ -125,6 +219,10 @@ struct SynthEvent {
  * sequencer runs. TimeMasterMode::TIME_MASTER_AUDIO is more precise in time, but you might want
  * to use TIME_MASTER_GRAPHICS if your "note" produces no audio.
  *
+ * Event times are in beats. The tempo map set with setTempoMap() or
+ * setTempo() converts them to seconds, sample accurately for the audio time
+ * master. The default tempo is 60 bpm, where a beat is a second.
+ *
  * Sequences can also be read from text files with the extension
  * ".synthSequence". You need to register the voices used in the sequence
  * with the PolySynth using this->synth().registerSynthClass<MyVoice>("MyVoice")
@@ -164,6 +262,11 @@ struct SynthEvent {
  * All events following will have this offset added to their start time.
  Negative numbers are allowed.
  *
+ * Text sequences can be converted with compileSequence() to the binary
+ * ".synthSequenceBin" format (see SynthSequenceFile), which is memory mapped
+ * instead of parsed. A compiled sequence is loaded when requested by its full
+ * name, or when no text sequence with the same name exists.
+ *
  */
 
 class SynthSequencer {
@@ -172,9 +275,24 @@ class SynthSequencer {
     TimeMasterMode masterMode = TimeMasterMode::TIME_MASTER_CPU) {
     mInternalSynth = std::make_unique<PolySynth>(masterMode);
     registerSynth(*mInternalSynth.get());
+    mSoundingEvents.reserve(MAX_SOUNDING_EVENTS);
   }
 
-  SynthSequencer(PolySynth &synth) { registerSynth(synth); }
+  SynthSequencer(PolySynth &synth) {
+    registerSynth(synth);
+    mSoundingEvents.reserve(MAX_SOUNDING_EVENTS);
+  }
+
+  /// Notes the sequencer tracks at once. When more are sounding, the note
+  /// that would end first is turned off early to make room. evictedNotes()
+  /// counts these
+  static const size_t MAX_SOUNDING_EVENTS = 1024;
+
+  /// Number of notes turned off early because MAX_SOUNDING_EVENTS notes were
+  /// sounding
+  uint64_t evictedNotes() const { return mEvictedNotes; }
+
+  ~SynthSequencer();
 
   /// Insert this function within the audio callback
   void render(AudioIOData &io);
@@ -217,6 +335,12 @@ class SynthSequencer {
   void addVoiceFromNow(TSynthVoice *voice, double startTime,
                        double duration = -1);
 
+  /**
+   * Insert events into the sequencer. Cheaper than adding events one by one
+   * as the events are published to the time master once.
+   */
+  void addEvents(std::vector<SynthSequencerEvent> events);
+
   /**
    * @brief Basic audio callback for quick prototyping
    * @param io
@@ -236,7 +360,19 @@ class SynthSequencer {
   bool verbose() { return mVerbose; }
   void verbose(bool verbose) { mVerbose = verbose; }
 
-  void setTempo(float tempo) { mNormalizedTempo = tempo / 60.f; }
+  /// Replace the tempo map with a constant tempo in beats per minute
+  void setTempo(float tempo) { setTempoMap(TempoMap(tempo)); }
+
+  /**
+   * @brief Set tempo map used to convert event times in beats to seconds
+   *
+   * Can be called while playing from any thread other than the time master.
+   * Playback continues from the current beat with the new tempo map.
+   */
+  void setTempoMap(const TempoMap &tempoMap);
+
+  /// Copy of the current tempo map
+  TempoMap tempoMap();
 
   bool playSequence(std::string sequenceName, float startTime = 0.0f);
 
@@ -247,9 +383,23 @@ class SynthSequencer {
 
   std::string buildFullPath(std::string sequenceName);
 
-  std::list<SynthSequencerEvent> loadSequence(std::string sequenceName,
-                                              double timeOffset = 0,
-                                              double timeScale = 1.0);
+  /// Load events from a sequence file. Events are sorted by start time
+  std::vector<SynthSequencerEvent> loadSequence(std::string sequenceName,
+                                                double timeOffset = 0,
+                                                double timeScale = 1.0);
+
+  /**
+   * @brief Write a sequence in the compiled binary format
+   * @param sequenceName text sequence to compile
+   * @param outputName output file. If empty, the sequence is written next to
+   * the text sequence with the ".synthSequenceBin" extension
+   * @return false if the file could not be written
+   *
+   * Offsets, tempo changes and inserted sequences are resolved, so the
+   * compiled sequence loads without parsing. Voices used in the sequence
+   * must be registered, as for playSequence().
+   */
+  bool compileSequence(std::string sequenceName, std::string outputName = "");
 
   std::vector<std::string> getSequenceList();
 
@@ -288,19 +438,36 @@ class SynthSequencer {
 
   double mFps{30};  // graphics frames per second
 
-  unsigned int mNextEvent{0};
-  std::list<SynthSequencerEvent>
-      mEvents;  // List of events sorted by start time.
-  std::mutex mEventLock;
+  SynthSequencerTimeline mTimeline;
+  size_t mNextEvent{0};  // Cursor into active timeline events
+  // Voice id and end time of events triggered by the sequencer. Never grows
+  // past MAX_SOUNDING_EVENTS, so the time master doesn't allocate
+  std::vector<std::pair<int, double>> mSoundingEvents;
+  std::atomic<uint64_t> mEvictedNotes{0};
+  std::atomic<bool> mSeekRequested{false};
+  std::atomic<double> mSeekTime{0.0};
+  std::mutex mCallbackLock;  // Protects mTimeChangeCallbacks
   std::mutex mLoadingLock;
-  bool mPlaying{false};
+  std::atomic<bool> mPlaying{false};
 
   TimeMasterMode mMasterMode{TimeMasterMode::TIME_MASTER_AUDIO};
-  double mMasterTime{0.0};
+  double mMasterTime{0.0};  // Current position in beats
   double mPlaybackStartTime{0.0};
 
-  float mNormalizedTempo{1.0f};  // Linearly normalized inverted around 60 bpm
-                                 // (1.0 = 60bpm, 0.5 = 120 bpm)
+  // Master time is computed from a frame count since an anchor point, so it
+  // does not accumulate rounding errors. The anchor moves on seek and when
+  // the tempo map or frame rate change
+  int64_t mFrame{0};
+  double mFrameRate{0.0};
+  double mAnchorSeconds{0.0};
+
+  std::mutex mTempoMapLock;  // Protects mTempoMap and publishing
+  TempoMap mTempoMap;
+  std::atomic<TempoMap *> mPendingTempoMap{nullptr};
+  // Owned by the time master
+  std::unique_ptr<TempoMap> mActiveTempoMap{std::make_unique<TempoMap>()};
+  // Tempo maps replaced by the time master, freed by the editing thread
+  SingleRWRingBuffer mRetiredTempoMaps{16 * sizeof(TempoMap *)};
 
   // Time change callback
   std::vector<std::pair<std::function<void(float)>, float>>
@@ -314,10 +481,29 @@ class SynthSequencer {
   std::vector<std::function<void(std::string sequenceName)>>
       mSequenceEndCallbacks;
 
-  // CPU processing thread. Used when TIME_MASTER_CPU
+  // CPU processing thread. Used when TIME_MASTER_CPU. Only used by
+  // controlling threads, the CPU thread itself is found by mCpuThreadId
   std::shared_ptr<std::thread> mCpuThread;
-
-  void processEvents(double blockStartTime, double fps);
+  // Set by the CPU thread when it starts
+  std::atomic<std::thread::id> mCpuThreadId{std::thread::id()};
+
+  // Apply pending seek and timeline edits. Call from the time master thread
+  void syncTimeline();
+  void collectRetiredTempoMaps();
+  // Advance master time by frames at frameRate and process events
+  void advance(unsigned int frames, double frameRate);
+  // Stops and joins the CPU thread. From the CPU thread itself, only stops it
+  void stopCpuThread();
+  bool onCpuThread() { return mCpuThreadId == std::this_thread::get_id(); }
+  // Give voices allocated for events that have not been triggered back to
+  // the synth
+  void returnVoices(std::vector<SynthSequencerEvent> events);
+  // Called with mLoadingLock held
+  std::vector<SynthSequencerEvent> loadCompiledSequence(std::string fullName,
+                                                        double timeOffset,
+                                                        double timeScale);
+  void processEvents(double blockStartTime, int64_t blockStartFrame,
+                     unsigned int frames);
 };
 
 //  Implementations -------------
@@ -334,17 +520,11 @@ TSynthVoice &SynthSequencer::add(double startTime, double duration) {
 template <class TSynthVoice>
 void SynthSequencer::addVoice(TSynthVoice *voice, double startTime,
                               double duration) {
-  std::list<SynthSequencerEvent>::iterator insertedEvent;
-  std::unique_lock<std::mutex> lk(mEventLock);
-  // Insert into event list, sorted.
-  auto position = mEvents.begin();
-  while (position != mEvents.end() && position->startTime < startTime) {
-    position++;
-  }
-  insertedEvent = mEvents.insert(position, SynthSequencerEvent());
-  insertedEvent->startTime = startTime;
-  insertedEvent->duration = duration;
-  insertedEvent->voice = voice;
+  SynthSequencerEvent event;
+  event.startTime = startTime;
+  event.duration = duration;
+  event.setVoice(voice);
+  mTimeline.insert(event);
 }
 
 template <class TSynthVoice>
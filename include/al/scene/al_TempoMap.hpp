@@ -0,0 +1,172 @@
+#ifndef AL_TEMPOMAP_HPP
+#define AL_TEMPOMAP_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Tempo map with tempo ramps and time signatures for converting between
+        beats and seconds
+*/
+
+#include <cstddef>
+#include <vector>
+
+namespace al {
+
+/**
+ * @brief Tempo and meter of a piece, for converting beats to seconds and back
+ * @ingroup Scene
+ *
+ * Tempo points are given in beats (quarter notes) and beats per minute. The
+ * tempo holds until the next point, or ramps linearly (over beats) to the
+ * tempo of the next point when the point's curve is LINEAR. Without tempo
+ * points the tempo is 60 bpm, so one beat is one second.
+ *
+ * Every change recompiles a table of segments holding their start in both
+ * beats and seconds. Conversions look up the segment with a binary search and
+ * compute the position from the segment start, so results do not drift over
+ * long pieces and do not depend on the order of queries.
+ *
+ * @code
+ * TempoMap map;
+ * map.addTempo(0, 120);
+ * map.addTempo(32, 120, TempoMap::LINEAR); // Accelerate from beat 32...
+ * map.addTempo(48, 160);                   // ... reaching 160 bpm at beat 48
+ * map.addTimeSignature(0, 3, 4);
+ * double t = map.seconds(40.0);
+ * @endcode
+ */
+class TempoMap {
+ public:
+  /// How the tempo changes from a tempo point to the next
+  enum Curve { STEP, LINEAR };
+
+  struct BarPosition {
+    int bar;      ///< Bar index, starting at 0
+    double beat;  ///< Beats since the start of the bar
+  };
+
+  TempoMap(double bpm = 60.0);
+
+  /**
+   * @brief Remove all tempo points and time signatures and set a constant
+   * tempo
+   *
+   * A tempo that is not positive is replaced by 60 bpm, so the map always
+   * holds one valid tempo point.
+   */
+  void reset(double bpm = 60.0);
+
+  /**
+   * @brief Add a tempo point
+   * @param beat position of the tempo point. Replaces a point at the same beat
+   * @param bpm tempo in beats per minute. Must be positive
+   * @param curve STEP holds the tempo until the next point, LINEAR ramps to
+   * the tempo of the next point
+   */
+  void addTempo(double beat, double bpm, Curve curve = STEP);
+
+  /**
+   * @brief Add a time signature change
+   * @param beat position of the change. Should fall on a bar line of the
+   * previous time signature
+   * @param numerator beats per bar
+   * @param denominator note value of a beat (4 for quarter notes)
+   *
+   * The default time signature is 4/4.
+   */
+  void addTimeSignature(double beat, int numerator, int denominator);
+
+  /// Time in seconds at a position in beats
+  double seconds(double beat) const;
+
+  /// Position in beats at a time in seconds
+  double beats(double seconds) const;
+
+  /// Tempo in bpm at a position in beats
+  double tempo(double beat) const;
+
+  /// Bar and beat within the bar for a position in beats
+  BarPosition barPosition(double beat) const;
+
+  /// Position in beats of a bar and beat within the bar
+  double beat(int bar, double beatInBar = 0.0) const;
+
+  size_t numTempoPoints() const { return mTempoPoints.size(); }
+
+ private:
+  struct TempoPoint {
+    double beat;
+    double bpm;
+    Curve curve;
+  };
+
+  struct TimeSignature {
+    double beat;
+    int numerator;
+    int denominator;
+  };
+
+  // Compiled tempo segment. Tempo is in beats per second and changes by
+  // slope beats per second for each beat
+  struct Segment {
+    double startBeat;
+    double startSeconds;
+    double tempo;
+    double slope;
+  };
+
+  // Compiled time signature
+  struct Meter {
+    double startBeat;
+    int startBar;
+    double beatsPerBar;
+  };
+
+  void compile();
+  const Segment &segmentForBeat(double beat) const;
+  const Segment &segmentForSeconds(double seconds) const;
+  const Meter &meterForBeat(double beat) const;
+
+  std::vector<TempoPoint> mTempoPoints;
+  std::vector<TimeSignature> mTimeSignatures;
+  std::vector<Segment> mSegments;
+  std::vector<Meter> mMeters;
+};
+
+}  // namespace al
+
+#endif  // AL_TEMPOMAP_HPP
@@ -195,7 +195,10 @@ class AmbiDecode : public AmbiBase {
   /// @param[in ] enc				input Ambisonic domain buffers
   /// (non-interleaved)
   /// @param[in ] numDecFrames	number of frames in time domain buffers
-  virtual void decode(float* dec, const float* enc, int numDecFrames) const;
+  /// @param[in ] decStride		samples between time domain channels. If
+  /// less than 1, numDecFrames is used
+  virtual void decode(float* dec, const float* enc, int numDecFrames,
+                      int decStride = 0) const;
 
   float decodeWeight(int speaker, int channel) const {
     return mWeights[channel] * mDecodeMatrix[speaker * channels() + channel];
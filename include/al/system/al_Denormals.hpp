@@ -0,0 +1,117 @@
+#ifndef INCLUDE_AL_DENORMALS_HPP
+#define INCLUDE_AL_DENORMALS_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012. The Regents of the University of California. All
+   rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+        File description:
+        Control of flush to zero (FTZ) and denormals are zero (DAZ) modes
+*/
+
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define AL_DENORMALS_SSE
+#elif defined(__aarch64__)
+#define AL_DENORMALS_AARCH64
+#endif
+
+namespace al {
+
+/**
+ * @brief Scoped flush to zero / denormals are zero guard
+ * @ingroup System
+ *
+ * Sets FTZ and DAZ on the calling thread for the lifetime of the object and
+ * restores the previous floating point mode on destruction. Recursive
+ * filters (reverbs, biquads, release envelopes) decay into denormal numbers
+ * when their input goes silent, which can be many times slower to compute
+ * on x86. AudioIO installs a guard around each audio callback and
+ * DynamicScene around each block rendered by its audio worker threads.
+ */
+class ScopedDenormalFlush {
+ public:
+  ScopedDenormalFlush() : mPrevious(state()) { state(mPrevious | FLAGS); }
+  ~ScopedDenormalFlush() { state(mPrevious); }
+
+  ScopedDenormalFlush(const ScopedDenormalFlush &) = delete;
+  ScopedDenormalFlush &operator=(const ScopedDenormalFlush &) = delete;
+
+  /// Returns true if denormal flushing can be set on this platform
+  static bool supported() {
+#if defined(AL_DENORMALS_SSE) || defined(AL_DENORMALS_AARCH64)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /// Set or clear flushing of denormals on the calling thread. Returns false
+  /// if flushing is not supported
+  static bool flush(bool v) {
+    unsigned long current = state();
+    state(v ? (current | FLAGS) : (current & ~FLAGS));
+    return supported() || !v;
+  }
+
+  /// Returns true if denormals are being flushed on the calling thread
+  static bool flushing() { return supported() && (state() & FLAGS) == FLAGS; }
+
+ private:
+#if defined(AL_DENORMALS_SSE)
+  static const unsigned long FLAGS = 0x8040;  // FTZ | DAZ in MXCSR
+  static unsigned long state() { return _mm_getcsr(); }
+  static void state(unsigned long v) { _mm_setcsr((unsigned int)v); }
+#elif defined(AL_DENORMALS_AARCH64)
+  static const unsigned long FLAGS = 1ul << 24;  // FZ in FPCR
+  static unsigned long state() {
+    unsigned long fpcr;
+    asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+    return fpcr;
+  }
+  static void state(unsigned long v) { asm volatile("msr fpcr, %0" : : "r"(v)); }
+#else
+  static const unsigned long FLAGS = 0;
+  static unsigned long state() { return 0; }
+  static void state(unsigned long) {}
+#endif
+
+  unsigned long mPrevious;
+};
+
+}  // namespace al
+
+#endif  // INCLUDE_AL_DENORMALS_HPP
@@ -45,8 +45,77 @@
         Graham Wakefield, 2010, grrrwaaa@gmail.com
 */
 
+#include <vector>
+
 namespace al {
 
+/// Scheduling, affinity and floating point settings for a thread
+
+/// Settings are applied by the thread itself through applyToCurrentThread(),
+/// typically at the start of a thread function or audio callback. Real-time
+/// policies and memory locking usually need elevated privileges (e.g.
+/// rtprio and memlock limits on Linux), failures are reported and the
+/// remaining settings are still applied.
+///
+/// @ingroup System
+struct ThreadConfig {
+  /// Scheduling policy
+  enum Policy {
+    POLICY_DEFAULT, /**< Leave the scheduling policy untouched */
+    POLICY_FIFO,    /**< Real-time first in first out (SCHED_FIFO) */
+    POLICY_RR       /**< Real-time round robin (SCHED_RR) */
+  };
+
+  Policy policy{POLICY_DEFAULT};
+  int priority{0};             ///< Priority in [1, 99] for real-time policies
+  std::vector<int> cpus;       ///< CPUs the thread may run on. Empty for any
+  bool lockMemory{false};      ///< Lock process memory to avoid page faults
+  bool flushDenormals{false};  ///< Flush denormals to zero (FTZ/DAZ)
+
+  /// Configuration for a real-time audio thread
+  static ThreadConfig realtime(int priority = 80, int cpu = -1) {
+    ThreadConfig config;
+    config.policy = POLICY_FIFO;
+    config.priority = priority;
+    if (cpu >= 0) {
+      config.cpus.push_back(cpu);
+    }
+    config.flushDenormals = true;
+    return config;
+  }
+
+  /// Copy of this configuration pinned to a single CPU taken from cpus
+  /// (round robin by index). Used to spread worker threads across cores
+  ThreadConfig forWorker(unsigned int index) const {
+    ThreadConfig config = *this;
+    if (cpus.size() > 1) {
+      config.cpus = {cpus[index % cpus.size()]};
+    }
+    return config;
+  }
+
+  /// Returns true if applying this configuration would change nothing
+  bool isDefault() const {
+    return policy == POLICY_DEFAULT && cpus.empty() && !lockMemory &&
+           !flushDenormals;
+  }
+
+  /// Apply configuration to the calling thread. Returns false if any of the
+  /// settings could not be applied. Settings left at their defaults are not
+  /// touched, so applying a default configuration does not undo an earlier
+  /// real-time one: the policy, affinity and memory lock stay as they were
+  bool applyToCurrentThread() const;
+
+  /// Apply the policy, affinity and denormal settings to the calling thread,
+  /// without locking memory or printing failures. Can be called from an
+  /// audio callback. Returns false if any of them could not be applied
+  bool applyThreadSettingsToCurrentThread() const;
+
+  /// Lock the memory of the process. Faults in every mapped page, so call it
+  /// outside real-time threads
+  static bool lockProcessMemory();
+};
+
 /// Function object interface used by thread
 struct ThreadFunction {
   virtual ~ThreadFunction() {}
@@ -0,0 +1,136 @@
+#ifndef INCLUDE_AL_MULTIWRITERRINGBUFFER_HPP
+#define INCLUDE_AL_MULTIWRITERRINGBUFFER_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Bounded lock-free queue of fixed size records with any number of
+        writers and a single reader
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "al/types/al_SingleRWRingBuffer.hpp"
+
+namespace al {
+
+/**
+ * @brief Bounded lock-free queue of records for many writers and one reader
+ * @ingroup allocore
+ *
+ * All slots are allocated in the constructor, so push() and pop() never
+ * allocate, lock or block. push() can be called from any number of threads
+ * (including the audio thread) and fails when the queue is full. pop() must
+ * only be called from a single thread.
+ *
+ * T must be default constructible and copy assignable. Records are copied
+ * in and out, so keep them small and trivially copyable.
+ */
+template <class T>
+class MultiWriterRingBuffer {
+ public:
+  /// Allocate queue. Capacity is rounded up to the next power of 2
+  MultiWriterRingBuffer(size_t capacity = 256)
+      : mCapacity(next_power_of_two(uint32_t(capacity < 2 ? 2 : capacity))),
+        mMask(mCapacity - 1),
+        mSlots(new Slot[mCapacity]) {
+    for (size_t i = 0; i < mCapacity; i++) {
+      mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MultiWriterRingBuffer(const MultiWriterRingBuffer &) = delete;
+  MultiWriterRingBuffer &operator=(const MultiWriterRingBuffer &) = delete;
+
+  /// Copy value into the queue. Returns false if the queue is full
+  bool push(const T &value) {
+    size_t position = mWrite.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &mSlots[position & mMask];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t difference = intptr_t(sequence) - intptr_t(position);
+      if (difference == 0) {
+        // Slot is free for this position, claim it
+        if (mWrite.compare_exchange_weak(position, position + 1,
+                                         std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;  // Reader has not consumed this slot yet
+      } else {
+        position = mWrite.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = value;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Copy the oldest record into value. Returns false if the queue is empty.
+  /// Call from the reader thread only
+  bool pop(T &value) {
+    Slot &slot = mSlots[mRead & mMask];
+    if (slot.sequence.load(std::memory_order_acquire) != mRead + 1) {
+      return false;  // Empty, or the writer is still copying
+    }
+    value = slot.value;
+    slot.sequence.store(mRead + mCapacity, std::memory_order_release);
+    mRead++;
+    return true;
+  }
+
+  size_t capacity() const { return mCapacity; }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  const size_t mCapacity;
+  const size_t mMask;
+  std::unique_ptr<Slot[]> mSlots;
+  std::atomic<size_t> mWrite{0};
+  size_t mRead{0};  // Owned by the reader
+};
+
+}  // namespace al
+
+#endif  // INCLUDE_AL_MULTIWRITERRINGBUFFER_HPP
@@ -45,6 +45,7 @@
 */
 
 #include <inttypes.h>
+#include <atomic>
 #include <cstring>
 
 //#include "allocore/system/pstdint.h"
@@ -92,11 +93,13 @@ class SingleRWRingBuffer {
 
   /** Clear any data in the ringbuffer
    */
-  void clear() { mRead = mWrite; }
+  void clear() { mRead.store(mWrite.load(std::memory_order_acquire)); }
 
  protected:
   size_t mSize, mWrap;
-  size_t mRead, mWrite;
+  // Each index is written by one side only. Acquire and release order the
+  // data copies with the index updates
+  std::atomic<size_t> mRead, mWrite;
   char* mData;
 };
 
@@ -121,15 +124,15 @@ inline SingleRWRingBuffer ::SingleRWRingBuffer(size_t sz)
 inline SingleRWRingBuffer ::~SingleRWRingBuffer() { delete[] mData; }
 
 inline size_t SingleRWRingBuffer ::writeSpace() const {
-  const size_t r = mRead;
-  const size_t w = mWrite;
+  const size_t r = mRead.load(std::memory_order_acquire);
+  const size_t w = mWrite.load(std::memory_order_relaxed);
   if (r == w) return mWrap;
   return ((mSize + (r - w)) & mWrap) - 1;
 }
 
 inline size_t SingleRWRingBuffer ::readSpace() const {
-  const size_t r = mRead;
-  const size_t w = mWrite;
+  const size_t r = mRead.load(std::memory_order_relaxed);
+  const size_t w = mWrite.load(std::memory_order_acquire);
   return (mSize + (w - r)) & mWrap;
 }
 
@@ -138,7 +141,7 @@ inline size_t SingleRWRingBuffer ::write(const char* src, size_t sz) {
   sz = sz > space ? space : sz;
   if (sz == 0) return 0;
 
-  size_t w = mWrite;
+  size_t w = mWrite.load(std::memory_order_relaxed);
   size_t end = w + sz;
 
   if (end < mSize) {
@@ -150,7 +153,7 @@ inline size_t SingleRWRingBuffer ::write(const char* src, size_t sz) {
     memcpy(mData, src + split, end);
   }
 
-  mWrite = end;
+  mWrite.store(end, std::memory_order_release);
   return sz;
 }
 
@@ -159,7 +162,7 @@ inline size_t SingleRWRingBuffer ::read(char* dst, size_t sz) {
   sz = sz > space ? space : sz;
   if (sz == 0) return 0;
 
-  size_t r = mRead;
+  size_t r = mRead.load(std::memory_order_relaxed);
   size_t end = r + sz;
 
   if (end < mSize) {
@@ -171,7 +174,7 @@ inline size_t SingleRWRingBuffer ::read(char* dst, size_t sz) {
     memcpy(dst + split, mData, end);
   }
 
-  mRead = end;
+  mRead.store(end, std::memory_order_release);
   return sz;
 }
 
@@ -180,7 +183,7 @@ inline size_t SingleRWRingBuffer ::peek(char* dst, size_t sz) {
   sz = sz > space ? space : sz;
   if (sz == 0) return 0;
 
-  size_t r = mRead;
+  size_t r = mRead.load(std::memory_order_relaxed);
   size_t end = r + sz;
 
   if (end < mSize) {
@@ -0,0 +1,110 @@
+#ifndef AL_COMMANDQUEUE_HPP
+#define AL_COMMANDQUEUE_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Runs commands received by control servers on a worker thread
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace al {
+
+/**
+ * @brief Queue of commands run in order on a worker thread
+ * @ingroup UI
+ *
+ * Lets a network server return to its socket while slow commands, like
+ * preset recalls that read files, run on the worker thread. The thread is
+ * started by the first push().
+ *
+ * A command pushed with a key replaces the command waiting at the end of the
+ * queue if it has the same key, so only the last of a burst of equivalent
+ * requests runs. Commands with an empty key are never replaced.
+ */
+class CommandQueue {
+ public:
+  CommandQueue() {}
+  /// Waits for the running command. Waiting commands are dropped
+  ~CommandQueue();
+
+  void push(std::function<void()> command, const std::string &key = "");
+
+  /// Block until every command pushed has run. Don't call from a command
+  void waitForCommands();
+
+  /// Number of commands waiting, not counting the one running
+  size_t depth();
+  /// Largest depth since the last resetCounters()
+  size_t maxDepth() { return mMaxDepth; }
+  /// Number of commands run
+  uint64_t processed() { return mProcessed; }
+  /// Number of commands replaced by a later one before running
+  uint64_t coalesced() { return mCoalesced; }
+  void resetCounters();
+
+ private:
+  struct Command {
+    std::function<void()> function;
+    std::string key;
+  };
+
+  void run();
+
+  std::mutex mLock;
+  std::condition_variable mCondition;      // Signals the worker thread
+  std::condition_variable mIdleCondition;  // Signals waitForCommands()
+  std::deque<Command> mCommands;
+  bool mBusy{false};
+  bool mRunning{false};
+  std::unique_ptr<std::thread> mThread;
+
+  std::atomic<size_t> mMaxDepth{0};
+  std::atomic<uint64_t> mProcessed{0};
+  std::atomic<uint64_t> mCoalesced{0};
+};
+
+}  // namespace al
+
+#endif  // AL_COMMANDQUEUE_HPP
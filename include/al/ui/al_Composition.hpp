@@ -43,6 +43,10 @@
         Andrés Cabrera mantaraya36@gmail.com
 */
 
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -112,6 +116,17 @@ class Composition : public osc::MessageConsumer {
     return registerSequencer(sequencer);
   }
 
+  /**
+   * @brief Set how many upcoming sequences are loaded ahead of time
+   * @param count number of sequences. 0 loads each sequence when its step
+   * starts waiting.
+   *
+   * During playback, sequences and their presets are loaded and compiled on a
+   * background thread while earlier steps play, so starting each sequence
+   * does not read any files. Takes effect on the next call to play().
+   */
+  void setPreloadCount(size_t count) { mPreloadCount = count; }
+
  protected:
   virtual bool consumeMessage(osc::Message &m,
                               std::string rootOSCPath) override;
@@ -123,7 +138,7 @@ class Composition : public osc::MessageConsumer {
   std::string mCompositionName;
 
   std::thread *mPlayThread;
-  bool mPlaying;
+  bool mPlaying{false};
   PresetSequencer *mSequencer;
   std::mutex mPlayerLock;
   std::mutex mPlayWaitLock;
@@ -131,15 +146,32 @@ class Composition : public osc::MessageConsumer {
 
   // This interface is shared with PresetSequencer, perhaps this should be
   // abstracted?
-  bool mBeginCallbackEnabled;
+  bool mBeginCallbackEnabled{false};
   std::function<void(Composition *, void *userData)> mBeginCallback;
   void *mBeginCallbackData;
-  bool mEndCallbackEnabled;
+  bool mEndCallbackEnabled{false};
   std::function<void(bool, Composition *, void *userData)> mEndCallback;
   void *mEndCallbackData;
 
   std::function<void(bool, PresetSequencer *)> mSequencerEndCallbackCache;
 
+  // Preloading of upcoming sequences, protected by mPreloadLock
+  size_t mPreloadCount{2};
+  std::unique_ptr<std::thread> mPreloadThread;
+  std::mutex mPreloadLock;
+  std::condition_variable mPreloadCondition;
+  bool mPreloading{false};
+  std::vector<std::string> mPreloadNames;  // Sequence name for each step
+  size_t mPreloadNext{0};                  // Next step to preload
+  int64_t mPreloadCurrent{-1};             // Step being preloaded
+  size_t mPlayIndex{0};                    // Next step to play
+  std::map<size_t, PresetSequencer::PreparedSequence> mPreloaded;
+
+  void startPreloading();
+  void stopPreloading();
+  PresetSequencer::PreparedSequence takePreloaded(size_t index);
+  static void preloadThread(Composition *composition);
+
   std::vector<CompositionStep> loadCompositionSteps(
       std::string compositionSteps);
   std::string getRootPath();
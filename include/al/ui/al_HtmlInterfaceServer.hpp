@@ -46,6 +46,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #ifndef AL_WINDOWS
@@ -61,6 +62,7 @@
 #endif
 
 #include "al/ui/al_Parameter.hpp"
+#include "al/ui/al_ParameterServer.hpp"
 #include "al/ui/al_PresetHandler.hpp"
 #include "al/ui/al_PresetServer.hpp"
 
@@ -78,6 +80,18 @@ namespace al {
  * the registered parameters. Because it uses Parameter obejcts, the HTML
  * GUI can be kept in sync with other control interfaces like ParameterGUI
  * and other devices that set the parameters via OSC.
+ *
+ * The class can also serve the interface itself, without interface.js or
+ * node.js. Construct it with autorun set to false, call startWebServer() and
+ * open http://host:port/ in a browser. The page receives the parameters
+ * through a WebSocket. Values that changed are pushed to the page at
+ * setPushRate(), batched into one JSON or binary message per frame. Controls
+ * moved in the page are sent back through the WebSocket and dispatched by
+ * the ParameterServer the parameter was added with, like OSC messages to
+ * that server.
+ *
+ * Parameters added to the built-in server get change callbacks that can't be
+ * removed, so the HtmlInterfaceServer must be destroyed after them.
 
  * @ingroup UI
  */
@@ -107,13 +121,59 @@ class HtmlInterfaceServer {
   void runInterfaceJs();  // Runs interface.js. Call only if autorun set to
                           // false in the constructor
 
+  /// Format of the value updates pushed by the built-in web server
+  enum PushFormat {
+    PUSH_JSON,   ///< One JSON text message per frame
+    PUSH_BINARY  ///< One binary message per frame. Strings are sent as JSON
+  };
+
+  /**
+   * @brief Serve the HTML interface and WebSocket updates
+   * @param port TCP port. 0 picks a free port, see webServerPort()
+   * @param address Address to listen on. Only this machine can connect to
+   * the default. Use "0.0.0.0" to serve other machines
+   * @return true if the server is listening
+   *
+   * WebSocket connections are refused from pages served by other hosts.
+   * Requests are refused unless their Host header is an IP address,
+   * localhost or a name added with addAllowedHost(), so another site can't
+   * reach the server by pointing its own domain name at this machine.
+   */
+  bool startWebServer(uint16_t port = 8080, std::string address = "127.0.0.1");
+
+  void stopWebServer();
+
+  /// Port the built-in web server listens on, or 0 if it is not running
+  uint16_t webServerPort();
+
+  /// Number of browsers connected to the built-in web server
+  size_t webClientCount();
+
+  /**
+   * @brief Set how often value changes are pushed to the browsers
+   *
+   * Defaults to 30 frames per second. Each frame carries the latest value
+   * of every parameter that changed since the previous one.
+   */
+  void setPushRate(float framesPerSecond);
+
+  void setPushFormat(PushFormat format);
+
+  /// Accept requests that name this machine as host, like "studio.local",
+  /// in the built-in web server
+  void addAllowedHost(std::string host);
+
  private:
+  class WebServer;
+
   void writeHtmlFile(std::vector<Parameter *> parameters,
                      std::string interfaceName = "");
   void writeHtmlFile(PresetServer &presetServer, std::string interfaceName = "",
                      int numPresets = -1);
+  bool canWriteHtmlFile();
 
   std::string mRootPath;
+  bool mAutorun;
   std::string mNodeJsPath;
 #ifndef AL_WINDOWS
   pid_t mPid;
@@ -126,6 +186,8 @@ class HtmlInterfaceServer {
   int mInterfaceRecvPort;  // Interface.js receives OSC on this port
 
   std::vector<Parameter *> mParameters;
+
+  std::unique_ptr<WebServer> mWebServer;
 };
 
 }  // namespace al
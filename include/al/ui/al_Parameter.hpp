@@ -47,6 +47,8 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -54,6 +56,7 @@
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "al/math/al_Vec.hpp"
@@ -173,10 +176,10 @@ class ParameterField {
     std::swap(lhs.mType, rhs.mType);
   }
 
-  ParameterDataType type() { return mType; }
+  ParameterDataType type() const { return mType; }
 
   template <typename type>
-  type get() {
+  type get() const {
     return *static_cast<type *>(mData);
   }
 
@@ -264,7 +267,7 @@ class ParameterMeta {
    * The parameter needs to be registered to a ParameterServer to listen to
    * OSC values on this address
    */
-  std::string getFullAddress() { return mFullAddress; }
+  const std::string &getFullAddress() const { return mFullAddress; }
 
   /**
    * @brief getName returns the name of the parameter
@@ -342,6 +345,23 @@ class ParameterMeta {
               << typeid(*this).name() << std::endl;
   }
 
+  /**
+   * @brief Determines whether value change callbacks are called synchronously
+   *
+   * Implemented by ParameterWrapper. When false, set() only stores the value
+   * and marks the parameter as changed, and processChange() runs the
+   * callbacks. ParameterScheduler does this for groups of parameters.
+   */
+  virtual void setSynchronousCallbacks(bool synchronous = true) {
+    (void)synchronous;
+  }
+
+  /// true if the value changed since the last processChange()
+  virtual bool hasChange() { return false; }
+
+  /// Call the change callbacks once if the value changed
+  virtual void processChange() {}
+
   void set(ParameterMeta *p);
 
  protected:
@@ -354,6 +374,146 @@ class ParameterMeta {
   std::map<std::string, float> mHints;  // Provide hints for behavior
 };
 
+/**
+ * @brief Marks types whose value is fully copied by copying their bytes
+ *
+ * ParameterValue keeps these types in a seqlock. Trivially copyable types are
+ * included by default, specialize for other plain data types.
+ */
+template <class T>
+struct IsParameterPlainData : std::is_trivially_copyable<T> {};
+template <>
+struct IsParameterPlainData<Vec3f> : std::true_type {};
+template <>
+struct IsParameterPlainData<Vec4f> : std::true_type {};
+template <>
+struct IsParameterPlainData<Pose> : std::true_type {};
+
+/**
+ * @brief Storage for the value of a ParameterWrapper
+ * @ingroup UI
+ *
+ * Arithmetic types are held in a std::atomic and plain data types (see
+ * IsParameterPlainData) in a seqlock, so reading them never takes a lock and
+ * can be done from the audio and graphics threads while network and GUI
+ * threads write.
+ *
+ * Other types like std::string are kept as immutable snapshots that are
+ * swapped on write with std::atomic_load() and std::atomic_store() on a
+ * std::shared_ptr. Standard libraries implement these with a pool of
+ * mutexes that are held only while the pointer is copied, never while a
+ * value is copied or allocated, and each load() also copies the value. Use
+ * snapshot() to avoid the copy.
+ */
+template <class T, class Enable = void>
+class ParameterValue {
+ public:
+  ParameterValue(const T &value = T())
+      : mValue(std::make_shared<const T>(value)) {}
+  ParameterValue(const ParameterValue &other)
+      : mValue(std::atomic_load(&other.mValue)) {}
+
+  ParameterValue &operator=(const ParameterValue &other) {
+    std::atomic_store(&mValue, std::atomic_load(&other.mValue));
+    return *this;
+  }
+
+  T load() const { return *std::atomic_load(&mValue); }
+
+  /// Current value without copying it
+  std::shared_ptr<const T> snapshot() const {
+    return std::atomic_load(&mValue);
+  }
+
+  void store(const T &value) {
+    std::atomic_store(&mValue, std::make_shared<const T>(value));
+  }
+
+ private:
+  std::shared_ptr<const T> mValue;
+};
+
+template <class T>
+class ParameterValue<
+    T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+ public:
+  ParameterValue(const T &value = T()) : mValue(value) {}
+  ParameterValue(const ParameterValue &other) : mValue(other.load()) {}
+
+  ParameterValue &operator=(const ParameterValue &other) {
+    store(other.load());
+    return *this;
+  }
+
+  T load() const { return mValue.load(std::memory_order_acquire); }
+
+  void store(const T &value) { mValue.store(value, std::memory_order_release); }
+
+ private:
+  std::atomic<T> mValue;
+};
+
+template <class T>
+class ParameterValue<T, typename std::enable_if<
+                            !std::is_arithmetic<T>::value &&
+                            IsParameterPlainData<T>::value>::type> {
+ public:
+  ParameterValue(const T &value = T()) { storeWords(value); }
+  ParameterValue(const ParameterValue &other) { storeWords(other.load()); }
+
+  ParameterValue &operator=(const ParameterValue &other) {
+    store(other.load());
+    return *this;
+  }
+
+  T load() const {
+    uint64_t words[WORDS];
+    uint32_t sequence;
+    do {
+      sequence = mSequence.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORDS; i++) {
+        words[i] = mWords[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Retry if a write was in progress or happened while copying
+    } while ((sequence & 1) != 0 ||
+             sequence != mSequence.load(std::memory_order_relaxed));
+    T value;
+    std::memcpy(static_cast<void *>(&value), words, sizeof(T));
+    return value;
+  }
+
+  void store(const T &value) {
+    // Writers exclude each other by moving the sequence from even to odd
+    uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    do {
+      while ((sequence & 1) != 0) {
+        sequence = mSequence.load(std::memory_order_relaxed);
+      }
+    } while (!mSequence.compare_exchange_weak(sequence, sequence + 1,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_release);
+    storeWords(value);
+    mSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+ private:
+  static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) /
+                              sizeof(uint64_t);
+
+  void storeWords(const T &value) {
+    uint64_t words[WORDS] = {};
+    std::memcpy(words, static_cast<const void *>(&value), sizeof(T));
+    for (size_t i = 0; i < WORDS; i++) {
+      mWords[i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint32_t> mSequence{0};
+  std::atomic<uint64_t> mWords[WORDS];
+};
+
 /**
  * @brief The ParameterWrapper class provides a generic thread safe Parameter
  * class from the ParameterType template parameter
@@ -373,10 +533,8 @@ class ParameterWrapper : public ParameterMeta {
    * @param min Minimum value for the parameter
    * @param max Maximum value for the parameter
    *
-   * The mechanism used to protect data is locking a mutex within the set()
-   * function and doing try_lock() on the mutex to update a cached value in the
-   * get() function. In the worst case this might incur some jitter when reading
-   * the value.
+   * The value is held in a ParameterValue, so get() never waits for a set()
+   * to finish copying the value and set() never waits for readers.
    */
   ParameterWrapper(std::string parameterName, std::string group = "",
                    ParameterType defaultValue = ParameterType(),
@@ -394,8 +552,8 @@ class ParameterWrapper : public ParameterMeta {
    * @brief set the parameter's value
    *
    * This function is thread-safe and can be called from any number of threads.
-   * It blocks to lock a mutex so its use in critical contexts should be
-   * avoided.
+   * Callbacks are called from the calling thread, so its use in critical
+   * contexts should be avoided.
    */
   virtual void set(ParameterType value) {
     //        if (value > mMax) value = mMax;
@@ -403,18 +561,14 @@ class ParameterWrapper : public ParameterMeta {
     if (mProcessCallback) {
       value = (*mProcessCallback)(value);  //, mProcessUdata);
     }
-    for (auto cb : mCallbacks) {
-      (*cb)(value);
-    }
-    setLocking(value);
+    setAndRunCallbacks(value);
   }
 
   /**
    * @brief set the parameter's value without calling callbacks
    *
    * This function is thread-safe and can be called from any number of threads.
-   * It blocks to lock a mutex so its use in critical contexts should be
-   * avoided. The processing callback is called, but the callbacks registered
+   * The processing callback is called, but the callbacks registered
    * with registerChangeCallback() are not called. This is useful to avoid
    * infinite recursion when a widget sets the parameter that then sets the
    * widget.
@@ -427,26 +581,24 @@ class ParameterWrapper : public ParameterMeta {
     }
 
     if (blockReceiver) {
-      for (auto cb : mCallbacks) {
-        (*cb)(value);
-      }
+      setAndRunCallbacks(value);
+    } else {
+      setLocking(value);
     }
-    setLocking(value);
   }
 
   /**
-   * @brief set the parameter's value forcing a lock
+   * @brief store the parameter's value without processing or callbacks
+   *
+   * The name is kept for compatibility, storing the value does not lock.
    */
-  inline void setLocking(ParameterType value) {
-    mMutex->lock();
-    mValue = value;
-    mMutex->unlock();
-  }
+  inline void setLocking(ParameterType value) { mValue.store(value); }
 
   /**
    * @brief get the parameter's value
    *
-   * This function is thread-safe and can be called from any number of threads
+   * This function is thread-safe and can be called from any number of threads.
+   * It does not lock.
    *
    * @return the parameter value
    */
@@ -516,39 +668,27 @@ class ParameterWrapper : public ParameterMeta {
    * triggers a change in the opengl state. This will cause a crash as the
    * opengl functions need to be called from the opengl context instead of from
    * a thread in the network context. By setting this to false and then calling
-   * runChangeCallbacks within the opengl thread will call the callbacks
+   * processChange() within the opengl thread will call the callbacks
    * whenever the value has changed, but at the right time, in the right
-   * context.
+   * context. Callbacks run once per processChange() with the latest value, no
+   * matter how many times the value was set.
    */
-  void setSynchronousCallbacks(bool synchronous = true) {
+  void setSynchronousCallbacks(bool synchronous = true) override {
     mSynchronous = synchronous;
-    if (mCallbacks.size() > 0 && mCallbacks[0] == mAsyncCallback) {
-      if (synchronous) {
-        mCallbacks.erase(mCallbacks.begin());
-      } else {
-        std::cout << "WARNING: setSynchronousCallbacks() already set to false"
-                  << std::endl;
-      }
-    } else {
-      if (!synchronous) {
-        mCallbacks.insert(mCallbacks.begin(), mAsyncCallback);
-      }
-    }
   }
 
-  bool hasChange() { return mChanged; }
+  bool hasChange() override {
+    return mChanged.load(std::memory_order_acquire);
+  }
 
   /**
    * @brief call change callbacks if value has changed since last call
    */
-  void processChange() {
-    if (mChanged && mCallbacks.size() > 0 && mCallbacks[0] == mAsyncCallback) {
-      auto callbackIt = mCallbacks.begin() + 1;
+  void processChange() override {
+    if (mChanged.exchange(false, std::memory_order_acq_rel)) {
       ParameterType value = get();
-      mChanged = false;
-      while (callbackIt != mCallbacks.end()) {
-        (*(*callbackIt))(value);
-        callbackIt++;
+      for (auto &cb : mCallbacks) {
+        (*cb)(value);
       }
     }
   }
@@ -579,21 +719,32 @@ class ParameterWrapper : public ParameterMeta {
   ParameterType mMin;
   ParameterType mMax;
 
+  const ParameterValue<ParameterType> &storage() const { return mValue; }
+
   void runChangeCallbacksSynchronous(ParameterType &value);
 
+  // Runs the change callbacks and stores the value. With asynchronous
+  // callbacks the value is stored before the parameter is marked as changed,
+  // so processChange() never misses it
+  void setAndRunCallbacks(ParameterType &value) {
+    if (mSynchronous.load(std::memory_order_relaxed)) {
+      runChangeCallbacksSynchronous(value);
+      setLocking(value);
+    } else {
+      setLocking(value);
+      mChanged.store(true, std::memory_order_release);
+    }
+  }
+
   std::shared_ptr<ParameterProcessCallback> mProcessCallback;
   // void * mProcessUdata;
   // std::vector<void *> mCallbackUdata;
 
  private:
-  // pointer to avoid having to explicitly declare copy/move
-  std::mutex *mMutex;
-  ParameterType mValue;
-  ParameterType mValueCache;
+  ParameterValue<ParameterType> mValue;
 
-  bool mSynchronous{true};
-  std::shared_ptr<ParameterChangeCallback> mAsyncCallback;
-  bool mChanged{false};
+  std::atomic<bool> mSynchronous{true};
+  std::atomic<bool> mChanged{false};
 
  private:
   std::vector<std::shared_ptr<ParameterChangeCallback>> mCallbacks;
@@ -645,8 +796,7 @@ class Parameter : public ParameterWrapper<float> {
    * @param max Maximum value for the parameter
    *
    * This Parameter class is designed for parameters that can be expressed as a
-   * single float. It realies on float being atomic on the platform so there
-   * is no locking. This is a safe assumption for most platforms today.
+   * single float. The value is a std::atomic<float> so there is no locking.
    */
   Parameter(std::string parameterName, std::string Group,
             float defaultValue = 0, std::string prefix = "",
@@ -655,15 +805,13 @@ class Parameter : public ParameterWrapper<float> {
   Parameter(std::string parameterName, float defaultValue = 0,
             float min = -99999.0, float max = 99999.0);
 
-  Parameter(const al::Parameter &param) : ParameterWrapper<float>(param) {
-    mFloatValue = param.mFloatValue;
-  }
+  Parameter(const al::Parameter &param) : ParameterWrapper<float>(param) {}
 
   /**
    * @brief set the parameter's value
    *
    * This function is thread-safe and can be called from any number of threads
-   * It does not block and relies on the atomicity of float.
+   * It does not block.
    */
   virtual void set(float value) override;
 
@@ -686,7 +834,7 @@ class Parameter : public ParameterWrapper<float> {
    */
   virtual float get() override;
 
-  virtual float toFloat() override { return mFloatValue; }
+  virtual float toFloat() override { return get(); }
 
   virtual void fromFloat(float value) override { set(value); }
 
@@ -713,9 +861,6 @@ class Parameter : public ParameterWrapper<float> {
   virtual void sendValue(osc::Send &sender, std::string prefix = "") override {
     sender.send(prefix + getFullAddress(), get());
   }
-
- private:
-  float mFloatValue;
 };
 
 /// ParamaterInt
@@ -734,24 +879,21 @@ class ParameterInt : public ParameterWrapper<int32_t> {
    * @param max Maximum value for the parameter
    *
    * This Parameter class is designed for parameters that can be expressed as a
-   * single 32 bit integer number. It realies on float being atomic on the
-   * platform so there is no locking. This is a safe assumption for most
-   * desktop platforms today.
+   * single 32 bit integer number. The value is a std::atomic<int32_t> so there
+   * is no locking.
    */
   ParameterInt(std::string parameterName, std::string Group = "",
                int32_t defaultValue = 0, std::string prefix = "",
                int32_t min = 0, int32_t max = 127);
 
   ParameterInt(const al::ParameterInt &param)
-      : ParameterWrapper<int32_t>(param) {
-    mIntValue = param.mIntValue;
-  }
+      : ParameterWrapper<int32_t>(param) {}
 
   /**
    * @brief set the parameter's value
    *
    * This function is thread-safe and can be called from any number of threads
-   * It does not block and relies on the atomicity of float.
+   * It does not block.
    */
   virtual void set(int32_t value) override;
 
@@ -774,7 +916,7 @@ class ParameterInt : public ParameterWrapper<int32_t> {
    */
   virtual int32_t get() override;
 
-  virtual float toFloat() override { return float(mIntValue); }
+  virtual float toFloat() override { return float(get()); }
 
   virtual void fromFloat(float value) override { set(int32_t(value)); }
 
@@ -799,9 +941,6 @@ class ParameterInt : public ParameterWrapper<int32_t> {
                 << std::endl;
     }
   }
-
- private:
-  int32_t mIntValue;
 };
 
 /// ParamaterBool
@@ -822,8 +961,7 @@ class ParameterBool : public Parameter {
    * @param max Value when on/true
    *
    * This ParameterBool class is designed for boolean parameters that have
-   * float values for on or off states. It relies on floats being atomic on
-   * the platform.
+   * float values for on or off states.
    */
   ParameterBool(std::string parameterName, std::string Group = "",
                 float defaultValue = 0, std::string prefix = "", float min = 0,
@@ -871,10 +1009,10 @@ class Trigger : public ParameterWrapper<bool> {
   void trigger() { set(true); }
 };
 
-// These three types are blocking, should not be used in time-critical contexts
-// like the audio callback. The classes were explicitly defined to overcome
-// the issues related to the > and < operators needed when validating minumum
-// and maximum values for the parameter
+// Setting a ParameterString allocates, so it should not be done in
+// time-critical contexts like the audio callback. The classes were explicitly
+// defined to overcome the issues related to the > and < operators needed when
+// validating minumum and maximum values for the parameter
 
 /// ParameterString
 /// @ingroup UI
@@ -900,6 +1038,23 @@ class ParameterString : public ParameterWrapper<std::string> {
 
   virtual void fromFloat(float value) override { set(std::to_string(value)); }
 
+  /**
+   * @brief Copy the value into buffer without allocating
+   * @return number of characters copied
+   *
+   * Copies at most size - 1 characters and null terminates buffer.
+   */
+  size_t copyTo(char *buffer, size_t size) const {
+    if (size == 0) {
+      return 0;
+    }
+    std::shared_ptr<const std::string> value = storage().snapshot();
+    size_t length = std::min(value->size(), size - 1);
+    std::memcpy(buffer, value->data(), length);
+    buffer[length] = '\0';
+    return length;
+  }
+
   virtual void sendValue(osc::Send &sender, std::string prefix = "") override {
     sender.send(prefix + getFullAddress(), get());
   }
@@ -1292,23 +1447,16 @@ class ParameterColor : public ParameterWrapper<al::Color> {
 // Implementations -----------------------------------------------------------
 
 template <class ParameterType>
-ParameterWrapper<ParameterType>::~ParameterWrapper() {
-  delete mMutex;
-}
+ParameterWrapper<ParameterType>::~ParameterWrapper() {}
 
 template <class ParameterType>
 ParameterWrapper<ParameterType>::ParameterWrapper(std::string parameterName,
                                                   std::string group,
                                                   ParameterType defaultValue,
                                                   std::string prefix)
-    : ParameterMeta(parameterName, group, prefix), mProcessCallback(nullptr) {
-  mValue = defaultValue;
-  mValueCache = defaultValue;
-  mMutex = new std::mutex;
-  std::shared_ptr<ParameterChangeCallback> mAsyncCallback =
-      std::make_shared<ParameterChangeCallback>(
-          [&](ParameterType value) { mChanged = true; });
-}
+    : ParameterMeta(parameterName, group, prefix),
+      mProcessCallback(nullptr),
+      mValue(defaultValue) {}
 
 template <class ParameterType>
 ParameterWrapper<ParameterType>::ParameterWrapper(
@@ -1318,29 +1466,25 @@ ParameterWrapper<ParameterType>::ParameterWrapper(
                                                         defaultValue, prefix) {
   mMin = min;
   mMax = max;
-  mMutex = new std::mutex;
 }
 
 template <class ParameterType>
 ParameterWrapper<ParameterType>::ParameterWrapper(
     const ParameterWrapper<ParameterType> &param)
-    : ParameterMeta(param.mParameterName, param.mGroup, param.mPrefix) {
+    : ParameterMeta(param.mParameterName, param.mGroup, param.mPrefix),
+      mValue(param.mValue) {
   mMin = param.mMin;
   mMax = param.mMax;
   mProcessCallback = param.mProcessCallback;
   // mProcessUdata = param.mProcessUdata;
   mCallbacks = param.mCallbacks;
-  mMutex = new std::mutex;
   // mCallbackUdata = param.mCallbackUdata;
+  mSynchronous = param.mSynchronous.load();
 }
 
 template <class ParameterType>
 ParameterType ParameterWrapper<ParameterType>::get() {
-  if (mMutex->try_lock()) {
-    mValueCache = mValue;
-    mMutex->unlock();
-  }
-  return mValueCache;
+  return mValue.load();
 }
 
 template <class ParameterType>
@@ -1360,15 +1504,8 @@ void ParameterWrapper<ParameterType>::registerChangeCallback(
 template <class ParameterType>
 void ParameterWrapper<ParameterType>::runChangeCallbacksSynchronous(
     ParameterType &value) {
-  for (auto cb : mCallbacks) {
-    if (cb == mAsyncCallback) {
-      // Async callback is just a marker and should be the first callback
-      // in the vector
-      mChanged = true;
-      return;
-    } else {
-      (*cb)(value);
-    }
+  for (auto &cb : mCallbacks) {
+    (*cb)(value);
   }
 }
 
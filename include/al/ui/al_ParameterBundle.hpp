@@ -42,6 +42,8 @@
         Andrés Cabrera mantaraya36@gmail.com
 */
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -98,7 +100,10 @@ class ParameterBundle {
    * Note this function is not thread safe, so it must be called in the same
    * conetext where the bundle is processed.
    */
-  void clear() { mParameters.clear(); }
+  void clear() {
+    mParameters.clear();
+    mStructureVersion++;
+  }
 
   std::vector<ParameterMeta *> &parameters() { return mParameters; }
 
@@ -111,8 +116,17 @@ class ParameterBundle {
 
   void addNotifier(OSCNotifier *notifier);
 
+  /**
+   * @brief counter incremented whenever parameters or sub-bundles are added to
+   * or removed from any bundle, or a bundle is renamed
+   *
+   * Used by ParameterServer to know when its address index is out of date.
+   */
+  static uint64_t structureVersion() { return mStructureVersion; }
+
  private:
   static std::map<std::string, int> mBundleCounter;
+  static std::atomic<uint64_t> mStructureVersion;
   int mBundleIndex = -1;
   std::string mBundleName;
   std::string mParentPrefix;
@@ -0,0 +1,243 @@
+#ifndef AL_PARAMETERJOURNAL_HPP
+#define AL_PARAMETERJOURNAL_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        In memory journal of parameter changes with snapshots, seeking and
+        export to a binary file
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "al/system/al_Time.hpp"
+#include "al/ui/al_Parameter.hpp"
+
+namespace al {
+
+/**
+ * @brief Records every change of a set of parameters for later inspection
+ * @ingroup UI
+ *
+ * Each change is written to a fixed size ring with its time, the id of the
+ * parameter and its value. Writing takes a few atomic operations and never
+ * locks, so set() can run on any thread, including the audio thread. When the
+ * ring is full the oldest changes are overwritten.
+ *
+ * A background thread takes full snapshots of all values at
+ * setSnapshotInterval(), by applying the changes recorded since the previous
+ * snapshot to it. The state at any past time still in the ring is the latest
+ * snapshot before it, plus the changes recorded since. This makes it
+ * possible to find out what the parameters were when a glitch happened:
+ *
+ * @code
+  ParameterJournal journal;
+  journal << frequency << amplitude << position;
+  ...
+  journal.restore(journal.time() - 2.5); // State 2.5 seconds ago
+  journal.writeFile("glitch.journal");
+   @endcode
+ *
+ * Numeric parameters are supported: Parameter, ParameterBool, ParameterInt,
+ * ParameterMenu, ParameterChoice, ParameterVec3, ParameterVec4,
+ * ParameterColor and ParameterPose. Values are kept as 32 bit floats, or 32
+ * bit integers for integer parameters.
+ *
+ * The journal registers change callbacks that cannot be removed, and its
+ * snapshot thread can read the parameters. Destroy it before the parameters
+ * it records, for example by declaring it after them, and don't set them
+ * once it is gone.
+ */
+class ParameterJournal {
+ public:
+  static const uint8_t MAX_COMPONENTS = 7;
+
+  /// Value of a parameter in a snapshot or a change
+  struct Value {
+    union {
+      float floats[MAX_COMPONENTS];
+      int32_t ints[MAX_COMPONENTS];
+    };
+    bool known{false};  ///< false if no value was recorded
+  };
+
+  /// Description of a recorded parameter
+  struct Entry {
+    std::string address;
+    char type;  ///< 'f' for float values, 'i' for integer values
+    uint8_t components;
+    ParameterMeta *parameter;  ///< nullptr in journals read from a file
+  };
+
+  /**
+   * @param capacity Number of changes kept. Rounded up to a power of two
+   */
+  ParameterJournal(size_t capacity = 65536);
+  ~ParameterJournal();
+
+  /// Start recording a parameter. Returns false for unsupported types
+  bool registerParameter(ParameterMeta &param);
+
+  ParameterJournal &operator<<(ParameterMeta &param) {
+    registerParameter(param);
+    return *this;
+  }
+
+  /**
+   * @brief Set the period of full snapshots
+   * @param seconds Time between snapshots. 0 stops taking them periodically
+   *
+   * Defaults to 1 second. Seeking replays at most this much time of changes.
+   */
+  void setSnapshotInterval(al_sec seconds);
+
+  /// Take a snapshot of all values now
+  void snapshot();
+
+  /// Time in seconds since the journal was created
+  al_sec time() const;
+
+  /// Earliest time that stateAt() can reach
+  al_sec startTime() const;
+
+  /// Changes that were overwritten or dropped since the journal started
+  uint64_t lostChanges() const;
+
+  const std::vector<Entry> &parameters() const { return mParameters; }
+
+  /**
+   * @brief Get the values of all parameters at a past time
+   * @param time Time in seconds, as returned by time()
+   * @param values Receives a value for each entry of parameters()
+   * @return false if the time is no longer in the journal
+   */
+  bool stateAt(al_sec time, std::vector<Value> &values) const;
+
+  /**
+   * @brief Set the recorded parameters to their values at a past time
+   * @return false if the time is no longer in the journal
+   *
+   * The restored values are recorded as new changes.
+   */
+  bool restore(al_sec time);
+
+  /**
+   * @brief Call a function for each change between two times, in order
+   */
+  void changes(
+      al_sec startTime, al_sec endTime,
+      const std::function<void(al_sec, uint32_t id, const Value &)> &function)
+      const;
+
+  /**
+   * @brief Write the journal to a binary file
+   *
+   * The file holds the parameter descriptions, the values at startTime() and
+   * every change after it. Times are stored as variable length nanosecond
+   * differences and values as floats or variable length integers, so a
+   * change usually takes 4 to 6 bytes plus its values.
+   */
+  bool writeFile(const std::string &fileName) const;
+
+  /**
+   * @brief Read a journal written by writeFile()
+   *
+   * The entries of a journal read from a file have no parameter, so
+   * restore() does nothing, but the values can be queried with stateAt().
+   * Fails if parameters have been registered in this journal.
+   */
+  bool readFile(const std::string &fileName);
+
+ private:
+  // One change in the ring. Fields are atomic words so readers can detect
+  // changes overwritten while they read them
+  struct Record {
+    // 2 * index + 1 while being written, 2 * index + 2 when complete
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> time{0};
+    std::atomic<uint32_t> id{0};
+    std::atomic<uint32_t> words[MAX_COMPONENTS]{};
+  };
+
+  struct Snapshot {
+    uint64_t time;
+    uint64_t index;  // Changes from this index on are not in the snapshot
+    std::vector<Value> values;  // Can be shorter than mParameters
+  };
+
+  void record(uint32_t id, const uint32_t *words, uint8_t count);
+  bool readRecord(uint64_t index, uint64_t &time, uint32_t &id,
+                  Value &value) const;
+  // Latest snapshot at or before time whose changes are all still in the ring
+  bool findSnapshot(uint64_t time, Snapshot &snapshot) const;
+  void fillValues(std::vector<Value> &values) const;
+  void readCurrentValue(const Entry &entry, Value &value) const;
+  void writeValue(const Entry &entry, const Value &value);
+  void startSnapshotThread();
+  void snapshotThread();
+  void stopSnapshotThread();
+  uint64_t toNanoseconds(al_sec time) const;
+
+  std::unique_ptr<Record[]> mRecords;
+  size_t mMask;
+  std::atomic<uint64_t> mWriteIndex{0};
+  std::atomic<uint64_t> mDropped{0};
+  al_nsec mStartTime;
+
+  std::vector<Entry> mParameters;
+  std::vector<Value> mInitialValues;  // Values when registered
+  mutable std::mutex mParameterLock;
+
+  std::vector<Snapshot> mSnapshots;  // Oldest first
+  mutable std::mutex mSnapshotLock;
+
+  std::unique_ptr<std::thread> mSnapshotThread;
+  std::condition_variable mSnapshotCondition;
+  std::mutex mSnapshotThreadLock;
+  al_sec mSnapshotInterval{1.0};
+  bool mSnapshotRunning{false};
+};
+
+}  // namespace al
+
+#endif  // AL_PARAMETERJOURNAL_HPP
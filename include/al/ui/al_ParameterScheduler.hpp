@@ -0,0 +1,125 @@
+#ifndef AL_PARAMETERSCHEDULER_HPP
+#define AL_PARAMETERSCHEDULER_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Runs deferred parameter change callbacks once per flush, in dependency
+        order
+*/
+
+#include <mutex>
+#include <vector>
+
+#include "al/ui/al_Parameter.hpp"
+
+namespace al {
+
+/**
+ * @brief Batches the change callbacks of a group of parameters
+ * @ingroup UI
+ *
+ * Parameters registered in a scheduler have asynchronous callbacks: set()
+ * stores the value and marks the parameter as changed, and flush() runs the
+ * callbacks of every changed parameter once with its latest value. Call
+ * flush() from the context the callbacks belong to, for example once per
+ * graphics frame in onAnimate() or once per audio block in onSound().
+ *
+ * When the callbacks of a parameter set other parameters, declare it with
+ * addDependency(). flush() processes parameters in dependency order, so a
+ * derived parameter set by several sources runs its own callbacks once,
+ * after all of them:
+ *
+ * @code
+  ParameterScheduler scheduler;
+  scheduler << morph << cutoff << gain;
+  scheduler.addDependency(morph, cutoff);
+  scheduler.addDependency(cutoff, gain);
+  ...
+  void onAnimate(double dt) override { scheduler.flush(); }
+   @endcode
+ *
+ * Parameters set during flush() by a parameter later in the order, or by a
+ * different thread, are processed in the next flush(). Register parameters
+ * and dependencies before setting the parameters from other threads, and
+ * don't call the scheduler's functions from the callbacks it runs.
+ */
+class ParameterScheduler {
+ public:
+  /**
+   * @brief Defer the change callbacks of a parameter to flush()
+   *
+   * Calls setSynchronousCallbacks(false) on the parameter. A parameter
+   * should belong to a single scheduler.
+   */
+  void registerParameter(ParameterMeta &param);
+
+  ParameterScheduler &operator<<(ParameterMeta &param) {
+    registerParameter(param);
+    return *this;
+  }
+
+  /**
+   * @brief Declare that the callbacks of source set target
+   * @return false if the dependency would create a cycle
+   *
+   * Registers both parameters if needed. flush() processes source before
+   * target.
+   */
+  bool addDependency(ParameterMeta &source, ParameterMeta &target);
+
+  /**
+   * @brief Run the callbacks of every changed parameter once
+   * @return the number of parameters whose callbacks were run
+   */
+  size_t flush();
+
+  /// Registered parameters in the order flush() processes them
+  const std::vector<ParameterMeta *> &order() const { return mOrder; }
+
+ private:
+  size_t indexOf(ParameterMeta &param);
+  bool sortParameters();
+
+  std::vector<ParameterMeta *> mParameters;  // Registration order
+  std::vector<std::vector<size_t>> mDependents;
+  std::vector<ParameterMeta *> mOrder;
+  std::mutex mLock;
+};
+
+}  // namespace al
+
+#endif  // AL_PARAMETERSCHEDULER_HPP
@@ -42,11 +42,18 @@
         Andrés Cabrera mantaraya36@gmail.com
 */
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 
+#include "al/io/al_AudioTelemetry.hpp"
 #include "al/protocol/al_OSC.hpp"
 #include "al/ui/al_Parameter.hpp"
 #include "al/ui/al_ParameterBundle.hpp"
+#include "al/ui/al_ParameterStream.hpp"
 
 namespace al {
 
@@ -107,12 +114,14 @@ class OSCNotifier {
    * @param oscPort The network port so send the value changes on
    */
   virtual void addListener(std::string IPaddress, uint16_t oscPort) {
+    std::unique_lock<std::mutex> lk(mListenerLock);
+    if (findListener(IPaddress, oscPort)) {
+      return;
+    }
     auto newListenerSocket = new osc::Send;
 
     if (newListenerSocket->open(oscPort, IPaddress.c_str())) {
-      mListenerLock.lock();
       mOSCSenders.push_back(newListenerSocket);
-      mListenerLock.unlock();
       //		std::cout << "Registered listener " << IPaddress << ":"
       //<< oscPort<< std::endl;
     } else {
@@ -122,6 +131,45 @@ class OSCNotifier {
     }
   }
 
+  /**
+   * @brief Register a listener that receives the binary parameter stream
+   * @param IPaddress The IP address of the listener
+   * @param oscPort The network port to send the value changes on
+   *
+   * Numeric notifications for addresses added with addStreamParameter() reach
+   * this listener as compact binary frames instead of OSC messages. The
+   * listener first receives the id of every streamed address. Listeners
+   * request this during the handshake when they support it.
+   */
+  virtual void addStreamListener(std::string IPaddress, uint16_t oscPort);
+
+  /**
+   * @brief Add an address to the binary parameter stream
+   * @return The id of the address in the stream
+   */
+  uint32_t addStreamParameter(const ParameterStreamEntry &entry);
+
+  /**
+   * @brief Quantize the values streamed for an address
+   * @param step Resolution of the streamed values. 0 sends full precision
+   *
+   * Quantized values are sent as differences to the previous value, which
+   * usually take one or two bytes instead of four. Only applies to float
+   * values. Starts a new stream session, so listeners never apply the new
+   * step to values encoded with the previous one.
+   */
+  void setStreamQuantization(const std::string &address, float step);
+
+  /**
+   * @brief Send the current value of every streamed address at once
+   * @param session Session of the stream. Requests for other sessions are
+   * ignored
+   *
+   * Listeners request this when they lose frames, as relative values can't
+   * be applied until the values they are relative to are sent again.
+   */
+  void sendStreamKeyFrame(uint32_t session);
+
   /**
    * @brief Notify the listeners of value changes
    * @param OSCaddress The OSC path to send the value on
@@ -134,15 +182,55 @@ class OSCNotifier {
    * then.
    *
    */
-  void notifyListeners(std::string OSCaddress, float value);
-  void notifyListeners(std::string OSCaddress, int value);
-  void notifyListeners(std::string OSCaddress, std::string value);
-  void notifyListeners(std::string OSCaddress, Vec3f value);
-  void notifyListeners(std::string OSCaddress, Vec4f value);
-  void notifyListeners(std::string OSCaddress, Pose value);
-  void notifyListeners(std::string OSCaddress, Color value);
+  void notifyListeners(const std::string &OSCaddress, float value);
+  void notifyListeners(const std::string &OSCaddress, int value);
+  void notifyListeners(const std::string &OSCaddress, std::string value);
+  void notifyListeners(const std::string &OSCaddress, Vec3f value);
+  void notifyListeners(const std::string &OSCaddress, Vec4f value);
+  void notifyListeners(const std::string &OSCaddress, Pose value);
+  void notifyListeners(const std::string &OSCaddress, Color value);
+
+  void notifyListeners(const std::string &OSCaddress, ParameterMeta *param);
+
+  /**
+   * @brief Send audio callback telemetry to the listeners as a bundle
+   * @param OSCaddress prefix for the messages
+   *
+   * Sends OSCaddress + "/load" (last, mean, max, smoothed),
+   * OSCaddress + "/count" (callbacks, xruns, deadline misses),
+   * OSCaddress + "/histogram" (bin counts) and one OSCaddress + "/span"
+   * message (name, last, mean, max) per span.
+   */
+  void notifyListeners(const std::string &OSCaddress,
+                       const AudioTelemetry::Snapshot &telemetry);
+
+  /**
+   * @brief Coalesce notifications and send them as bundles
+   * @param rate Flushes per second. 0 sends every notification immediately.
+   *
+   * When the rate is above 0, notifyListeners() only records the latest value
+   * for each address. A background thread sends the recorded values at this
+   * rate, packed into OSC bundles no larger than setMaxPacketSize(). Audio
+   * telemetry is always sent immediately.
+   */
+  void setNotificationRate(float rate);
 
-  void notifyListeners(std::string OSCaddress, ParameterMeta *param);
+  float notificationRate() { return mNotificationRate; }
+
+  /**
+   * @brief Set maximum size in bytes of coalesced notification bundles
+   *
+   * Defaults to 1024, the receive buffer size of osc::Recv in earlier
+   * versions. Values up to 1472 still fit the UDP payload of a 1500 byte
+   * Ethernet frame. Messages larger than this are sent in a bundle of their
+   * own.
+   */
+  void setMaxPacketSize(size_t bytes) { mMaxPacketSize = bytes; }
+
+  /**
+   * @brief Send notifications held by setNotificationRate() now
+   */
+  void flushNotifications();
 
   void send(osc::Packet &p) {
     mListenerLock.lock();
@@ -171,8 +259,14 @@ class OSCNotifier {
   }
 
  protected:
+  // Must hold mListenerLock
+  osc::Send *findListener(const std::string &IPaddress, uint16_t oscPort);
+  bool isStreamListener(osc::Send *sender);
+
   std::mutex mListenerLock;
   std::vector<osc::Send *> mOSCSenders;
+  // Listeners in mOSCSenders that receive the binary parameter stream
+  std::vector<osc::Send *> mStreamSenders;
 
   class HandshakeHandler : public osc::PacketHandler {
    public:
@@ -196,6 +290,20 @@ class OSCNotifier {
         notifier->addListener(m.senderAddress(), listenerPort);
         std::cout << "Registered listener " << m.senderAddress() << ":"
                   << listenerPort << std::endl;
+      } else if (m.addressPattern() == "/registerStreamListener" &&
+                 m.typeTags() == "ii") {
+        int listenerPort, version;
+        m >> listenerPort >> version;
+        if (version == parameterStreamVersion) {
+          notifier->addStreamListener(m.senderAddress(), listenerPort);
+        } else {
+          notifier->addListener(m.senderAddress(), listenerPort);
+        }
+      } else if (m.addressPattern() == "/requestStreamKeyFrame" &&
+                 m.typeTags() == "i") {
+        int session;
+        m >> session;
+        notifier->sendStreamKeyFrame(uint32_t(session));
       } else {
         std::cout << "Unhandled command" << std::endl;
         m.print();
@@ -209,6 +317,46 @@ class OSCNotifier {
   std::mutex mNodeLock;
 
  private:
+  struct PendingNotification {
+    std::string address;
+    char type;  // 'f' for floats, 'i' for int, 's' for string
+    bool streamed;  // Sent to stream listeners in the binary stream
+    uint8_t count;
+    float floats[7];
+    int32_t intValue;
+    std::string stringValue;
+  };
+
+  // Returns the pending notification for address. Must hold mPendingLock
+  PendingNotification &pendingNotification(const std::string &address);
+  bool queueFloats(const std::string &address, const float *values,
+                   uint8_t count, bool streamed);
+  // Return whether the values went to the stream listeners
+  bool streamValues(const std::string &address, const float *values);
+  bool streamValues(const std::string &address, int32_t value);
+  // Must hold mStreamLock
+  void sendStreamFrames();
+  void sendStreamParameters(osc::Send *sender, uint32_t firstId);
+  void flushThread();
+  void stopFlushThread();
+
+  std::atomic<float> mNotificationRate{0.0f};
+  size_t mMaxPacketSize{1024};
+
+  std::vector<PendingNotification> mPending;
+  std::unordered_map<std::string, size_t> mPendingIndex;
+  std::mutex mPendingLock;
+  std::vector<PendingNotification> mFlushing;
+  std::mutex mFlushLock;
+
+  std::unique_ptr<std::thread> mFlushThread;
+  std::condition_variable mFlushCondition;
+  bool mFlushRunning{false};
+
+  ParameterStreamEncoder mStream;
+  std::unordered_map<std::string, uint32_t> mStreamIds;
+  std::atomic<bool> mStreaming{false};  // There are stream listeners
+  std::mutex mStreamLock;
 };
 
 /**
@@ -294,6 +442,8 @@ class ParameterServer : public osc::PacketHandler,
    * @brief Get the list of registered parameters.
    */
   std::vector<Parameter *> parameters();
+  /// All registered parameters, of any type
+  std::vector<ParameterMeta *> allParameters();
   std::vector<ParameterString *> stringParameters();
   std::vector<ParameterVec3 *> vec3Parameters();
   std::vector<ParameterVec4 *> vec4Parameters();
@@ -347,6 +497,17 @@ class ParameterServer : public osc::PacketHandler,
 
   uint16_t serverPort() { return mServer->port(); }
 
+  /**
+   * @brief Quantize the values of a parameter in the binary parameter stream
+   * @param step Resolution of the streamed values. 0 sends full precision
+   *
+   * Must be called after registering the parameter.
+   */
+  void setStreamQuantization(ParameterMeta &param, float step) {
+    setStreamQuantization(param.getFullAddress(), step);
+  }
+  using OSCNotifier::setStreamQuantization;
+
   void verbose(bool verbose = true) { mVerbose = verbose; }
   static bool setParameterValueFromMessage(ParameterMeta *param,
                                            std::string address,
@@ -374,6 +535,10 @@ class ParameterServer : public osc::PacketHandler,
                   << port << std::endl;
         osc::Send listenerRequest(port, m.senderAddress().c_str());
         listenerRequest.send("/registerListener", mServer->port());
+        // Servers that support the binary stream switch this listener to it.
+        // Earlier servers ignore this message
+        listenerRequest.send("/registerStreamListener", mServer->port(),
+                             parameterStreamVersion);
       }
     }
   }
@@ -386,6 +551,43 @@ class ParameterServer : public osc::PacketHandler,
                                std::vector<ParameterBundle *> bundleGroup,
                                std::string rootAddress);
 
+  /// Sets a parameter from a message whose type tags it accepts
+  typedef bool (*MessageSetter)(ParameterMeta *param, osc::Message &m);
+  /// Sets a parameter from values decoded from the binary parameter stream
+  typedef void (*StreamSetter)(ParameterMeta *param, const double *values);
+
+  struct AddressHandler {
+    ParameterMeta *parameter;
+    MessageSetter setter;
+    StreamSetter streamSetter;
+  };
+
+  /// State of a binary parameter stream received from one server
+  struct StreamSession {
+    ParameterStreamDecoder decoder;
+    // Index entries for each id, resolved for mAddressIndexVersion
+    std::vector<const std::vector<AddressHandler> *> handlers;
+    uint64_t addressIndexVersion{0};
+    uint64_t lostFrames{0};  // Gaps already answered with a key frame request
+    std::chrono::steady_clock::time_point lastTableRequest;
+    std::chrono::steady_clock::time_point lastKeyFrameRequest;
+    std::chrono::steady_clock::time_point lastActivity;
+  };
+
+  void indexParameter(ParameterMeta *param, const std::string &prefix);
+  void indexBundle(ParameterBundle *bundle);
+  void rebuildAddressIndex();
+
+  // Must hold mParameterLock
+  void onStreamParameter(osc::Message &m);
+  void onStreamFrame(osc::Message &m);
+  void requestStreamParameters(
+      std::chrono::steady_clock::time_point &lastRequest,
+      const std::string &serverAddress);
+  void requestStreamKeyFrame(StreamSession &session, uint32_t sessionId,
+                             const std::string &serverAddress);
+  void expireStreamSessions();
+
   std::vector<std::pair<std::string, uint16_t>>
       mNotifiers;  // List of primary nodes
 
@@ -399,6 +601,21 @@ class ParameterServer : public osc::PacketHandler,
   std::map<std::string, int> mCurrentActiveBundle;
   std::mutex mParameterLock;
 
+  // Full OSC address of registered parameters, including parameters in
+  // bundles, to their setters. Rebuilt on the next message after registration
+  std::unordered_map<std::string, std::vector<AddressHandler>> mAddressIndex;
+  bool mAddressIndexDirty{true};
+  uint64_t mAddressIndexVersion{0};
+  uint64_t mIndexedBundleVersion{0};
+  std::string mLookupAddress;
+
+  // Binary parameter streams received, by session. Sessions are created by
+  // /al/streamParameter and dropped when idle
+  std::unordered_map<uint32_t, StreamSession> mStreamSessions;
+  std::chrono::steady_clock::time_point mLastStreamExpiry;
+  // Frames of unknown sessions request the parameters, at most once a second
+  std::chrono::steady_clock::time_point mLastUnknownStreamRequest;
+
   std::string mOscAddress;
   int mOscPort;
 
@@ -0,0 +1,213 @@
+#ifndef AL_PARAMETERSTREAM_HPP
+#define AL_PARAMETERSTREAM_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology,
+   UCSB. Copyright (C) 2012-2018. The Regents of the University of California.
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are
+   met:
+
+                Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+                Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer in the
+                documentation and/or other materials provided with the
+   distribution.
+
+                Neither the name of the University of California nor the names
+   of its contributors may be used to endorse or promote products derived from
+                this software without specific prior written permission.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+   OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+   OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+   ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+        File description:
+        Compact binary encoding of parameter values for high rate streaming
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace al {
+
+/// Version of the binary parameter stream, negotiated in the handshake
+constexpr int parameterStreamVersion = 1;
+
+/**
+ * @brief Description of a parameter in a binary parameter stream
+ * @ingroup UI
+ *
+ * Sent once per listener when the stream is negotiated, so frames only need
+ * the numeric id of each parameter.
+ */
+struct ParameterStreamEntry {
+  enum Type : uint8_t { FLOAT = 'f', INT = 'i' };
+
+  std::string address;
+  uint8_t type{FLOAT};
+  uint8_t components{1};  ///< Up to MAX_COMPONENTS values per parameter
+  /// Quantization step of FLOAT values. 0 sends full precision floats
+  float step{0.0f};
+
+  static const uint8_t MAX_COMPONENTS = 7;
+};
+
+/**
+ * @brief Encodes the latest values of parameters into binary frames
+ * @ingroup UI
+ *
+ * A frame starts with the stream session and a sequence number, both 32 bit
+ * big endian. Entries follow in ascending id order. Each starts with a varint
+ * holding the gap to the previous id, shifted left once, with the low bit set
+ * when the entry carries absolute values. Full precision floats follow as 32
+ * bit big endian values. Integers and quantized floats follow as zigzag
+ * varints, holding the difference to the previous value of the parameter
+ * unless the entry is absolute.
+ *
+ * Each parameter is sent absolute when first sent, after resynchronize() and
+ * at least every ABSOLUTE_INTERVAL frames, so receivers recover from lost
+ * frames.
+ */
+class ParameterStreamEncoder {
+ public:
+  static const uint32_t ABSOLUTE_INTERVAL = 64;
+  static const size_t HEADER_SIZE = 8;
+
+  ParameterStreamEncoder();
+
+  /// Random identifier of this stream, sent in every frame
+  uint32_t session() const { return mSession; }
+
+  /// Add a parameter to the stream. Returns its id
+  uint32_t addParameter(const ParameterStreamEntry &entry);
+
+  /// Set the quantization step of a FLOAT parameter
+  void setStep(uint32_t id, float step);
+
+  size_t parameterCount() const { return mParameters.size(); }
+  const ParameterStreamEntry &parameter(uint32_t id) const {
+    return mParameters[id].entry;
+  }
+
+  /// Record the latest values of a FLOAT parameter, to send in the next frame
+  void setValue(uint32_t id, const float *values);
+  /// Record the latest values of an INT parameter, to send in the next frame
+  void setValue(uint32_t id, const int32_t *values);
+
+  /// Whether there are recorded values waiting for encode()
+  bool pending() const { return mPendingIds.size() > 0; }
+
+  /// Send absolute values in the next frames, e.g. for a new listener
+  void resynchronize();
+
+  /// Send absolute values of all parameters in the next frames, also those
+  /// that do not change, e.g. for a listener that lost frames
+  void keyFrame();
+
+  /**
+   * @brief Continue the stream with a new session
+   *
+   * Receivers only decode frames of sessions whose parameter descriptions
+   * they have, so a change of description, e.g. of the quantization step,
+   * can't be applied to frames encoded with the previous one. The next
+   * frames carry absolute values of all parameters.
+   */
+  void newSession();
+
+  /**
+   * @brief Encode recorded values into frames
+   * @param maxFrameSize Largest frame to produce, in bytes
+   * @param frameFunction Called with each frame
+   */
+  void encode(size_t maxFrameSize,
+              const std::function<void(const char *, size_t)> &frameFunction);
+
+ private:
+  struct ParameterState {
+    ParameterStreamEntry entry;
+    float floats[ParameterStreamEntry::MAX_COMPONENTS];
+    int64_t values[ParameterStreamEntry::MAX_COMPONENTS];
+    int64_t sent[ParameterStreamEntry::MAX_COMPONENTS];
+    uint32_t absoluteSequence{0};
+    bool hasValue{false};
+    bool hasSent{false};
+    bool pending{false};
+  };
+
+  void markPending(ParameterState &state, uint32_t id);
+
+  uint32_t mSession;
+  uint32_t mSequence{0};
+  std::vector<ParameterState> mParameters;
+  std::vector<uint32_t> mPendingIds;
+  std::vector<char> mFrame;
+};
+
+/**
+ * @brief Decodes frames produced by ParameterStreamEncoder
+ * @ingroup UI
+ */
+class ParameterStreamDecoder {
+ public:
+  /// Add or replace the description of parameter id
+  void setParameter(uint32_t id, const ParameterStreamEntry &entry);
+
+  size_t parameterCount() const { return mParameters.size(); }
+  /// Description of parameter id, or nullptr if it is unknown
+  const ParameterStreamEntry *parameter(uint32_t id) const;
+
+  /// Read the session of a frame. Returns false if it is too short
+  static bool frameSession(const char *frame, size_t size, uint32_t &session);
+
+  /**
+   * @brief Decode a frame
+   * @param valueFunction Called with the id and values of each parameter
+   * @return false if the frame is malformed or refers to unknown parameters.
+   * Values decoded before the problem have been passed to valueFunction.
+   *
+   * Relative values are skipped after a lost frame, until the parameter is
+   * sent absolute again. Receivers should then ask the sender for a key
+   * frame, see ParameterStreamEncoder::keyFrame().
+   */
+  bool decode(
+      const char *frame, size_t size,
+      const std::function<void(uint32_t, const double *)> &valueFunction);
+
+  /// Number of gaps in the frame sequence seen so far
+  uint64_t lostFrames() const { return mLostFrames; }
+
+ private:
+  struct ParameterState {
+    ParameterStreamEntry entry;
+    int64_t values[ParameterStreamEntry::MAX_COMPONENTS];
+    bool known{false};
+    bool hasBase{false};
+  };
+
+  std::vector<ParameterState> mParameters;
+  uint32_t mLastSequence{0};
+  bool mHasSequence{false};
+  uint64_t mLostFrames{0};
+};
+
+}  // namespace al
+
+#endif  // AL_PARAMETERSTREAM_HPP
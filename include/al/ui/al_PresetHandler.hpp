@@ -44,14 +44,17 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <list>
 #include <map>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "al/protocol/al_OSC.hpp"
 #include "al/system/al_Time.hpp"
+#include "al/system/al_Watcher.hpp"
 #include "al/ui/al_Parameter.hpp"
 #include "al/ui/al_ParameterServer.hpp"
 
@@ -66,6 +69,13 @@ namespace al {
 class PresetHandler {
  public:
   typedef std::map<std::string, std::vector<ParameterField>> ParameterStates;
+
+  /// Interpolation curve for morphs
+  enum MorphCurve {
+    MORPH_LINEAR = 0,
+    MORPH_EXPONENTIAL,  ///< Geometric, for values that don't cross zero
+    MORPH_SMOOTHSTEP    ///< Eased in and out
+  };
   /**
    * @brief PresetHandler contructor
    *
@@ -188,11 +198,81 @@ class PresetHandler {
    */
   void skipParameter(std::string parameterAddr, bool skip = true);
 
+  /**
+   * @brief Keep presets in memory after they are read from disk
+   * @param enable
+   *
+   * When enabled, each preset and preset map file is parsed once and later
+   * recalls and readPresetMap() calls are served from memory. Files written
+   * by any PresetHandler are reloaded on their next use. Other changes to
+   * the files are not detected: signal them with al::Watcher::notify()
+   * passing the file path, or call clearCache(). Presets are still stored as
+   * text files. availablePresets() always reads the current map in memory.
+   */
+  void enableCache(bool enable = true);
+
+  bool cacheEnabled() { return mCacheEnabled; }
+
+  /// Read all presets in the current path into the cache
+  void preloadCache();
+
+  void clearCache();
+
+  /**
+   * @brief Limit the number of presets kept in the cache
+   * @param size maximum number of presets. 0 means unlimited (default)
+   *
+   * When the cache is full, the least recently used preset is dropped.
+   */
+  void setCacheSize(size_t size);
+
+  /**
+   * @brief Read presets next to the recalled one on a background thread
+   * @param enable
+   * @param radius number of presets on each side of the recalled preset in
+   * the current preset map to prefetch
+   *
+   * Enables the cache. After a preset is recalled, its neighbors in the
+   * preset map are parsed on a background thread, so recalling them from
+   * MIDI or OSC callbacks does not touch the disk.
+   */
+  void enablePrefetch(bool enable = true, int radius = 1);
+
+  /// Number of preset and preset map loads served from the cache
+  uint64_t cacheHits() { return mCacheHits; }
+  /// Number of preset and preset map loads that had to read the file
+  uint64_t cacheMisses() { return mCacheMisses; }
+  void resetCacheCounters() {
+    mCacheHits = 0;
+    mCacheMisses = 0;
+  }
+  /// Number of presets in the cache, including prefetched presets
+  size_t cachedPresets();
+
   int getCurrentPresetIndex();
 
   float getMorphTime();
   void setMorphTime(float time);
+
+  /**
+   * @brief Set the interpolation curve for morphs
+   *
+   * Takes effect on the next call to morphTo() or recallPreset().
+   * MORPH_EXPONENTIAL interpolates values in the log domain and falls back to
+   * linear interpolation for values that are zero or change sign.
+   */
+  void setMorphCurve(MorphCurve curve) { mMorphCurve = curve; }
+  MorphCurve getMorphCurve() { return mMorphCurve; }
+
   void stopMorphing() { mTotalSteps.store(0); }
+
+  /**
+   * @brief Morph to parameter states over morphTime seconds
+   *
+   * Target values are resolved to parameters when the morph starts. Numeric
+   * values are packed in contiguous arrays that are interpolated on every
+   * morph step, and only parameters whose value changed are set.
+   */
   void morphTo(ParameterStates &parameterStates, float morphTime);
   void morphTo(std::string presetName, float morphTime);
 
@@ -266,6 +346,15 @@ class PresetHandler {
 
   std::vector<ParameterMeta *> parameters() { return mParameters; }
 
+  /**
+   * @brief Map of preset addresses to registered parameters
+   *
+   * Includes parameters in registered bundles, using the addresses they are
+   * stored with in preset files. Useful to resolve preset values to
+   * parameters once instead of on every recall.
+   */
+  std::unordered_map<std::string, ParameterMeta *> parameterAddresses();
+
   std::string buildMapPath(std::string mapName, bool useSubDirectory = false);
 
   std::vector<std::string> availablePresetMaps();
@@ -342,6 +431,60 @@ class PresetHandler {
 
   ParameterStates getBundleStates(ParameterBundle *bundle, std::string id);
 
+  // Invalidates cached presets when their files are written
+  class CacheWatcher : public Watcher {
+   public:
+    CacheWatcher(PresetHandler &handler) : mHandler(handler) {}
+    void onEvent(std::string resourcename, std::string eventname) override;
+
+   private:
+    PresetHandler &mHandler;
+  };
+
+  ParameterStates parsePresetFile(std::string fileName);
+  // Returns true and copies values if fileName is cached. Otherwise returns
+  // false and the generation of fileName to pass to insertCached()
+  bool findCached(const std::string &fileName, ParameterStates &values,
+                  uint64_t &generation);
+  // Does nothing if fileName changed since generation was read
+  void insertCached(const std::string &fileName, const ParameterStates &values,
+                    uint64_t generation);
+  uint64_t cacheGeneration(const std::string &fileName);
+  // Returns false if the file can't be read
+  bool parsePresetMapFile(const std::string &mapFullPath,
+                          std::map<int, std::string> &presetsMap);
+  // Drops least recently used entries over the cache size and returns their
+  // paths. Must be called with mCacheLock held
+  void evictCached(std::vector<std::string> &evicted);
+  // Stops watching evicted files. Must be called without mCacheLock
+  void unwatchEvicted(const std::vector<std::string> &evicted);
+  void prefetchAdjacent(int index);
+  static void prefetchFunction(PresetHandler *handler);
+
+  // Compiled morph. Must be called with mTargetLock held
+  void compileMorph(ParameterStates &targetValues);
+  // Interpolates and queues the values of parameters that changed in
+  // mMorphPushes. Must be called with mTargetLock held
+  void applyMorph(float phase);
+  // Sets the queued values. Called without mTargetLock, so parameter
+  // callbacks can use the handler
+  void pushMorphValues();
+
+  struct MorphParameter {
+    ParameterMeta *param;
+    uint32_t firstValue;  // Index into the morph value arrays
+    uint32_t numValues;
+    bool scalar;     // Single numeric field, set through fromFloat()
+    bool integer;    // Changes are detected on truncated values
+    bool forcePush;  // Set on next step regardless of changes
+  };
+
+  struct MorphPush {
+    ParameterMeta *param;
+    float value;      // For scalar parameters
+    int32_t fields;   // Index into mMorphPushFields, -1 for scalars
+  };
+
   bool mVerbose{false};
   bool mUseCallbacks{true};
   std::string mRootDir;
@@ -356,13 +499,54 @@ class PresetHandler {
 
   std::map<std::string, std::vector<ParameterBundle *>> mBundles;
 
+  struct CacheEntry {
+    ParameterStates values;
+    std::list<std::string>::iterator order;
+  };
+  std::atomic<bool> mCacheEnabled{false};
+  std::mutex mCacheLock;
+  std::unordered_map<std::string, CacheEntry> mCache;  // By file path
+  // Preset maps by file path. Not limited by the cache size
+  std::unordered_map<std::string, std::map<int, std::string>> mMapCache;
+  std::list<std::string> mCacheOrder;  // Most recently used first
+  // Bumped by mCacheWatcher when a file changes, by file path
+  std::unordered_map<std::string, uint64_t> mCacheGenerations;
+  uint64_t mCacheEpoch{0};  // Bumped by clearCache(), added to generations
+  size_t mCacheSize{0};
+  std::atomic<uint64_t> mCacheHits{0};
+  std::atomic<uint64_t> mCacheMisses{0};
+  CacheWatcher mCacheWatcher{*this};
+
+  std::atomic<int> mPrefetchRadius{0};
+  bool mPrefetchRunning{false};  // Protected by mPrefetchLock
+  std::mutex mPrefetchLock;
+  std::condition_variable mPrefetchCondition;
+  std::vector<std::string> mPrefetchQueue;  // Preset file paths
+  std::unique_ptr<std::thread> mPrefetchThread;
+
   // Protects file writing from this class. Only one file may be written at
   // a time.
   std::mutex mFileLock;
 
   std::mutex mTargetLock;
   ParameterStates mTargetValues;
-  ParameterStates mStartValues;
+
+  MorphCurve mMorphCurve{MORPH_LINEAR};
+  MorphCurve mMorphPlanCurve{MORPH_LINEAR};
+  std::vector<MorphParameter> mMorphParameters;
+  std::vector<float> mMorphStart;  // log of magnitude for exponential values
+  std::vector<float> mMorphDelta;
+  std::vector<float> mMorphEnd;
+  std::vector<float> mMorphValues;
+  std::vector<float> mMorphPushed;      // Last values set on parameters
+  std::vector<uint32_t> mMorphExpLanes;  // Values interpolated in log domain
+  // Fields passed to set() for parameters that are not scalar
+  std::vector<std::vector<ParameterField>> mMorphFields;
+  std::vector<ParameterField> mCaptureFields;
+  // Values queued by applyMorph() and set by pushMorphValues()
+  std::mutex mMorphPushLock;  // Keeps steps and their pushes in order
+  std::vector<MorphPush> mMorphPushes;
+  std::vector<std::vector<ParameterField>> mMorphPushFields;
 
   TimeMasterMode mTimeMasterMode{TimeMasterMode::TIME_MASTER_CPU};
 
@@ -371,7 +555,8 @@ class PresetHandler {
   std::atomic<uint64_t> mMorphStepCount{0};
   std::atomic<uint64_t> mTotalSteps{0};
   //  std::atomic<float> mCurrentMorphIndex;
-  bool mCpuThreadRunning{false};  // To keep the morphing thread alive
+  // Keeps the morphing thread alive
+  std::atomic<bool> mCpuThreadRunning{false};
   std::unique_ptr<std::thread> mMorphingThread;
   //  std::condition_variable mMorphConditionVar;
   double mMorphInterval{0.05};
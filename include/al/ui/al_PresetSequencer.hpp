@@ -45,10 +45,10 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <future>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 #include <utility>
@@ -114,6 +114,14 @@ class Composition;
  * The directory where sequences are loaded is taken from the PresetHandler
  * object registered with the sequencer.
  *
+ * When a sequence is loaded, its steps are compiled into flat tables of
+ * parameter pointers and start/end values. Presets are read from disk and
+ * parameters and event callbacks are resolved at that point, so stepping the
+ * sequencer (from its own thread or through stepSequencer()) only walks
+ * contiguous data. Preset morphs are interpolated by the sequencer at its
+ * step granularity instead of by the PresetHandler. Register parameters,
+ * event commands and the preset handler before playing a sequence.
+ *
  */
 class PresetSequencer : public osc::MessageConsumer {
   friend class Composition;
@@ -140,6 +148,59 @@ class PresetSequencer : public osc::MessageConsumer {
     void *callbackData;
   } EventCallback;
 
+ private:
+  // Compiled sequence, with one PlanStep per sequence step
+  enum PlanCurve : uint8_t { CURVE_LINEAR = 0, CURVE_STEP };
+
+  struct PlanParameter {
+    ParameterMeta *param;
+    uint32_t firstValue;  // Index into start, end and curves
+    uint32_t numValues;
+    bool scalar;  // Single numeric field, set through fromFloat()
+  };
+
+  struct PlanStep {
+    StepType type;
+    float morphTime;
+    float waitTime;
+    uint32_t firstParameter;  // Index into parameters
+    uint32_t numParameters;
+    uint32_t firstCallback;  // Index into callbacks
+    uint32_t numCallbacks;
+  };
+
+  struct Plan {
+    std::vector<PlanStep> steps;
+    std::vector<PlanParameter> parameters;
+    std::vector<float> start;
+    std::vector<float> end;
+    std::vector<uint8_t> curves;
+    // Fields passed to set() for parameters that are not scalar
+    std::vector<std::vector<ParameterField>> fields;
+    std::vector<uint32_t> callbacks;  // Indices into mEventCallbacks
+  };
+
+ public:
+  /**
+   * @brief A sequence loaded and compiled ahead of playback
+   *
+   * Created by prepareSequence() and consumed by playSequence(), so sequence
+   * files and presets can be read before the sequence is due to start.
+   */
+  class PreparedSequence {
+    friend class PresetSequencer;
+
+   public:
+    const std::string &name() const { return mName; }
+    bool empty() const { return mSteps.size() == 0; }
+
+   private:
+    std::string mName;
+    std::vector<Step> mSteps;
+    Plan mPlan;
+    uint64_t mPlanVersion{0};
+  };
+
   /**
    * @brief Start playing the sequence specified
    * @param sequenceName
@@ -148,10 +209,39 @@ class PresetSequencer : public osc::MessageConsumer {
    * There is a single sequencer engine in the PresetSequencer class, so if
    * a sequence is playing when this command is issued, the current playback
    * is interrupted and the new sequence requested starts immediately.
+   *
+   * The sequence and its presets are loaded and compiled on the calling
+   * thread before playback is interrupted. An empty name replays the current
+   * steps. If a preset file used by the playing sequence is written, the
+   * sequence is compiled again on the sequencer thread and the new values
+   * are used from the next preset step.
    */
   void playSequence(std::string sequenceName, double timeScale = 1.0f,
                     double timeOffset = 0.0);
 
+  /**
+   * @brief Load and compile a sequence without affecting playback
+   * @param sequenceName
+   * @param timeScale Times in sequence are multiplied by this factor
+   *
+   * Reads the sequence and its presets. Can be called from any thread, but
+   * parameters, event commands and the preset handler should not be
+   * registered concurrently. Sequences prepared before a registration changes
+   * or before one of their preset files is written are recompiled when
+   * played. Changes to preset files that are not written through a
+   * PresetHandler must be signaled with al::Watcher::notify().
+   */
+  PreparedSequence prepareSequence(std::string sequenceName,
+                                   double timeScale = 1.0);
+
+  /**
+   * @brief Start playing a prepared sequence
+   *
+   * Like playSequence(std::string) but without reading any files, so the
+   * time to start the sequence does not depend on its size.
+   */
+  void playSequence(PreparedSequence &&sequence, double timeOffset = 0.0);
+
   void stopSequence(bool triggerCallbacks = true);
 
   /**
@@ -224,6 +314,8 @@ class PresetSequencer : public osc::MessageConsumer {
 
   PresetSequencer &registerParameter(ParameterMeta &param) {
     mParameters.push_back(&param);
+    mPlanDirty = true;
+    mPlanVersion++;
     return *this;
   }
 
@@ -338,6 +430,25 @@ class PresetSequencer : public osc::MessageConsumer {
   void startCpuThread();
   void stopCpuThread();
 
+  // Does not touch playback state, so it can run on any thread
+  void compilePlan(const std::vector<Step> &steps, Plan &plan);
+  uint32_t addPlanParameter(Plan &plan, ParameterMeta *param,
+                            const std::vector<ParameterField> &values);
+  void startPlayback(double timeOffset);
+  void beginMorph(int64_t stepIndex, double startTime);
+  void applyPlanParameters(const PlanStep &step, float factor);
+  void triggerPlanEvent(uint64_t stepIndex);
+
+  // Marks compiled plans stale when a preset file they use is written
+  class PresetWatcher : public Watcher {
+   public:
+    PresetWatcher(PresetSequencer &sequencer) : mSequencer(sequencer) {}
+    void onEvent(std::string resourcename, std::string eventname) override;
+
+   private:
+    PresetSequencer &mSequencer;
+  };
+
   std::vector<Step> mSteps;
   std::string mDirectory;
   PresetHandler *mPresetHandler{nullptr};
@@ -353,7 +464,7 @@ class PresetSequencer : public osc::MessageConsumer {
   bool mSequencerActive{false};
   bool mRunning;
   bool mStartRunning;
-  std::queue<Step> mParameterList;
+  uint64_t mNextParameterStep{0};  // First queued parameter or event step
   double mCurrentTime = 0.0;  // Current time (in seconds)
   double mTargetTime;
   double mLastPresetTime;  // To anchor parameter deltas
@@ -377,7 +488,19 @@ class PresetSequencer : public osc::MessageConsumer {
   std::unique_ptr<std::thread> mSequencerThread;
   std::mutex mSequenceLock;
   uint64_t mCurrentStep;
-  PresetHandler::ParameterStates mStartValues;
+
+  bool mPlanDirty{true};
+  // Incremented when registrations or preset files that affect compiled plans
+  // change
+  std::atomic<uint64_t> mPlanVersion{0};
+  // Set by mPresetWatcher, the playing plan is compiled again when set
+  std::atomic<bool> mPresetsChanged{false};
+  PresetWatcher mPresetWatcher{*this};
+  Plan mPlan;
+  std::vector<ParameterField> mCaptureFields;
+  int64_t mLastPresetStep{-1};  // Last preset step reached
+  int64_t mMorphStep{-1};       // Preset step being morphed, -1 if none
+  double mMorphStartTime{0.0};
   std::mutex mPlayWaitLock;
   std::condition_variable mPlayWaitVariable;
   //  std::mutex mPlayStartedLock;
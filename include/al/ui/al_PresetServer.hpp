@@ -43,11 +43,25 @@
 */
 
 
+#include "al/ui/al_CommandQueue.hpp"
 #include "al/ui/al_PresetHandler.hpp"
 
 namespace al {
 
-///@ingroup UI
+/**
+ * @brief Recalls and stores presets of PresetHandler objects from OSC
+ * @ingroup UI
+ *
+ * OSC messages are parsed on the receiving thread, which by default is the
+ * receive thread shared by every osc::Recv, see osc::Recv::sharedThread().
+ * The recalls, stores and morph time changes they request run in order on a
+ * worker thread, so reading preset files doesn't hold up the messages that
+ * follow, nor messages to other sockets. A recall
+ * received while the previous recall is still waiting replaces it. When a
+ * command has run, listeners receive an acknowledgement on
+ * <address>/ack/<command> with the command's value, for example
+ * /preset/ack/recall 3.
+ */
 class PresetServer : public osc::PacketHandler, public OSCNotifier {
  public:
   /**
@@ -116,10 +130,31 @@ class PresetServer : public osc::PacketHandler, public OSCNotifier {
 
   void attachPacketHandler(osc::PacketHandler *handler);
 
+  /// Send <address>/ack/<command> to listeners when a command has run
+  void acknowledgeCommands(bool acknowledge) { mAcknowledge = acknowledge; }
+
+  /// Number of commands waiting for the worker thread
+  size_t queueDepth() { return mCommands.depth(); }
+  /// Largest queueDepth() since resetQueueCounters()
+  size_t maxQueueDepth() { return mCommands.maxDepth(); }
+  /// Number of commands run
+  uint64_t processedCommands() { return mCommands.processed(); }
+  /// Number of recalls dropped because a later recall replaced them
+  uint64_t coalescedCommands() { return mCommands.coalesced(); }
+  void resetQueueCounters() { mCommands.resetCounters(); }
+
+  /// Block until the commands received so far have run
+  void waitForCommands() { mCommands.waitForCommands(); }
+
  protected:
   static void changeCallback(int value, void *sender, void *userData);
 
  private:
+  // Queue a recall, or a store if store is true, of the preset name, or of
+  // index if name is empty
+  void queuePresetCommand(bool store, int index, std::string name,
+                          std::string sender);
+
   osc::Recv *mServer;
   std::vector<PresetHandler *> mPresetHandlers;
   //	std::mutex mServerLock;
@@ -136,6 +171,10 @@ class PresetServer : public osc::PacketHandler, public OSCNotifier {
   std::vector<std::string> mDisabledListeners;
 
   ParameterServer *mParameterServer;
+
+  std::atomic<bool> mAcknowledge{true};
+  // Declared last so the worker thread stops before other members go away
+  CommandQueue mCommands;
 };
 
 } //namespace al
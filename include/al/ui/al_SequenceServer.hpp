@@ -3,6 +3,7 @@
 
 #include <string>
 
+#include "al/ui/al_CommandQueue.hpp"
 #include "al/ui/al_ParameterServer.hpp"
 #include "al/ui/al_PresetSequencer.hpp"
 #include "al/ui/al_SequenceRecorder.hpp"
@@ -11,6 +12,15 @@ namespace al {
 
 /// SequenceServer
 /// @ingroup UI
+///
+/// Messages are received on the receive thread shared by every osc::Recv by
+/// default, see osc::Recv::sharedThread(). They are handled in order on a
+/// worker thread, so loading a sequence doesn't hold up the messages that
+/// follow, nor messages to other sockets. A play request
+/// (<address> with a sequence name) waiting at the end of the queue is
+/// replaced by a later one, all other messages run in the order received.
+/// When a message has been handled, listeners receive <address>/ack with the
+/// address of the message, for example /sequence/ack "/sequence".
 class SequenceServer : public osc::PacketHandler, public OSCNotifier {
  public:
   /**
@@ -72,6 +82,22 @@ class SequenceServer : public osc::PacketHandler, public OSCNotifier {
   void setAddress(std::string address);
   std::string getAddress();
 
+  /// Send <address>/ack to listeners when a message has been handled
+  void acknowledgeCommands(bool acknowledge) { mAcknowledge = acknowledge; }
+
+  /// Number of messages waiting for the worker thread
+  size_t queueDepth() { return mCommands.depth(); }
+  /// Largest queueDepth() since resetQueueCounters()
+  size_t maxQueueDepth() { return mCommands.maxDepth(); }
+  /// Number of messages handled
+  uint64_t processedCommands() { return mCommands.processed(); }
+  /// Number of messages dropped because a later one replaced them
+  uint64_t coalescedCommands() { return mCommands.coalesced(); }
+  void resetQueueCounters() { mCommands.resetCounters(); }
+
+  /// Block until the messages received so far have been handled
+  void waitForCommands() { mCommands.waitForCommands(); }
+
  protected:
   //	void attachPacketHandler(osc::PacketHandler *handler);
   static void changeCallback(int value, void *sender, void *userData);
@@ -88,6 +114,12 @@ class SequenceServer : public osc::PacketHandler, public OSCNotifier {
   //	std::mutex mHandlerLock;
   //	std::vector<osc::PacketHandler *> mHandlers;
   std::vector<osc::MessageConsumer *> mConsumers;
+
+  std::atomic<bool> mAcknowledge{true};
+  // Declared last so the worker thread stops before other members go away
+  CommandQueue mCommands;
+
+  void processMessage(osc::Message &m);
 };
 
 }  // namespace al
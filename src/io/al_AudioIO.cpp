@@ -1,4 +1,5 @@
 #include "al/io/al_AudioIO.hpp"
+#include "al/system/al_Denormals.hpp"
 
 #include <algorithm>
 #include <cassert>
@@ -402,6 +403,11 @@ static int paCallback(const void *input, void *output, unsigned long frameCount,
                       PaStreamCallbackFlags statusFlags, void *userData) {
   AudioIO &io = *(AudioIO *)userData;
 
+  if (statusFlags & (paInputUnderflow | paInputOverflow | paOutputUnderflow |
+                     paOutputOverflow)) {
+    io.callbackTelemetry().reportXrun();
+  }
+
   assert(frameCount == (unsigned)io.framesPerBuffer());
   const float **inBuffers = (const float **)input;
   for (int i = 0; i < io.channelsInDevice(); i++) {
@@ -415,16 +421,8 @@ static int paCallback(const void *input, void *output, unsigned long frameCount,
 
   // apply smoothly-ramped gain to all output channels
   if (io.usingGain()) {
-    float dgain = (io.mGain - io.mGainPrev) / frameCount;
-
     for (int j = 0; j < io.channelsOutDevice(); ++j) {
-      float *out = io.outBuffer(j);
-      float gain = io.mGainPrev;
-
-      for (unsigned i = 0; i < frameCount; ++i) {
-        out[i] *= gain;
-        gain += dgain;
-      }
+      rampGainBlock(io.outBuffer(j), io.mGainPrev, io.mGain, frameCount);
     }
 
     io.mGainPrev = io.mGain;
@@ -432,22 +430,27 @@ static int paCallback(const void *input, void *output, unsigned long frameCount,
 
   // kill pesky nans so we don't hurt anyone's ears
   if (io.zeroNANs()) {
-    for (unsigned i = 0; i < unsigned(frameCount * io.channelsOutDevice());
-         ++i) {
-      float &s = (&io.out(0, 0))[i];
-      // if(isnan(s)) s = 0.f;
-      if (s != s) s = 0.f;  // portable isnan; only nans do not equal themselves
+    for (int j = 0; j < io.channelsOutDevice(); ++j) {
+      float *out = io.outBuffer(j);
+      for (unsigned i = 0; i < frameCount; ++i) {
+        float &s = out[i];
+        // if(isnan(s)) s = 0.f;
+        if (s != s)
+          s = 0.f;  // portable isnan; only nans do not equal themselves
+      }
     }
   }
 
   if (io.clipOut()) {
-    for (unsigned i = 0; i < unsigned(frameCount * io.channelsOutDevice());
-         ++i) {
-      float &s = (&io.out(0, 0))[i];
-      if (s < -1.f)
-        s = -1.f;
-      else if (s > 1.f)
-        s = 1.f;
+    for (int j = 0; j < io.channelsOutDevice(); ++j) {
+      float *out = io.outBuffer(j);
+      for (unsigned i = 0; i < frameCount; ++i) {
+        float &s = out[i];
+        if (s < -1.f)
+          s = -1.f;
+        else if (s > 1.f)
+          s = 1.f;
+      }
     }
   }
 
@@ -661,20 +664,22 @@ int AudioBackend::numDevices() {
 static int rtaudioCallback(void *output, void *input, unsigned int frameCount,
                            double streamTime, RtAudioStreamStatus status,
                            void *userData) {
+  AudioIO &io = *(AudioIO *)userData;
+
   if (status) {
+    io.callbackTelemetry().reportXrun();
     std::cout << "Stream underflow detected!" << std::endl;
   }
 
-  AudioIO &io = *(AudioIO *)userData;
-
   assert(frameCount == (unsigned)io.framesPerBuffer());
 
   if (input != NULL) {
     const float *inBuffers = (const float *)input;
     float *hwInBuffer = const_cast<float *>(io.inBuffer(0));
+    const unsigned int stride = io.channelStride();
     for (unsigned int frame = 0; frame < io.framesPerBuffer(); frame++) {
       for (int i = 0; i < io.channelsInDevice(); i++) {
-        hwInBuffer[i * frameCount + frame] = *inBuffers++;
+        hwInBuffer[i * stride + frame] = *inBuffers++;
       }
     }
   }
@@ -685,16 +690,8 @@ static int rtaudioCallback(void *output, void *input, unsigned int frameCount,
 
   // apply smoothly-ramped gain to all output channels
   if (io.usingGain()) {
-    float dgain = (io.mGain - io.mGainPrev) / frameCount;
-
     for (int j = 0; j < io.channelsOutDevice(); ++j) {
-      float *out = io.outBuffer(j);
-      float gain = io.mGainPrev;
-
-      for (unsigned i = 0; i < frameCount; ++i) {
-        out[i] *= gain;
-        gain += dgain;
-      }
+      rampGainBlock(io.outBuffer(j), io.mGainPrev, io.mGain, frameCount);
     }
 
     io.mGainPrev = io.mGain;
@@ -702,31 +699,37 @@ static int rtaudioCallback(void *output, void *input, unsigned int frameCount,
 
   // kill pesky nans so we don't hurt anyone's ears
   if (io.zeroNANs()) {
-    for (unsigned i = 0; i < unsigned(frameCount * io.channelsOutDevice());
-         ++i) {
-      float &s = (&io.out(0, 0))[i];
-      // if(isnan(s)) s = 0.f;
-      if (s != s) s = 0.f;  // portable isnan; only nans do not equal themselves
+    for (int j = 0; j < io.channelsOutDevice(); ++j) {
+      float *out = io.outBuffer(j);
+      for (unsigned i = 0; i < frameCount; ++i) {
+        float &s = out[i];
+        // if(isnan(s)) s = 0.f;
+        if (s != s)
+          s = 0.f;  // portable isnan; only nans do not equal themselves
+      }
     }
   }
 
   if (io.clipOut()) {
-    for (unsigned i = 0; i < unsigned(frameCount * io.channelsOutDevice());
-         ++i) {
-      float &s = (&io.out(0, 0))[i];
-      if (s < -1.f)
-        s = -1.f;
-      else if (s > 1.f)
-        s = 1.f;
+    for (int j = 0; j < io.channelsOutDevice(); ++j) {
+      float *out = io.outBuffer(j);
+      for (unsigned i = 0; i < frameCount; ++i) {
+        float &s = out[i];
+        if (s < -1.f)
+          s = -1.f;
+        else if (s > 1.f)
+          s = 1.f;
+      }
     }
   }
 
   float *outBuffers = (float *)output;
 
   float *finalOutBuffer = const_cast<float *>(io.outBuffer(0));
+  const unsigned int stride = io.channelStride();
   for (unsigned int frame = 0; frame < io.framesPerBuffer(); frame++) {
     for (int i = 0; i < io.channelsOutDevice(); i++) {
-      *outBuffers++ = finalOutBuffer[i * frameCount + frame];
+      *outBuffers++ = finalOutBuffer[i * stride + frame];
     }
   }
 
@@ -943,7 +946,9 @@ AudioIO::AudioIO()
       mZeroNANs(true),
       mClipOut(true),
       mAutoZeroOut(true),
-      mBackend{std::make_unique<AudioBackend>()} {}
+      mBackend{std::make_unique<AudioBackend>()} {
+  telemetry(&mTelemetryData);
+}
 
 AudioIO::~AudioIO() { close(); }
 
@@ -1153,6 +1158,8 @@ void AudioIO::framesPerBuffer(unsigned int n) {
 
 bool AudioIO::start() {
   if (!mBackend->isOpen()) open();
+  // Backends may run callbacks on a new thread after each start
+  mThreadConfigPending = !threadConfig().isDefault();
   return mBackend->start(mFramesPerSecond, mFramesPerBuffer, this);
 }
 
@@ -1182,6 +1189,14 @@ void AudioIO::print() const {
 
 // void AudioIO::processAudio(){ frame(0); if(callback) callback(*this); }
 void AudioIO::processAudio() {
+  if (mThreadConfigPending && mThreadConfigLock.try_lock()) {
+    // Memory is locked by threadConfig() on the caller's thread
+    mThreadConfigApplied = mThreadConfig.applyThreadSettingsToCurrentThread();
+    mThreadConfigPending = false;
+    mThreadConfigLock.unlock();
+  }
+  ScopedDenormalFlush denormalFlush;
+  mTelemetryData.beginCallback();
   frame(0);
   if (callback) callback(*this);
 
@@ -1190,17 +1205,38 @@ void AudioIO::processAudio() {
     frame(0);
     (*iter++)->onAudioCB(*this);
   }
+  mTelemetryData.endCallback(secondsPerBuffer());
 }
 
 bool AudioIO::isOpen() { return mBackend->isOpen(); }
 
 bool AudioIO::isRunning() { return mBackend->isRunning(); }
 
-double AudioIO::cpu() const { return mBackend->cpu(); }
+double AudioIO::cpu() const {
+  // Prefer measured callback load, backends may not report CPU usage
+  if (mTelemetryData.callbacks() > 0) {
+    return mTelemetryData.load();
+  }
+  return mBackend->cpu();
+}
 bool AudioIO::zeroNANs() const { return mZeroNANs; }
 
 void AudioIO::clipOut(bool v) { mClipOut = v; }
 
+void AudioIO::threadConfig(const ThreadConfig &v) {
+  if (v.lockMemory && !ThreadConfig::lockProcessMemory()) {
+    std::cerr << "WARNING: AudioIO could not lock memory" << std::endl;
+  }
+  std::unique_lock<std::mutex> lk(mThreadConfigLock);
+  mThreadConfig = v;
+  mThreadConfigPending = true;
+}
+
+ThreadConfig AudioIO::threadConfig() {
+  std::unique_lock<std::mutex> lk(mThreadConfigLock);
+  return mThreadConfig;
+}
+
 double AudioIO::time() const {
   assert(mBackend);
   return mBackend->time();
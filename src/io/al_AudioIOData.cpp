@@ -43,6 +43,7 @@ AudioIOData::AudioIOData(void *userData)
       mUser(userData),
       mFrame(0),
       mFramesPerBuffer(512),
+      mChannelStride(512),
       mFramesPerSecond(44100),
       mBufI(nullptr),
       mBufO(nullptr),
@@ -50,21 +51,52 @@ AudioIOData::AudioIOData(void *userData)
       mBufT(nullptr),
       mNumI(0),
       mNumO(0),
-      mNumB(0) {}
+      mNumB(0) {
+  mBufT = allocateChannels(1);
+}
 
 AudioIOData::~AudioIOData() {
-  deleteBuf(mBufI);
-  deleteBuf(mBufO);
-  deleteBuf(mBufB);
-  deleteBuf(mBufT);
+  freeChannels(mBufI);
+  freeChannels(mBufO);
+  freeChannels(mBufB);
+  freeChannels(mBufT);
+}
+
+float *AudioIOData::allocateChannels(unsigned int numChannels) {
+  size_t numBytes = size_t(numChannels) * mChannelStride * sizeof(float);
+  if (numBytes == 0) {
+    return nullptr;
+  }
+  void *buf = nullptr;
+#ifdef AL_WINDOWS
+  buf = _aligned_malloc(numBytes, BUFFER_ALIGNMENT);
+#else
+  if (posix_memalign(&buf, BUFFER_ALIGNMENT, numBytes) != 0) {
+    buf = nullptr;
+  }
+#endif
+  if (buf) {
+    memset(buf, 0, numBytes);
+  }
+  return static_cast<float *>(buf);
+}
+
+void AudioIOData::freeChannels(float *&buf) {
+#ifdef AL_WINDOWS
+  _aligned_free(buf);
+#else
+  ::free(buf);
+#endif
+  buf = nullptr;
 }
 
-void AudioIOData::zeroBus() { zero(mBufB, framesPerBuffer() * mNumB); }
-void AudioIOData::zeroOut() { zero(mBufO, channelsOut() * framesPerBuffer()); }
+void AudioIOData::zeroBus() { zero(mBufB, mChannelStride * mNumB); }
+void AudioIOData::zeroOut() { zero(mBufO, mChannelStride * channelsOut()); }
 
 void AudioIOData::channelsBus(int num) {
-  resize(mBufB, num * mFramesPerBuffer);
-  mNumB = num;
+  freeChannels(mBufB);
+  mBufB = allocateChannels(num);
+  mNumB = mBufB ? num : 0;
 }
 
 void AudioIOData::channels(int num, bool forOutput) {
@@ -92,11 +124,14 @@ void AudioIOData::framesPerSecond(
 
 void AudioIOData::framesPerBuffer(unsigned int n) {
   if (framesPerBuffer() != n) {
+    const unsigned int alignFrames = BUFFER_ALIGNMENT / sizeof(float);
     mFramesPerBuffer = n;
+    mChannelStride = (n + alignFrames - 1) / alignFrames * alignFrames;
     resizeBuffer(true);
     resizeBuffer(false);
     channelsBus(AudioIOData::channelsBus());
-    resize(mBufT, mFramesPerBuffer);
+    freeChannels(mBufT);
+    mBufT = allocateChannels(1);
   }
 }
 
@@ -104,11 +139,10 @@ void AudioIOData::resizeBuffer(bool forOutput) {
   float *&buffer = forOutput ? mBufO : mBufI;
   unsigned int &chans = forOutput ? mNumO : mNumI;
 
+  freeChannels(buffer);
   if (chans > 0 && mFramesPerBuffer > 0) {
-    int n = resize(buffer, chans * mFramesPerBuffer);
-    if (0 == n) chans = 0;
-  } else {
-    deleteBuf(buffer);
+    buffer = allocateChannels(chans);
+    if (!buffer) chans = 0;
   }
 }
 
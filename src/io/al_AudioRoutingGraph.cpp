@@ -0,0 +1,171 @@
+#include "al/io/al_AudioRoutingGraph.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace al;
+
+AudioRoutingGraph::AudioRoutingGraph() {}
+
+AudioRoutingGraph::~AudioRoutingGraph() {
+  collectRetired();
+  std::unique_ptr<Schedule> pending(mPending.exchange(nullptr));
+  std::unique_ptr<Schedule> active(mActive);
+  mActive = nullptr;
+}
+
+AudioRoutingGraph &AudioRoutingGraph::send(unsigned int voiceOutChan,
+                                           unsigned int bus, float gain) {
+  std::unique_lock<std::mutex> lk(mRouteLock);
+  mRoutes.push_back({SEND, voiceOutChan, bus, gain, nullptr});
+  return *this;
+}
+
+AudioRoutingGraph &AudioRoutingGraph::busToBus(unsigned int srcBus,
+                                               unsigned int dstBus, float gain,
+                                               BusProcessor processor) {
+  std::unique_lock<std::mutex> lk(mRouteLock);
+  mRoutes.push_back({BUS_TO_BUS, srcBus, dstBus, gain, processor});
+  return *this;
+}
+
+AudioRoutingGraph &AudioRoutingGraph::busToOutput(unsigned int bus,
+                                                  unsigned int outChan,
+                                                  float gain) {
+  std::unique_lock<std::mutex> lk(mRouteLock);
+  mRoutes.push_back({BUS_TO_OUTPUT, bus, outChan, gain, nullptr});
+  return *this;
+}
+
+void AudioRoutingGraph::clear() {
+  std::unique_lock<std::mutex> lk(mRouteLock);
+  mRoutes.clear();
+}
+
+bool AudioRoutingGraph::commit() {
+  std::unique_lock<std::mutex> lk(mRouteLock);
+  std::unique_ptr<Schedule> schedule = std::make_unique<Schedule>();
+
+  // Sort bus to bus routes so that all routes writing to a bus run before any
+  // route reading from it (Kahn's algorithm over bus indices)
+  std::vector<const Route *> busRoutes;
+  unsigned int numBuses = 0;
+  for (auto &route : mRoutes) {
+    if (route.type == BUS_TO_BUS) {
+      busRoutes.push_back(&route);
+      numBuses = std::max(numBuses, std::max(route.src, route.dst) + 1);
+    }
+  }
+  std::vector<unsigned int> inDegree(numBuses, 0);
+  for (auto *route : busRoutes) {
+    inDegree[route->dst]++;
+  }
+  std::vector<unsigned int> readyBuses;
+  for (unsigned int bus = 0; bus < numBuses; bus++) {
+    if (inDegree[bus] == 0) {
+      readyBuses.push_back(bus);
+    }
+  }
+  while (readyBuses.size() > 0) {
+    unsigned int bus = readyBuses.back();
+    readyBuses.pop_back();
+    for (auto *route : busRoutes) {
+      if (route->src == bus) {
+        MixOp op{route->src, route->dst, route->gain, -1};
+        if (route->processor) {
+          op.processor = int(schedule->processors.size());
+          schedule->processors.push_back(route->processor);
+        }
+        schedule->busOps.push_back(op);
+        if (--inDegree[route->dst] == 0) {
+          readyBuses.push_back(route->dst);
+        }
+      }
+    }
+  }
+  if (schedule->busOps.size() != busRoutes.size()) {
+    std::cerr << "ERROR: AudioRoutingGraph bus routes contain a cycle. "
+                 "Routes not committed."
+              << std::endl;
+    return false;
+  }
+
+  for (auto &route : mRoutes) {
+    if (route.type == SEND) {
+      schedule->sends.push_back({route.src, route.dst, route.gain, -1});
+    } else if (route.type == BUS_TO_OUTPUT) {
+      schedule->outOps.push_back({route.src, route.dst, route.gain, -1});
+    }
+  }
+
+  // A pending schedule that the audio thread has not picked up yet can be
+  // freed here, as the audio thread only takes schedules through exchange()
+  std::unique_ptr<Schedule> unused(mPending.exchange(schedule.release()));
+  collectRetired();
+  return true;
+}
+
+void AudioRoutingGraph::acquire() {
+  // Only swap if there is room to hand back the previous schedule, otherwise
+  // try again on the next block
+  if (mRetired.writeSpace() < sizeof(Schedule *)) {
+    return;
+  }
+  Schedule *newSchedule = mPending.exchange(nullptr);
+  if (newSchedule) {
+    Schedule *previous = mActive;
+    mActive = newSchedule;
+    if (previous) {
+      mRetired.write((const char *)&previous, sizeof(Schedule *));
+    }
+  }
+}
+
+void AudioRoutingGraph::processSends(const AudioIOData &voiceIO,
+                                     AudioIOData &io,
+                                     unsigned int offset) const {
+  if (!mActive || offset >= io.framesPerBuffer()) {
+    return;
+  }
+  unsigned int numFrames = (unsigned int)io.framesPerBuffer() - offset;
+  for (auto &op : mActive->sends) {
+    if (op.src < voiceIO.channelsOut() && op.dst < io.channelsBus()) {
+      mixBlock(io.busBuffer(op.dst) + offset, voiceIO.outBuffer(op.src) + offset,
+               op.gain, numFrames);
+    }
+  }
+}
+
+void AudioRoutingGraph::processBuses(AudioIOData &io) const {
+  if (!mActive) {
+    return;
+  }
+  unsigned int numFrames = (unsigned int)io.framesPerBuffer();
+  for (auto &op : mActive->busOps) {
+    if (op.src < io.channelsBus() && op.dst < io.channelsBus()) {
+      const float *src = io.busBuffer(op.src);
+      if (op.processor >= 0) {
+        float *temp = io.tempBuffer();
+        if (!temp) {
+          continue;
+        }
+        mActive->processors[op.processor](src, temp, numFrames);
+        src = temp;
+      }
+      mixBlock(io.busBuffer(op.dst), src, op.gain, numFrames);
+    }
+  }
+  for (auto &op : mActive->outOps) {
+    if (op.src < io.channelsBus() && op.dst < io.channelsOut()) {
+      mixBlock(io.outBuffer(op.dst), io.busBuffer(op.src), op.gain, numFrames);
+    }
+  }
+}
+
+void AudioRoutingGraph::collectRetired() {
+  Schedule *retired;
+  while (mRetired.read((char *)&retired, sizeof(Schedule *)) ==
+         sizeof(Schedule *)) {
+    std::unique_ptr<Schedule> toFree(retired);
+  }
+}
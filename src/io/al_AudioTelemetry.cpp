@@ -0,0 +1,158 @@
+#include "al/io/al_AudioTelemetry.hpp"
+
+#include <cstring>
+
+using namespace al;
+
+AudioTelemetry::ScopedSpan::ScopedSpan(AudioTelemetry *telemetry,
+                                       const char *name)
+    : mTelemetry(telemetry), mId(-1) {
+  if (mTelemetry) {
+    mId = mTelemetry->spanId(name);
+    mStart = Clock::now();
+  }
+}
+
+void AudioTelemetry::ScopedSpan::stop() {
+  if (mTelemetry && mId >= 0) {
+    mTelemetry->addSpanTime(mId, Clock::now() - mStart);
+  }
+  mTelemetry = nullptr;
+}
+
+AudioTelemetry::AudioTelemetry() {
+  for (auto &bin : mHistogram) {
+    bin.store(0, std::memory_order_relaxed);
+  }
+}
+
+void AudioTelemetry::beginCallback() {
+  if (mResetRequested.exchange(false, std::memory_order_acquire)) {
+    clear();
+  }
+  mCallbackStart = Clock::now();
+}
+
+void AudioTelemetry::endCallback(double period) {
+  Clock::time_point end = Clock::now();
+  if (period <= 0.0) {
+    return;
+  }
+  double elapsed = std::chrono::duration<double>(end - mCallbackStart).count();
+  float load = float(elapsed / period);
+
+  mPeriod.store(period, std::memory_order_relaxed);
+  mLastLoad.store(load, std::memory_order_relaxed);
+  if (load > mMaxLoad.load(std::memory_order_relaxed)) {
+    mMaxLoad.store(load, std::memory_order_relaxed);
+  }
+  mLoadSum.store(mLoadSum.load(std::memory_order_relaxed) + load,
+                 std::memory_order_relaxed);
+  float smoothed = mSmoothedLoad.load(std::memory_order_relaxed);
+  mSmoothedLoad.store(smoothed + 0.05f * (load - smoothed),
+                      std::memory_order_relaxed);
+  if (load > 1.0f) {
+    mDeadlineMisses.fetch_add(1, std::memory_order_relaxed);
+  }
+  unsigned int bin = (unsigned int)(load * BINS_PER_PERIOD);
+  if (bin >= HISTOGRAM_BINS) {
+    bin = HISTOGRAM_BINS - 1;
+  }
+  mHistogram[bin].fetch_add(1, std::memory_order_relaxed);
+
+  for (auto &span : mSpans) {
+    if (!span.name.load(std::memory_order_acquire)) {
+      break;
+    }
+    int64_t ns = span.pendingNs.exchange(0, std::memory_order_relaxed);
+    float spanLoad = float(ns * 1.0e-9 / period);
+    span.lastLoad.store(spanLoad, std::memory_order_relaxed);
+    if (spanLoad > span.maxLoad.load(std::memory_order_relaxed)) {
+      span.maxLoad.store(spanLoad, std::memory_order_relaxed);
+    }
+    span.loadSum.store(span.loadSum.load(std::memory_order_relaxed) + spanLoad,
+                       std::memory_order_relaxed);
+  }
+  // Publish callback count last so snapshots see complete sums
+  mCallbacks.fetch_add(1, std::memory_order_release);
+}
+
+int AudioTelemetry::spanId(const char *name) {
+  for (unsigned int i = 0; i < MAX_SPANS; i++) {
+    const char *current = mSpans[i].name.load(std::memory_order_acquire);
+    if (!current) {
+      // Claim the free slot. If another thread got there first, current is
+      // updated to its name and checked below
+      if (mSpans[i].name.compare_exchange_strong(current, name,
+                                                 std::memory_order_acq_rel)) {
+        return int(i);
+      }
+    }
+    if (current == name || std::strcmp(current, name) == 0) {
+      return int(i);
+    }
+  }
+  return -1;
+}
+
+void AudioTelemetry::addSpanTime(int id, Clock::duration duration) {
+  if (id < 0 || id >= int(MAX_SPANS)) {
+    return;
+  }
+  mSpans[id].pendingNs.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+      std::memory_order_relaxed);
+}
+
+AudioTelemetry::Snapshot AudioTelemetry::snapshot() const {
+  Snapshot s;
+  s.callbacks = mCallbacks.load(std::memory_order_acquire);
+  s.xruns = mXruns.load(std::memory_order_relaxed);
+  s.deadlineMisses = mDeadlineMisses.load(std::memory_order_relaxed);
+  s.period = mPeriod.load(std::memory_order_relaxed);
+  s.lastLoad = mLastLoad.load(std::memory_order_relaxed);
+  s.maxLoad = mMaxLoad.load(std::memory_order_relaxed);
+  s.smoothedLoad = mSmoothedLoad.load(std::memory_order_relaxed);
+  if (s.callbacks > 0) {
+    s.meanLoad = float(mLoadSum.load(std::memory_order_relaxed) / s.callbacks);
+  }
+  for (unsigned int i = 0; i < HISTOGRAM_BINS; i++) {
+    s.histogram[i] = mHistogram[i].load(std::memory_order_relaxed);
+  }
+  for (auto &span : mSpans) {
+    const char *name = span.name.load(std::memory_order_acquire);
+    if (!name) {
+      break;
+    }
+    SpanStats stats;
+    stats.name = name;
+    stats.lastLoad = span.lastLoad.load(std::memory_order_relaxed);
+    stats.maxLoad = span.maxLoad.load(std::memory_order_relaxed);
+    stats.meanLoad =
+        s.callbacks > 0
+            ? float(span.loadSum.load(std::memory_order_relaxed) / s.callbacks)
+            : 0.0f;
+    s.spans.push_back(stats);
+  }
+  return s;
+}
+
+void AudioTelemetry::clear() {
+  mCallbacks.store(0, std::memory_order_relaxed);
+  mXruns.store(0, std::memory_order_relaxed);
+  mDeadlineMisses.store(0, std::memory_order_relaxed);
+  mLastLoad.store(0.0f, std::memory_order_relaxed);
+  mMaxLoad.store(0.0f, std::memory_order_relaxed);
+  mSmoothedLoad.store(0.0f, std::memory_order_relaxed);
+  mLoadSum.store(0.0, std::memory_order_relaxed);
+  for (auto &bin : mHistogram) {
+    bin.store(0, std::memory_order_relaxed);
+  }
+  // Span names are kept, only their statistics are cleared
+  for (auto &span : mSpans) {
+    span.pendingNs.store(0, std::memory_order_relaxed);
+    span.lastLoad.store(0.0f, std::memory_order_relaxed);
+    span.maxLoad.store(0.0f, std::memory_order_relaxed);
+    span.loadSum.store(0.0, std::memory_order_relaxed);
+  }
+}
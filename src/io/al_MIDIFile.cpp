@@ -0,0 +1,365 @@
+#include "al/io/al_MIDIFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace al;
+
+static uint32_t readU32(const uint8_t *p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+         (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static uint16_t readU16(const uint8_t *p) {
+  return uint16_t((p[0] << 8) | p[1]);
+}
+
+// Read a variable length quantity. Returns false if it runs past end
+static bool readVLQ(const uint8_t *&p, const uint8_t *end, uint32_t &value) {
+  value = 0;
+  for (int i = 0; i < 4; i++) {
+    if (p >= end) {
+      return false;
+    }
+    uint8_t byte = *p++;
+    value = (value << 7) | (byte & 0x7F);
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void writeVLQ(std::vector<uint8_t> &out, uint64_t value) {
+  if (value > 0x0FFFFFFF) {
+    value = 0x0FFFFFFF;  // Largest delta time SMF can store
+  }
+  uint8_t bytes[4];
+  int count = 0;
+  bytes[count++] = value & 0x7F;
+  while (value >>= 7) {
+    bytes[count++] = (value & 0x7F) | 0x80;
+  }
+  while (count > 0) {
+    out.push_back(bytes[--count]);
+  }
+}
+
+static void writeU32(std::vector<uint8_t> &out, uint32_t value) {
+  out.push_back(uint8_t(value >> 24));
+  out.push_back(uint8_t(value >> 16));
+  out.push_back(uint8_t(value >> 8));
+  out.push_back(uint8_t(value));
+}
+
+double MIDIFileEvent::tempo() const {
+  if (!isMeta() || metaType() != META_TEMPO || size < 3) {
+    return 0.0;
+  }
+  uint32_t microsecondsPerBeat =
+      (uint32_t(data[0]) << 16) | (uint32_t(data[1]) << 8) | data[2];
+  return microsecondsPerBeat > 0 ? 60.0e6 / microsecondsPerBeat : 0.0;
+}
+
+// MIDIFile -------------------------------------------------------------------
+
+bool MIDIFile::open(const std::string &fileName) {
+  std::ifstream f(fileName, std::ios::binary | std::ios::ate);
+  if (!f.is_open()) {
+    std::cerr << "ERROR: Could not open MIDI file: " << fileName << std::endl;
+    mTracks.clear();
+    return false;
+  }
+  std::streamsize size = f.tellg();
+  f.seekg(0);
+  std::vector<uint8_t> data(size_t(std::max(std::streamsize(0), size)));
+  if (!f.read((char *)data.data(), size)) {
+    std::cerr << "ERROR: Could not read MIDI file: " << fileName << std::endl;
+    mTracks.clear();
+    return false;
+  }
+  mData.swap(data);
+  if (!open(nullptr, 0)) {
+    std::cerr << "ERROR: Not a valid MIDI file: " << fileName << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool MIDIFile::open(const uint8_t *data, size_t size) {
+  if (data) {
+    mData.assign(data, data + size);
+  }
+  mTracks.clear();
+  const uint8_t *p = mData.data();
+  const uint8_t *end = p + mData.size();
+  if (mData.size() < 14 || memcmp(p, "MThd", 4) != 0 || readU32(p + 4) < 6 ||
+      readU32(p + 4) > mData.size() - 8) {
+    return false;
+  }
+  mFormat = readU16(p + 8);
+  uint16_t numTracks = readU16(p + 10);
+  uint16_t division = readU16(p + 12);
+  if (division & 0x8000) {
+    // SMPTE: negative frames per second in the high byte, ticks per frame in
+    // the low byte
+    int framesPerSecond = -int8_t(division >> 8);
+    double fps = framesPerSecond == 29 ? 29.97 : framesPerSecond;
+    mTicksPerBeat = 0;
+    mTicksPerSecond = fps * (division & 0xFF);
+  } else {
+    mTicksPerBeat = division;
+    mTicksPerSecond = 0.0;
+  }
+  p += 8 + readU32(p + 4);
+
+  // Index track chunks, skipping unknown chunk types
+  while (p + 8 <= end && mTracks.size() < numTracks) {
+    uint32_t chunkSize = readU32(p + 4);
+    if (size_t(end - (p + 8)) < chunkSize) {
+      chunkSize = uint32_t(end - (p + 8));  // Truncated file, read what's there
+    }
+    if (memcmp(p, "MTrk", 4) == 0) {
+      mTracks.push_back({size_t(p + 8 - mData.data()), chunkSize});
+    }
+    p += 8 + chunkSize;
+  }
+  if ((!isSMPTE() && mTicksPerBeat == 0) || mTracks.size() == 0) {
+    mTracks.clear();
+    return false;
+  }
+  return true;
+}
+
+bool MIDIFile::read(const EventHandler &handler) const {
+  double ticksToBeats =
+      isSMPTE() ? 1.0 / mTicksPerSecond : 1.0 / mTicksPerBeat;
+  for (size_t trackIndex = 0; trackIndex < mTracks.size(); trackIndex++) {
+    const Track &track = mTracks[trackIndex];
+    const uint8_t *p = mData.data() + track.offset;
+    const uint8_t *end = p + track.size;
+    MIDIFileEvent event;
+    event.track = uint16_t(trackIndex);
+    event.tick = 0;
+    uint8_t runningStatus = 0;
+    while (p < end) {
+      uint32_t delta;
+      if (!readVLQ(p, end, delta) || p >= end) {
+        return false;
+      }
+      event.tick += delta;
+      event.beat = event.tick * ticksToBeats;
+      event.data = nullptr;
+      event.size = 0;
+      event.data1 = event.data2 = 0;
+
+      uint8_t status = *p;
+      if (status & 0x80) {
+        p++;
+      } else if (runningStatus) {
+        status = runningStatus;  // Data byte, reuse previous status
+      } else {
+        return false;
+      }
+      event.status = status;
+
+      if (status == MIDIFileEvent::META) {
+        uint32_t length;
+        if (p >= end) {
+          return false;
+        }
+        event.data1 = *p++;
+        if (!readVLQ(p, end, length) || uint32_t(end - p) < length) {
+          return false;
+        }
+        event.data = p;
+        event.size = length;
+        p += length;
+        handler(event);
+        if (event.data1 == MIDIFileEvent::META_END_OF_TRACK) {
+          break;
+        }
+      } else if (status == MIDIFileEvent::SYSEX ||
+                 status == MIDIFileEvent::SYSEX_ESCAPE) {
+        uint32_t length;
+        if (!readVLQ(p, end, length) || uint32_t(end - p) < length) {
+          return false;
+        }
+        event.data = p;
+        event.size = length;
+        p += length;
+        runningStatus = 0;
+        handler(event);
+      } else if (status >= 0x80 && status < 0xF0) {
+        runningStatus = status;
+        uint8_t type = status & 0xF0;
+        int numDataBytes = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+        if (end - p < numDataBytes) {
+          return false;
+        }
+        event.data1 = *p++ & 0x7F;
+        if (numDataBytes == 2) {
+          event.data2 = *p++ & 0x7F;
+        }
+        handler(event);
+      } else {
+        return false;  // System common/real time messages are not valid here
+      }
+    }
+  }
+  return true;
+}
+
+// MIDIFileWriter -------------------------------------------------------------
+
+int MIDIFileWriter::addTrack(std::string name) {
+  mTracks.emplace_back();
+  mTracks.back().name = name;
+  return int(mTracks.size()) - 1;
+}
+
+void MIDIFileWriter::noteOn(int track, uint64_t tick, int channel,
+                            int noteNumber, int velocity) {
+  uint8_t bytes[3] = {uint8_t(0x90 | (channel & 0x0F)),
+                      uint8_t(noteNumber & 0x7F), uint8_t(velocity & 0x7F)};
+  add(track, tick, bytes, 3);
+}
+
+void MIDIFileWriter::noteOff(int track, uint64_t tick, int channel,
+                             int noteNumber, int velocity) {
+  uint8_t bytes[3] = {uint8_t(0x80 | (channel & 0x0F)),
+                      uint8_t(noteNumber & 0x7F), uint8_t(velocity & 0x7F)};
+  add(track, tick, bytes, 3);
+}
+
+void MIDIFileWriter::controlChange(int track, uint64_t tick, int channel,
+                                   int controlNumber, int value) {
+  uint8_t bytes[3] = {uint8_t(0xB0 | (channel & 0x0F)),
+                      uint8_t(controlNumber & 0x7F), uint8_t(value & 0x7F)};
+  add(track, tick, bytes, 3);
+}
+
+void MIDIFileWriter::programChange(int track, uint64_t tick, int channel,
+                                   int program) {
+  uint8_t bytes[2] = {uint8_t(0xC0 | (channel & 0x0F)),
+                      uint8_t(program & 0x7F)};
+  add(track, tick, bytes, 2);
+}
+
+void MIDIFileWriter::tempo(int track, uint64_t tick, double bpm) {
+  if (bpm <= 0.0) {
+    return;
+  }
+  uint32_t microsecondsPerBeat = uint32_t(60.0e6 / bpm + 0.5);
+  uint8_t bytes[6] = {MIDIFileEvent::META,
+                      MIDIFileEvent::META_TEMPO,
+                      3,
+                      uint8_t(microsecondsPerBeat >> 16),
+                      uint8_t(microsecondsPerBeat >> 8),
+                      uint8_t(microsecondsPerBeat)};
+  add(track, tick, bytes, 6);
+}
+
+void MIDIFileWriter::timeSignature(int track, uint64_t tick, int numerator,
+                                   int denominator) {
+  uint8_t denominatorPower = 0;
+  while ((1 << denominatorPower) < denominator && denominatorPower < 7) {
+    denominatorPower++;
+  }
+  uint8_t bytes[7] = {MIDIFileEvent::META,
+                      MIDIFileEvent::META_TIME_SIGNATURE,
+                      4,
+                      uint8_t(numerator),
+                      denominatorPower,
+                      24,  // MIDI clocks per metronome click
+                      8};  // 32nd notes per quarter note
+  add(track, tick, bytes, 7);
+}
+
+void MIDIFileWriter::add(int track, uint64_t tick, const uint8_t *bytes,
+                         uint8_t size) {
+  if (track < 0 || track >= int(mTracks.size())) {
+    std::cerr << "ERROR: MIDIFileWriter invalid track " << track << std::endl;
+    return;
+  }
+  Event event;
+  event.tick = tick;
+  event.order = mOrder++;
+  event.size = size;
+  memcpy(event.bytes, bytes, size);
+  mTracks[track].events.push_back(event);
+}
+
+bool MIDIFileWriter::write(const std::string &fileName) const {
+  std::vector<uint8_t> out;
+  out.insert(out.end(), {'M', 'T', 'h', 'd', 0, 0, 0, 6});
+  uint16_t format = mTracks.size() > 1 ? 1 : 0;
+  uint16_t numTracks = uint16_t(std::max(size_t(1), mTracks.size()));
+  out.insert(out.end(),
+             {uint8_t(format >> 8), uint8_t(format), uint8_t(numTracks >> 8),
+              uint8_t(numTracks), uint8_t(mTicksPerBeat >> 8),
+              uint8_t(mTicksPerBeat)});
+
+  auto isNoteOff = [](const Event &e) {
+    uint8_t type = e.bytes[0] & 0xF0;
+    return type == 0x80 || (type == 0x90 && e.size == 3 && e.bytes[2] == 0);
+  };
+
+  std::vector<const Event *> sorted;
+  for (size_t t = 0; t < numTracks; t++) {
+    out.insert(out.end(), {'M', 'T', 'r', 'k', 0, 0, 0, 0});
+    size_t sizePosition = out.size() - 4;
+    size_t trackStart = out.size();
+    uint64_t lastTick = 0;
+    if (t < mTracks.size()) {
+      const Track &track = mTracks[t];
+      if (track.name.size() > 0) {
+        out.insert(out.end(), {0, MIDIFileEvent::META,
+                               MIDIFileEvent::META_TRACK_NAME});
+        writeVLQ(out, track.name.size());
+        out.insert(out.end(), track.name.begin(), track.name.end());
+      }
+      sorted.clear();
+      for (auto &event : track.events) {
+        sorted.push_back(&event);
+      }
+      std::sort(sorted.begin(), sorted.end(),
+                [&](const Event *a, const Event *b) {
+                  if (a->tick != b->tick) {
+                    return a->tick < b->tick;
+                  }
+                  bool aOff = isNoteOff(*a);
+                  if (aOff != isNoteOff(*b)) {
+                    return aOff;
+                  }
+                  return a->order < b->order;
+                });
+      for (const Event *event : sorted) {
+        writeVLQ(out, event->tick - lastTick);
+        out.insert(out.end(), event->bytes, event->bytes + event->size);
+        lastTick = event->tick;
+      }
+    }
+    out.insert(out.end(), {0, MIDIFileEvent::META,
+                           MIDIFileEvent::META_END_OF_TRACK, 0});
+    uint32_t trackSize = uint32_t(out.size() - trackStart);
+    std::vector<uint8_t> sizeBytes;
+    writeU32(sizeBytes, trackSize);
+    std::copy(sizeBytes.begin(), sizeBytes.end(), out.begin() + sizePosition);
+  }
+
+  FILE *f = fopen(fileName.c_str(), "wb");
+  if (!f) {
+    std::cerr << "ERROR: Could not write MIDI file: " << fileName << std::endl;
+    return false;
+  }
+  bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+  ok = (fclose(f) == 0) && ok;
+  if (!ok) {
+    std::cerr << "ERROR: Failed writing MIDI file: " << fileName << std::endl;
+  }
+  return ok;
+}
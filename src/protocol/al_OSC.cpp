@@ -14,6 +14,21 @@
 #include "osc/OscReceivedElements.h"
 #include "osc/OscTypes.h"
 
+#ifdef AL_LINUX
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#endif
+
 /*
 Summary of OSC 1.0 spec from http://opensoundcontrol.org
 
@@ -165,121 +180,241 @@ void Packet::printRaw() const {
 
 size_t Packet::size() const { return mImpl->Size(); }
 
-class Message::Impl : public ::osc::ReceivedMessage {
- public:
-  Impl(const char* message, int size)
-      : ::osc::ReceivedMessage(::osc::ReceivedPacket(message, size)),
-        args(ArgumentStream()) {
-    // printf("made an ::osc::ReceivedMessage out of message %p and size %d\n",
-    // message, size);
-  }
+// Big endian readers for OSC arguments
+static inline uint32_t readUInt32(const char* data) {
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+  return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) |
+         (uint32_t(b[2]) << 8) | uint32_t(b[3]);
+}
 
-  template <class T>
-  void operator>>(T& v) {
-    OSCTRY("Message>>", args >> v;)
-  }
+static inline uint64_t readUInt64(const char* data) {
+  return (uint64_t(readUInt32(data)) << 32) | readUInt32(data + 4);
+}
 
-  ::osc::ReceivedMessageArgumentStream args;
-};
+// Size of the padded OSC string starting at data, or 0 if it is not
+// terminated before end
+static inline size_t oscStringSize(const char* data, const char* end) {
+  const void* terminator = memchr(data, '\0', end - data);
+  if (!terminator) {
+    return 0;
+  }
+  size_t length = static_cast<const char*>(terminator) - data;
+  return (length + 4) & ~size_t(3);
+}
 
 Message::Message(const char* message, int size, const TimeTag& timeTag,
                  const char* senderAddr)
-    : mImpl(new Impl(message, size)), mTimeTag(timeTag) {
-  OSCTRY("Message()", mAddressPattern = mImpl->AddressPattern();
-         mTypeTags = mImpl->ArgumentCount() ? mImpl->TypeTags() : "";
-         resetStream();)
+    : mTimeTag(timeTag) {
   if (senderAddr != nullptr) {
     strncpy(mSenderAddr, senderAddr, 32);
   } else {
     mSenderAddr[0] = '\0';
   }
+  const char* end = message + size;
+  size_t addressSize =
+      (size > 0 && size % 4 == 0) ? oscStringSize(message, end) : 0;
+  if (addressSize == 0) {
+    AL_WARN("OSC error: malformed message");
+    return;
+  }
+  const char* tags = message + addressSize;
+  const char* arguments = tags;
+  if (tags < end && *tags == ',') {
+    size_t tagsSize = oscStringSize(tags, end);
+    if (tagsSize == 0) {
+      AL_WARN("OSC error: malformed type tags");
+      return;
+    }
+    mTags = tags + 1;
+    mTagsSize = strlen(mTags);
+    arguments = tags + tagsSize;
+  }
+  mAddress = message;
+  mAddressSize = strlen(message);
+  mArguments = arguments;
+  mEnd = end;
+  resetStream();
+}
+
+Message::~Message() {}
+
+const std::string& Message::addressPattern() const {
+  if (!mAddressPatternCached) {
+    mAddressPattern.assign(mAddress, mAddressSize);
+    mAddressPatternCached = true;
+  }
+  return mAddressPattern;
 }
 
-Message::~Message() { OSCTRY("~Message()", delete mImpl;) }
+const std::string& Message::typeTags() const {
+  if (!mTypeTagsCached) {
+    mTypeTags.assign(mTags, mTagsSize);
+    mTypeTagsCached = true;
+  }
+  return mTypeTags;
+}
 
 void Message::print() const {
-  OSCTRY(
-      "Message::print",
-      printf("%s, %s %" AL_PRINTF_LL "d from %s\n", addressPattern().c_str(),
-             typeTags().c_str(), timeTag(), mSenderAddr);
-
-      ::osc::ReceivedMessageArgumentIterator it = mImpl->ArgumentsBegin();
-
-      printf("\targs = ("); for (unsigned i = 0; i < typeTags().size(); ++i) {
-        char tag = typeTags()[i];
-        switch (tag) {
-          case 'f': {
-            float v = it->AsFloat();
-            printf("%g", v);
-          } break;
-          case 'i': {
-            long v = it->AsInt32();
-            printf("%ld", v);
-          } break;
-          case 'h': {
-            long long v = it->AsInt64();
-            printf("%" AL_PRINTF_LL "d", v);
-          } break;
-          case 'c': {
-            char v = it->AsChar();
-            printf("'%c' (=%3d)", isprint(v) ? v : ' ', v);
-          } break;
-          case 'd': {
-            double v = it->AsDouble();
-            printf("%g", v);
-          } break;
-          case 's': {
-            const char* v = it->AsString();
-            printf("%s", v);
-          } break;
-          case 'b':
-            printf("blob");
-            break;
-          default:
-            printf("?");
+  printf("%s, %s %" AL_PRINTF_LL "d from %s\n", mAddress, mTags, timeTag(),
+         mSenderAddr);
+  const char* position = mArguments;
+  printf("\targs = (");
+  for (size_t i = 0; i < mTagsSize; ++i) {
+    char tag = mTags[i];
+    size_t size = 0;
+    switch (tag) {
+      case 'f':
+      case 'i':
+      case 'c':
+      case 'r':
+      case 'm':
+        size = 4;
+        break;
+      case 'h':
+      case 'd':
+      case 't':
+        size = 8;
+        break;
+      case 's':
+      case 'S':
+        size = oscStringSize(position, mEnd);
+        break;
+      case 'b':
+        if (mEnd - position >= 4) {
+          size = 4 + ((readUInt32(position) + 3) & ~uint32_t(3));
         }
-        if (i < (typeTags().size() - 1)) printf(", ");
-        ++it;
-      } printf(")\n");)
+        break;
+      case 'T':
+      case 'F':
+      case 'N':
+      case 'I':
+        break;
+      default:
+        printf("?)\n");
+        return;
+    }
+    if (size_t(mEnd - position) < size) {
+      printf("?)\n");
+      return;
+    }
+    switch (tag) {
+      case 'f': {
+        uint32_t bits = readUInt32(position);
+        float v;
+        memcpy(&v, &bits, 4);
+        printf("%g", v);
+      } break;
+      case 'i': {
+        long v = int32_t(readUInt32(position));
+        printf("%ld", v);
+      } break;
+      case 'h': {
+        long long v = int64_t(readUInt64(position));
+        printf("%" AL_PRINTF_LL "d", v);
+      } break;
+      case 'c': {
+        char v = char(readUInt32(position));
+        printf("'%c' (=%3d)", isprint(v) ? v : ' ', v);
+      } break;
+      case 'd': {
+        uint64_t bits = readUInt64(position);
+        double v;
+        memcpy(&v, &bits, 8);
+        printf("%g", v);
+      } break;
+      case 's':
+        printf("%s", position);
+        break;
+      case 'b':
+        printf("blob");
+        break;
+      default:
+        printf("%c", tag);
+    }
+    if (i < mTagsSize - 1) printf(", ");
+    position += size;
+  }
+  printf(")\n");
 }
 
 Message& Message::resetStream() {
-  mImpl->args = mImpl->ArgumentStream();
+  mReadPosition = mArguments;
+  mReadTag = 0;
   return *this;
 }
+
+const char* Message::nextArgument(char tag, size_t size, const char* what) {
+  if (mReadTag >= mTagsSize) {
+    AL_WARN("OSC error: %s: missing argument", what);
+    return nullptr;
+  }
+  if (mTags[mReadTag] != tag) {
+    AL_WARN("OSC error: %s: wrong argument type", what);
+    return nullptr;
+  }
+  if (size_t(mEnd - mReadPosition) < size) {
+    AL_WARN("OSC error: %s: malformed argument", what);
+    return nullptr;
+  }
+  const char* argument = mReadPosition;
+  mReadPosition += size;
+  mReadTag++;
+  return argument;
+}
+
 Message& Message::operator>>(int& v) {
-  ::osc::int32 r = 0;
-  OSCTRY("Message >> int", (*mImpl) >> r;)
-  v = r;
+  const char* argument = nextArgument('i', 4, "Message >> int");
+  v = argument ? int32_t(readUInt32(argument)) : 0;
   return *this;
 }
 Message& Message::operator>>(float& v) {
-  OSCTRY("Message >> float", (*mImpl) >> v;)
+  if (const char* argument = nextArgument('f', 4, "Message >> float")) {
+    uint32_t bits = readUInt32(argument);
+    memcpy(&v, &bits, 4);
+  }
   return *this;
 }
 Message& Message::operator>>(double& v) {
-  OSCTRY("Message >> double", (*mImpl) >> v;)
+  if (const char* argument = nextArgument('d', 8, "Message >> double")) {
+    uint64_t bits = readUInt64(argument);
+    memcpy(&v, &bits, 8);
+  }
   return *this;
 }
 Message& Message::operator>>(char& v) {
-  OSCTRY("Message >> char", (*mImpl) >> v;)
+  if (const char* argument = nextArgument('c', 4, "Message >> char")) {
+    v = char(readUInt32(argument));
+  }
   return *this;
 }
 Message& Message::operator>>(const char*& v) {
-  OSCTRY("Message >> const char *", (*mImpl) >> v;)
+  size_t size = (mReadTag < mTagsSize && mTags[mReadTag] == 's')
+                    ? oscStringSize(mReadPosition, mEnd)
+                    : 0;
+  if (const char* argument =
+          nextArgument('s', size > 0 ? size : mEnd - mReadPosition + 1,
+                       "Message >> const char *")) {
+    v = argument;
+  }
   return *this;
 }
 Message& Message::operator>>(std::string& v) {
   const char* r = "";
-  OSCTRY("Message >> string", (*mImpl) >> r;)
+  *this >> r;
   v = r;
   return *this;
 }
 Message& Message::operator>>(Blob& v) {
-  ::osc::Blob b;
-  OSCTRY("Message >> Blob", (*mImpl) >> b;)
-  v.data = b.data;
-  v.size = b.size;
+  uint32_t blobSize = 0;
+  if (mReadTag < mTagsSize && mTags[mReadTag] == 'b' &&
+      mEnd - mReadPosition >= 4) {
+    blobSize = readUInt32(mReadPosition);
+  }
+  size_t size = 4 + ((size_t(blobSize) + 3) & ~size_t(3));
+  if (const char* argument = nextArgument('b', size, "Message >> Blob")) {
+    v.data = argument + 4;
+    v.size = blobSize;
+  }
   return *this;
 }
 
@@ -398,6 +533,280 @@ static void* recvThreadFunc(void* user) {
   return NULL;
 }
 
+#ifdef AL_LINUX
+
+/// Waits on any number of receive sockets with epoll and drains each ready
+/// socket with recvmmsg, many datagrams per system call
+class ReceiveReactor {
+ public:
+  /// Datagrams read per recvmmsg call
+  static const int BATCH = 32;
+  /// Larger datagrams are dropped
+  static const int MAX_DATAGRAM_SIZE = 8192;
+  /// Batches read from one socket before serving the others
+  static const int MAX_BATCHES_PER_WAKE = 8;
+
+  ReceiveReactor() {
+    mEpoll = epoll_create1(EPOLL_CLOEXEC);
+    mWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(mEpoll, EPOLL_CTL_ADD, mWake, &event);
+  }
+
+  ~ReceiveReactor() {
+    close(mWake);
+    close(mEpoll);
+  }
+
+  /// Reactor running on the thread shared by all Recv instances
+  static ReceiveReactor& shared() {
+    // Never destroyed, as the thread can outlive static destruction
+    static ReceiveReactor* reactor = []() {
+      ReceiveReactor* r = new ReceiveReactor;
+      std::thread([r]() { r->run(); }).detach();
+      return r;
+    }();
+    return *reactor;
+  }
+
+  bool add(int socket, Recv* recv) {
+    std::lock_guard<std::mutex> lk(mLock);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = recv;
+    if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, socket, &event) != 0) {
+      return false;
+    }
+    auto entry = std::make_shared<Entry>();
+    entry->socket = socket;
+    mSockets[recv] = entry;
+    return true;
+  }
+
+  /// Waits for the handlers of recv to return if they are running on another
+  /// thread. Handlers of other receivers are not waited for
+  void remove(int socket, Recv* recv) {
+    std::shared_ptr<Entry> entry;
+    {
+      std::lock_guard<std::mutex> lk(mLock);
+      auto found = mSockets.find(recv);
+      if (found == mSockets.end()) {
+        return;
+      }
+      entry = found->second;
+      epoll_ctl(mEpoll, EPOLL_CTL_DEL, socket, nullptr);
+      mSockets.erase(found);
+    }
+    if (std::this_thread::get_id() == mRunThread.load()) {
+      // Called from a handler, so no other handler is running. The entry
+      // being drained, if it is this one, is locked further up the stack
+      entry->removed = true;
+      return;
+    }
+    std::lock_guard<std::mutex> lk(entry->lock);
+    entry->removed = true;
+  }
+
+  /// Dispatch packets until quit() is called
+  void run() {
+    if (mBuffers.size() == 0) {
+      mBuffers.resize(BATCH * MAX_DATAGRAM_SIZE);
+    }
+    mRunThread = std::this_thread::get_id();
+    epoll_event events[BATCH];
+    while (true) {
+      int count = epoll_wait(mEpoll, events, BATCH, -1);
+      if (count < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        AL_WARN("OSC error: epoll_wait failed (%s)", strerror(errno));
+        mRunThread = std::thread::id();
+        return;
+      }
+      for (int i = 0; i < count; i++) {
+        if (events[i].data.ptr == nullptr) {
+          uint64_t value;
+          if (read(mWake, &value, sizeof(value)) > 0) {
+            mRunThread = std::thread::id();
+            return;
+          }
+          continue;
+        }
+        Recv* recv = static_cast<Recv*>(events[i].data.ptr);
+        std::shared_ptr<Entry> entry;
+        {
+          std::lock_guard<std::mutex> lk(mLock);
+          auto found = mSockets.find(recv);
+          if (found == mSockets.end()) {
+            continue;
+          }
+          entry = found->second;
+        }
+        std::lock_guard<std::mutex> lk(entry->lock);
+        if (!entry->removed) {
+          drain(*entry, recv);
+        }
+      }
+    }
+  }
+
+  /// Make run() return. If it is not running, the next run() returns at once
+  void quit() {
+    uint64_t one = 1;
+    if (write(mWake, &one, sizeof(one)) < 0) {
+      AL_WARN("OSC error: could not stop receive thread");
+    }
+  }
+
+  /// Discard a quit() that no run() has consumed
+  void clearQuit() {
+    uint64_t value;
+    while (read(mWake, &value, sizeof(value)) > 0) {
+    }
+  }
+
+ private:
+  // A registered socket. lock is held while its handlers run
+  struct Entry {
+    int socket;
+    std::mutex lock;
+    bool removed{false};
+  };
+
+  void drain(Entry& entry, Recv* recv) {
+    mmsghdr headers[BATCH];
+    iovec vectors[BATCH];
+    sockaddr_in senders[BATCH];
+    char senderAddress[INET_ADDRSTRLEN];
+    for (int batch = 0; batch < MAX_BATCHES_PER_WAKE; batch++) {
+      for (int i = 0; i < BATCH; i++) {
+        vectors[i].iov_base = &mBuffers[i * MAX_DATAGRAM_SIZE];
+        vectors[i].iov_len = MAX_DATAGRAM_SIZE;
+        std::memset(&headers[i], 0, sizeof(headers[i]));
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        headers[i].msg_hdr.msg_name = &senders[i];
+        headers[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+      }
+      int count =
+          recvmmsg(entry.socket, headers, BATCH, MSG_DONTWAIT, nullptr);
+      if (count <= 0) {
+        return;
+      }
+      for (int i = 0; i < count; i++) {
+        if (headers[i].msg_hdr.msg_flags & MSG_TRUNC) {
+          AL_WARN_ONCE("OSC error: dropped packet larger than %d bytes",
+                       MAX_DATAGRAM_SIZE);
+          continue;
+        }
+        inet_ntop(AF_INET, &senders[i].sin_addr, senderAddress,
+                  sizeof(senderAddress));
+        recv->parse(&mBuffers[i * MAX_DATAGRAM_SIZE], int(headers[i].msg_len),
+                    senderAddress);
+        // A handler may have stopped its own Recv
+        if (entry.removed) {
+          return;
+        }
+      }
+      if (count < BATCH) {
+        return;
+      }
+    }
+  }
+
+  int mEpoll;
+  int mWake;
+  std::mutex mLock;  // Protects mSockets. Not held while handlers run
+  std::unordered_map<Recv*, std::shared_ptr<Entry>> mSockets;
+  std::atomic<std::thread::id> mRunThread{};
+  std::vector<char> mBuffers;
+};
+
+class Recv::SocketReceiver {
+ public:
+  SocketReceiver(uint16_t port, const char* address, Recv* r) : recv{r} {
+    // Resolve the address as oscpack does on the other platforms
+    IpEndpointName endpoint{address, port};
+    mSocket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (mSocket < 0) {
+      throw std::runtime_error("unable to create udp socket\n");
+    }
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr =
+        endpoint.address == IpEndpointName::ANY_ADDRESS
+            ? htonl(INADDR_ANY)
+            : htonl(uint32_t(endpoint.address));
+    if (bind(mSocket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) <
+        0) {
+      close(mSocket);
+      throw std::runtime_error("unable to bind udp socket\n");
+    }
+  }
+
+  ~SocketReceiver() {
+    detach();
+    if (mOwnReactor) {
+      mOwnReactor->remove(mSocket, recv);
+    }
+    close(mSocket);
+  }
+
+  /// Serve the socket from the shared receive thread
+  bool attach() {
+    if (mShared) {
+      return true;
+    }
+    mShared = ReceiveReactor::shared().add(mSocket, recv);
+    return mShared;
+  }
+
+  /// Returns whether the socket was served from the shared receive thread
+  bool detach() {
+    if (!mShared) {
+      return false;
+    }
+    ReceiveReactor::shared().remove(mSocket, recv);
+    mShared = false;
+    return true;
+  }
+
+  /// Set up the reactor of a thread of its own, created on first use
+  void prepareLoop() {
+    if (!mOwnReactor) {
+      mOwnReactor = std::make_unique<ReceiveReactor>();
+      mOwnReactor->add(mSocket, recv);
+    }
+    mOwnReactor->clearQuit();
+  }
+
+  void loop() {
+    if (mOwnReactor) {
+      mOwnReactor->run();
+    }
+  }
+
+  void stop() {
+    if (mOwnReactor) {
+      mOwnReactor->quit();
+    }
+  }
+
+  Recv* recv;
+
+ private:
+  int mSocket;
+  std::atomic<bool> mShared{false};
+  // Only created for sharedThread(false)
+  std::unique_ptr<ReceiveReactor> mOwnReactor;
+};
+
+#else
+
 class Recv::SocketReceiver : public ::osc::OscPacketListener {
  public:
   UdpListeningReceiveSocket receiveSocket;
@@ -430,6 +839,8 @@ class Recv::SocketReceiver : public ::osc::OscPacketListener {
   void stop() { receiveSocket.AsynchronousBreak(); }
 };
 
+#endif
+
 Recv::Recv() : mBuffer(1024), mBackground(false) {}
 
 Recv::Recv(uint16_t port, const char* address, al_sec timeout)
@@ -440,7 +851,10 @@ Recv::Recv(uint16_t port, const char* address, al_sec timeout)
 Recv::~Recv() { stop(); }
 
 bool Recv::open(uint16_t port, const char* address, al_sec timeout) {
+  stop();
   mOpen = false;
+  // Close the previous socket first so the same port can be opened again
+  socketReceiver.reset();
   try {
     // unique pointer assignment releases and deletes previously owned object
     if (*address == '\0') {
@@ -464,12 +878,28 @@ bool Recv::open(uint16_t port, const char* address, al_sec timeout) {
 int Recv::recv() { return 0; }
 
 bool Recv::start() {
+  if (!socketReceiver) {
+    return false;
+  }
+#ifdef AL_LINUX
+  if (mSharedThread) {
+    mBackground = socketReceiver->attach();
+    return mBackground;
+  }
+  socketReceiver->prepareLoop();
+#endif
   mBackground = true;
   return mThread.start(recvThreadFunc, this);
 }
 
 void Recv::stop() {
   if (socketReceiver) {
+#ifdef AL_LINUX
+    if (socketReceiver->detach()) {
+      mBackground = false;
+      return;
+    }
+#endif
     socketReceiver->stop();
     if (mBackground) {
       mThread.join();
@@ -479,6 +909,9 @@ void Recv::stop() {
 }
 
 void Recv::parse(const char* packet, int size, const char* senderAddr) {
+  if (size > int(mBuffer.size())) {
+    mBuffer.resize(size);
+  }
   std::memcpy(&mBuffer[0], packet, size);
   for (auto* handler : mHandlers) {
     handler->parse(&mBuffer[0], size, 1, senderAddr);
@@ -96,7 +96,7 @@ DistributedScene::DistributedScene(std::string name, int threadPoolSize,
                 this->mNotifier->notifyListeners(
                     prefix + "/" + std::to_string(voice->id()) +
                         param->getFullAddress(),
-                    param);
+                    value);
               }
               //                                std::cout << voice->id() << "
               //                                parameter " << param->getName()
@@ -118,7 +118,7 @@ DistributedScene::DistributedScene(std::string name, int threadPoolSize,
             this->mNotifier->notifyListeners(prefix + "/" +
                                                  std::to_string(voice->id()) +
                                                  p->getFullAddress(),
-                                             p);
+                                             value);
           }
         });
       }
@@ -134,7 +134,7 @@ DistributedScene::DistributedScene(std::string name, int threadPoolSize,
             this->mNotifier->notifyListeners(prefix + "/" +
                                                  std::to_string(voice->id()) +
                                                  p->getFullAddress(),
-                                             p);
+                                             value);
           }
         });
       }
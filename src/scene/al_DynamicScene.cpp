@@ -1,6 +1,7 @@
 #include "al/scene/al_DynamicScene.hpp"
 
 #include "al/graphics/al_Shapes.hpp"
+#include "al/system/al_Denormals.hpp"
 
 using namespace std;
 using namespace al;
@@ -164,6 +165,12 @@ void DynamicScene::render(AudioIOData &io) {
     processVoiceTurnOff();
   }
   io.zeroBus();
+  // One reference for the whole block, as the graph can be replaced from
+  // another thread
+  mBlockRoutingGraph = routingGraph();
+  if (mBlockRoutingGraph) {
+    mBlockRoutingGraph->acquire();
+  }
 
   auto *voice = mActiveVoices;
   int fpb = internalAudioIO.framesPerBuffer();
@@ -182,7 +189,9 @@ void DynamicScene::render(AudioIOData &io) {
           internalAudioIO.zeroOut();
           internalAudioIO.zeroBus();
           internalAudioIO.frame(offset);
+          AudioTelemetry::ScopedSpan renderSpan(io.telemetry(), "voice render");
           voice->onProcess(internalAudioIO);
+          renderSpan.stop();
           Vec3d listeningDir;
           vector<Vec3f> posOffsets;
           if (dynamic_cast<PositionedVoice *>(voice)) {
@@ -198,13 +207,7 @@ void DynamicScene::render(AudioIOData &io) {
             if (posVoice->useDistanceAttenuation()) {
               float distance = listeningDir.mag();
               float atten = mDistAtten.attenuation(distance);
-              internalAudioIO.frame(0);
-              float *buf = internalAudioIO.outBuffer(0);
-
-              while (internalAudioIO()) {
-                *buf = *buf * atten;
-                buf++;
-              }
+              gainBlock(internalAudioIO.outBuffer(0), atten, fpb);
             }
           } else {
             listeningDir = mListenerPose;
@@ -214,15 +217,17 @@ void DynamicScene::render(AudioIOData &io) {
             internalAudioIO.frame(offset);
             Pose listeningPose = listeningDir;
             (*mBusRoutingCallback)(internalAudioIO, listeningPose);
-            io.frame(offset);
-            internalAudioIO.frame(offset);
             // Then gather all the internal buses into the master AudioIO buses
-            while (io() && internalAudioIO()) {
-              for (int i = 0; i < mVoiceBusChannels; i++) {
-                io.bus(i) += internalAudioIO.bus(i);
-              }
+            for (int i = 0; i < mVoiceBusChannels; i++) {
+              mixBlock(io.busBuffer(i) + offset,
+                       internalAudioIO.busBuffer(i) + offset, fpb - offset);
             }
           }
+          if (mBlockRoutingGraph) {
+            mBlockRoutingGraph->processSends(internalAudioIO, io, offset);
+          }
+          AudioTelemetry::ScopedSpan spatializeSpan(io.telemetry(),
+                                                    "spatialize");
           for (unsigned int i = 0; i < voice->numOutChannels(); i++) {
             io.frame(offset);
             internalAudioIO.frame(offset);
@@ -260,14 +265,21 @@ void DynamicScene::render(AudioIOData &io) {
     std::unique_lock<std::mutex> lk(mThreadTriggerLock);
     mAudioThreadDone.wait(lk, [this]() { return mAudioBusy == 0; });
   }
+  AudioTelemetry::ScopedSpan spatializeSpan(io.telemetry(), "spatialize");
   mSpatializer->finalize(io);
+  spatializeSpan.stop();
+  if (mBlockRoutingGraph) {
+    mBlockRoutingGraph->processBuses(io);
+  }
   processGain(io);
 
   // Run post processing callbacks
+  AudioTelemetry::ScopedSpan postSpan(io.telemetry(), "post-process");
   for (auto cb : mPostProcessing) {
     io.frame(0);
     cb->onAudioCB(io);
   }
+  postSpan.stop();
   if (mMasterMode == TimeMasterMode::TIME_MASTER_AUDIO) {
     processInactiveVoices();
   }
@@ -339,10 +351,16 @@ void DynamicScene::updateThreadFunc(UpdateThreadFuncData data) {
 }
 
 void DynamicScene::audioThreadFunc(DynamicScene *scene, int id) {
+  unsigned int configVersion = 0;
   while (scene->mSynthRunning) {
     std::unique_lock<std::mutex> lk(scene->mThreadTriggerLock);
     scene->mThreadTrigger.wait(lk);
     scene->mAudioBusy++;
+    if (configVersion != scene->mAudioThreadConfigVersion) {
+      scene->mAudioThreadConfig.forWorker(id).applyToCurrentThread();
+      configVersion = scene->mAudioThreadConfigVersion;
+    }
+    ScopedDenormalFlush denormalFlush;
 
     vector<int> &idsToProcess = scene->mThreadMap[id];
     AudioIOData &internalAudioIO = scene->mThreadedAudioData[id];
@@ -364,7 +382,9 @@ void DynamicScene::audioThreadFunc(DynamicScene *scene, int id) {
           internalAudioIO.zeroOut();
           internalAudioIO.zeroBus();
           internalAudioIO.frame(offset);
+          AudioTelemetry::ScopedSpan renderSpan(io.telemetry(), "voice render");
           voice->onProcess(internalAudioIO);
+          renderSpan.stop();
           Vec3d listeningDir;
           vector<Vec3f> posOffsets;
           if (dynamic_cast<PositionedVoice *>(voice)) {
@@ -381,13 +401,7 @@ void DynamicScene::audioThreadFunc(DynamicScene *scene, int id) {
             if (posVoice->useDistanceAttenuation()) {
               float distance = scene->mListenerPose.vec().mag();
               float atten = scene->mDistAtten.attenuation(distance);
-              internalAudioIO.frame(0);
-              float *buf = internalAudioIO.outBuffer(0);
-
-              while (internalAudioIO()) {
-                *buf = *buf * atten;
-                buf++;
-              }
+              gainBlock(internalAudioIO.outBuffer(0), atten, fpb);
             }
           } else {
             listeningDir = scene->mListenerPose;
@@ -399,15 +413,18 @@ void DynamicScene::audioThreadFunc(DynamicScene *scene, int id) {
             internalAudioIO.frame(offset);
             (*scene->mBusRoutingCallback)(internalAudioIO,
                                           scene->mListenerPose);
-            io.frame(offset);
-            internalAudioIO.frame(offset);
             // Then gather all the internal buses into the master AudioIO buses
-            while (io() && internalAudioIO()) {
-              for (int i = 0; i < scene->mVoiceBusChannels; i++) {
-                io.bus(i) += internalAudioIO.bus(i);
-              }
+            for (int i = 0; i < scene->mVoiceBusChannels; i++) {
+              mixBlock(io.busBuffer(i) + offset,
+                       internalAudioIO.busBuffer(i) + offset, fpb - offset);
             }
           }
+          if (scene->mBlockRoutingGraph) {
+            scene->mBlockRoutingGraph->processSends(internalAudioIO, io,
+                                                    offset);
+          }
+          AudioTelemetry::ScopedSpan spatializeSpan(io.telemetry(),
+                                                    "spatialize");
           for (unsigned int i = 0; i < voice->numOutChannels(); i++) {
             io.frame(offset);
             internalAudioIO.frame(offset);
@@ -533,7 +533,16 @@ void PolySynth::render(AudioIOData &io) {
     processVoiceTurnOff();
   }
 
+  // One reference for the whole block, as the graph can be replaced from
+  // another thread
+  std::shared_ptr<AudioRoutingGraph> routingGraph =
+      std::atomic_load(&mRoutingGraph);
+  if (routingGraph) {
+    routingGraph->acquire();
+  }
+
   // Render active voices
+  AudioTelemetry::ScopedSpan renderSpan(io.telemetry(), "voice render");
   auto *voice = mActiveVoices;
   int fpb = io.framesPerBuffer();
   while (voice) {
@@ -557,15 +566,16 @@ void PolySynth::render(AudioIOData &io) {
             (*mBusRoutingCallback)(internalAudioIO, p);
           }
           // Then gather all the internal buses into the master AudioIO buses
-          io.frame(offset);
-          internalAudioIO.frame(offset);
-          while (io() && internalAudioIO()) {
-            for (int i = 0; i < mVoiceMaxOutputChannels; i++) {
-              io.out(i) += internalAudioIO.out(i);
-            }
-            for (int i = 0; i < mVoiceBusChannels; i++) {
-              io.bus(i) += internalAudioIO.bus(i);
-            }
+          for (int i = 0; i < mVoiceMaxOutputChannels; i++) {
+            mixBlock(io.outBuffer(i) + offset,
+                     internalAudioIO.outBuffer(i) + offset, fpb - offset);
+          }
+          for (int i = 0; i < mVoiceBusChannels; i++) {
+            mixBlock(io.busBuffer(i) + offset,
+                     internalAudioIO.busBuffer(i) + offset, fpb - offset);
+          }
+          if (routingGraph) {
+            routingGraph->processSends(internalAudioIO, io, offset);
           }
         }
       } else {
@@ -575,12 +585,18 @@ void PolySynth::render(AudioIOData &io) {
     }
     voice = voice->next;
   }
+  renderSpan.stop();
+  if (routingGraph) {
+    routingGraph->processBuses(io);
+  }
   processGain(io);
   // Run post processing callbacks
+  AudioTelemetry::ScopedSpan postSpan(io.telemetry(), "post-process");
   for (auto cb : mPostProcessing) {
     io.frame(0);
     cb->onAudioCB(io);
   }
+  postSpan.stop();
   if (mMasterMode == TimeMasterMode::TIME_MASTER_AUDIO) {
     processInactiveVoices();
   }
@@ -811,6 +827,12 @@ void PolySynth::startCpuClockThread() {
     mCpuClockThread = std::make_unique<std::thread>([this]() {
       using namespace std::chrono;
       while (mRunCPUClock) {
+        if (mCpuClockThreadConfigPending &&
+            mCpuClockThreadConfigLock.try_lock()) {
+          mCpuClockThreadConfig.applyToCurrentThread();
+          mCpuClockThreadConfigPending = false;
+          mCpuClockThreadConfigLock.unlock();
+        }
         high_resolution_clock::time_point startTime =
             high_resolution_clock::now();
         std::chrono::milliseconds waitTime(int(mCpuGranularitySec * 1000));
@@ -828,6 +850,12 @@ void PolySynth::startCpuClockThread() {
   }
 }
 
+void PolySynth::setCpuClockThreadConfig(const ThreadConfig &config) {
+  std::unique_lock<std::mutex> lk(mCpuClockThreadConfigLock);
+  mCpuClockThreadConfig = config;
+  mCpuClockThreadConfigPending = true;
+}
+
 void PolySynth::prepare(AudioIOData &io) {
   internalAudioIO.framesPerBuffer(io.framesPerBuffer());
   internalAudioIO.channelsIn(mVoiceMaxInputChannels);
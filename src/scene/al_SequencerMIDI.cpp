@@ -0,0 +1,159 @@
+#include "al/scene/al_SequencerMIDI.hpp"
+
+#include <algorithm>
+
+using namespace al;
+
+void SequencerMIDI::mapChannel(int channel, std::string voiceName,
+                               FieldMapping mapping) {
+  if (channel < 0 || channel >= int(mChannelMappings.size())) {
+    std::cerr << "ERROR: SequencerMIDI invalid MIDI channel " << channel
+              << std::endl;
+    return;
+  }
+  mChannelMappings[channel] = {voiceName, mapping};
+}
+
+void SequencerMIDI::triggerMappedVoice(const MIDIMessage &m) {
+  ChannelMapping &channelMapping = mChannelMappings[m.channel()];
+  if (channelMapping.voiceName.size() == 0) {
+    return;
+  }
+  int &voiceId = mLiveVoiceIds[m.channel()][m.noteNumber() & 0x7F];
+  if (m.type() == MIDIByte::NOTE_ON && m.velocity() > 0) {
+    if (voiceId >= 0) {
+      mSynth->triggerOff(voiceId);
+      voiceId = -1;
+    }
+    SynthVoice *voice = mSynth->getVoice(channelMapping.voiceName);
+    if (!voice) {
+      return;
+    }
+    if (channelMapping.mapping) {
+      mLiveFields.clear();
+      channelMapping.mapping(m.noteNumber(), int(m.velocity(1.0)),
+                             mLiveFields);
+      voice->setTriggerParams(mLiveFields);
+    }
+    voiceId = mSynth->triggerOn(voice);
+  } else if (m.type() == MIDIByte::NOTE_OFF ||
+             (m.type() == MIDIByte::NOTE_ON && m.velocity() == 0)) {
+    if (voiceId >= 0) {
+      mSynth->triggerOff(voiceId);
+      voiceId = -1;
+    }
+  }
+}
+
+bool SequencerMIDI::loadMIDIFile(std::string fileName,
+                                 SynthSequencer &sequencer,
+                                 double timeOffset) {
+  MIDIFile file;
+  if (!file.open(fileName)) {
+    return false;
+  }
+  // Standard MIDI Files default to 120 bpm. SMPTE files are read in seconds,
+  // which are beats at 60 bpm
+  TempoMap tempoMap(file.isSMPTE() ? 60.0 : 120.0);
+
+  std::vector<SynthSequencerEvent> events;
+  // Notes waiting for their note off, as first in first out lists per
+  // channel and note linked through nextOpen (indices into events)
+  std::array<std::array<int32_t, 128>, 16> openHead;
+  std::array<std::array<int32_t, 128>, 16> openTail;
+  std::vector<int32_t> nextOpen;
+  int currentTrack = -1;
+  double trackEnd = 0.0;
+
+  auto closeOpenNotes = [&]() {
+    for (size_t channel = 0; channel < 16; channel++) {
+      for (size_t note = 0; note < 128; note++) {
+        for (int32_t i = openHead[channel][note]; i >= 0; i = nextOpen[i]) {
+          events[i].duration =
+              std::max(0.0, timeOffset + trackEnd - events[i].startTime);
+        }
+        openHead[channel][note] = -1;
+        openTail[channel][note] = -1;
+      }
+    }
+  };
+
+  bool ok = file.read([&](const MIDIFileEvent &event) {
+    if (event.track != currentTrack) {
+      if (currentTrack >= 0) {
+        closeOpenNotes();
+      } else {
+        for (auto &channel : openHead) {
+          channel.fill(-1);
+        }
+        for (auto &channel : openTail) {
+          channel.fill(-1);
+        }
+      }
+      currentTrack = event.track;
+    }
+    trackEnd = event.beat;
+    if (event.isMeta()) {
+      if (file.isSMPTE()) {
+        return;
+      }
+      if (event.metaType() == MIDIFileEvent::META_TEMPO &&
+          event.tempo() > 0.0) {
+        tempoMap.addTempo(event.beat, event.tempo());
+      } else if (event.metaType() == MIDIFileEvent::META_TIME_SIGNATURE &&
+                 event.size >= 2) {
+        tempoMap.addTimeSignature(event.beat, event.data[0],
+                                  1 << event.data[1]);
+      }
+      return;
+    }
+    if (!event.isChannelMessage()) {
+      return;
+    }
+    uint8_t channel = event.channel();
+    uint8_t note = event.data1;
+    if (event.isNoteOn()) {
+      ChannelMapping &channelMapping = mChannelMappings[channel];
+      if (channelMapping.voiceName.size() == 0) {
+        return;
+      }
+      events.emplace_back();
+      SynthSequencerEvent &newEvent = events.back();
+      newEvent.type = SynthSequencerEvent::EVENT_PFIELDS;
+      newEvent.startTime = timeOffset + event.beat;
+      newEvent.duration = -1;
+      newEvent.fields.name = channelMapping.voiceName;
+      if (channelMapping.mapping) {
+        channelMapping.mapping(note, event.data2, newEvent.fields.pFields);
+      }
+      int32_t index = int32_t(events.size() - 1);
+      nextOpen.push_back(-1);
+      if (openTail[channel][note] >= 0) {
+        nextOpen[openTail[channel][note]] = index;
+      } else {
+        openHead[channel][note] = index;
+      }
+      openTail[channel][note] = index;
+    } else if (event.isNoteOff()) {
+      int32_t index = openHead[channel][note];
+      if (index >= 0) {
+        events[index].duration =
+            std::max(0.0, timeOffset + event.beat - events[index].startTime);
+        openHead[channel][note] = nextOpen[index];
+        if (openHead[channel][note] < 0) {
+          openTail[channel][note] = -1;
+        }
+      }
+    }
+  });
+  if (currentTrack >= 0) {
+    closeOpenNotes();
+  }
+  if (!ok) {
+    std::cerr << "WARNING: Error parsing MIDI file " << fileName
+              << ". Loaded events up to the error." << std::endl;
+  }
+  sequencer.setTempoMap(tempoMap);
+  sequencer.addEvents(std::move(events));
+  return true;
+}
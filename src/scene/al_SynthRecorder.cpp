@@ -1,21 +1,189 @@
 
 #include "al/scene/al_SynthRecorder.hpp"
+#include "al/io/al_MIDIFile.hpp"
+#include "al/scene/al_SynthSequenceFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <cstring>
+#include <typeinfo>
 
 using namespace al;
 
+// Field type for ParameterMenu values in records. The field holds the menu
+// index, resolved to the menu text by the writer thread through
+// Record::menus
+static const uint8_t FIELD_MENU = 3;
+
+SynthRecorder::~SynthRecorder() {
+  mRecording = false;
+  if (mWriterThread) {
+    mWriterThread->join();
+  }
+}
+
 void SynthRecorder::startRecord(std::string name, bool overwrite,
                                 bool startOnEvent) {
+  if (mWriterThread) {
+    stopRecord();
+  }
+  // Discard anything left over from a previous recording
+  Record stale;
+  while (mEventLog.pop(stale)) {
+  }
+  mSequence.clear();
+  mDroppedEvents = 0;
   mOverwrite = overwrite;
   mStartOnEvent = startOnEvent;
-  mRecording = true;
-  mSequenceStart = std::chrono::high_resolution_clock::now();
+  mSequenceStartNs = nowNs();
   mSequenceName = name;
+  mRecording.store(true, std::memory_order_release);
+  mWriterThread =
+      std::make_unique<std::thread>(&SynthRecorder::writerThreadFunction, this);
 }
 
 void SynthRecorder::stopRecord() {
-  mRecording = false;
+  mRecording.store(false, std::memory_order_release);
+  if (mWriterThread) {
+    mWriterThread->join();
+    mWriterThread = nullptr;
+  }
+  if (mDroppedEvents > 0) {
+    std::cout << "WARNING: SynthRecorder event log full. Dropped "
+              << mDroppedEvents << " events." << std::endl;
+  }
+  writeSequence();
+}
+
+void SynthRecorder::captureTriggerOn(SynthVoice *voice) {
+  Record record;
+  record.timeNs = nowNs();
+  record.typeName = typeid(*voice).name();
+  record.id = voice->id();
+  record.type = SynthEventType::TRIGGER_ON;
+  record.numFields = 0;
+  unsigned int numMenus = 0;
+  size_t stringBytes = 0;
+  auto &params = voice->triggerParameters();
+  auto &kinds = voice->triggerParameterKinds();
+  // Kinds are resolved at registration. Only parameters added to
+  // mTriggerParams directly need to be resolved here
+  bool kindsResolved = kinds.size() == params.size();
+  for (size_t i = 0; i < params.size(); i++) {
+    ParameterMeta *param = params[i];
+    if (!param) {
+      continue;
+    }
+    if (record.numFields == Record::MAX_FIELDS) {
+      break;
+    }
+    uint8_t &type = record.fieldTypes[record.numFields];
+    uint32_t &field = record.fields[record.numFields];
+    SynthVoice::TriggerParameterKind kind =
+        kindsResolved ? kinds[i] : SynthVoice::triggerParameterKind(param);
+    if (kind == SynthVoice::TRIGGER_STRING) {
+      // Copied straight into the record, the last byte is kept for an
+      // empty string once the record is full
+      size_t length = static_cast<ParameterString *>(param)->copyTo(
+          record.strings + stringBytes, Record::STRING_BYTES - stringBytes);
+      type = SynthSequenceFile::FIELD_STRING;
+      field = uint32_t(stringBytes);
+      stringBytes = std::min(stringBytes + length + 1,
+                             size_t(Record::STRING_BYTES - 1));
+    } else if (kind == SynthVoice::TRIGGER_MENU &&
+               numMenus < Record::MAX_MENUS) {
+      type = FIELD_MENU;
+      field = uint32_t(static_cast<ParameterMenu *>(param)->get());
+      record.menus[numMenus++] = static_cast<ParameterMenu *>(param);
+    } else {
+      float value = param->toFloat();
+      type = SynthSequenceFile::FIELD_FLOAT;
+      memcpy(&field, &value, sizeof(float));
+    }
+    record.numFields++;
+  }
+  if (!mEventLog.push(record)) {
+    mDroppedEvents++;
+  }
+}
+
+void SynthRecorder::captureTriggerOff(int id) {
+  Record record;
+  record.timeNs = nowNs();
+  record.typeName = nullptr;
+  record.id = id;
+  record.type = SynthEventType::TRIGGER_OFF;
+  record.numFields = 0;
+  if (!mEventLog.push(record)) {
+    mDroppedEvents++;
+  }
+}
+
+void SynthRecorder::writerThreadFunction() {
+  while (mRecording.load(std::memory_order_acquire)) {
+    drainEventLog();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  // Pick up events that arrived before recording stopped
+  drainEventLog();
+}
+
+void SynthRecorder::drainEventLog() {
+  Record record;
+  while (mEventLog.pop(record)) {
+    if (record.type == SynthEventType::TRIGGER_ON && mStartOnEvent) {
+      mSequenceStartNs = record.timeNs;
+      mStartOnEvent = false;
+    }
+    SynthEvent event;
+    event.type = SynthEventType(record.type);
+    event.id = record.id;
+    event.time = (record.timeNs - mSequenceStartNs) * 1.0e-9;
+    event.duration = -1;
+    if (record.typeName) {
+      event.synthName = demangle(record.typeName);
+    }
+    event.pFields.reserve(record.numFields);
+    unsigned int menuIndex = 0;
+    for (unsigned int i = 0; i < record.numFields; i++) {
+      uint32_t field = record.fields[i];
+      switch (record.fieldTypes[i]) {
+        case SynthSequenceFile::FIELD_STRING:
+          event.pFields.push_back(std::string(record.strings + field));
+          break;
+        case FIELD_MENU: {
+          auto elements = record.menus[menuIndex++]->getElements();
+          event.pFields.push_back(field < elements.size() ? elements[field]
+                                                          : std::string());
+        } break;
+        default: {
+          float value;
+          memcpy(&value, &field, sizeof(float));
+          event.pFields.push_back(value);
+        }
+      }
+    }
+    if (mVerbose) {
+      if (event.type == SynthEventType::TRIGGER_ON) {
+        std::cout << "trigger at " << event.time << ":" << event.synthName
+                  << ":" << event.id << std::endl;
+      } else {
+        std::cout << "trigger OFF at " << event.time << ":" << event.id
+                  << std::endl;
+      }
+    }
+    mSequence.push_back(std::move(event));
+  }
+}
+
+void SynthRecorder::writeSequence() {
   std::string path = File::conformDirectory(mDirectory);
-  std::string fileName = path + mSequenceName + ".synthSequence";
+  std::string extension =
+      mFormat == BINARY_SEQUENCE
+          ? ".synthSequenceBin"
+          : (mFormat == MIDI_FILE ? ".mid" : ".synthSequence");
+  std::string fileName = path + mSequenceName + extension;
 
   std::string newSequenceName = mSequenceName;
   if (!mOverwrite) {
@@ -23,10 +191,32 @@ void SynthRecorder::stopRecord() {
     int counter = 0;
     while (File::exists(newFileName)) {
       newSequenceName = mSequenceName + "_" + std::to_string(counter++);
-      newFileName = path + newSequenceName + ".synthSequence";
+      newFileName = path + newSequenceName + extension;
     }
     fileName = newFileName;
   }
+  if (mFormat == BINARY_SEQUENCE) {
+    SynthSequenceFileWriter writer;
+    for (SynthEvent &event : mSequence) {
+      if (event.type == SynthEventType::TRIGGER_ON) {
+        writer.addTriggerOn(event.time, event.id, event.synthName,
+                            event.pFields);
+      } else if (event.type == SynthEventType::TRIGGER_OFF) {
+        writer.addTriggerOff(event.time, event.id);
+      }
+    }
+    mSequence.clear();
+    if (writer.write(fileName)) {
+      std::cout << "Recorded: " << fileName << std::endl;
+    }
+    return;
+  } else if (mFormat == MIDI_FILE) {
+    if (writeMIDIFile(fileName)) {
+      std::cout << "Recorded: " << fileName << std::endl;
+    }
+    mSequence.clear();
+    return;
+  }
   std::vector<std::string> usedInstruments;
   std::ofstream f(fileName);
   if (!f.is_open()) {
@@ -138,6 +328,107 @@ void SynthRecorder::stopRecord() {
   //        recorder->mPresetHandler->getSubDirectory();
 }
 
+bool SynthRecorder::writeMIDIFile(std::string fileName) {
+  // Default mapping: a channel per voice class, note and velocity from
+  // trigger parameters named like frequency and amplitude
+  struct VoiceFields {
+    int channel;
+    int frequencyField;
+    int amplitudeField;
+  };
+  std::map<std::string, VoiceFields> voiceFields;
+  auto defaultMapping = [&](const SynthEvent &event, int &channel,
+                            int &noteNumber, int &velocity) {
+    auto found = voiceFields.find(event.synthName);
+    if (found == voiceFields.end()) {
+      VoiceFields fields{int(voiceFields.size() % 16), -1, -1};
+      auto *voice = mPolySynth ? mPolySynth->getVoice(event.synthName) : nullptr;
+      if (voice) {
+        int index = 0;
+        for (auto *param : voice->triggerParameters()) {
+          if (!param) {
+            continue;
+          }
+          std::string name = param->getName();
+          std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+          if (fields.frequencyField < 0 &&
+              name.find("freq") != std::string::npos) {
+            fields.frequencyField = index;
+          } else if (fields.amplitudeField < 0 &&
+                     name.find("amp") != std::string::npos) {
+            fields.amplitudeField = index;
+          }
+          index++;
+        }
+        mPolySynth->insertFreeVoice(voice);
+      }
+      found = voiceFields.insert({event.synthName, fields}).first;
+    }
+    const VoiceFields &fields = found->second;
+    channel = fields.channel;
+    noteNumber = 60;
+    velocity = 100;
+    int numFields = int(event.pFields.size());
+    if (fields.frequencyField >= 0 && fields.frequencyField < numFields &&
+        event.pFields[fields.frequencyField].type() == ParameterField::FLOAT) {
+      float frequency = event.pFields[fields.frequencyField].get<float>();
+      if (frequency > 0.0f) {
+        noteNumber = int(std::round(69.0 + 12.0 * std::log2(frequency / 440.0)));
+      }
+    }
+    if (fields.amplitudeField >= 0 && fields.amplitudeField < numFields &&
+        event.pFields[fields.amplitudeField].type() == ParameterField::FLOAT) {
+      velocity =
+          int(event.pFields[fields.amplitudeField].get<float>() * 127.0f + 0.5f);
+    }
+    return true;
+  };
+
+  // Recorded times are in seconds, written as beats at 60 bpm
+  MIDIFileWriter writer;
+  int track = writer.addTrack(mSequenceName);
+  writer.tempo(track, 0, 60.0);
+  struct Note {
+    int channel;
+    int noteNumber;
+  };
+  std::map<int, Note> openNotes;  // By voice id
+  uint64_t endTick = 0;
+  for (SynthEvent &event : mSequence) {
+    endTick = std::max(endTick, writer.ticks(event.time));
+    if (event.type == SynthEventType::TRIGGER_ON) {
+      int channel, noteNumber, velocity;
+      bool include = mMIDIExportMapping
+                         ? mMIDIExportMapping(event, channel, noteNumber,
+                                              velocity)
+                         : defaultMapping(event, channel, noteNumber, velocity);
+      if (!include) {
+        continue;
+      }
+      channel = std::min(std::max(channel, 0), 15);
+      noteNumber = std::min(std::max(noteNumber, 0), 127);
+      velocity = std::min(std::max(velocity, 1), 127);
+      writer.noteOn(track, writer.ticks(event.time), channel, noteNumber,
+                    velocity);
+      openNotes[event.id] = {channel, noteNumber};
+    } else if (event.type == SynthEventType::TRIGGER_OFF) {
+      auto found = openNotes.find(event.id);
+      if (found != openNotes.end()) {
+        writer.noteOff(track, writer.ticks(event.time), found->second.channel,
+                       found->second.noteNumber);
+        openNotes.erase(found);
+      }
+    }
+  }
+  // End notes still held when recording stopped at the last event, so they
+  // don't sound forever when the file is played
+  for (auto &note : openNotes) {
+    writer.noteOff(track, endTick, note.second.channel,
+                   note.second.noteNumber);
+  }
+  return writer.write(fileName);
+}
+
 void SynthRecorder::registerPolySynth(PolySynth &polySynth) {
   polySynth.registerTriggerOnCallback(SynthRecorder::onTriggerOn, this);
   polySynth.registerTriggerOffCallback(SynthRecorder::onTriggerOff, this);
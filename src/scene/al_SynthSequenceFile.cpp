@@ -0,0 +1,364 @@
+#include "al/scene/al_SynthSequenceFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+#ifdef AL_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace al;
+
+static_assert(sizeof(SynthSequenceFile::Header) == 32,
+              "Unexpected compiled sequence header size");
+static_assert(sizeof(SynthSequenceFile::Event) == 32,
+              "Unexpected compiled sequence event size");
+
+const char SynthSequenceFile::MAGIC[8] = {'A', 'L', 'S', 'Y', 'N', 'S', 'Q', '\0'};
+
+static const std::string compiledSequenceExtension = ".synthSequenceBin";
+
+// Size of the field type array including padding
+static uint64_t fieldTypesSize(uint64_t numFields) {
+  return (numFields + 3) & ~uint64_t(3);
+}
+
+bool SynthSequenceFile::open(const std::string &fileName) {
+  close();
+  const char *data = nullptr;
+  uint64_t size = 0;
+#ifdef AL_WINDOWS
+  HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cerr << "ERROR: Could not open compiled sequence: " << fileName
+              << std::endl;
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(file, &fileSize);
+  size = uint64_t(fileSize.QuadPart);
+  HANDLE mapping =
+      size > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)
+               : NULL;
+  if (mapping) {
+    data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  }
+  if (!data) {
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+  } else {
+    mFileHandle = file;
+    mMappingHandle = mapping;
+  }
+#else
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "ERROR: Could not open compiled sequence: " << fileName
+              << std::endl;
+    return false;
+  }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+    size = uint64_t(fileStat.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      data = (const char *)mapped;
+    }
+  }
+  ::close(fd);  // The mapping stays valid after closing
+#endif
+  if (!data) {
+    std::cerr << "ERROR: Could not map compiled sequence: " << fileName
+              << std::endl;
+    return false;
+  }
+  mMapping = (void *)data;
+  mMappingSize = size_t(size);
+
+  // Validate before exposing any of the tables
+  const Header *header = (const Header *)data;
+  if (size < sizeof(Header) || memcmp(header->magic, MAGIC, 8) != 0 ||
+      header->version != VERSION) {
+    std::cerr << "ERROR: Not a compiled sequence: " << fileName << std::endl;
+    close();
+    return false;
+  }
+  uint64_t eventsOffset = sizeof(Header);
+  uint64_t fieldsOffset =
+      eventsOffset + uint64_t(header->numEvents) * sizeof(Event);
+  uint64_t typesOffset =
+      fieldsOffset + uint64_t(header->numFields) * sizeof(uint32_t);
+  uint64_t stringOffsetsOffset =
+      typesOffset + fieldTypesSize(header->numFields);
+  uint64_t stringsOffset =
+      stringOffsetsOffset +
+      (uint64_t(header->numStrings) + 1) * sizeof(uint32_t);
+  if (stringsOffset + header->stringDataSize > size) {
+    std::cerr << "ERROR: Truncated compiled sequence: " << fileName
+              << std::endl;
+    close();
+    return false;
+  }
+  mEvents = (const Event *)(data + eventsOffset);
+  mFields = (const uint32_t *)(data + fieldsOffset);
+  mFieldTypes = (const uint8_t *)(data + typesOffset);
+  mStringOffsets = (const uint32_t *)(data + stringOffsetsOffset);
+  mStrings = data + stringsOffset;
+  for (uint32_t i = 0; i < header->numEvents; i++) {
+    if (uint64_t(mEvents[i].firstField) + mEvents[i].numFields >
+        header->numFields) {
+      std::cerr << "ERROR: Corrupt compiled sequence: " << fileName
+                << std::endl;
+      close();
+      return false;
+    }
+  }
+  // Each string starts inside the string data and ends with its own null
+  // terminator before the next one starts
+  bool stringsValid =
+      mStringOffsets[header->numStrings] <= header->stringDataSize;
+  for (uint32_t i = 0; stringsValid && i < header->numStrings; i++) {
+    uint32_t start = mStringOffsets[i];
+    uint32_t end = mStringOffsets[i + 1];
+    stringsValid = start < end && end <= header->stringDataSize &&
+                   mStrings[end - 1] == '\0';
+  }
+  if (!stringsValid) {
+    std::cerr << "ERROR: Corrupt compiled sequence: " << fileName << std::endl;
+    close();
+    return false;
+  }
+  mHeader = header;
+  return true;
+}
+
+void SynthSequenceFile::close() {
+  if (mMapping) {
+#ifdef AL_WINDOWS
+    UnmapViewOfFile(mMapping);
+    CloseHandle((HANDLE)mMappingHandle);
+    CloseHandle((HANDLE)mFileHandle);
+    mMappingHandle = nullptr;
+    mFileHandle = nullptr;
+#else
+    munmap(mMapping, mMappingSize);
+#endif
+  }
+  mMapping = nullptr;
+  mMappingSize = 0;
+  mHeader = nullptr;
+  mEvents = nullptr;
+  mFields = nullptr;
+  mFieldTypes = nullptr;
+  mStringOffsets = nullptr;
+  mStrings = nullptr;
+}
+
+const char *SynthSequenceFile::string(uint32_t index) const {
+  if (!mHeader || index >= mHeader->numStrings) {
+    return nullptr;
+  }
+  return mStrings + mStringOffsets[index];
+}
+
+float SynthSequenceFile::fieldFloat(const Event &event,
+                                    unsigned int field) const {
+  uint32_t bits = mFields[event.firstField + field];
+  switch (fieldType(event, field)) {
+    case FIELD_FLOAT: {
+      float value;
+      memcpy(&value, &bits, sizeof(float));
+      return value;
+    }
+    case FIELD_INT32:
+      return float(int32_t(bits));
+    default:
+      return 0.0f;
+  }
+}
+
+const char *SynthSequenceFile::fieldString(const Event &event,
+                                           unsigned int field) const {
+  if (fieldType(event, field) != FIELD_STRING) {
+    return nullptr;
+  }
+  return string(mFields[event.firstField + field]);
+}
+
+std::vector<ParameterField> SynthSequenceFile::fields(
+    const Event &event) const {
+  std::vector<ParameterField> pFields;
+  pFields.reserve(event.numFields);
+  for (unsigned int i = 0; i < event.numFields; i++) {
+    switch (fieldType(event, i)) {
+      case FIELD_FLOAT:
+        pFields.push_back(fieldFloat(event, i));
+        break;
+      case FIELD_INT32:
+        pFields.push_back(int32_t(mFields[event.firstField + i]));
+        break;
+      case FIELD_STRING: {
+        const char *text = fieldString(event, i);
+        pFields.push_back(text ? text : "");
+      } break;
+    }
+  }
+  return pFields;
+}
+
+bool SynthSequenceFile::isCompiledSequence(const std::string &fileName) {
+  return fileName.size() >= compiledSequenceExtension.size() &&
+         fileName.compare(fileName.size() - compiledSequenceExtension.size(),
+                          compiledSequenceExtension.size(),
+                          compiledSequenceExtension) == 0;
+}
+
+// SynthSequenceFileWriter ----------------------------------------------------
+
+void SynthSequenceFileWriter::addEvent(
+    double time, double duration, const std::string &synthName,
+    const std::vector<ParameterField> &fields) {
+  add(SynthSequenceFile::EVENT, time, duration, -1, synthName, fields);
+}
+
+void SynthSequenceFileWriter::addTriggerOn(
+    double time, int id, const std::string &synthName,
+    const std::vector<ParameterField> &fields) {
+  add(SynthSequenceFile::TRIGGER_ON, time, -1, id, synthName, fields);
+}
+
+void SynthSequenceFileWriter::addTriggerOff(double time, int id) {
+  add(SynthSequenceFile::TRIGGER_OFF, time, -1, id, "", {});
+}
+
+void SynthSequenceFileWriter::clear() {
+  mEvents.clear();
+  mFields.clear();
+  mFieldTypes.clear();
+  mStringOffsets.clear();
+  mStrings.clear();
+  mStringIndex.clear();
+}
+
+bool SynthSequenceFileWriter::write(const std::string &fileName) {
+  // Sort through an index so that field ranges stay valid
+  std::vector<uint32_t> order(mEvents.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return mEvents[a].time < mEvents[b].time;
+  });
+
+  SynthSequenceFile::Header header;
+  memcpy(header.magic, SynthSequenceFile::MAGIC, 8);
+  header.version = SynthSequenceFile::VERSION;
+  header.numEvents = uint32_t(mEvents.size());
+  header.numFields = uint32_t(mFields.size());
+  header.numStrings = uint32_t(mStringOffsets.size());
+  header.stringDataSize = uint32_t(mStrings.size());
+  header.reserved = 0;
+
+  FILE *f = fopen(fileName.c_str(), "wb");
+  if (!f) {
+    std::cerr << "ERROR: Could not write compiled sequence: " << fileName
+              << std::endl;
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  for (uint32_t index : order) {
+    ok = ok && fwrite(&mEvents[index], sizeof(SynthSequenceFile::Event), 1,
+                      f) == 1;
+  }
+  std::vector<uint8_t> types = mFieldTypes;
+  types.resize(fieldTypesSize(types.size()), 0);
+  std::vector<uint32_t> stringOffsets = mStringOffsets;
+  stringOffsets.push_back(uint32_t(mStrings.size()));
+  if (mFields.size() > 0) {
+    ok = ok && fwrite(mFields.data(), sizeof(uint32_t), mFields.size(), f) ==
+                   mFields.size();
+  }
+  if (types.size() > 0) {
+    ok = ok && fwrite(types.data(), 1, types.size(), f) == types.size();
+  }
+  ok = ok && fwrite(stringOffsets.data(), sizeof(uint32_t),
+                    stringOffsets.size(), f) == stringOffsets.size();
+  if (mStrings.size() > 0) {
+    ok = ok && fwrite(mStrings.data(), 1, mStrings.size(), f) == mStrings.size();
+  }
+  // Keep the file size a multiple of 8 so files can be concatenated or mapped
+  // at aligned offsets
+  const char padding[8] = {0};
+  long position = ftell(f);
+  if (position > 0 && position % 8 != 0) {
+    ok = ok && fwrite(padding, 1, 8 - position % 8, f) == size_t(8 - position % 8);
+  }
+  ok = (fclose(f) == 0) && ok;
+  if (!ok) {
+    std::cerr << "ERROR: Failed writing compiled sequence: " << fileName
+              << std::endl;
+  }
+  return ok;
+}
+
+uint32_t SynthSequenceFileWriter::intern(const std::string &text) {
+  auto found = mStringIndex.find(text);
+  if (found != mStringIndex.end()) {
+    return found->second;
+  }
+  uint32_t index = uint32_t(mStringOffsets.size());
+  mStringOffsets.push_back(uint32_t(mStrings.size()));
+  mStrings.append(text);
+  mStrings.push_back('\0');
+  mStringIndex[text] = index;
+  return index;
+}
+
+void SynthSequenceFileWriter::add(SynthSequenceFile::EventType type,
+                                  double time, double duration, int id,
+                                  const std::string &synthName,
+                                  const std::vector<ParameterField> &fields) {
+  SynthSequenceFile::Event event;
+  event.time = time;
+  event.duration = duration;
+  event.id = id;
+  event.synthName = intern(synthName);
+  event.firstField = uint32_t(mFields.size());
+  event.numFields = uint16_t(std::min(fields.size(), size_t(UINT16_MAX)));
+  event.type = type;
+  event.reserved = 0;
+  for (uint16_t i = 0; i < event.numFields; i++) {
+    const ParameterField &field = fields[i];
+    uint32_t bits = 0;
+    switch (field.type()) {
+      case ParameterField::FLOAT: {
+        float value = field.get<float>();
+        memcpy(&bits, &value, sizeof(float));
+        mFieldTypes.push_back(SynthSequenceFile::FIELD_FLOAT);
+      } break;
+      case ParameterField::INT32:
+        bits = uint32_t(field.get<int32_t>());
+        mFieldTypes.push_back(SynthSequenceFile::FIELD_INT32);
+        break;
+      case ParameterField::STRING:
+        bits = intern(field.get<std::string>());
+        mFieldTypes.push_back(SynthSequenceFile::FIELD_STRING);
+        break;
+      case ParameterField::NULLDATA:
+        mFieldTypes.push_back(SynthSequenceFile::FIELD_FLOAT);
+        break;
+    }
+    mFields.push_back(bits);
+  }
+  mEvents.push_back(event);
+}
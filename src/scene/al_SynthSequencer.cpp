@@ -1,81 +1,268 @@
 
 #include "al/scene/al_SynthSequencer.hpp"
+#include "al/scene/al_SynthSequenceFile.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <typeinfo>  // For class name instrospection
+#include <unordered_map>
 
 using namespace al;
 
+// SynthSequencerTimeline -----------------------------------------------------
+
+SynthSequencerTimeline::~SynthSequencerTimeline() {
+  collectRetired();
+  std::unique_ptr<Events> pending(mPending.exchange(nullptr));
+  std::unique_ptr<Events> active(mActive);
+  mActive = nullptr;
+}
+
+void SynthSequencerTimeline::insert(const SynthSequencerEvent &event,
+                                    bool publishNow) {
+  std::unique_lock<std::mutex> lk(mEditLock);
+  auto position = std::upper_bound(
+      mEdit.begin(), mEdit.end(), event.startTime,
+      [](double time, const SynthSequencerEvent &e) {
+        return time < e.startTime;
+      });
+  size_t index = size_t(position - mEdit.begin());
+  mEdit.insert(position, event);
+  if (!publishNow) {
+    mUnpublished = true;
+    return;
+  }
+  if (!mUnpublished) {
+    // Only this thread stores non null pending buffers, so a buffer taken
+    // back from mPending matches mEdit before this insert
+    Events *pending = mPending.exchange(nullptr);
+    if (pending) {
+      pending->insert(pending->begin() + index, event);
+      mPending.store(pending);
+      collectRetired();
+      return;
+    }
+  }
+  publishLocked();
+}
+
+void SynthSequencerTimeline::insert(Events events, bool publishNow) {
+  auto byStartTime = [](const SynthSequencerEvent &a,
+                        const SynthSequencerEvent &b) {
+    return a.startTime < b.startTime;
+  };
+  std::stable_sort(events.begin(), events.end(), byStartTime);
+  std::unique_lock<std::mutex> lk(mEditLock);
+  size_t previousSize = mEdit.size();
+  mEdit.insert(mEdit.end(), std::make_move_iterator(events.begin()),
+               std::make_move_iterator(events.end()));
+  std::inplace_merge(mEdit.begin(), mEdit.begin() + previousSize, mEdit.end(),
+                     byStartTime);
+  if (publishNow) {
+    publishLocked();
+  } else {
+    mUnpublished = true;
+  }
+}
+
+void SynthSequencerTimeline::assign(Events events) {
+  std::stable_sort(
+      events.begin(), events.end(),
+      [](const SynthSequencerEvent &a, const SynthSequencerEvent &b) {
+        return a.startTime < b.startTime;
+      });
+  std::unique_lock<std::mutex> lk(mEditLock);
+  mEdit = std::move(events);
+  lk.unlock();
+  publish();
+}
+
+SynthSequencerTimeline::Events SynthSequencerTimeline::clear() {
+  Events removed;
+  std::unique_lock<std::mutex> lk(mEditLock);
+  removed.swap(mEdit);
+  lk.unlock();
+  publish();
+  return removed;
+}
+
+void SynthSequencerTimeline::publish() {
+  std::unique_lock<std::mutex> lk(mEditLock);
+  publishLocked();
+}
+
+void SynthSequencerTimeline::publishLocked() {
+  mUnpublished = false;
+  std::unique_ptr<Events> published = std::make_unique<Events>(mEdit);
+  // A pending buffer that the rendering thread has not picked up yet can be
+  // freed here, as it only takes buffers through exchange()
+  std::unique_ptr<Events> unused(mPending.exchange(published.release()));
+  collectRetired();
+}
+
+SynthSequencerTimeline::Events SynthSequencerTimeline::events() {
+  std::unique_lock<std::mutex> lk(mEditLock);
+  return mEdit;
+}
+
+size_t SynthSequencerTimeline::size() {
+  std::unique_lock<std::mutex> lk(mEditLock);
+  return mEdit.size();
+}
+
+bool SynthSequencerTimeline::acquire() {
+  // Only swap if there is room to hand back the previous buffer
+  if (mRetired.writeSpace() < sizeof(Events *)) {
+    return false;
+  }
+  Events *newEvents = mPending.exchange(nullptr);
+  if (!newEvents) {
+    return false;
+  }
+  Events *previous = mActive;
+  mActive = newEvents;
+  if (previous) {
+    mRetired.write((const char *)&previous, sizeof(Events *));
+  }
+  return true;
+}
+
+size_t SynthSequencerTimeline::seek(double time) const {
+  const Events &events = active();
+  return std::lower_bound(events.begin(), events.end(), time,
+                          [](const SynthSequencerEvent &e, double t) {
+                            return e.startTime < t;
+                          }) -
+         events.begin();
+}
+
+size_t SynthSequencerTimeline::seekAfter(double time) const {
+  const Events &events = active();
+  return std::upper_bound(events.begin(), events.end(), time,
+                          [](double t, const SynthSequencerEvent &e) {
+                            return t < e.startTime;
+                          }) -
+         events.begin();
+}
+
+void SynthSequencerTimeline::collectRetired() {
+  Events *retired;
+  while (mRetired.read((char *)&retired, sizeof(Events *)) ==
+         sizeof(Events *)) {
+    std::unique_ptr<Events> toFree(retired);
+  }
+}
+
+// SynthSequencer -------------------------------------------------------------
+
+SynthSequencer::~SynthSequencer() {
+  stopCpuThread();
+  collectRetiredTempoMaps();
+  std::unique_ptr<TempoMap> pending(mPendingTempoMap.exchange(nullptr));
+}
+
 void SynthSequencer::render(AudioIOData &io) {
   if (mMasterMode == TimeMasterMode::TIME_MASTER_AUDIO) {
-    double timeIncrement =
-        mNormalizedTempo * io.framesPerBuffer() / (double)io.framesPerSecond();
-    double blockStartTime = mMasterTime;
-    mMasterTime += timeIncrement;
-    processEvents(blockStartTime, mNormalizedTempo * io.framesPerSecond());
+    syncTimeline();
+    advance((unsigned int)io.framesPerBuffer(), io.framesPerSecond());
   }
   mPolySynth->render(io);
 }
 
 void SynthSequencer::render(Graphics &g) {
   if (mMasterMode == TimeMasterMode::TIME_MASTER_GRAPHICS) {
-    double timeIncrement = 1.0 / mFps;
-    double blockStartTime = mMasterTime;
-    mMasterTime += timeIncrement;
-    processEvents(blockStartTime, mNormalizedTempo * mFps);
+    syncTimeline();
+    advance(1, mFps);
   }
   mPolySynth->render(g);
 }
 
+void SynthSequencer::setTempoMap(const TempoMap &tempoMap) {
+  std::unique_lock<std::mutex> lk(mTempoMapLock);
+  mTempoMap = tempoMap;
+  // A map the time master has not picked up yet can be freed here
+  std::unique_ptr<TempoMap> unused(
+      mPendingTempoMap.exchange(new TempoMap(tempoMap)));
+  collectRetiredTempoMaps();
+}
+
+TempoMap SynthSequencer::tempoMap() {
+  std::unique_lock<std::mutex> lk(mTempoMapLock);
+  return mTempoMap;
+}
+
+void SynthSequencer::collectRetiredTempoMaps() {
+  TempoMap *retired;
+  while (mRetiredTempoMaps.read((char *)&retired, sizeof(TempoMap *)) ==
+         sizeof(TempoMap *)) {
+    std::unique_ptr<TempoMap> toFree(retired);
+  }
+}
+
+void SynthSequencer::advance(unsigned int frames, double frameRate) {
+  if (frameRate != mFrameRate) {
+    if (mFrameRate > 0.0) {
+      mAnchorSeconds += mFrame / mFrameRate;
+    }
+    mFrame = 0;
+    mFrameRate = frameRate;
+  }
+  double blockStartTime = mMasterTime;
+  int64_t blockStartFrame = mFrame;
+  mFrame += frames;
+  mMasterTime = mActiveTempoMap->beats(mAnchorSeconds + mFrame / mFrameRate);
+  processEvents(blockStartTime, blockStartFrame, frames);
+}
+
 void SynthSequencer::print() {
   std::cout << "POLYSYNTH INFO ................." << std::endl;
   mPolySynth->print();
 }
 
 bool SynthSequencer::playSequence(std::string sequenceName, float startTime) {
+  // From a callback on the CPU thread, the thread keeps running and plays
+  // the new sequence
+  bool restartCpuThread = !onCpuThread();
+  if (restartCpuThread) {
+    stopCpuThread();
+  }
   //        synth().allNotesOff();
   // Add an offset of 0.1 to make sure the allNotesOff message gets processed
   // before the sequence
-  mMasterTime = startTime;
-  double currentMasterTime = mMasterTime;
   const double startPad = 0.0;
-  std::list<SynthSequencerEvent> events =
-      loadSequence(sequenceName, currentMasterTime - startTime + startPad);
-  std::unique_lock<std::mutex> lk(mEventLock);
+  std::vector<SynthSequencerEvent> events =
+      loadSequence(sequenceName, startPad);
   mLastSequencePlayed = sequenceName;
-  mEvents = events;
-  mNextEvent = 0;
-  mPlaybackStartTime = currentMasterTime - startTime + startPad;
+  returnVoices(mTimeline.clear());
+  mTimeline.assign(std::move(events));
+  mPlaybackStartTime = startPad;
+  // Seek after publishing, so the time master sees the new events when it
+  // applies the seek
+  mSeekTime = startTime;
+  mSeekRequested = true;
   mPlaying = true;
-  lk.unlock();
   for (auto cb : mSequenceBeginCallbacks) {
     cb(mLastSequencePlayed);
   }
-  if (mMasterMode == TimeMasterMode::TIME_MASTER_CPU) {
+  if (mMasterMode == TimeMasterMode::TIME_MASTER_CPU && restartCpuThread) {
     mCpuThread = std::make_shared<std::thread>([&](int granularityns = 1000) {
-      bool running = true;
+      mCpuThreadId = std::this_thread::get_id();
       auto startTime = std::chrono::high_resolution_clock::now();
-      while (running) {
-        std::unique_lock<std::mutex> lk(mEventLock);
-        if (mEvents.size() == 0) {
-          running = false;
-          if (verbose()) {
-            std::cout << "CPU play thread done." << std::endl;
-          }
-        }
-        lk.unlock();
-        double timeIncrement = granularityns / 1.0e-9;
-        double blockStartTime = mMasterTime;
-        mMasterTime += timeIncrement;
-        processEvents(blockStartTime, 1.0e9 / granularityns);
+      uint64_t ticks = 0;
+      while (mPlaying) {
+        syncTimeline();
+        advance(1, 1.0e9 / granularityns);
+        ticks++;
         std::this_thread::sleep_until(
-            startTime +
-            std::chrono::nanoseconds(uint32_t(mMasterTime * 1.0e9)));
+            startTime + std::chrono::nanoseconds(ticks * granularityns));
+      }
+      if (verbose()) {
+        std::cout << "CPU play thread done." << std::endl;
       }
     });
   }
@@ -83,28 +270,41 @@ bool SynthSequencer::playSequence(std::string sequenceName, float startTime) {
 }
 
 void SynthSequencer::stopSequence() {
-  std::unique_lock<std::mutex> lk(mEventLock);
-  for (auto &event : mEvents) {
-    if (event.type == SynthSequencerEvent::EVENT_VOICE) {
-      // Give back allocated voice to synth
-      if (event.voice) {
-        mPolySynth->insertFreeVoice(event.voice);
-      }
+  returnVoices(mTimeline.clear());
+  mPlaying = false;
+}
+
+void SynthSequencer::stopCpuThread() {
+  if (onCpuThread()) {
+    mPlaying = false;
+    return;
+  }
+  if (mCpuThread) {
+    mPlaying = false;
+    mCpuThread->join();
+    mCpuThread = nullptr;
+    mCpuThreadId = std::thread::id();
+  }
+}
+
+void SynthSequencer::returnVoices(std::vector<SynthSequencerEvent> events) {
+  for (auto &event : events) {
+    // Voices already taken by the time master belong to the synth
+    SynthVoice *voice = event.takeVoice();
+    if (voice) {
+      mPolySynth->insertFreeVoice(voice);
     }
   }
+}
 
-  mEvents.clear();
-  mNextEvent = 0;
-  mPlaying = false;
+void SynthSequencer::addEvents(std::vector<SynthSequencerEvent> events) {
+  mTimeline.insert(std::move(events));
 }
 
 void SynthSequencer::setTime(float newTime) {
   synth().allNotesOff();
-  //  mPlaybackStartTime = newTime;
-  mMasterTime = newTime;
-  mNextEvent = 0;
-
-  //  std::cout << "Setting time not implemented" <<std::endl;
+  mSeekTime = newTime;
+  mSeekRequested = true;
 }
 
 void SynthSequencer::setDirectory(std::string directory) {
@@ -114,15 +314,9 @@ void SynthSequencer::setDirectory(std::string directory) {
 
 void SynthSequencer::registerTimeChangeCallback(std::function<void(float)> func,
                                                 float minTimeDeltaSec) {
-  if (mEventLock.try_lock()) {
-    mTimeAccumCallbackNs.push_back(0.0);
-    mTimeChangeCallbacks.push_back({func, minTimeDeltaSec});
-    //    mTimeChangeMinTimeDelta = minTimeDeltaSec;
-    mEventLock.unlock();
-  } else {
-    std::cerr << "ERROR: Failed to set time change callback. Sequencer running"
-              << std::endl;
-  }
+  std::unique_lock<std::mutex> lk(mCallbackLock);
+  mTimeAccumCallbackNs.push_back(0.0);
+  mTimeChangeCallbacks.push_back({func, minTimeDeltaSec});
 }
 
 void SynthSequencer::registerSequenceBeginCallback(
@@ -149,19 +343,27 @@ std::string SynthSequencer::buildFullPath(std::string sequenceName) {
   if (fullName.back() != '/') {
     fullName += "/";
   }
-  if (sequenceName.size() < 14 ||
-      sequenceName.substr(sequenceName.size() - 14) != ".synthSequence") {
+  if (!SynthSequenceFile::isCompiledSequence(sequenceName) &&
+      (sequenceName.size() < 14 ||
+       sequenceName.substr(sequenceName.size() - 14) != ".synthSequence")) {
     sequenceName += ".synthSequence";
   }
   fullName += sequenceName;
   return fullName;
 }
 
-std::list<SynthSequencerEvent> SynthSequencer::loadSequence(
+std::vector<SynthSequencerEvent> SynthSequencer::loadSequence(
     std::string sequenceName, double timeOffset, double timeScale) {
   std::unique_lock<std::mutex> lk(mLoadingLock);
-  std::list<SynthSequencerEvent> events;
+  std::vector<SynthSequencerEvent> events;
   std::string fullName = buildFullPath(sequenceName);
+  // Prefer the text sequence, fall back to a compiled sequence of the same
+  // name if there is no text version
+  if (SynthSequenceFile::isCompiledSequence(fullName)) {
+    return loadCompiledSequence(fullName, timeOffset, timeScale);
+  } else if (!File::exists(fullName) && File::exists(fullName + "Bin")) {
+    return loadCompiledSequence(fullName + "Bin", timeOffset, timeScale);
+  }
   std::ifstream f(fullName);
   if (!f.is_open()) {
     std::cout << "Could not open:" << fullName << std::endl;
@@ -249,55 +451,14 @@ std::list<SynthSequencerEvent> SynthSequencer::loadSequence(
         }
       }
 
-      if (false) {  // Insert event as EVENT_VOICE. This is not good as it
-                    // forces preallocating all the events...
-        SynthVoice *newVoice = mPolySynth->getVoice(name);
-        if (newVoice) {
-          if (!newVoice->setTriggerParams(pFields)) {
-            std::cout << "Error setting pFields for voice of type " << name
-                      << ". Fields: ";
-            for (auto &field : pFields) {
-              std::cout << field.type() << " ";
-            }
-            std::cout << std::endl;
-            mPolySynth->insertFreeVoice(
-                newVoice);  // Return voice to sequencer.
-          } else {
-            double absoluteTime = timeOffset + startTime;
-            // Insert into event list, sorted.
-            auto position = events.begin();
-            while (position != events.end() &&
-                   position->startTime < absoluteTime) {
-              position++;
-            }
-            auto insertedEvent = events.insert(position, SynthSequencerEvent());
-            // Add 0.1 padding to ensure all events play.
-            insertedEvent->type = SynthSequencerEvent::EVENT_VOICE;
-            insertedEvent->startTime = absoluteTime;
-            insertedEvent->duration = duration;
-            insertedEvent->voice = newVoice;
-            //                        std::cout << "Inserted event " <<
-            //                        events.size() << " at time " <<
-            //                        absoluteTime << std::endl;
-          }
-        }
-      } else {
-        double absoluteTime = timeOffset + startTime;
-        // Insert into event list, sorted.
-        auto position = events.begin();
-        while (position != events.end() && position->startTime < absoluteTime) {
-          position++;
-        }
-        auto insertedEvent = events.insert(position, SynthSequencerEvent());
-        // Add 0.1 padding to ensure all events play.
-        insertedEvent->type = SynthSequencerEvent::EVENT_PFIELDS;
-        insertedEvent->startTime = absoluteTime;
-        insertedEvent->duration = duration;
-        insertedEvent->fields.name = name;
-        insertedEvent->voice = nullptr;
-        insertedEvent->fields.pFields =
-            pFields;  // TODO it would be nice not to have to copy here...
-      }
+      // Events are sorted once the whole file has been read
+      events.emplace_back();
+      auto &insertedEvent = events.back();
+      insertedEvent.type = SynthSequencerEvent::EVENT_PFIELDS;
+      insertedEvent.startTime = timeOffset + startTime;
+      insertedEvent.duration = duration;
+      insertedEvent.fields.name = name;
+      insertedEvent.fields.pFields = std::move(pFields);
 
       //                std::cout << "Done reading sequence" << std::endl;
     } else if (command == '+' && ss.get() == ' ') {
@@ -336,24 +497,14 @@ std::list<SynthSequencerEvent> SynthSequencer::loadSequence(
           }
           std::cerr << std::endl;
         } else {
-          std::list<SynthSequencerEvent>::iterator insertedEvent;
-          double absoluteTime = timeOffset + startTime;
-          {
-            //                            // Insert into event list, sorted.
-            auto position = events.begin();
-            while (position != events.end() &&
-                   position->startTime < absoluteTime) {
-              position++;
-            }
-            insertedEvent = events.insert(position, SynthSequencerEvent());
-          }
-          // Add 0.1 padding to ensure all events play.
-          insertedEvent->type = SynthSequencerEvent::EVENT_VOICE;
-          insertedEvent->startTime = absoluteTime;
-          insertedEvent->duration =
-              -1;  // Turn on events have undetermined duration until a turn off
-                   // is found later
-          insertedEvent->voice = newVoice;
+          events.emplace_back();
+          auto &insertedEvent = events.back();
+          insertedEvent.type = SynthSequencerEvent::EVENT_VOICE;
+          insertedEvent.startTime = timeOffset + startTime;
+          // Turn on events have undetermined duration until a turn off is
+          // found later
+          insertedEvent.duration = -1;
+          insertedEvent.setVoice(newVoice);
           //                        std::cout << "Inserted event " << id << " at
           //                        time " << startTime << std::endl;
         }
@@ -370,8 +521,9 @@ std::list<SynthSequencerEvent> SynthSequencer::loadSequence(
       int id = std::stoi(idText);
       double eventTime = std::stod(time) * timeScale * tempoFactor;
       for (SynthSequencerEvent &event : events) {
-        if (event.voice->id() == id && event.duration < 0 &&
-            event.type == SynthSequencerEvent::EVENT_VOICE) {
+        if (event.type == SynthSequencerEvent::EVENT_VOICE &&
+            event.duration < 0 && event.peekVoice() &&
+            event.peekVoice()->id() == id) {
           double duration = eventTime - event.startTime + timeOffset;
           if (duration < 0) {
             duration = 0;
@@ -398,14 +550,10 @@ std::list<SynthSequencerEvent> SynthSequencer::loadSequence(
                                     stod(timeScaleInFile) * tempoFactor);
       lk.lock();
       events.insert(events.end(), newEvents.begin(), newEvents.end());
-      // FIXME: This sorting only works if both the existing sequence and
+      // FIXME: Merging only works if both the existing sequence and
       // the incoming sequence use absolute event times. Sorting
       // anything else results in chaos... This should be detected
       // and acted on
-      events.sort(
-          [](const SynthSequencerEvent &a, const SynthSequencerEvent &b) {
-            return a.startTime < b.startTime;
-          });
     } else if (command == '>' && ss.get() == ' ') {
       std::string time;
       std::getline(ss, time);
@@ -426,9 +574,114 @@ std::list<SynthSequencerEvent> SynthSequencer::loadSequence(
   if (f.bad()) {
     std::cout << "Error reading:" << fullName << std::endl;
   }
+  std::stable_sort(
+      events.begin(), events.end(),
+      [](const SynthSequencerEvent &a, const SynthSequencerEvent &b) {
+        return a.startTime < b.startTime;
+      });
+  return events;
+}
+
+std::vector<SynthSequencerEvent> SynthSequencer::loadCompiledSequence(
+    std::string fullName, double timeOffset, double timeScale) {
+  std::vector<SynthSequencerEvent> events;
+  SynthSequenceFile file;
+  if (!file.open(fullName)) {
+    return events;
+  }
+  events.reserve(file.size());
+  // Trigger on events waiting for their trigger off, by id
+  std::unordered_map<int32_t, size_t> openTriggers;
+  std::vector<float> pFields;
+  for (uint32_t i = 0; i < file.size(); i++) {
+    const SynthSequenceFile::Event &event = file.event(i);
+    double startTime = timeOffset + event.time * timeScale;
+    if (event.type == SynthSequenceFile::EVENT) {
+      events.emplace_back();
+      auto &insertedEvent = events.back();
+      insertedEvent.type = SynthSequencerEvent::EVENT_PFIELDS;
+      insertedEvent.startTime = startTime;
+      insertedEvent.duration = event.duration * timeScale;
+      insertedEvent.fields.name = file.synthName(event);
+      insertedEvent.fields.pFields = file.fields(event);
+    } else if (event.type == SynthSequenceFile::TRIGGER_ON) {
+      const char *name = file.synthName(event);
+      SynthVoice *newVoice = mPolySynth->getVoice(name);
+      if (!newVoice) {
+        if (verbose()) {
+          std::cout << "Warning: Unable to get free voice from PolySynth."
+                    << std::endl;
+        }
+        continue;
+      }
+      pFields.resize(event.numFields);
+      for (unsigned int field = 0; field < event.numFields; field++) {
+        pFields[field] = file.fieldFloat(event, field);
+      }
+      newVoice->id(event.id);
+      if (!newVoice->setTriggerParams(pFields.data(), int(pFields.size()))) {
+        std::cerr << "Error setting pFields for voice of type " << name
+                  << std::endl;
+        mPolySynth->insertFreeVoice(newVoice);
+        continue;
+      }
+      events.emplace_back();
+      auto &insertedEvent = events.back();
+      insertedEvent.type = SynthSequencerEvent::EVENT_VOICE;
+      insertedEvent.startTime = startTime;
+      insertedEvent.duration =
+          event.duration >= 0 ? event.duration * timeScale : -1;
+      insertedEvent.setVoice(newVoice);
+      if (insertedEvent.duration < 0) {
+        openTriggers[event.id] = events.size() - 1;
+      }
+    } else if (event.type == SynthSequenceFile::TRIGGER_OFF) {
+      auto found = openTriggers.find(event.id);
+      if (found != openTriggers.end()) {
+        SynthSequencerEvent &onEvent = events[found->second];
+        onEvent.duration = std::max(0.0, startTime - onEvent.startTime);
+        openTriggers.erase(found);
+      }
+    }
+  }
+  // The file is sorted by time already
   return events;
 }
 
+bool SynthSequencer::compileSequence(std::string sequenceName,
+                                     std::string outputName) {
+  std::vector<SynthSequencerEvent> events = loadSequence(sequenceName, 0.0);
+  if (outputName.size() == 0) {
+    outputName = buildFullPath(sequenceName);
+    if (!SynthSequenceFile::isCompiledSequence(outputName)) {
+      outputName += "Bin";
+    }
+  }
+  SynthSequenceFileWriter writer;
+  int nextId = 0;
+  for (auto &event : events) {
+    if (event.type == SynthSequencerEvent::EVENT_PFIELDS) {
+      writer.addEvent(event.startTime, event.duration, event.fields.name,
+                      event.fields.pFields);
+    } else if (event.type == SynthSequencerEvent::EVENT_VOICE) {
+      SynthVoice *voice = event.peekVoice();
+      if (!voice) {
+        continue;
+      }
+      // Ids are renumbered, as inserted sequences may reuse them
+      int id = nextId++;
+      writer.addTriggerOn(event.startTime, id,
+                          demangle(typeid(*voice).name()),
+                          voice->getTriggerParams());
+      if (event.duration >= 0) {
+        writer.addTriggerOff(event.startTime + event.duration, id);
+      }
+    }
+  }
+  returnVoices(std::move(events));
+  return writer.write(outputName);
+}
+
 std::vector<std::string> SynthSequencer::getSequenceList() {
   std::vector<std::string> sequenceList;
   std::string path = mDirectory;
@@ -452,6 +705,19 @@ std::vector<std::string> SynthSequencer::getSequenceList() {
     sequenceList.push_back(name.substr(0, name.size() - 14));
   }
 
+  // Compiled sequences without a text version are listed too
+  FileList compiled_files = filterInDir(path, [](const FilePath &f) {
+    return SynthSequenceFile::isCompiledSequence(f.file());
+  });
+  for (int i = 0; i < compiled_files.count(); i += 1) {
+    const std::string &name = compiled_files[i].file();
+    std::string sequenceName = name.substr(0, name.size() - 17);
+    if (std::find(sequenceList.begin(), sequenceList.end(), sequenceName) ==
+        sequenceList.end()) {
+      sequenceList.push_back(sequenceName);
+    }
+  }
+
   std::sort(sequenceList.begin(), sequenceList.end(),
             [](const auto &lhs, const auto &rhs) {
               const auto result =
@@ -469,98 +735,137 @@ std::vector<std::string> SynthSequencer::getSequenceList() {
 }
 
 double SynthSequencer::getSequenceDuration(std::string sequenceName) {
-  std::list<SynthSequencerEvent> events = loadSequence(sequenceName, 0.0);
+  std::vector<SynthSequencerEvent> events = loadSequence(sequenceName, 0.0);
   double dur = 0.0;
-  for (auto const &event : events) {
+  for (auto &event : events) {
     if (event.startTime + event.duration > dur) {
       dur = event.startTime + event.duration;
     }
   }
+  // Voices allocated for the events are not needed
+  returnVoices(std::move(events));
   return dur;
 }
 
-void SynthSequencer::processEvents(double blockStartTime, double fpsAdjusted) {
-  if (mEventLock.try_lock()) {
-    if (mNextEvent < mEvents.size()) {
+void SynthSequencer::syncTimeline() {
+  // Read the seek request before acquiring, so that events published before
+  // the request are picked up together with it
+  bool seek = mSeekRequested.exchange(false);
+  bool newEvents = mTimeline.acquire();
+  // Only swap tempo maps if there is room to hand back the previous one
+  if (mRetiredTempoMaps.writeSpace() >= sizeof(TempoMap *)) {
+    TempoMap *newTempoMap = mPendingTempoMap.exchange(nullptr);
+    if (newTempoMap) {
+      TempoMap *previous = mActiveTempoMap.release();
+      mRetiredTempoMaps.write((const char *)&previous, sizeof(TempoMap *));
+      mActiveTempoMap.reset(newTempoMap);
+      // Continue from the current beat
+      mAnchorSeconds = mActiveTempoMap->seconds(mMasterTime);
+      mFrame = 0;
+    }
+  }
+  if (seek) {
+    mMasterTime = mSeekTime;
+    mAnchorSeconds = mActiveTempoMap->seconds(mMasterTime);
+    mFrame = 0;
+    mNextEvent = mTimeline.seek(mMasterTime);
+    mSoundingEvents.clear();  // Notes were turned off by setTime()
+  } else if (newEvents) {
+    // Events before the current time have been processed in previous blocks
+    mNextEvent = mTimeline.seek(mMasterTime);
+  }
+}
+
+void SynthSequencer::processEvents(double blockStartTime,
+                                   int64_t blockStartFrame,
+                                   unsigned int frames) {
+  auto &events = mTimeline.active();
+  if (mNextEvent < events.size()) {
+    if (mCallbackLock.try_lock()) {
       int i = 0;
       for (auto cb : mTimeChangeCallbacks) {
         mTimeAccumCallbackNs[i] += (mMasterTime - blockStartTime) * 1.0e9;
-        //        std::cout << mTimeAccumCallbackNs[i] << std::endl;
         if (mTimeAccumCallbackNs[i] * 1.0e-9 > cb.second) {
           cb.first(float(blockStartTime - mPlaybackStartTime));
           mTimeAccumCallbackNs[i] -= cb.second * 1.0e9;
         }
         i++;
       }
-      auto iter = mEvents.begin();
-      std::advance(iter, mNextEvent);
-      auto event = iter;
-      while (event != mEvents.end() &&
-             event->startTime <= mMasterTime - blockStartTime) {
-        event++;
+      mCallbackLock.unlock();
+    }
+    // The block covers the times from blockStartTime up to, but not
+    // including, mMasterTime
+    while (mNextEvent < events.size() &&
+           events[mNextEvent].startTime < mMasterTime) {
+      auto &event = events[mNextEvent];
+      // Offset in frames from the absolute event time, so that it does not
+      // depend on block boundaries
+      int offsetCounter = 0;
+      if (event.startTime > blockStartTime) {
+        int64_t eventFrame = std::llround(
+            (mActiveTempoMap->seconds(event.startTime) - mAnchorSeconds) *
+            mFrameRate);
+        offsetCounter = int(std::min(
+            std::max(eventFrame - blockStartFrame, int64_t(0)),
+            int64_t(frames) - 1));
       }
-      while (event->startTime <= mMasterTime) {
-        event->offsetCounter =
-            (event->startTime - blockStartTime) * fpsAdjusted;
-        if (event->type == SynthSequencerEvent::EVENT_VOICE) {
-          mPolySynth->triggerOn(event->voice, event->offsetCounter);
-          event->voiceId = event->voice->id();
-          event->voice = nullptr;  // Voice has been consumed, all voices
-                                   // reamining in the event list are put back
-                                   // in the synth's free voice pool
-        } else if (event->type == SynthSequencerEvent::EVENT_PFIELDS) {
-          auto *voice = mPolySynth->getVoice(event->fields.name);
-          if (voice) {
-            voice->setTriggerParams(event->fields.pFields);
-            mPolySynth->triggerOn(voice, event->offsetCounter);
-            event->voiceId = voice->id();
-            //            event->voice = voice;
-          } else {
-            std::cerr
-                << "SynthSequencer::processEvents: Could not get free voice '"
-                << event->fields.name << "' for sequencer!" << std::endl;
-          }
-        } else if (event->type == SynthSequencerEvent::EVENT_TEMPO) {
-          // TODO support tempo events
+      int voiceId = -1;
+      if (event.type == SynthSequencerEvent::EVENT_VOICE) {
+        // Voices are taken only once, even if events are republished
+        SynthVoice *voice = event.takeVoice();
+        if (voice) {
+          voiceId = mPolySynth->triggerOn(voice, offsetCounter);
         }
-        //                std::cout << "Event " << mNextEvent << " " <<
-        //                event->startTime << " " <<
-        //                typeid(*event->voice).name() << std::endl;
-        mNextEvent++;
-        iter++;
-        if (iter == mEvents.end()) {
-          break;
+      } else if (event.type == SynthSequencerEvent::EVENT_PFIELDS) {
+        auto *voice = mPolySynth->getVoice(event.fields.name);
+        if (voice) {
+          voice->setTriggerParams(event.fields.pFields);
+          voiceId = mPolySynth->triggerOn(voice, offsetCounter);
+        } else {
+          std::cerr
+              << "SynthSequencer::processEvents: Could not get free voice '"
+              << event.fields.name << "' for sequencer!" << std::endl;
         }
-        event = iter;
-      }
-    }
-    bool allEventsDone = true;
-    bool triggerOffThisBlock = false;
-    for (auto &event : mEvents) {
-      //            if (event.startTime*mNormalizedTempo > mMasterTime) {
-      //                break;
-      //            }
-      double eventTermination = event.startTime + event.duration;
-      if (event.voiceId >= 0 && eventTermination <= mMasterTime) {
-        mPolySynth->triggerOff(event.voiceId);
-        event.voiceId = -1;
-        //        std::cout << "trigger off " <<  event.voice->id() << " " <<
-        //        eventTermination << " " << mMasterTime  << std::endl;
-        //        event.voice = nullptr; // When an event gives up a voice, it
-        //        is done.
-        triggerOffThisBlock = true;
+      } else if (event.type == SynthSequencerEvent::EVENT_TEMPO) {
+        // TODO support tempo events
       }
-      if (eventTermination > mMasterTime) {
-        allEventsDone = false;
+      if (voiceId >= 0) {
+        std::pair<int, double> sounding{voiceId,
+                                        event.startTime + event.duration};
+        if (mSoundingEvents.size() < MAX_SOUNDING_EVENTS) {
+          mSoundingEvents.push_back(sounding);
+        } else {
+          auto first = std::min_element(
+              mSoundingEvents.begin(), mSoundingEvents.end(),
+              [](const std::pair<int, double> &a,
+                 const std::pair<int, double> &b) {
+                return a.second < b.second;
+              });
+          mPolySynth->triggerOff(first->first);
+          *first = sounding;
+          mEvictedNotes.fetch_add(1, std::memory_order_relaxed);
+        }
       }
+      mNextEvent++;
     }
-    if (allEventsDone &&
-        triggerOffThisBlock) {  // This block marks the end of the sequence
-      mPlaying = false;
-      for (auto cb : mSequenceEndCallbacks) {
-        cb(mLastSequencePlayed);
-      }
+  }
+  bool triggerOffThisBlock = false;
+  for (size_t i = 0; i < mSoundingEvents.size();) {
+    if (mSoundingEvents[i].second <= mMasterTime) {
+      mPolySynth->triggerOff(mSoundingEvents[i].first);
+      mSoundingEvents[i] = mSoundingEvents.back();
+      mSoundingEvents.pop_back();
+      triggerOffThisBlock = true;
+    } else {
+      i++;
+    }
+  }
+  if (triggerOffThisBlock && mSoundingEvents.size() == 0 &&
+      mNextEvent >= events.size()) {
+    // This block marks the end of the sequence
+    mPlaying = false;
+    for (auto cb : mSequenceEndCallbacks) {
+      cb(mLastSequencePlayed);
     }
-    mEventLock.unlock();
   }
 }
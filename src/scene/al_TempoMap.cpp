@@ -0,0 +1,182 @@
+#include "al/scene/al_TempoMap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+using namespace al;
+
+// Slopes below this are treated as constant tempo, where the closed forms for
+// ramps lose precision
+static const double minimumSlope = 1.0e-12;
+
+// Tempo used by reset() when given an invalid tempo
+static const double defaultTempo = 60.0;
+
+TempoMap::TempoMap(double bpm) { reset(bpm); }
+
+void TempoMap::reset(double bpm) {
+  if (!(bpm > 0.0)) {
+    std::cerr << "ERROR: TempoMap tempo must be positive. Using "
+              << defaultTempo << " bpm instead of " << bpm << "." << std::endl;
+    bpm = defaultTempo;
+  }
+  mTempoPoints.clear();
+  mTimeSignatures.clear();
+  addTempo(0.0, bpm);
+}
+
+void TempoMap::addTempo(double beat, double bpm, Curve curve) {
+  if (!(bpm > 0.0)) {
+    std::cerr << "ERROR: TempoMap tempo must be positive. Ignoring " << bpm
+              << " bpm." << std::endl;
+    return;
+  }
+  auto position = std::lower_bound(
+      mTempoPoints.begin(), mTempoPoints.end(), beat,
+      [](const TempoPoint &p, double b) { return p.beat < b; });
+  if (position != mTempoPoints.end() && position->beat == beat) {
+    *position = {beat, bpm, curve};
+  } else {
+    mTempoPoints.insert(position, {beat, bpm, curve});
+  }
+  compile();
+}
+
+void TempoMap::addTimeSignature(double beat, int numerator, int denominator) {
+  if (numerator <= 0 || denominator <= 0) {
+    std::cerr << "ERROR: Invalid time signature " << numerator << "/"
+              << denominator << std::endl;
+    return;
+  }
+  auto position = std::lower_bound(
+      mTimeSignatures.begin(), mTimeSignatures.end(), beat,
+      [](const TimeSignature &s, double b) { return s.beat < b; });
+  if (position != mTimeSignatures.end() && position->beat == beat) {
+    *position = {beat, numerator, denominator};
+  } else {
+    mTimeSignatures.insert(position, {beat, numerator, denominator});
+  }
+  compile();
+}
+
+double TempoMap::seconds(double beat) const {
+  const Segment &segment = segmentForBeat(beat);
+  double deltaBeats = beat - segment.startBeat;
+  if (std::abs(segment.slope) < minimumSlope || deltaBeats < 0.0) {
+    return segment.startSeconds + deltaBeats / segment.tempo;
+  }
+  // Integral of 1 / (tempo + slope * b) over the segment
+  return segment.startSeconds +
+         std::log1p(segment.slope * deltaBeats / segment.tempo) /
+             segment.slope;
+}
+
+double TempoMap::beats(double seconds) const {
+  const Segment &segment = segmentForSeconds(seconds);
+  double deltaSeconds = seconds - segment.startSeconds;
+  if (std::abs(segment.slope) < minimumSlope || deltaSeconds < 0.0) {
+    return segment.startBeat + deltaSeconds * segment.tempo;
+  }
+  return segment.startBeat +
+         segment.tempo * std::expm1(segment.slope * deltaSeconds) /
+             segment.slope;
+}
+
+double TempoMap::tempo(double beat) const {
+  const Segment &segment = segmentForBeat(beat);
+  double deltaBeats = std::max(0.0, beat - segment.startBeat);
+  return (segment.tempo + segment.slope * deltaBeats) * 60.0;
+}
+
+TempoMap::BarPosition TempoMap::barPosition(double beat) const {
+  const Meter &meter = meterForBeat(beat);
+  double bars = std::floor((beat - meter.startBeat) / meter.beatsPerBar);
+  BarPosition position;
+  position.bar = meter.startBar + int(bars);
+  position.beat = beat - meter.startBeat - bars * meter.beatsPerBar;
+  return position;
+}
+
+double TempoMap::beat(int bar, double beatInBar) const {
+  // Find the last meter starting at or before bar
+  auto meter = std::upper_bound(
+      mMeters.begin(), mMeters.end(), bar,
+      [](int b, const Meter &m) { return b < m.startBar; });
+  if (meter != mMeters.begin()) {
+    meter--;
+  }
+  return meter->startBeat + (bar - meter->startBar) * meter->beatsPerBar +
+         beatInBar;
+}
+
+void TempoMap::compile() {
+  assert(mTempoPoints.size() > 0);
+  mSegments.clear();
+  mSegments.reserve(mTempoPoints.size());
+  double startSeconds = 0.0;
+  for (size_t i = 0; i < mTempoPoints.size(); i++) {
+    const TempoPoint &point = mTempoPoints[i];
+    Segment segment;
+    segment.startBeat = point.beat;
+    segment.tempo = point.bpm / 60.0;
+    segment.slope = 0.0;
+    if (i == 0) {
+      // Beat 0 is at 0 seconds, even if the first point comes later
+      startSeconds = point.beat / segment.tempo;
+    }
+    segment.startSeconds = startSeconds;
+    if (i + 1 < mTempoPoints.size()) {
+      const TempoPoint &next = mTempoPoints[i + 1];
+      double length = next.beat - point.beat;
+      if (point.curve == LINEAR) {
+        segment.slope = (next.bpm / 60.0 - segment.tempo) / length;
+      }
+      mSegments.push_back(segment);
+      startSeconds = seconds(next.beat);
+    } else {
+      mSegments.push_back(segment);
+    }
+  }
+
+  mMeters.clear();
+  Meter meter{0.0, 0, 4.0};
+  if (mTimeSignatures.size() == 0 || mTimeSignatures[0].beat > 0.0) {
+    mMeters.push_back(meter);  // 4/4 until the first time signature
+  }
+  for (auto &signature : mTimeSignatures) {
+    if (mMeters.size() > 0) {
+      const Meter &previous = mMeters.back();
+      meter.startBar =
+          previous.startBar +
+          int(std::ceil((signature.beat - previous.startBeat) /
+                            previous.beatsPerBar -
+                        1.0e-9));
+    }
+    meter.startBeat = signature.beat;
+    meter.beatsPerBar = signature.numerator * 4.0 / signature.denominator;
+    mMeters.push_back(meter);
+  }
+}
+
+const TempoMap::Segment &TempoMap::segmentForBeat(double beat) const {
+  auto segment = std::upper_bound(
+      mSegments.begin(), mSegments.end(), beat,
+      [](double b, const Segment &s) { return b < s.startBeat; });
+  return segment == mSegments.begin() ? *segment : *(segment - 1);
+}
+
+const TempoMap::Segment &TempoMap::segmentForSeconds(double seconds) const {
+  auto segment = std::upper_bound(
+      mSegments.begin(), mSegments.end(), seconds,
+      [](double s, const Segment &seg) { return s < seg.startSeconds; });
+  return segment == mSegments.begin() ? *segment : *(segment - 1);
+}
+
+const TempoMap::Meter &TempoMap::meterForBeat(double beat) const {
+  auto meter = std::upper_bound(
+      mMeters.begin(), mMeters.end(), beat,
+      [](double b, const Meter &m) { return b < m.startBeat; });
+  return meter == mMeters.begin() ? *meter : *(meter - 1);
+}
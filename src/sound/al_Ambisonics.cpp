@@ -213,18 +213,21 @@ AmbiDecode::~AmbiDecode() {
   // delete[] mSpeakers; // listener now owns speakers and will delete them
 }
 
-void AmbiDecode::decode(float* dec, const float* ambi, int numDecFrames) const {
+void AmbiDecode::decode(float* dec, const float* ambi, int numDecFrames,
+                        int decStride) const {
+  if (decStride < 1) {
+    decStride = numDecFrames;
+  }
   // iterate speakers
   for (int s = 0; s < numSpeakers(); ++s) {
     // skip zero-amp speakers:
     if (mSpeakers[s].gain != 0.) {
-      float* out = dec + mSpeakers[s].deviceChannel * numDecFrames;
+      float* out = dec + mSpeakers[s].deviceChannel * decStride;
 
       // iterate ambi channels
       for (int c = 0; c < channels(); ++c) {
         const float* in = ambi + c * numDecFrames;
-        float w = decodeWeight(s, c);
-        for (int i = 0; i < numDecFrames; ++i) out[i] += in[i] * w;
+        mixBlock(out, in, decodeWeight(s, c), numDecFrames);
       }
     }
   }
@@ -519,7 +522,7 @@ void AmbisonicsSpatializer::finalize(AudioIOData& io) {
   float* outs = &io.out(0, 0);  // io.outBuffer();
   int numFrames = io.framesPerBuffer();
 
-  mDecoder.decode(outs, ambiChans(), numFrames);
+  mDecoder.decode(outs, ambiChans(), numFrames, io.channelStride());
 }
 
 void AmbisonicsSpatializer::print(std::ostream& stream) {
@@ -50,10 +50,7 @@ void Dbap::renderBuffer(AudioIOData &io, const Pose &listeningPose,
     gain = 1.0f / (1.0f + float(dist));
     gain = powf(gain, mFocus);
 
-    float *out = io.outBuffer(mDeviceChannels[k]);
-    for (int i = 0; i < numFrames; ++i) {
-      out[i] += gain * samples[i];
-    }
+    mixBlock(io.outBuffer(mDeviceChannels[k]), samples, gain, numFrames);
   }
 }
 
@@ -62,10 +62,10 @@ void Lbap::renderBuffer(AudioIOData &io, const Pose &listeningPose,
                       it->elevation);  // elevation angle between layers
     float gainTop = sin(M_PI_2 * fraction);
     float gainBottom = cos(M_PI_2 * fraction);
-    for (int i = 0; i < bufferSize; i++) {
-      buffer[i] = samples[i] * gainTop;
-      buffer[i + bufferSize] = samples[i] * gainBottom;
-    }
+    copyBlock(buffer, samples, bufferSize);
+    gainBlock(buffer, gainTop, bufferSize);
+    copyBlock(buffer + bufferSize, samples, bufferSize);
+    gainBlock(buffer + bufferSize, gainBottom, bufferSize);
 
     topRingIt->vbap->renderBuffer(io, listeningPose, buffer, bufferSize);
     it->vbap->renderBuffer(io, listeningPose, buffer + bufferSize, bufferSize);
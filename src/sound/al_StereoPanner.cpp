@@ -35,13 +35,11 @@ void al::StereoPanner::renderBuffer(al::AudioIOData &io,
     float gainL, gainR;
     equalPowerPan(vec, gainL, gainR);
 
-    for (unsigned int i = 0; i < numFrames; i++) {
-      bufL[i] += gainL * samples[i];
-      bufR[i] += gainR * samples[i];
-    }
+    mixBlock(bufL, samples, gainL, numFrames);
+    mixBlock(bufR, samples, gainR, numFrames);
   } else {  // dont pan
     for (unsigned int i = 0; i < numSpeakers; i++) {
-      memcpy(io.outBuffer(i), samples, sizeof(float) * numFrames);
+      copyBlock(io.outBuffer(i), samples, numFrames);
     }
   }
 }
@@ -1,7 +1,12 @@
 #include <stdio.h>
 #include <algorithm>  // for std::swap
+#include <iostream>
+#include "al/system/al_Denormals.hpp"
 #include "al/system/al_Thread.hpp"
 
+// Settings that failed in applyThreadSettings()
+enum { THREAD_AFFINITY = 1, THREAD_POLICY = 2, THREAD_DENORMALS = 4 };
+
 #ifdef AL_WINDOWS
 #define USE_THREADEX
 #else
@@ -10,6 +15,8 @@
 
 #ifdef USE_PTHREAD
 #include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 
 // typedef pthread_t ThreadHandle;
 // typedef void * (*ThreadFunction)(void *);
@@ -83,6 +90,43 @@ void* Thread::current() {
   return (void*)(&r);
 }
 
+bool ThreadConfig::lockProcessMemory() {
+  return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+}
+
+// Returns the THREAD_* bits of the settings that could not be applied
+static unsigned int applyThreadSettings(const ThreadConfig& config) {
+  unsigned int failed = 0;
+  if (config.cpus.size() > 0) {
+#ifdef AL_LINUX
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : config.cpus) {
+      CPU_SET(cpu, &cpuSet);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) !=
+        0) {
+      failed |= THREAD_AFFINITY;
+    }
+#else
+    failed |= THREAD_AFFINITY;
+#endif
+  }
+  if (config.policy != ThreadConfig::POLICY_DEFAULT) {
+    struct sched_param param;
+    param.sched_priority = std::max(1, std::min(config.priority, 99));
+    int schedPolicy =
+        config.policy == ThreadConfig::POLICY_RR ? SCHED_RR : SCHED_FIFO;
+    if (pthread_setschedparam(pthread_self(), schedPolicy, &param) != 0) {
+      failed |= THREAD_POLICY;
+    }
+  }
+  if (config.flushDenormals && !ScopedDenormalFlush::flush(true)) {
+    failed |= THREAD_DENORMALS;
+  }
+  return failed;
+}
+
 }  // namespace al
 #elif defined(USE_THREADEX)
 
@@ -138,10 +182,61 @@ class Thread::Impl {
     return 0;
   }
 };
+
+bool ThreadConfig::lockProcessMemory() { return false; }
+
+static unsigned int applyThreadSettings(const ThreadConfig& config) {
+  unsigned int failed = 0;
+  if (config.cpus.size() > 0) {
+    DWORD_PTR mask = 0;
+    for (int cpu : config.cpus) {
+      mask |= DWORD_PTR(1) << cpu;
+    }
+    if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+      failed |= THREAD_AFFINITY;
+    }
+  }
+  if (config.policy != ThreadConfig::POLICY_DEFAULT) {
+    if (!SetThreadPriority(GetCurrentThread(),
+                           THREAD_PRIORITY_TIME_CRITICAL)) {
+      failed |= THREAD_POLICY;
+    }
+  }
+  if (config.flushDenormals && !ScopedDenormalFlush::flush(true)) {
+    failed |= THREAD_DENORMALS;
+  }
+  return failed;
+}
 }  // namespace al
 #endif
 
 namespace al {
+bool ThreadConfig::applyToCurrentThread() const {
+  bool ok = true;
+  if (lockMemory && !lockProcessMemory()) {
+    std::cerr << "WARNING: ThreadConfig could not lock memory" << std::endl;
+    ok = false;
+  }
+  unsigned int failed = applyThreadSettings(*this);
+  if (failed & THREAD_AFFINITY) {
+    std::cerr << "WARNING: ThreadConfig could not set CPU affinity"
+              << std::endl;
+  }
+  if (failed & THREAD_POLICY) {
+    std::cerr << "WARNING: ThreadConfig could not set real-time priority "
+              << priority << std::endl;
+  }
+  if (failed & THREAD_DENORMALS) {
+    std::cerr << "WARNING: ThreadConfig denormal flushing not supported"
+              << std::endl;
+  }
+  return ok && failed == 0;
+}
+
+bool ThreadConfig::applyThreadSettingsToCurrentThread() const {
+  return applyThreadSettings(*this) == 0;
+}
+
 Thread::Thread() : mImpl(new Impl), mJoinOnDestroy(false) {}
 
 Thread::Thread(ThreadFunction& func) : mImpl(new Impl), mJoinOnDestroy(false) {
@@ -1,6 +1,7 @@
-#include "al/core/system/al_Watcher.hpp"
+#include "al/system/al_Watcher.hpp"
 
 #include <map>
+#include <mutex>
 #include <set>
 
 using namespace al;
@@ -8,30 +9,59 @@ using namespace al;
 typedef std::set<Watcher*> Watchers;
 typedef std::map<std::string, Watchers> WatchersMap;
 
-/// singleton notification center:
-static WatchersMap gWatchers;
+/// singleton notification center. Never destroyed, so watchers with static
+/// storage can unregister safely at exit
+static WatchersMap& watchers() {
+  static WatchersMap* gWatchers = new WatchersMap;
+  return *gWatchers;
+}
+
+/// recursive, as watchers may watch or unwatch from onEvent()
+static std::recursive_mutex& watchersLock() {
+  static std::recursive_mutex* gLock = new std::recursive_mutex;
+  return *gLock;
+}
 
 void Watcher::watch(std::string name) {
-  Watchers& w = gWatchers[name];
+  std::lock_guard<std::recursive_mutex> lk(watchersLock());
+  Watchers& w = watchers()[name];
   w.insert(this);
 }
 
 void Watcher::unwatch(std::string name) {
-  Watchers& w = gWatchers[name];
-  w.erase(this);
+  std::lock_guard<std::recursive_mutex> lk(watchersLock());
+  auto it = watchers().find(name);
+  if (it != watchers().end()) {
+    it->second.erase(this);
+    if (it->second.empty()) {
+      watchers().erase(it);
+    }
+  }
 }
 
 void Watcher::unwatch() {
-  for (WatchersMap::iterator it = gWatchers.begin(); it != gWatchers.end();
-       it++) {
-    unwatch(it->first);
+  std::lock_guard<std::recursive_mutex> lk(watchersLock());
+  WatchersMap& w = watchers();
+  for (WatchersMap::iterator it = w.begin(); it != w.end();) {
+    it->second.erase(this);
+    if (it->second.empty()) {
+      it = w.erase(it);
+    } else {
+      it++;
+    }
   }
 }
 
 void Watcher::notify(std::string name, std::string event) {
-  Watchers& w = gWatchers[name];
-  for (Watchers::iterator it = w.begin(); it != w.end(); it++) {
-    Watcher* rw = *it;
+  std::lock_guard<std::recursive_mutex> lk(watchersLock());
+  auto it = watchers().find(name);
+  if (it == watchers().end()) {
+    return;
+  }
+  // Copy, as handlers may change the set
+  Watchers w = it->second;
+  for (Watchers::iterator wit = w.begin(); wit != w.end(); wit++) {
+    Watcher* rw = *wit;
     rw->onEvent(name, event);
   }
 }
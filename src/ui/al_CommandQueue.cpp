@@ -0,0 +1,78 @@
+#include "al/ui/al_CommandQueue.hpp"
+
+using namespace al;
+
+CommandQueue::~CommandQueue() {
+  if (mThread) {
+    {
+      std::lock_guard<std::mutex> lk(mLock);
+      mRunning = false;
+      mCommands.clear();
+    }
+    mCondition.notify_one();
+    mThread->join();
+  }
+}
+
+void CommandQueue::push(std::function<void()> command,
+                        const std::string &key) {
+  {
+    std::lock_guard<std::mutex> lk(mLock);
+    if (key.size() > 0 && mCommands.size() > 0 &&
+        mCommands.back().key == key) {
+      mCommands.back().function = std::move(command);
+      mCoalesced++;
+    } else {
+      mCommands.push_back({std::move(command), key});
+      if (mCommands.size() > mMaxDepth) {
+        mMaxDepth = mCommands.size();
+      }
+    }
+    if (!mThread) {
+      mRunning = true;
+      mThread = std::make_unique<std::thread>(&CommandQueue::run, this);
+    }
+  }
+  mCondition.notify_one();
+}
+
+void CommandQueue::waitForCommands() {
+  std::unique_lock<std::mutex> lk(mLock);
+  mIdleCondition.wait(lk, [this]() { return mCommands.empty() && !mBusy; });
+}
+
+size_t CommandQueue::depth() {
+  std::lock_guard<std::mutex> lk(mLock);
+  return mCommands.size();
+}
+
+void CommandQueue::resetCounters() {
+  // Under the lock so a push() in between can't raise the depth above the
+  // new maximum
+  std::lock_guard<std::mutex> lk(mLock);
+  mMaxDepth = mCommands.size();
+  mProcessed = 0;
+  mCoalesced = 0;
+}
+
+void CommandQueue::run() {
+  std::unique_lock<std::mutex> lk(mLock);
+  while (true) {
+    mCondition.wait(lk, [this]() { return !mRunning || !mCommands.empty(); });
+    if (!mRunning) {
+      break;
+    }
+    std::function<void()> command = std::move(mCommands.front().function);
+    mCommands.pop_front();
+    mBusy = true;
+    lk.unlock();
+    command();
+    lk.lock();
+    mBusy = false;
+    mProcessed++;
+    if (mCommands.empty()) {
+      mIdleCondition.notify_all();
+    }
+  }
+  mIdleCondition.notify_all();
+}
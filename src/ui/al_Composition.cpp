@@ -348,10 +348,13 @@ void Composition::playbackThread(Composition *composition) {
   composition->mPlayerLock.lock();
   composition->mSequencerEndCallbackCache =
       composition->mSequencer->mEndCallback;
+  composition->startPreloading();
   auto sequenceStart = std::chrono::high_resolution_clock::now();
   auto targetTime = sequenceStart;
   while (composition->mPlaying) {
     CompositionStep &step = composition->mCompositionSteps[index];
+    // Loaded while previous steps played, or now while this step waits
+    auto sequence = composition->takePreloaded(index);
     // auto duration =
     // //std::chrono::time_point_cast<std::chrono::nanoseconds>(step.deltaTime/1e9);
     targetTime += std::chrono::microseconds(
@@ -368,7 +371,7 @@ void Composition::playbackThread(Composition *composition) {
     std::this_thread::sleep_until(targetTime);
     std::cout << "Composition step:" << step.sequenceName << ":"
               << step.deltaTime << std::endl;
-    composition->mSequencer->playSequence(step.sequenceName);
+    composition->mSequencer->playSequence(std::move(sequence));
 
     index++;
     if (index == composition->mCompositionSteps.size()) {
@@ -380,6 +383,7 @@ void Composition::playbackThread(Composition *composition) {
     //		}
   }
 
+  composition->stopPreloading();
   composition->mPlayerLock.unlock();
   std::cout << "Composition done." << std::endl;
   // Defer end callback to sequencer end callback
@@ -388,14 +392,13 @@ void Composition::playbackThread(Composition *composition) {
                           // here if playback stops between the check and the
                           // branches
     composition->mSequencer->registerEndCallback(
-        [&](bool finished, PresetSequencer *) {
-          composition->mSequencer->mEndCallback =
-              composition->mSequencerEndCallbackCache;
-
-          if (composition->mEndCallbackEnabled &&
-              composition->mEndCallback != nullptr) {
-            composition->mEndCallback(finished, composition,
-                                      composition->mEndCallbackData);
+        [composition](bool finished, PresetSequencer *) {
+          // Restoring the sequencer's callback destroys this lambda
+          Composition *c = composition;
+          c->mSequencer->mEndCallback = c->mSequencerEndCallbackCache;
+
+          if (c->mEndCallbackEnabled && c->mEndCallback != nullptr) {
+            c->mEndCallback(finished, c, c->mEndCallbackData);
           }
         });
   } else {
@@ -409,3 +412,78 @@ void Composition::playbackThread(Composition *composition) {
   composition->mSequencer->enableBeginCallback(true);
   composition->mSequencer->enableEndCallback(true);
 }
+
+void Composition::startPreloading() {
+  std::lock_guard<std::mutex> lk(mPreloadLock);
+  mPreloadNames.clear();
+  for (auto &step : mCompositionSteps) {
+    mPreloadNames.push_back(step.sequenceName);
+  }
+  mPreloaded.clear();
+  mPreloadNext = 0;
+  mPreloadCurrent = -1;
+  mPlayIndex = 0;
+  mPreloading = true;
+  mPreloadThread =
+      std::make_unique<std::thread>(Composition::preloadThread, this);
+}
+
+void Composition::stopPreloading() {
+  {
+    std::lock_guard<std::mutex> lk(mPreloadLock);
+    mPreloading = false;
+  }
+  mPreloadCondition.notify_all();
+  if (mPreloadThread) {
+    mPreloadThread->join();
+    mPreloadThread = nullptr;
+  }
+  mPreloaded.clear();
+}
+
+PresetSequencer::PreparedSequence Composition::takePreloaded(size_t index) {
+  std::unique_lock<std::mutex> lk(mPreloadLock);
+  // If the step is being loaded, waiting is quicker than loading it again
+  mPreloadCondition.wait(
+      lk, [this, index]() { return mPreloadCurrent != int64_t(index); });
+  mPlayIndex = index + 1;
+  if (mPreloadNext < mPlayIndex) {
+    mPreloadNext = mPlayIndex;
+  }
+  auto preloaded = mPreloaded.find(index);
+  if (preloaded != mPreloaded.end()) {
+    PresetSequencer::PreparedSequence sequence = std::move(preloaded->second);
+    mPreloaded.erase(mPreloaded.begin(), ++preloaded);
+    lk.unlock();
+    mPreloadCondition.notify_all();
+    return sequence;
+  }
+  mPreloaded.erase(mPreloaded.begin(), mPreloaded.upper_bound(index));
+  lk.unlock();
+  mPreloadCondition.notify_all();
+  return mSequencer->prepareSequence(mPreloadNames[index]);
+}
+
+void Composition::preloadThread(Composition *composition) {
+  std::unique_lock<std::mutex> lk(composition->mPreloadLock);
+  while (true) {
+    composition->mPreloadCondition.wait(lk, [composition]() {
+      return !composition->mPreloading ||
+             (composition->mPreloadNext < composition->mPreloadNames.size() &&
+              composition->mPreloadNext <
+                  composition->mPlayIndex + composition->mPreloadCount);
+    });
+    if (!composition->mPreloading) {
+      return;
+    }
+    size_t index = composition->mPreloadNext++;
+    std::string sequenceName = composition->mPreloadNames[index];
+    composition->mPreloadCurrent = int64_t(index);
+    lk.unlock();
+    auto sequence = composition->mSequencer->prepareSequence(sequenceName);
+    lk.lock();
+    composition->mPreloadCurrent = -1;
+    composition->mPreloaded.emplace(index, std::move(sequence));
+    composition->mPreloadCondition.notify_all();
+  }
+}
@@ -47,7 +47,25 @@
 #include "al/io/al_File.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+
+#ifndef AL_WINDOWS
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+#include "nlohmann/json.hpp"
 
 std::string htmlTemplateStart = R"(
 <html>
@@ -68,9 +86,1012 @@ iface.background = 'blue';
 
 using namespace al;
 
+// Built-in web server ---------------------------------------------------------
+
+static const char *webPage = R"(<!DOCTYPE html>
+<html>
+<head>
+<meta charset="utf-8">
+<title>Parameters</title>
+<style>
+body { font-family: sans-serif; background: #202428; color: #ddd; }
+.parameter { margin: 6px 0; }
+label { display: inline-block; width: 14em; }
+input[type=range] { width: 20em; }
+input[type=number] { width: 6em; }
+</style>
+</head>
+<body>
+<div id="status">Connecting...</div>
+<div id="parameters"></div>
+<script>
+var parameters = [];
+var socket = new WebSocket('ws://' + location.host + '/ws');
+socket.binaryType = 'arraybuffer';
+socket.onopen = function() {
+  document.getElementById('status').textContent = '';
+};
+socket.onclose = function() {
+  document.getElementById('status').textContent = 'Disconnected';
+};
+socket.onmessage = function(event) {
+  if (event.data instanceof ArrayBuffer) {
+    // Entries of uint16 id, uint8 count and count float32, little endian
+    var view = new DataView(event.data);
+    var offset = 0;
+    while (offset + 3 <= view.byteLength) {
+      var id = view.getUint16(offset, true);
+      var count = view.getUint8(offset + 2);
+      var values = [];
+      offset += 3;
+      for (var i = 0; i < count; i++, offset += 4) {
+        values.push(view.getFloat32(offset, true));
+      }
+      update(id, values);
+    }
+    return;
+  }
+  var message = JSON.parse(event.data);
+  if (message.type == 'parameters') {
+    build(message.parameters);
+  } else if (message.type == 'values') {
+    message.values.forEach(function(v) { update(v[0], v.slice(1)); });
+  }
+};
+function send(p) {
+  var message = [p.address];
+  p.inputs.forEach(function(input) {
+    if (input.type == 'checkbox') {
+      message.push(input.checked ? 1 : 0);
+    } else if (input.type == 'text') {
+      message.push(input.value);
+    } else {
+      message.push(Number(input.value));
+    }
+  });
+  if (socket.readyState == 1) {
+    socket.send(JSON.stringify(message));
+  }
+}
+function build(list) {
+  var container = document.getElementById('parameters');
+  container.innerHTML = '';
+  parameters = [];
+  list.forEach(function(p) {
+    var row = document.createElement('div');
+    var label = document.createElement('label');
+    row.className = 'parameter';
+    label.textContent = p.name;
+    row.appendChild(label);
+    p.inputs = [];
+    for (var i = 0; i < p.components; i++) {
+      var input;
+      if (p.kind == 'menu') {
+        input = document.createElement('select');
+        p.elements.forEach(function(element, index) {
+          var option = document.createElement('option');
+          option.value = index;
+          option.textContent = element;
+          input.appendChild(option);
+        });
+      } else {
+        input = document.createElement('input');
+        if (p.kind == 'bool') {
+          input.type = 'checkbox';
+        } else if (p.kind == 'string') {
+          input.type = 'text';
+        } else if ('min' in p) {
+          input.type = 'range';
+          input.min = p.min;
+          input.max = p.max;
+          input.step = p.kind == 'int' ? 1 : (p.max - p.min) / 1000;
+        } else {
+          input.type = 'number';
+          input.step = 'any';
+        }
+      }
+      input.oninput = function() { send(p); };
+      p.inputs.push(input);
+      row.appendChild(input);
+    }
+    container.appendChild(row);
+    parameters[p.id] = p;
+  });
+}
+function update(id, values) {
+  var p = parameters[id];
+  if (!p) {
+    return;
+  }
+  p.inputs.forEach(function(input, i) {
+    // Don't move the control the user is holding
+    if (i >= values.length || input === document.activeElement) {
+      return;
+    }
+    if (input.type == 'checkbox') {
+      input.checked = values[i] != 0;
+    } else {
+      input.value = values[i];
+    }
+  });
+}
+</script>
+</body>
+</html>
+)";
+
+static const char *webSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+static std::string sha1(const std::string &text) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                   0xC3D2E1F0};
+  std::string data = text;
+  uint64_t bitLength = uint64_t(text.size()) * 8;
+  data.push_back(char(0x80));
+  while (data.size() % 64 != 56) {
+    data.push_back(0);
+  }
+  for (int i = 7; i >= 0; i--) {
+    data.push_back(char(bitLength >> (8 * i)));
+  }
+  auto rotate = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+  for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const uint8_t *b =
+          reinterpret_cast<const uint8_t *>(&data[chunk + 4 * i]);
+      w[i] = uint32_t(b[0]) << 24 | uint32_t(b[1]) << 16 |
+             uint32_t(b[2]) << 8 | b[3];
+    }
+    for (int i = 16; i < 80; i++) {
+      w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = rotate(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotate(b, 30);
+      b = a;
+      a = temp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  std::string digest;
+  for (uint32_t word : h) {
+    for (int i = 3; i >= 0; i--) {
+      digest.push_back(char(word >> (8 * i)));
+    }
+  }
+  return digest;
+}
+
+static std::string base64(const std::string &data) {
+  static const char *table =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < data.size(); i += 3) {
+    uint32_t bytes = uint32_t(uint8_t(data[i])) << 16;
+    if (i + 1 < data.size()) {
+      bytes |= uint32_t(uint8_t(data[i + 1])) << 8;
+    }
+    if (i + 2 < data.size()) {
+      bytes |= uint8_t(data[i + 2]);
+    }
+    out.push_back(table[(bytes >> 18) & 0x3F]);
+    out.push_back(table[(bytes >> 12) & 0x3F]);
+    out.push_back(i + 1 < data.size() ? table[(bytes >> 6) & 0x3F] : '=');
+    out.push_back(i + 2 < data.size() ? table[bytes & 0x3F] : '=');
+  }
+  return out;
+}
+
+// true if a WebSocket Origin header names the host the page was served from.
+// Pages from other sites can open WebSockets to any local server, so their
+// upgrades are refused. Clients that are not browsers send no Origin
+static bool originMatchesHost(const std::string &origin,
+                              const std::string &host) {
+  if (origin.empty()) {
+    return true;
+  }
+  size_t scheme = origin.find("://");
+  if (scheme == std::string::npos || host.empty()) {
+    return false;
+  }
+  std::string originHost = origin.substr(scheme + 3);
+  std::string servedHost = host;
+  for (std::string *name : {&originHost, &servedHost}) {
+    std::transform(name->begin(), name->end(), name->begin(), ::tolower);
+  }
+  return originHost == servedHost;
+}
+
+// true if name is a dotted IPv4 address
+static bool isIPv4Address(const std::string &name) {
+  std::istringstream parts(name);
+  std::string part;
+  int count = 0;
+  while (std::getline(parts, part, '.')) {
+    if (part.empty() || part.size() > 3 ||
+        part.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoi(part) > 255) {
+      return false;
+    }
+    count++;
+  }
+  return count == 4 && name.back() != '.';
+}
+
+// true if a Host header names this machine in a way another site can't
+// take over: an IP address, localhost or one of allowedHosts. A site can
+// point its own domain name at this machine (DNS rebinding), so that its
+// pages count as served from here and pass the Origin check
+static bool hostAllowed(const std::string &host,
+                        const std::vector<std::string> &allowedHosts) {
+  std::string name = host;
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  if (name.size() > 0 && name[0] == '[') {
+    // IPv6 address, with an optional port after the bracket
+    size_t close = name.find(']');
+    return close != std::string::npos && close > 1 &&
+           name.find_first_not_of("0123456789abcdef:.", 1) == close &&
+           (close + 1 == name.size() || name[close + 1] == ':');
+  }
+  name = name.substr(0, name.find(':'));
+  if (name.empty()) {
+    return false;
+  }
+  return name == "localhost" || isIPv4Address(name) ||
+         std::find(allowedHosts.begin(), allowedHosts.end(), name) !=
+             allowedHosts.end();
+}
+
+template <class ParameterType>
+static void watchChanges(ParameterMeta *param, std::atomic<bool> *changed) {
+  static_cast<ParameterWrapper<ParameterType> *>(param)->registerChangeCallback(
+      [changed](ParameterType) {
+        changed->store(true, std::memory_order_release);
+      });
+}
+
+class HtmlInterfaceServer::WebServer {
+ public:
+  // Kinds of parameters, which determine the control in the page and the
+  // OSC type tags of the values sent back
+  enum Kind { FLOAT, BOOL, INT, MENU, CHOICE, STRING, VECTOR };
+
+  struct Entry {
+    size_t id;  // Index in mEntries, used by the page
+    ParameterMeta *parameter;
+    ParameterServer *server;  // Dispatches values from the page, or nullptr
+    Kind kind;
+    size_t components;
+    std::atomic<bool> changed{true};
+    bool recheck{false};
+    nlohmann::json values;  // Last values pushed
+    std::string valuesText;
+  };
+
+  struct Client {
+    int socket;
+    bool webSocket{false};  // Handshake done
+    bool resync{true};      // Needs every value
+    bool closing{false};    // Close once out is sent
+    std::string in;         // Received bytes not parsed yet
+    std::string out;        // Bytes waiting to be sent
+    std::string message;    // Fragments of the current WebSocket message
+    uint8_t messageOpcode{0};
+  };
+
+  // A slow browser stops receiving deltas above this, and gets every value
+  // once it catches up
+  static const size_t MAX_PENDING = 1 << 20;
+  static const size_t MAX_MESSAGE = 1 << 20;
+  static const size_t MAX_CLIENTS = 64;
+
+  ~WebServer() { stop(); }
+
+  bool addParameter(ParameterMeta *param, ParameterServer *server);
+  bool start(uint16_t port, const std::string &address);
+  void stop();
+
+  uint16_t port() { return mPort; }
+  size_t clientCount() { return mClientCount.load(); }
+  void setPushRate(float rate) { mPushRate = std::max(1.0f, rate); }
+  void setPushFormat(PushFormat format) { mFormat = format; }
+  void addAllowedHost(const std::string &host) {
+    std::string name = host;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    std::unique_lock<std::mutex> lk(mAllowedHostsLock);
+    mAllowedHosts.push_back(name);
+  }
+
+ private:
+  void run();
+  void acceptClients();
+  bool receive(Client &client);
+  bool sendPending(Client &client);
+  bool onHttpRequest(Client &client, const std::string &request);
+  bool onWebSocketData(Client &client);
+  void onWebSocketMessage(uint8_t opcode, const std::string &message);
+  void dispatch(Entry *entry, const nlohmann::json &values);
+  void push();
+  void sendFrame(Client &client, uint8_t opcode, const std::string &payload);
+  std::string parametersMessage();
+  bool readValues(Entry &entry, nlohmann::json &values);
+
+  std::vector<std::unique_ptr<Entry>> mEntries;
+  std::unordered_map<std::string, Entry *> mEntriesByAddress;
+  std::mutex mEntriesLock;
+
+  std::vector<Client> mClients;  // Only used by the server thread
+  std::atomic<size_t> mClientCount{0};
+  int mListenSocket{-1};
+  int mWakePipe[2]{-1, -1};
+  uint16_t mPort{0};
+  std::unique_ptr<std::thread> mThread;
+  std::atomic<bool> mRunning{false};
+  std::atomic<float> mPushRate{30.0f};
+  std::atomic<PushFormat> mFormat{PUSH_JSON};
+  std::vector<std::string> mAllowedHosts;
+  std::mutex mAllowedHostsLock;
+};
+
+bool HtmlInterfaceServer::WebServer::addParameter(ParameterMeta *param,
+                                                  ParameterServer *server) {
+  std::unique_lock<std::mutex> lk(mEntriesLock);
+  if (mEntriesByAddress.find(param->getFullAddress()) !=
+      mEntriesByAddress.end()) {
+    return true;
+  }
+  std::unique_ptr<Entry> entry(new Entry);
+  entry->id = mEntries.size();
+  entry->parameter = param;
+  entry->server = server;
+  std::atomic<bool> *changed = &entry->changed;
+  if (strcmp(typeid(*param).name(), typeid(ParameterBool).name()) == 0) {
+    entry->kind = BOOL;
+    watchChanges<float>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(Parameter).name()) == 0) {
+    entry->kind = FLOAT;
+    watchChanges<float>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterInt).name()) ==
+             0) {
+    entry->kind = INT;
+    watchChanges<int32_t>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterMenu).name()) ==
+             0) {
+    entry->kind = MENU;
+    watchChanges<int>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterChoice).name()) ==
+             0) {
+    entry->kind = CHOICE;
+    watchChanges<uint16_t>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterString).name()) ==
+             0) {
+    entry->kind = STRING;
+    watchChanges<std::string>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterVec3).name()) ==
+             0) {
+    entry->kind = VECTOR;
+    watchChanges<Vec3f>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterVec4).name()) ==
+             0) {
+    entry->kind = VECTOR;
+    watchChanges<Vec4f>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterColor).name()) ==
+             0) {
+    entry->kind = VECTOR;
+    watchChanges<Color>(param, changed);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterPose).name()) ==
+             0) {
+    entry->kind = VECTOR;
+    watchChanges<Pose>(param, changed);
+  } else {
+    std::cout << "HtmlInterfaceServer: Unsupported parameter type for "
+              << param->getFullAddress() << std::endl;
+    return false;
+  }
+  nlohmann::json values;
+  readValues(*entry, values);
+  entry->components = values.size();
+  mEntriesByAddress[param->getFullAddress()] = entry.get();
+  mEntries.push_back(std::move(entry));
+  return true;
+}
+
+bool HtmlInterfaceServer::WebServer::start(uint16_t port,
+                                           const std::string &address) {
+#ifndef AL_WINDOWS
+  stop();
+  sockaddr_in socketAddress;
+  memset(&socketAddress, 0, sizeof(socketAddress));
+  socketAddress.sin_family = AF_INET;
+  socketAddress.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1) {
+    std::cerr << "ERROR: HtmlInterfaceServer invalid address " << address
+              << std::endl;
+    return false;
+  }
+  mListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  socklen_t length = sizeof(socketAddress);
+  if (mListenSocket < 0 ||
+      bind(mListenSocket, reinterpret_cast<sockaddr *>(&socketAddress),
+           sizeof(socketAddress)) != 0 ||
+      listen(mListenSocket, 16) != 0 ||
+      getsockname(mListenSocket, reinterpret_cast<sockaddr *>(&socketAddress),
+                  &length) != 0 ||
+      pipe(mWakePipe) != 0) {
+    std::cerr << "ERROR: HtmlInterfaceServer could not listen on " << address
+              << ":" << port << std::endl;
+    stop();
+    return false;
+  }
+  fcntl(mListenSocket, F_SETFL, O_NONBLOCK);
+  fcntl(mWakePipe[0], F_SETFL, O_NONBLOCK);
+  mPort = ntohs(socketAddress.sin_port);
+  mRunning = true;
+  mThread = std::make_unique<std::thread>(&WebServer::run, this);
+  return true;
+#else
+  (void)port;
+  (void)address;
+  std::cout << "HtmlInterfaceServer web server not implemented for Windows."
+            << std::endl;
+  return false;
+#endif
+}
+
+void HtmlInterfaceServer::WebServer::stop() {
+#ifndef AL_WINDOWS
+  if (mThread) {
+    mRunning = false;
+    char wake = 0;
+    if (write(mWakePipe[1], &wake, 1) != 1) {
+      std::cerr << "ERROR: HtmlInterfaceServer could not wake server thread"
+                << std::endl;
+    }
+    mThread->join();
+    mThread = nullptr;
+  }
+  for (Client &client : mClients) {
+    close(client.socket);
+  }
+  mClients.clear();
+  mClientCount = 0;
+  for (int *fd : {&mListenSocket, &mWakePipe[0], &mWakePipe[1]}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+  mPort = 0;
+#endif
+}
+
+#ifndef AL_WINDOWS
+
+void HtmlInterfaceServer::WebServer::run() {
+  std::vector<pollfd> fds;
+  auto nextPush = std::chrono::steady_clock::now();
+  while (mRunning) {
+    fds.clear();
+    fds.push_back({mWakePipe[0], POLLIN, 0});
+    fds.push_back({mListenSocket, POLLIN, 0});
+    for (Client &client : mClients) {
+      short events = POLLIN;
+      if (client.out.size() > 0) {
+        events |= POLLOUT;
+      }
+      fds.push_back({client.socket, events, 0});
+    }
+    auto now = std::chrono::steady_clock::now();
+    int timeout = int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                          nextPush - now)
+                          .count());
+    if (poll(fds.data(), fds.size(), std::max(timeout, 0)) < 0 &&
+        errno != EINTR) {
+      std::cerr << "ERROR: HtmlInterfaceServer poll failed" << std::endl;
+      break;
+    }
+    if (fds[0].revents & POLLIN) {
+      char buffer[16];
+      while (read(mWakePipe[0], buffer, sizeof(buffer)) > 0) {
+      }
+    }
+    // Clients accepted now are not in fds yet
+    size_t polledClients = mClients.size();
+    if (fds[1].revents & POLLIN) {
+      acceptClients();
+    }
+    for (size_t i = 0; i < polledClients; i++) {
+      Client &client = mClients[i];
+      short revents = fds[i + 2].revents;
+      bool open = true;
+      if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        open = receive(client);
+      }
+      if (open && (revents & POLLOUT)) {
+        open = sendPending(client);
+      }
+      if (!open) {
+        client.closing = true;
+        client.out.clear();
+      }
+    }
+
+    now = std::chrono::steady_clock::now();
+    if (now >= nextPush) {
+      push();
+      auto interval =
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double>(1.0 / mPushRate.load()));
+      nextPush = std::max(nextPush + interval, now);
+    }
+
+    for (size_t i = 0; i < mClients.size();) {
+      Client &client = mClients[i];
+      if (client.closing && (client.out.empty() || !sendPending(client) ||
+                             client.out.empty())) {
+        close(client.socket);
+        mClients.erase(mClients.begin() + i);
+      } else {
+        i++;
+      }
+    }
+    mClientCount = mClients.size();
+  }
+}
+
+void HtmlInterfaceServer::WebServer::acceptClients() {
+  while (true) {
+    int clientSocket = accept(mListenSocket, nullptr, nullptr);
+    if (clientSocket < 0) {
+      return;
+    }
+    if (mClients.size() >= MAX_CLIENTS) {
+      close(clientSocket);
+      continue;
+    }
+    fcntl(clientSocket, F_SETFL, O_NONBLOCK);
+    int noDelay = 1;
+    setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay,
+               sizeof(noDelay));
+    mClients.emplace_back();
+    mClients.back().socket = clientSocket;
+  }
+}
+
+bool HtmlInterfaceServer::WebServer::receive(Client &client) {
+  char buffer[16384];
+  ssize_t bytes;
+  while ((bytes = recv(client.socket, buffer, sizeof(buffer), 0)) > 0) {
+    client.in.append(buffer, size_t(bytes));
+    if (client.in.size() > MAX_MESSAGE + 16) {
+      return false;
+    }
+  }
+  if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+    return false;
+  }
+  if (client.closing) {
+    client.in.clear();
+    return true;
+  }
+  if (client.webSocket) {
+    return onWebSocketData(client);
+  }
+  size_t end = client.in.find("\r\n\r\n");
+  if (end == std::string::npos) {
+    return client.in.size() < 16384;
+  }
+  std::string request = client.in.substr(0, end);
+  client.in.erase(0, end + 4);
+  if (!onHttpRequest(client, request)) {
+    return false;
+  }
+  return !client.webSocket || onWebSocketData(client);
+}
+
+bool HtmlInterfaceServer::WebServer::sendPending(Client &client) {
+  while (client.out.size() > 0) {
+    ssize_t bytes =
+        send(client.socket, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+    if (bytes < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    client.out.erase(0, size_t(bytes));
+  }
+  return true;
+}
+
+bool HtmlInterfaceServer::WebServer::onHttpRequest(Client &client,
+                                                   const std::string &request) {
+  std::istringstream lines(request);
+  std::string method, path, line, key, host, origin;
+  bool upgrade = false;
+  lines >> method >> path;
+  std::getline(lines, line);
+  while (std::getline(lines, line)) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    std::string name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    size_t start = line.find_first_not_of(' ', colon + 1);
+    size_t end = line.find_last_not_of("\r ");
+    std::string value = start <= end ? line.substr(start, end - start + 1) : "";
+    if (name == "upgrade") {
+      std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+      upgrade = value == "websocket";
+    } else if (name == "sec-websocket-key") {
+      key = value;
+    } else if (name == "host") {
+      host = value;
+    } else if (name == "origin") {
+      origin = value;
+    }
+  }
+
+  bool allowed;
+  {
+    std::unique_lock<std::mutex> lk(mAllowedHostsLock);
+    allowed = hostAllowed(host, mAllowedHosts);
+  }
+  if (method != "GET") {
+    client.out += "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n"
+                  "Connection: close\r\n\r\n";
+    client.closing = true;
+  } else if (!allowed) {
+    client.out += "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n"
+                  "Connection: close\r\n\r\n";
+    client.closing = true;
+  } else if (path == "/ws" && upgrade && key.size() > 0 &&
+             !originMatchesHost(origin, host)) {
+    client.out += "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n"
+                  "Connection: close\r\n\r\n";
+    client.closing = true;
+  } else if (path == "/ws" && upgrade && key.size() > 0) {
+    client.out += "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                  "Connection: Upgrade\r\nSec-WebSocket-Accept: " +
+                  base64(sha1(key + webSocketGuid)) + "\r\n\r\n";
+    client.webSocket = true;
+    client.resync = true;
+    sendFrame(client, 0x1, parametersMessage());
+  } else if (path == "/" || path == "/index.html") {
+    client.out += "HTTP/1.1 200 OK\r\nContent-Type: text/html; "
+                  "charset=utf-8\r\nContent-Length: " +
+                  std::to_string(strlen(webPage)) +
+                  "\r\nConnection: close\r\n\r\n" + webPage;
+    client.closing = true;
+  } else {
+    client.out += "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+                  "Connection: close\r\n\r\n";
+    client.closing = true;
+  }
+  return true;
+}
+
+bool HtmlInterfaceServer::WebServer::onWebSocketData(Client &client) {
+  while (client.in.size() >= 2) {
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(client.in.data());
+    bool final = data[0] & 0x80;
+    uint8_t opcode = data[0] & 0x0F;
+    if (!(data[1] & 0x80)) {
+      return false;  // Frames from browsers must be masked
+    }
+    uint64_t length = data[1] & 0x7F;
+    size_t header = 2;
+    if (length == 126) {
+      header = 4;
+      if (client.in.size() < header) {
+        return true;
+      }
+      length = uint64_t(data[2]) << 8 | data[3];
+    } else if (length == 127) {
+      header = 10;
+      if (client.in.size() < header) {
+        return true;
+      }
+      length = 0;
+      for (int i = 0; i < 8; i++) {
+        length = length << 8 | data[2 + i];
+      }
+    }
+    if (length > MAX_MESSAGE ||
+        client.message.size() + length > MAX_MESSAGE) {
+      return false;
+    }
+    if (client.in.size() < header + 4 + length) {
+      return true;
+    }
+    const uint8_t *mask = data + header;
+    std::string payload(client.in, header + 4, size_t(length));
+    for (size_t i = 0; i < payload.size(); i++) {
+      payload[i] ^= char(mask[i % 4]);
+    }
+    client.in.erase(0, header + 4 + size_t(length));
+
+    if (opcode == 0x8) {  // Close
+      sendFrame(client, 0x8, payload.substr(0, 2));
+      client.closing = true;
+      return true;
+    } else if (opcode == 0x9) {  // Ping
+      sendFrame(client, 0xA, payload);
+    } else if (opcode == 0x1 || opcode == 0x2 || opcode == 0x0) {
+      if (opcode != 0x0) {
+        client.messageOpcode = opcode;
+        client.message.clear();
+      }
+      client.message += payload;
+      if (final) {
+        onWebSocketMessage(client.messageOpcode, client.message);
+        client.message.clear();
+      }
+    }
+  }
+  return true;
+}
+
+void HtmlInterfaceServer::WebServer::onWebSocketMessage(
+    uint8_t opcode, const std::string &message) {
+  if (opcode == 0x2) {
+    // A raw OSC message
+    osc::Message m(message.data(), int(message.size()));
+    Entry *entry = nullptr;
+    {
+      std::unique_lock<std::mutex> lk(mEntriesLock);
+      auto it = mEntriesByAddress.find(m.addressPattern());
+      if (it != mEntriesByAddress.end()) {
+        entry = it->second;
+      }
+    }
+    if (entry && entry->server) {
+      entry->server->onMessage(m);
+    } else if (entry) {
+      ParameterServer::setParameterValueFromMessage(
+          entry->parameter, m.addressPattern(), m);
+    }
+    return;
+  }
+  // A JSON array with the address followed by the values
+  nlohmann::json json = nlohmann::json::parse(message, nullptr, false);
+  if (!json.is_array() || json.size() < 2 || !json[0].is_string()) {
+    return;
+  }
+  Entry *entry = nullptr;
+  {
+    std::unique_lock<std::mutex> lk(mEntriesLock);
+    auto it = mEntriesByAddress.find(json[0].get<std::string>());
+    if (it == mEntriesByAddress.end()) {
+      return;
+    }
+    entry = it->second;
+  }
+  json.erase(json.begin());
+  dispatch(entry, json);
+}
+
+void HtmlInterfaceServer::WebServer::dispatch(Entry *entry,
+                                              const nlohmann::json &values) {
+  osc::Packet packet;
+  packet.beginMessage(entry->parameter->getFullAddress());
+  for (auto &value : values) {
+    if (entry->kind == STRING) {
+      if (!value.is_string()) {
+        return;
+      }
+      packet << value.get<std::string>();
+    } else if (!value.is_number()) {
+      return;
+    } else if (entry->kind == INT || entry->kind == MENU ||
+               entry->kind == CHOICE) {
+      // Converting a value out of range is undefined, so clamp it first
+      double number = std::min(
+          std::max(value.get<double>(),
+                   double(std::numeric_limits<int32_t>::min())),
+          double(std::numeric_limits<int32_t>::max()));
+      packet << int(number);
+    } else {
+      double number =
+          std::min(std::max(value.get<double>(),
+                            double(-std::numeric_limits<float>::max())),
+                   double(std::numeric_limits<float>::max()));
+      packet << float(number);
+    }
+  }
+  packet.endMessage();
+  osc::Message m(packet.data(), int(packet.size()));
+  if (entry->server) {
+    // Through the server's address index, as an OSC message would
+    entry->server->onMessage(m);
+  } else {
+    ParameterServer::setParameterValueFromMessage(
+        entry->parameter, entry->parameter->getFullAddress(), m);
+  }
+}
+
+void HtmlInterfaceServer::WebServer::push() {
+  std::vector<Entry *> deltas;
+  std::unique_lock<std::mutex> lk(mEntriesLock);
+  for (auto &entry : mEntries) {
+    bool changed = entry->changed.exchange(false, std::memory_order_acquire);
+    if (!changed && !entry->recheck) {
+      continue;
+    }
+    // Callbacks run before the value is stored, so read a changed value
+    // again on the next frame in case this read was too early
+    entry->recheck = changed;
+    nlohmann::json values;
+    if (!readValues(*entry, values)) {
+      continue;
+    }
+    std::string text = values.dump();
+    if (text != entry->valuesText) {
+      entry->values = std::move(values);
+      entry->valuesText = std::move(text);
+      deltas.push_back(entry.get());
+    }
+  }
+
+  std::vector<Entry *> everything;
+  for (Client &client : mClients) {
+    if (!client.webSocket || client.closing) {
+      continue;
+    }
+    if (client.out.size() > MAX_PENDING) {
+      client.resync = true;
+      continue;
+    }
+    std::vector<Entry *> *entries = &deltas;
+    if (client.resync) {
+      if (everything.empty()) {
+        for (auto &entry : mEntries) {
+          if (entry->valuesText.size() > 0) {
+            everything.push_back(entry.get());
+          }
+        }
+      }
+      entries = &everything;
+      client.resync = false;
+    }
+    if (entries->empty()) {
+      continue;
+    }
+
+    nlohmann::json json = {{"type", "values"},
+                           {"values", nlohmann::json::array()}};
+    std::string binary;
+    for (Entry *entry : *entries) {
+      size_t id = entry->id;
+      if (mFormat == PUSH_BINARY && entry->kind != STRING) {
+        binary.push_back(char(id & 0xFF));
+        binary.push_back(char(id >> 8));
+        binary.push_back(char(entry->values.size()));
+        for (auto &value : entry->values) {
+          float number = value.get<float>();
+          uint32_t bits;
+          memcpy(&bits, &number, sizeof(bits));
+          for (int byte = 0; byte < 4; byte++) {
+            binary.push_back(char(bits >> (8 * byte)));
+          }
+        }
+      } else {
+        nlohmann::json delta = entry->values;
+        delta.insert(delta.begin(), id);
+        json["values"].push_back(std::move(delta));
+      }
+    }
+    if (binary.size() > 0) {
+      sendFrame(client, 0x2, binary);
+    }
+    if (json["values"].size() > 0) {
+      sendFrame(client, 0x1, json.dump());
+    }
+  }
+}
+
+void HtmlInterfaceServer::WebServer::sendFrame(Client &client, uint8_t opcode,
+                                               const std::string &payload) {
+  client.out.push_back(char(0x80 | opcode));
+  if (payload.size() < 126) {
+    client.out.push_back(char(payload.size()));
+  } else if (payload.size() < 65536) {
+    client.out.push_back(char(126));
+    client.out.push_back(char(payload.size() >> 8));
+    client.out.push_back(char(payload.size() & 0xFF));
+  } else {
+    client.out.push_back(char(127));
+    for (int i = 7; i >= 0; i--) {
+      client.out.push_back(char(uint64_t(payload.size()) >> (8 * i)));
+    }
+  }
+  client.out += payload;
+  sendPending(client);
+}
+
+#endif  // AL_WINDOWS
+
+std::string HtmlInterfaceServer::WebServer::parametersMessage() {
+  nlohmann::json list = nlohmann::json::array();
+  std::unique_lock<std::mutex> lk(mEntriesLock);
+  for (size_t id = 0; id < mEntries.size(); id++) {
+    Entry &entry = *mEntries[id];
+    static const char *kindNames[] = {"float",  "bool",   "int",   "menu",
+                                      "choice", "string", "vector"};
+    nlohmann::json description = {
+        {"id", id},
+        {"address", entry.parameter->getFullAddress()},
+        {"name", entry.parameter->displayName()},
+        {"group", entry.parameter->getGroup()},
+        {"kind", kindNames[entry.kind]},
+        {"components", entry.components}};
+    if (entry.kind == FLOAT || entry.kind == BOOL) {
+      Parameter *p = static_cast<Parameter *>(entry.parameter);
+      description["min"] = p->min();
+      description["max"] = p->max();
+    } else if (entry.kind == INT) {
+      ParameterInt *p = static_cast<ParameterInt *>(entry.parameter);
+      description["min"] = p->min();
+      description["max"] = p->max();
+    } else if (entry.kind == MENU) {
+      description["elements"] =
+          static_cast<ParameterMenu *>(entry.parameter)->getElements();
+    }
+    list.push_back(std::move(description));
+  }
+  return nlohmann::json({{"type", "parameters"}, {"parameters", list}})
+      .dump();
+}
+
+bool HtmlInterfaceServer::WebServer::readValues(Entry &entry,
+                                                nlohmann::json &values) {
+  values = nlohmann::json::array();
+  if (entry.kind == MENU) {
+    // As an index, the field of a menu is its text
+    values.push_back(static_cast<ParameterMenu *>(entry.parameter)->get());
+    return true;
+  }
+  std::vector<ParameterField> fields;
+  entry.parameter->get(fields);
+  for (auto &field : fields) {
+    if (field.type() == ParameterField::FLOAT) {
+      values.push_back(field.get<float>());
+    } else if (field.type() == ParameterField::INT32) {
+      values.push_back(field.get<int32_t>());
+    } else if (field.type() == ParameterField::STRING) {
+      values.push_back(field.get<std::string>());
+    }
+  }
+  return values.size() > 0;
+}
+
 HtmlInterfaceServer::HtmlInterfaceServer(std::string pathToInterfaceJs,
-                                         bool autorun) {
+                                         bool autorun)
+    : mWebServer(new WebServer) {
   mRootPath = pathToInterfaceJs;
+  mAutorun = autorun;
   mInterfaceSendPort = 9010;   // Interface.js sends OSC on this port
   mInterfaceRecvPort = 10010;  // Interface.js receives OSC on this port
   mNodeJsPath = "/usr/bin/nodejs";
@@ -87,6 +1108,7 @@ HtmlInterfaceServer::HtmlInterfaceServer(std::string pathToInterfaceJs,
   }
 
 #ifndef AL_WINDOWS
+  mPid = 0;
   if (autorun) {
     if (pipe(p_stdin) != 0 || pipe(p_stdout) != 0) {
       std::cout << "Error setting up process pipes." << std::endl;
@@ -115,6 +1137,7 @@ HtmlInterfaceServer::HtmlInterfaceServer(std::string pathToInterfaceJs,
 }
 
 HtmlInterfaceServer::~HtmlInterfaceServer() {
+  stopWebServer();
 #ifndef AL_WINDOWS
   if (mPid > 0) {
     int status;
@@ -154,8 +1177,16 @@ void HtmlInterfaceServer::runInterfaceJs() {
 #endif
 }
 
+bool HtmlInterfaceServer::canWriteHtmlFile() {
+  // Without interface.js, only the built-in web server is used
+  return mAutorun || File::exists(mRootPath + "/server/interfaces");
+}
+
 void HtmlInterfaceServer::writeHtmlFile(std::vector<Parameter *> parameters,
                                         std::string interfaceName) {
+  if (!canWriteHtmlFile()) {
+    return;
+  }
   std::string code = htmlTemplateStart;
   std::string addCode = "iface.add(";
   float padding = 0.01;
@@ -201,6 +1232,9 @@ void HtmlInterfaceServer::writeHtmlFile(std::vector<Parameter *> parameters,
 void HtmlInterfaceServer::writeHtmlFile(PresetServer &presetServer,
                                         std::string interfaceName,
                                         int numPresets) {
+  if (!canWriteHtmlFile()) {
+    return;
+  }
   std::string code = htmlTemplateStart;
   std::string addCode = "iface.add(";
   int buttonsPerRow = 10;
@@ -283,6 +1317,7 @@ HtmlInterfaceServer &HtmlInterfaceServer::addParameter(
     Parameter &param, std::string interfaceName) {
   mParameters.push_back(&param);
   writeHtmlFile(mParameters, interfaceName);
+  mWebServer->addParameter(&param, nullptr);
   return *this;
 }
 
@@ -290,6 +1325,9 @@ HtmlInterfaceServer &HtmlInterfaceServer::addParameterServer(
     ParameterServer &paramServer, std::string interfaceName) {
   writeHtmlFile(paramServer.parameters(), interfaceName);
   paramServer.addListener("127.0.0.1", mInterfaceRecvPort);
+  for (ParameterMeta *param : paramServer.allParameters()) {
+    mWebServer->addParameter(param, &paramServer);
+  }
   return *this;
 }
 
@@ -298,3 +1336,27 @@ HtmlInterfaceServer &HtmlInterfaceServer::addPresetServer(
   writeHtmlFile(presetServer, interfaceName);
   return *this;
 }
+
+bool HtmlInterfaceServer::startWebServer(uint16_t port, std::string address) {
+  return mWebServer->start(port, address);
+}
+
+void HtmlInterfaceServer::stopWebServer() { mWebServer->stop(); }
+
+uint16_t HtmlInterfaceServer::webServerPort() { return mWebServer->port(); }
+
+size_t HtmlInterfaceServer::webClientCount() {
+  return mWebServer->clientCount();
+}
+
+void HtmlInterfaceServer::setPushRate(float framesPerSecond) {
+  mWebServer->setPushRate(framesPerSecond);
+}
+
+void HtmlInterfaceServer::setPushFormat(PushFormat format) {
+  mWebServer->setPushFormat(format);
+}
+
+void HtmlInterfaceServer::addAllowedHost(std::string host) {
+  mWebServer->addAllowedHost(host);
+}
@@ -15,17 +15,13 @@ Parameter::Parameter(std::string parameterName, std::string Group,
                      float defaultValue, std::string prefix, float min,
                      float max)
     : ParameterWrapper<float>(parameterName, Group, defaultValue, prefix, min,
-                              max) {
-  mFloatValue = defaultValue;
-}
+                              max) {}
 
 Parameter::Parameter(std::string parameterName, float defaultValue, float min,
                      float max)
-    : ParameterWrapper<float>(parameterName, "", defaultValue, "", min, max) {
-  mFloatValue = defaultValue;
-}
+    : ParameterWrapper<float>(parameterName, "", defaultValue, "", min, max) {}
 
-float Parameter::get() { return mFloatValue; }
+float Parameter::get() { return ParameterWrapper<float>::get(); }
 
 void Parameter::setNoCalls(float value, void *blockReceiver) {
   if (value > mMax) value = mMax;
@@ -34,10 +30,10 @@ void Parameter::setNoCalls(float value, void *blockReceiver) {
     value = (*mProcessCallback)(value);  //, mProcessUdata);
   }
   if (blockReceiver) {
-    runChangeCallbacksSynchronous(value);
+    setAndRunCallbacks(value);
+  } else {
+    setLocking(value);
   }
-
-  mFloatValue = value;
 }
 
 void Parameter::set(float value) {
@@ -47,8 +43,7 @@ void Parameter::set(float value) {
     value = (*mProcessCallback)(value);  //, mProcessUdata);
   }
 
-  runChangeCallbacksSynchronous(value);
-  mFloatValue = value;
+  setAndRunCallbacks(value);
 }
 
 // ParameterInt
@@ -57,11 +52,9 @@ ParameterInt::ParameterInt(std::string parameterName, std::string Group,
                            int32_t defaultValue, std::string prefix,
                            int32_t min, int32_t max)
     : ParameterWrapper<int32_t>(parameterName, Group, defaultValue, prefix, min,
-                                max) {
-  mIntValue = defaultValue;
-}
+                                max) {}
 
-int32_t ParameterInt::get() { return mIntValue; }
+int32_t ParameterInt::get() { return ParameterWrapper<int32_t>::get(); }
 
 void ParameterInt::setNoCalls(int32_t value, void *blockReceiver) {
   if (value > mMax) value = mMax;
@@ -70,10 +63,10 @@ void ParameterInt::setNoCalls(int32_t value, void *blockReceiver) {
     value = (*mProcessCallback)(value);  //, mProcessUdata);
   }
   if (blockReceiver) {
-    runChangeCallbacksSynchronous(value);
+    setAndRunCallbacks(value);
+  } else {
+    setLocking(value);
   }
-
-  mIntValue = value;
 }
 
 void ParameterInt::set(int32_t value) {
@@ -83,8 +76,7 @@ void ParameterInt::set(int32_t value) {
     value = (*mProcessCallback)(value);  //, mProcessUdata);
   }
 
-  runChangeCallbacksSynchronous(value);
-  mIntValue = value;
+  setAndRunCallbacks(value);
 }
 
 // ParameterBool
@@ -11,6 +11,7 @@ using namespace al;
 
 std::map<std::string, int> ParameterBundle::mBundleCounter =
     std::map<std::string, int>();
+std::atomic<uint64_t> ParameterBundle::mStructureVersion{0};
 
 ParameterBundle::ParameterBundle(std::string name) {
   if (name.find(" ") != std::string::npos) {
@@ -30,7 +31,10 @@ ParameterBundle::ParameterBundle(std::string name) {
 
 std::string ParameterBundle::name() const { return mBundleName; }
 
-void ParameterBundle::name(std::string newName) { mBundleName = newName; }
+void ParameterBundle::name(std::string newName) {
+  mBundleName = newName;
+  mStructureVersion++;
+}
 
 std::string ParameterBundle::bundlePrefix() const {
   std::string prefix = mParentPrefix + "/" + mBundleName;
@@ -46,6 +50,7 @@ int ParameterBundle::bundleIndex() const { return mBundleIndex; }
 
 void ParameterBundle::addParameter(ParameterMeta *parameter) {
   mParameters.push_back(parameter);
+  mStructureVersion++;
   if (strcmp(typeid(*parameter).name(), typeid(ParameterBool).name()) ==
       0) {  // ParameterBool
     ParameterBool *p = dynamic_cast<ParameterBool *>(parameter);
@@ -159,6 +164,7 @@ void ParameterBundle::addBundle(ParameterBundle &bundle, std::string id) {
   mBundles[id].push_back(&bundle);
   bundle.mBundleId = id;
   bundle.mParentPrefix = bundlePrefix();
+  mStructureVersion++;
 }
 
 ParameterBundle &ParameterBundle::operator<<(ParameterMeta *parameter) {
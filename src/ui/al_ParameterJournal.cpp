@@ -0,0 +1,758 @@
+#include "al/ui/al_ParameterJournal.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <typeinfo>
+
+using namespace al;
+
+// Snapshots kept. Older ones are thinned out, which only makes seeking into
+// the oldest part of the ring replay more changes
+static const size_t maxSnapshots = 64;
+
+static const char journalMagic[4] = {'A', 'L', 'P', 'J'};
+static const uint8_t journalVersion = 1;
+
+static uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static void writeVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(char((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(char(value));
+}
+
+static void writeZigzag(std::string &out, int64_t value) {
+  writeVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+static bool readVarint(const std::string &in, size_t &pos, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+    uint8_t byte = uint8_t(in[pos++]);
+    value |= uint64_t(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool readZigzag(const std::string &in, size_t &pos, int64_t &value) {
+  uint64_t encoded;
+  if (!readVarint(in, pos, encoded)) {
+    return false;
+  }
+  value = int64_t(encoded >> 1) ^ -int64_t(encoded & 1);
+  return true;
+}
+
+static void writeValues(std::string &out, const ParameterJournal::Entry &entry,
+                        const ParameterJournal::Value &value) {
+  for (uint8_t i = 0; i < entry.components; i++) {
+    if (entry.type == 'i') {
+      writeZigzag(out, value.ints[i]);
+    } else {
+      uint32_t bits = floatBits(value.floats[i]);
+      for (int byte = 0; byte < 4; byte++) {
+        out.push_back(char(bits >> (8 * byte)));
+      }
+    }
+  }
+}
+
+static bool readValues(const std::string &in, size_t &pos,
+                       const ParameterJournal::Entry &entry,
+                       ParameterJournal::Value &value) {
+  for (uint8_t i = 0; i < entry.components; i++) {
+    if (entry.type == 'i') {
+      int64_t intValue;
+      if (!readZigzag(in, pos, intValue)) {
+        return false;
+      }
+      value.ints[i] = int32_t(intValue);
+    } else {
+      if (pos + 4 > in.size()) {
+        return false;
+      }
+      uint32_t bits = 0;
+      for (int byte = 0; byte < 4; byte++) {
+        bits |= uint32_t(uint8_t(in[pos++])) << (8 * byte);
+      }
+      memcpy(&value.floats[i], &bits, sizeof(bits));
+    }
+  }
+  value.known = true;
+  return true;
+}
+
+ParameterJournal::ParameterJournal(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  mRecords = std::unique_ptr<Record[]>(new Record[size]);
+  mMask = size - 1;
+  mStartTime = al_steady_time_nsec();
+  // Changes from the start are applied to the values at registration
+  mSnapshots.push_back({0, 0, {}});
+}
+
+ParameterJournal::~ParameterJournal() { stopSnapshotThread(); }
+
+bool ParameterJournal::registerParameter(ParameterMeta &param) {
+  Entry entry{param.getFullAddress(), 'f', 0, &param};
+  std::unique_lock<std::mutex> lk(mParameterLock);
+  if (mParameters.size() > 0 && mParameters[0].parameter == nullptr) {
+    std::cerr << "ERROR: ParameterJournal can't record into a journal read "
+                 "from a file"
+              << std::endl;
+    return false;
+  }
+  for (auto &existing : mParameters) {
+    if (existing.parameter == &param) {
+      return true;
+    }
+  }
+  uint32_t id = uint32_t(mParameters.size());
+  if (strcmp(typeid(param).name(), typeid(ParameterBool).name()) == 0) {
+    ParameterBool *p = dynamic_cast<ParameterBool *>(&param);
+    entry.components = 1;
+    p->registerChangeCallback([this, id](float value) {
+      uint32_t word = floatBits(value);
+      record(id, &word, 1);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(Parameter).name()) == 0) {
+    Parameter *p = dynamic_cast<Parameter *>(&param);
+    entry.components = 1;
+    p->registerChangeCallback([this, id](float value) {
+      uint32_t word = floatBits(value);
+      record(id, &word, 1);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(ParameterInt).name()) == 0) {
+    ParameterInt *p = dynamic_cast<ParameterInt *>(&param);
+    entry.type = 'i';
+    entry.components = 1;
+    p->registerChangeCallback([this, id](int32_t value) {
+      uint32_t word = uint32_t(value);
+      record(id, &word, 1);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(ParameterMenu).name()) ==
+             0) {
+    ParameterMenu *p = dynamic_cast<ParameterMenu *>(&param);
+    entry.type = 'i';
+    entry.components = 1;
+    p->registerChangeCallback([this, id](int value) {
+      uint32_t word = uint32_t(value);
+      record(id, &word, 1);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(ParameterChoice).name()) ==
+             0) {
+    ParameterChoice *p = dynamic_cast<ParameterChoice *>(&param);
+    entry.type = 'i';
+    entry.components = 1;
+    p->registerChangeCallback([this, id](uint16_t value) {
+      uint32_t word = value;
+      record(id, &word, 1);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(ParameterVec3).name()) ==
+             0) {
+    ParameterVec3 *p = dynamic_cast<ParameterVec3 *>(&param);
+    entry.components = 3;
+    p->registerChangeCallback([this, id](al::Vec3f value) {
+      uint32_t words[3] = {floatBits(value[0]), floatBits(value[1]),
+                           floatBits(value[2])};
+      record(id, words, 3);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(ParameterVec4).name()) ==
+             0) {
+    ParameterVec4 *p = dynamic_cast<ParameterVec4 *>(&param);
+    entry.components = 4;
+    p->registerChangeCallback([this, id](al::Vec4f value) {
+      uint32_t words[4] = {floatBits(value[0]), floatBits(value[1]),
+                           floatBits(value[2]), floatBits(value[3])};
+      record(id, words, 4);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(ParameterColor).name()) ==
+             0) {
+    ParameterColor *p = dynamic_cast<ParameterColor *>(&param);
+    entry.components = 4;
+    p->registerChangeCallback([this, id](al::Color value) {
+      uint32_t words[4] = {floatBits(value.r), floatBits(value.g),
+                           floatBits(value.b), floatBits(value.a)};
+      record(id, words, 4);
+    });
+  } else if (strcmp(typeid(param).name(), typeid(ParameterPose).name()) ==
+             0) {
+    ParameterPose *p = dynamic_cast<ParameterPose *>(&param);
+    entry.components = 7;
+    p->registerChangeCallback([this, id](al::Pose value) {
+      uint32_t words[7] = {floatBits(float(value.pos()[0])),
+                           floatBits(float(value.pos()[1])),
+                           floatBits(float(value.pos()[2])),
+                           floatBits(float(value.quat().w)),
+                           floatBits(float(value.quat().x)),
+                           floatBits(float(value.quat().y)),
+                           floatBits(float(value.quat().z))};
+      record(id, words, 7);
+    });
+  } else {
+    std::cerr << "ERROR: Unsupported Parameter type for ParameterJournal: "
+              << entry.address << std::endl;
+    return false;
+  }
+  Value initial;
+  readCurrentValue(entry, initial);
+  mParameters.push_back(entry);
+  mInitialValues.push_back(initial);
+  lk.unlock();
+  startSnapshotThread();
+  return true;
+}
+
+void ParameterJournal::setSnapshotInterval(al_sec seconds) {
+  stopSnapshotThread();
+  mSnapshotInterval = std::max(0.0, seconds);
+  bool recording;
+  {
+    std::unique_lock<std::mutex> lk(mParameterLock);
+    recording = mParameters.size() > 0 && mParameters[0].parameter;
+  }
+  if (recording) {
+    startSnapshotThread();
+  }
+}
+
+void ParameterJournal::snapshot() {
+  uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+  uint64_t now = uint64_t(al_steady_time_nsec() - mStartTime);
+  std::unique_lock<std::mutex> lk(mSnapshotLock);
+  const Snapshot &latest = mSnapshots.back();
+  if (latest.index == writeIndex) {
+    return;  // Nothing changed
+  }
+  Snapshot newSnapshot{now, latest.index, latest.values};
+  fillValues(newSnapshot.values);
+  bool complete = latest.index + mMask + 1 >= writeIndex;
+  std::vector<uint64_t> changeTimes(newSnapshot.values.size(), 0);
+  for (uint64_t index = latest.index; complete && index < writeIndex;
+       index++) {
+    uint64_t time;
+    uint32_t id;
+    Value value;
+    if (!readRecord(index, time, id, value)) {
+      // Still being written. The snapshot stops before it, and seeking
+      // applies it from there
+      break;
+    }
+    if (id < newSnapshot.values.size() && time >= changeTimes[id]) {
+      newSnapshot.values[id] = value;
+      changeTimes[id] = time;
+    }
+    newSnapshot.index = index + 1;
+  }
+  if (latest.index + mMask + 1 < mWriteIndex.load(std::memory_order_acquire)) {
+    complete = false;
+  }
+  if (!complete) {
+    // The changes since the last snapshot were overwritten. Read the values
+    // from the parameters instead. A change being recorded right now may be
+    // missed until the parameter changes again
+    newSnapshot.index = writeIndex;
+    std::unique_lock<std::mutex> parameterLock(mParameterLock);
+    for (size_t id = 0;
+         id < mParameters.size() && id < newSnapshot.values.size(); id++) {
+      readCurrentValue(mParameters[id], newSnapshot.values[id]);
+    }
+  }
+  mSnapshots.push_back(std::move(newSnapshot));
+
+  writeIndex = mWriteIndex.load(std::memory_order_acquire);
+  while (mSnapshots.size() > 1 &&
+         mSnapshots[0].index + mMask + 1 < writeIndex) {
+    mSnapshots.erase(mSnapshots.begin());
+  }
+  if (mSnapshots.size() > maxSnapshots) {
+    mSnapshots.erase(mSnapshots.begin() + 1);
+  }
+}
+
+al_sec ParameterJournal::time() const {
+  return (al_steady_time_nsec() - mStartTime) * 1.0e-9;
+}
+
+al_sec ParameterJournal::startTime() const {
+  uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lk(mSnapshotLock);
+  for (auto &snapshot : mSnapshots) {
+    if (snapshot.index + mMask + 1 >= writeIndex) {
+      return snapshot.time * 1.0e-9;
+    }
+  }
+  return time();
+}
+
+uint64_t ParameterJournal::lostChanges() const {
+  uint64_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+  uint64_t overwritten = writeIndex > mMask + 1 ? writeIndex - mMask - 1 : 0;
+  return overwritten + mDropped.load(std::memory_order_relaxed);
+}
+
+bool ParameterJournal::stateAt(al_sec time, std::vector<Value> &values) const {
+  uint64_t t = toNanoseconds(time);
+  Snapshot snapshot;
+  if (!findSnapshot(t, snapshot)) {
+    return false;
+  }
+  values = std::move(snapshot.values);
+  fillValues(values);
+  uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+  // Changes are in the ring in the order they were recorded, which can
+  // differ slightly from the order of their times across threads, so the
+  // whole tail is scanned and the latest change of each parameter wins
+  std::vector<uint64_t> changeTimes(values.size(), 0);
+  for (uint64_t index = snapshot.index; index < writeIndex; index++) {
+    uint64_t recordTime;
+    uint32_t id;
+    Value value;
+    if (readRecord(index, recordTime, id, value) && recordTime <= t &&
+        id < values.size() && recordTime >= changeTimes[id]) {
+      values[id] = value;
+      changeTimes[id] = recordTime;
+    }
+  }
+  // Fail if the ring wrapped past the snapshot while reading
+  return snapshot.index + mMask + 1 >=
+         mWriteIndex.load(std::memory_order_acquire);
+}
+
+bool ParameterJournal::restore(al_sec time) {
+  std::vector<Value> values;
+  if (!stateAt(time, values)) {
+    return false;
+  }
+  std::vector<Entry> entries;
+  {
+    std::unique_lock<std::mutex> lk(mParameterLock);
+    entries = mParameters;
+  }
+  for (size_t id = 0; id < entries.size() && id < values.size(); id++) {
+    if (entries[id].parameter && values[id].known) {
+      writeValue(entries[id], values[id]);
+    }
+  }
+  return true;
+}
+
+void ParameterJournal::changes(
+    al_sec startTime, al_sec endTime,
+    const std::function<void(al_sec, uint32_t, const Value &)> &function)
+    const {
+  struct Change {
+    uint64_t time;
+    uint32_t id;
+    Value value;
+  };
+  uint64_t start = toNanoseconds(startTime);
+  uint64_t end = toNanoseconds(endTime);
+  uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+  uint64_t first = writeIndex > mMask + 1 ? writeIndex - mMask - 1 : 0;
+  std::vector<Change> changeList;
+  for (uint64_t index = first; index < writeIndex; index++) {
+    Change change;
+    if (readRecord(index, change.time, change.id, change.value) &&
+        change.time >= start && change.time <= end) {
+      changeList.push_back(change);
+    }
+  }
+  std::stable_sort(
+      changeList.begin(), changeList.end(),
+      [](const Change &a, const Change &b) { return a.time < b.time; });
+  for (auto &change : changeList) {
+    function(change.time * 1.0e-9, change.id, change.value);
+  }
+}
+
+bool ParameterJournal::writeFile(const std::string &fileName) const {
+  // Start from the earliest snapshot that can be replayed
+  Snapshot base;
+  bool found = false;
+  {
+    uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lk(mSnapshotLock);
+    for (auto &snapshot : mSnapshots) {
+      if (snapshot.index + mMask + 1 >= writeIndex) {
+        base = snapshot;
+        found = true;
+        break;
+      }
+    }
+  }
+  if (!found) {
+    std::cerr << "ERROR: ParameterJournal has no complete state to write"
+              << std::endl;
+    return false;
+  }
+  std::vector<Entry> entries;
+  {
+    std::unique_lock<std::mutex> lk(mParameterLock);
+    entries = mParameters;
+  }
+  fillValues(base.values);
+
+  std::vector<uint64_t> changeIndices;
+  std::vector<uint64_t> times;
+  std::vector<uint32_t> ids;
+  std::vector<Value> values;
+  uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+  for (uint64_t index = base.index; index < writeIndex; index++) {
+    uint64_t time;
+    uint32_t id;
+    Value value;
+    if (readRecord(index, time, id, value) && id < entries.size()) {
+      changeIndices.push_back(changeIndices.size());
+      times.push_back(time);
+      ids.push_back(id);
+      values.push_back(value);
+    }
+  }
+  if (base.index + mMask + 1 < mWriteIndex.load(std::memory_order_acquire)) {
+    std::cerr << "ERROR: ParameterJournal changes were overwritten while "
+                 "writing "
+              << fileName << std::endl;
+    return false;
+  }
+  std::stable_sort(changeIndices.begin(), changeIndices.end(),
+                   [&](uint64_t a, uint64_t b) { return times[a] < times[b]; });
+
+  std::string out(journalMagic, sizeof(journalMagic));
+  out.push_back(char(journalVersion));
+  writeVarint(out, entries.size());
+  for (auto &entry : entries) {
+    writeVarint(out, entry.address.size());
+    out += entry.address;
+    out.push_back(entry.type);
+    out.push_back(char(entry.components));
+  }
+  writeVarint(out, base.time);
+  for (size_t id = 0; id < entries.size(); id++) {
+    out.push_back(char(base.values[id].known));
+    if (base.values[id].known) {
+      writeValues(out, entries[id], base.values[id]);
+    }
+  }
+  writeVarint(out, changeIndices.size());
+  uint64_t previousTime = base.time;
+  for (uint64_t i : changeIndices) {
+    writeZigzag(out, int64_t(times[i] - previousTime));
+    previousTime = times[i];
+    writeVarint(out, ids[i]);
+    writeValues(out, entries[ids[i]], values[i]);
+  }
+
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file.write(out.data(), out.size())) {
+    std::cerr << "ERROR: Could not write ParameterJournal file " << fileName
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool ParameterJournal::readFile(const std::string &fileName) {
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file.good()) {
+    std::cerr << "ERROR: Could not open ParameterJournal file " << fileName
+              << std::endl;
+    return false;
+  }
+  std::string in((std::istreambuf_iterator<char>(file)),
+                 std::istreambuf_iterator<char>());
+  auto fail = [&]() {
+    std::cerr << "ERROR: Invalid ParameterJournal file " << fileName
+              << std::endl;
+    return false;
+  };
+  if (in.size() < sizeof(journalMagic) + 1 ||
+      memcmp(in.data(), journalMagic, sizeof(journalMagic)) != 0 ||
+      uint8_t(in[sizeof(journalMagic)]) != journalVersion) {
+    return fail();
+  }
+  size_t pos = sizeof(journalMagic) + 1;
+
+  uint64_t count;
+  if (!readVarint(in, pos, count)) {
+    return fail();
+  }
+  std::vector<Entry> entries;
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t length;
+    if (!readVarint(in, pos, length) || pos + length + 2 > in.size()) {
+      return fail();
+    }
+    Entry entry{in.substr(pos, length), in[pos + length],
+                uint8_t(in[pos + length + 1]), nullptr};
+    pos += length + 2;
+    if ((entry.type != 'f' && entry.type != 'i') ||
+        entry.components > MAX_COMPONENTS) {
+      return fail();
+    }
+    entries.push_back(entry);
+  }
+
+  Snapshot base;
+  base.index = 0;
+  if (!readVarint(in, pos, base.time)) {
+    return fail();
+  }
+  base.values.resize(entries.size());
+  for (size_t id = 0; id < entries.size(); id++) {
+    if (pos >= in.size()) {
+      return fail();
+    }
+    if (in[pos++] && !readValues(in, pos, entries[id], base.values[id])) {
+      return fail();
+    }
+  }
+
+  if (!readVarint(in, pos, count)) {
+    return fail();
+  }
+  size_t size = mMask + 1;
+  while (size < count) {
+    size <<= 1;
+  }
+  std::unique_ptr<Record[]> records(new Record[size]);
+  uint64_t time = base.time;
+  for (uint64_t index = 0; index < count; index++) {
+    int64_t delta;
+    uint64_t id;
+    Value value;
+    if (!readZigzag(in, pos, delta) || !readVarint(in, pos, id) ||
+        id >= entries.size() || !readValues(in, pos, entries[id], value)) {
+      return fail();
+    }
+    time += uint64_t(delta);
+    Record &record = records[index];
+    record.time.store(time, std::memory_order_relaxed);
+    record.id.store(uint32_t(id), std::memory_order_relaxed);
+    for (uint8_t i = 0; i < entries[id].components; i++) {
+      record.words[i].store(uint32_t(value.ints[i]),
+                            std::memory_order_relaxed);
+    }
+    record.sequence.store(2 * index + 2, std::memory_order_release);
+  }
+
+  std::unique_lock<std::mutex> snapshotLock(mSnapshotLock, std::defer_lock);
+  std::unique_lock<std::mutex> lk(mParameterLock, std::defer_lock);
+  std::lock(snapshotLock, lk);
+  if (mParameters.size() > 0 && mParameters[0].parameter) {
+    std::cerr << "ERROR: ParameterJournal can't read a file into a journal "
+                 "with registered parameters"
+              << std::endl;
+    return false;
+  }
+  mRecords = std::move(records);
+  mMask = size - 1;
+  mWriteIndex.store(count, std::memory_order_release);
+  mDropped.store(0, std::memory_order_relaxed);
+  mParameters = entries;
+  mInitialValues = base.values;
+  mSnapshots.clear();
+  mSnapshots.push_back(std::move(base));
+  return true;
+}
+
+void ParameterJournal::record(uint32_t id, const uint32_t *words,
+                              uint8_t count) {
+  uint64_t index = mWriteIndex.fetch_add(1, std::memory_order_relaxed);
+  Record &record = mRecords[index & mMask];
+  uint64_t previous = record.sequence.load(std::memory_order_relaxed);
+  // The slot is free if it is complete and from an earlier lap. Otherwise a
+  // writer from an earlier lap is still in it, or this writer was
+  // preempted for a whole lap
+  if ((previous & 1) || previous > 2 * index ||
+      !record.sequence.compare_exchange_strong(previous, 2 * index + 1,
+                                               std::memory_order_relaxed)) {
+    mDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // Timed after claiming the slot, so a writer that is preempted in between
+  // does not record a time older than changes it is ordered after
+  uint64_t time = uint64_t(al_steady_time_nsec() - mStartTime);
+  std::atomic_thread_fence(std::memory_order_release);
+  record.time.store(time, std::memory_order_relaxed);
+  record.id.store(id, std::memory_order_relaxed);
+  for (uint8_t i = 0; i < count; i++) {
+    record.words[i].store(words[i], std::memory_order_relaxed);
+  }
+  record.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+bool ParameterJournal::readRecord(uint64_t index, uint64_t &time,
+                                  uint32_t &id, Value &value) const {
+  const Record &record = mRecords[index & mMask];
+  if (record.sequence.load(std::memory_order_acquire) != 2 * index + 2) {
+    return false;
+  }
+  time = record.time.load(std::memory_order_relaxed);
+  id = record.id.load(std::memory_order_relaxed);
+  for (uint8_t i = 0; i < MAX_COMPONENTS; i++) {
+    value.ints[i] = int32_t(record.words[i].load(std::memory_order_relaxed));
+  }
+  value.known = true;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  // Overwritten while reading
+  return record.sequence.load(std::memory_order_relaxed) == 2 * index + 2;
+}
+
+bool ParameterJournal::findSnapshot(uint64_t time, Snapshot &snapshot) const {
+  uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lk(mSnapshotLock);
+  for (auto it = mSnapshots.rbegin(); it != mSnapshots.rend(); it++) {
+    if (it->time <= time) {
+      if (it->index + mMask + 1 < writeIndex) {
+        return false;
+      }
+      snapshot = *it;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ParameterJournal::fillValues(std::vector<Value> &values) const {
+  std::unique_lock<std::mutex> lk(mParameterLock);
+  size_t known = values.size();
+  if (known >= mInitialValues.size()) {
+    return;
+  }
+  values.resize(mInitialValues.size());
+  std::copy(mInitialValues.begin() + known, mInitialValues.end(),
+            values.begin() + known);
+}
+
+void ParameterJournal::readCurrentValue(const Entry &entry,
+                                        Value &value) const {
+  ParameterMeta *param = entry.parameter;
+  if (!param) {
+    return;
+  }
+  value.known = true;
+  if (strcmp(typeid(*param).name(), typeid(ParameterBool).name()) == 0 ||
+      strcmp(typeid(*param).name(), typeid(Parameter).name()) == 0) {
+    value.floats[0] = dynamic_cast<Parameter *>(param)->get();
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterInt).name()) ==
+             0) {
+    value.ints[0] = dynamic_cast<ParameterInt *>(param)->get();
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterMenu).name()) ==
+             0) {
+    value.ints[0] = dynamic_cast<ParameterMenu *>(param)->get();
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterChoice).name()) ==
+             0) {
+    value.ints[0] = dynamic_cast<ParameterChoice *>(param)->get();
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterVec3).name()) ==
+             0) {
+    Vec3f v = dynamic_cast<ParameterVec3 *>(param)->get();
+    std::copy(v.elems(), v.elems() + 3, value.floats);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterVec4).name()) ==
+             0) {
+    Vec4f v = dynamic_cast<ParameterVec4 *>(param)->get();
+    std::copy(v.elems(), v.elems() + 4, value.floats);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterColor).name()) ==
+             0) {
+    Color c = dynamic_cast<ParameterColor *>(param)->get();
+    value.floats[0] = c.r;
+    value.floats[1] = c.g;
+    value.floats[2] = c.b;
+    value.floats[3] = c.a;
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterPose).name()) ==
+             0) {
+    Pose pose = dynamic_cast<ParameterPose *>(param)->get();
+    value.floats[0] = float(pose.pos()[0]);
+    value.floats[1] = float(pose.pos()[1]);
+    value.floats[2] = float(pose.pos()[2]);
+    value.floats[3] = float(pose.quat().w);
+    value.floats[4] = float(pose.quat().x);
+    value.floats[5] = float(pose.quat().y);
+    value.floats[6] = float(pose.quat().z);
+  } else {
+    value.known = false;
+  }
+}
+
+void ParameterJournal::writeValue(const Entry &entry, const Value &value) {
+  ParameterMeta *param = entry.parameter;
+  const float *f = value.floats;
+  if (strcmp(typeid(*param).name(), typeid(ParameterBool).name()) == 0 ||
+      strcmp(typeid(*param).name(), typeid(Parameter).name()) == 0) {
+    dynamic_cast<Parameter *>(param)->set(f[0]);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterInt).name()) ==
+             0) {
+    dynamic_cast<ParameterInt *>(param)->set(value.ints[0]);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterMenu).name()) ==
+             0) {
+    dynamic_cast<ParameterMenu *>(param)->set(value.ints[0]);
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterChoice).name()) ==
+             0) {
+    dynamic_cast<ParameterChoice *>(param)->set(uint16_t(value.ints[0]));
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterVec3).name()) ==
+             0) {
+    dynamic_cast<ParameterVec3 *>(param)->set(Vec3f(f[0], f[1], f[2]));
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterVec4).name()) ==
+             0) {
+    dynamic_cast<ParameterVec4 *>(param)->set(Vec4f(f[0], f[1], f[2], f[3]));
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterColor).name()) ==
+             0) {
+    dynamic_cast<ParameterColor *>(param)->set(Color(f[0], f[1], f[2], f[3]));
+  } else if (strcmp(typeid(*param).name(), typeid(ParameterPose).name()) ==
+             0) {
+    dynamic_cast<ParameterPose *>(param)->set(
+        Pose(Vec3d(f[0], f[1], f[2]), Quatd(f[3], f[4], f[5], f[6])));
+  }
+}
+
+void ParameterJournal::startSnapshotThread() {
+  std::unique_lock<std::mutex> lk(mSnapshotThreadLock);
+  if (mSnapshotThread || mSnapshotInterval <= 0.0) {
+    return;
+  }
+  mSnapshotRunning = true;
+  mSnapshotThread =
+      std::make_unique<std::thread>(&ParameterJournal::snapshotThread, this);
+}
+
+void ParameterJournal::snapshotThread() {
+  std::unique_lock<std::mutex> lk(mSnapshotThreadLock);
+  while (mSnapshotRunning) {
+    mSnapshotCondition.wait_for(
+        lk, std::chrono::duration<double>(mSnapshotInterval));
+    lk.unlock();
+    snapshot();
+    lk.lock();
+  }
+}
+
+void ParameterJournal::stopSnapshotThread() {
+  std::unique_ptr<std::thread> thread;
+  {
+    std::unique_lock<std::mutex> lk(mSnapshotThreadLock);
+    mSnapshotRunning = false;
+    thread = std::move(mSnapshotThread);
+  }
+  mSnapshotCondition.notify_all();
+  if (thread) {
+    thread->join();
+  }
+}
+
+uint64_t ParameterJournal::toNanoseconds(al_sec time) const {
+  return time <= 0.0 ? 0 : uint64_t(time * 1.0e9);
+}
@@ -0,0 +1,93 @@
+#include "al/ui/al_ParameterScheduler.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+using namespace al;
+
+void ParameterScheduler::registerParameter(ParameterMeta &param) {
+  std::unique_lock<std::mutex> lk(mLock);
+  indexOf(param);
+}
+
+bool ParameterScheduler::addDependency(ParameterMeta &source,
+                                       ParameterMeta &target) {
+  std::unique_lock<std::mutex> lk(mLock);
+  size_t sourceIndex = indexOf(source);
+  size_t targetIndex = indexOf(target);
+  std::vector<size_t> &dependents = mDependents[sourceIndex];
+  if (std::find(dependents.begin(), dependents.end(), targetIndex) !=
+      dependents.end()) {
+    return true;
+  }
+  dependents.push_back(targetIndex);
+  if (!sortParameters()) {
+    dependents.pop_back();
+    sortParameters();
+    std::cerr << "ERROR: ParameterScheduler dependency from "
+              << source.getFullAddress() << " to " << target.getFullAddress()
+              << " creates a cycle. Ignored." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+size_t ParameterScheduler::flush() {
+  std::unique_lock<std::mutex> lk(mLock);
+  size_t processed = 0;
+  for (ParameterMeta *param : mOrder) {
+    if (param->hasChange()) {
+      param->processChange();
+      processed++;
+    }
+  }
+  return processed;
+}
+
+size_t ParameterScheduler::indexOf(ParameterMeta &param) {
+  auto it = std::find(mParameters.begin(), mParameters.end(), &param);
+  if (it != mParameters.end()) {
+    return size_t(it - mParameters.begin());
+  }
+  param.setSynchronousCallbacks(false);
+  mParameters.push_back(&param);
+  mDependents.emplace_back();
+  sortParameters();
+  return mParameters.size() - 1;
+}
+
+bool ParameterScheduler::sortParameters() {
+  // Kahn's algorithm. Among parameters that are ready, the one registered
+  // first goes first, so unrelated parameters keep their registration order
+  std::vector<size_t> sources(mParameters.size(), 0);
+  for (auto &dependents : mDependents) {
+    for (size_t target : dependents) {
+      sources[target]++;
+    }
+  }
+  std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+  for (size_t i = 0; i < sources.size(); i++) {
+    if (sources[i] == 0) {
+      ready.push(i);
+    }
+  }
+  std::vector<ParameterMeta *> order;
+  order.reserve(mParameters.size());
+  while (!ready.empty()) {
+    size_t index = ready.top();
+    ready.pop();
+    order.push_back(mParameters[index]);
+    for (size_t target : mDependents[index]) {
+      if (--sources[target] == 0) {
+        ready.push(target);
+      }
+    }
+  }
+  if (order.size() != mParameters.size()) {
+    return false;
+  }
+  mOrder = std::move(order);
+  return true;
+}
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstring>
 
 using namespace al;
@@ -12,14 +13,22 @@ using namespace al;
 OSCNotifier::OSCNotifier() { mHandshakeHandler.notifier = this; }
 
 OSCNotifier::~OSCNotifier() {
+  stopFlushThread();
   for (osc::Send *sender : mOSCSenders) {
     delete sender;
   }
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress, float value) {
+void OSCNotifier::notifyListeners(const std::string &OSCaddress, float value) {
+  bool streamed = streamValues(OSCaddress, &value);
+  if (queueFloats(OSCaddress, &value, 1, streamed)) {
+    return;
+  }
   mListenerLock.lock();
   for (osc::Send *sender : mOSCSenders) {
+    if (streamed && isStreamListener(sender)) {
+      continue;
+    }
     sender->send(OSCaddress, value);
     //		std::cout << "Notifying " << sender->address() << ":" <<
     // sender->port() << " -- " << OSCaddress << std::endl;
@@ -27,9 +36,21 @@ void OSCNotifier::notifyListeners(std::string OSCaddress, float value) {
   mListenerLock.unlock();
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress, int value) {
+void OSCNotifier::notifyListeners(const std::string &OSCaddress, int value) {
+  bool streamed = streamValues(OSCaddress, int32_t(value));
+  if (mNotificationRate > 0.0f) {
+    std::unique_lock<std::mutex> lk(mPendingLock);
+    PendingNotification &pending = pendingNotification(OSCaddress);
+    pending.type = 'i';
+    pending.streamed = streamed;
+    pending.intValue = value;
+    return;
+  }
   mListenerLock.lock();
   for (osc::Send *sender : mOSCSenders) {
+    if (streamed && isStreamListener(sender)) {
+      continue;
+    }
     sender->send(OSCaddress, value);
     //        std::cout << "Notifying " << sender->address() << ":" <<
     //        sender->port() << " -- " << OSCaddress << std::endl;
@@ -37,7 +58,16 @@ void OSCNotifier::notifyListeners(std::string OSCaddress, int value) {
   mListenerLock.unlock();
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress, std::string value) {
+void OSCNotifier::notifyListeners(const std::string &OSCaddress,
+                                  std::string value) {
+  if (mNotificationRate > 0.0f) {
+    std::unique_lock<std::mutex> lk(mPendingLock);
+    PendingNotification &pending = pendingNotification(OSCaddress);
+    pending.type = 's';
+    pending.streamed = false;
+    pending.stringValue = value;
+    return;
+  }
   mListenerLock.lock();
   for (osc::Send *sender : mOSCSenders) {
     sender->send(OSCaddress, value);
@@ -47,9 +77,16 @@ void OSCNotifier::notifyListeners(std::string OSCaddress, std::string value) {
   mListenerLock.unlock();
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress, Vec3f value) {
+void OSCNotifier::notifyListeners(const std::string &OSCaddress, Vec3f value) {
+  bool streamed = streamValues(OSCaddress, value.elems());
+  if (queueFloats(OSCaddress, value.elems(), 3, streamed)) {
+    return;
+  }
   mListenerLock.lock();
   for (osc::Send *sender : mOSCSenders) {
+    if (streamed && isStreamListener(sender)) {
+      continue;
+    }
     sender->send(OSCaddress, value[0], value[1], value[2]);
     //		std::cout << "Notifying " << sender->address() << ":" <<
     // sender->port() << " -- " << OSCaddress << std::endl;
@@ -57,9 +94,16 @@ void OSCNotifier::notifyListeners(std::string OSCaddress, Vec3f value) {
   mListenerLock.unlock();
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress, Vec4f value) {
+void OSCNotifier::notifyListeners(const std::string &OSCaddress, Vec4f value) {
+  bool streamed = streamValues(OSCaddress, value.elems());
+  if (queueFloats(OSCaddress, value.elems(), 4, streamed)) {
+    return;
+  }
   mListenerLock.lock();
   for (osc::Send *sender : mOSCSenders) {
+    if (streamed && isStreamListener(sender)) {
+      continue;
+    }
     sender->send(OSCaddress, value[0], value[1], value[2], value[3]);
     //		std::cout << "Notifying " << sender->address() << ":" <<
     // sender->port() << " -- " << OSCaddress << std::endl;
@@ -67,9 +111,20 @@ void OSCNotifier::notifyListeners(std::string OSCaddress, Vec4f value) {
   mListenerLock.unlock();
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress, Pose value) {
+void OSCNotifier::notifyListeners(const std::string &OSCaddress, Pose value) {
+  float values[7] = {float(value.pos()[0]), float(value.pos()[1]),
+                     float(value.pos()[2]), float(value.quat().w),
+                     float(value.quat().x), float(value.quat().y),
+                     float(value.quat().z)};
+  bool streamed = streamValues(OSCaddress, values);
+  if (queueFloats(OSCaddress, values, 7, streamed)) {
+    return;
+  }
   mListenerLock.lock();
   for (osc::Send *sender : mOSCSenders) {
+    if (streamed && isStreamListener(sender)) {
+      continue;
+    }
     sender->send(OSCaddress, (float)value.pos()[0], (float)value.pos()[1],
                  (float)value.pos()[2], (float)value.quat().w,
                  (float)value.quat().x, (float)value.quat().y,
@@ -80,7 +135,10 @@ void OSCNotifier::notifyListeners(std::string OSCaddress, Pose value) {
   mListenerLock.unlock();
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress, Color value) {
+void OSCNotifier::notifyListeners(const std::string &OSCaddress, Color value) {
+  if (queueFloats(OSCaddress, value.components, 3, false)) {
+    return;
+  }
   mListenerLock.lock();
   for (osc::Send *sender : mOSCSenders) {
     sender->send(OSCaddress, float(value.r), float(value.g), float(value.b));
@@ -90,7 +148,32 @@ void OSCNotifier::notifyListeners(std::string OSCaddress, Color value) {
   mListenerLock.unlock();
 }
 
-void OSCNotifier::notifyListeners(std::string OSCaddress,
+void OSCNotifier::notifyListeners(const std::string &OSCaddress,
+                                  const AudioTelemetry::Snapshot &telemetry) {
+  osc::Packet p(4096);
+  p.beginBundle();
+  p.addMessage(OSCaddress + "/load", telemetry.lastLoad, telemetry.meanLoad,
+               telemetry.maxLoad, telemetry.smoothedLoad);
+  p.addMessage(OSCaddress + "/count", int(telemetry.callbacks),
+               int(telemetry.xruns), int(telemetry.deadlineMisses));
+  p.beginMessage(OSCaddress + "/histogram");
+  for (auto binCount : telemetry.histogram) {
+    p << int(binCount);
+  }
+  p.endMessage();
+  for (auto &span : telemetry.spans) {
+    p.addMessage(OSCaddress + "/span", span.name, span.lastLoad,
+                 span.meanLoad, span.maxLoad);
+  }
+  p.endBundle();
+  mListenerLock.lock();
+  for (osc::Send *sender : mOSCSenders) {
+    sender->send(p);
+  }
+  mListenerLock.unlock();
+}
+
+void OSCNotifier::notifyListeners(const std::string &OSCaddress,
                                   ParameterMeta *param) {
   if (strcmp(typeid(*param).name(), typeid(ParameterBool).name()) ==
       0) {  // ParameterBool
@@ -135,8 +218,524 @@ void OSCNotifier::notifyListeners(std::string OSCaddress,
   }
 }
 
+void OSCNotifier::setNotificationRate(float rate) {
+  stopFlushThread();
+  mNotificationRate = std::max(0.0f, rate);
+  if (mNotificationRate > 0.0f) {
+    mFlushRunning = true;
+    mFlushThread =
+        std::make_unique<std::thread>(&OSCNotifier::flushThread, this);
+  } else {
+    flushNotifications();
+  }
+}
+
+// Size of an OSC string including its terminator and padding
+static size_t oscStringSize(size_t length) { return (length + 4) & ~size_t(3); }
+
+void OSCNotifier::flushNotifications() {
+  if (mStreaming) {
+    std::unique_lock<std::mutex> lk(mStreamLock);
+    sendStreamFrames();
+  }
+  std::unique_lock<std::mutex> flushLock(mFlushLock);
+  {
+    std::unique_lock<std::mutex> lk(mPendingLock);
+    if (mPending.size() == 0) {
+      return;
+    }
+    mFlushing.swap(mPending);
+    mPendingIndex.clear();
+  }
+  // Bundle header is "#bundle" and the time tag. Each message is preceded by
+  // its size
+  const size_t bundleHeaderSize = 16;
+  auto messageSize = [](const PendingNotification &n) {
+    size_t size = 4 + oscStringSize(n.address.size());
+    if (n.type == 'f') {
+      size += oscStringSize(1 + n.count) + 4 * n.count;
+    } else if (n.type == 'i') {
+      size += oscStringSize(2) + 4;
+    } else {
+      size += oscStringSize(2) + oscStringSize(n.stringValue.size());
+    }
+    return size;
+  };
+  size_t largest = 0;
+  for (auto &notification : mFlushing) {
+    largest = std::max(largest, messageSize(notification));
+  }
+  osc::Packet packet(int(std::max(mMaxPacketSize, bundleHeaderSize + largest)));
+
+  // Stream listeners get the streamed values in binary frames instead
+  auto sendBundles = [&](const std::vector<osc::Send *> &senders,
+                         bool skipStreamed) {
+    size_t packetSize = bundleHeaderSize;
+    packet.clear();
+    packet.beginBundle();
+    for (auto &notification : mFlushing) {
+      if (skipStreamed && notification.streamed) {
+        continue;
+      }
+      size_t size = messageSize(notification);
+      if (packetSize + size > mMaxPacketSize && packetSize > bundleHeaderSize) {
+        packet.endBundle();
+        for (osc::Send *sender : senders) {
+          sender->send(packet);
+        }
+        packet.clear();
+        packet.beginBundle();
+        packetSize = bundleHeaderSize;
+      }
+      packet.beginMessage(notification.address);
+      if (notification.type == 'f') {
+        for (uint8_t i = 0; i < notification.count; i++) {
+          packet << notification.floats[i];
+        }
+      } else if (notification.type == 'i') {
+        packet << int(notification.intValue);
+      } else {
+        packet << notification.stringValue;
+      }
+      packet.endMessage();
+      packetSize += size;
+    }
+    packet.endBundle();
+    if (packetSize > bundleHeaderSize) {
+      for (osc::Send *sender : senders) {
+        sender->send(packet);
+      }
+    }
+  };
+
+  std::unique_lock<std::mutex> lk(mListenerLock);
+  if (mStreamSenders.size() == 0) {
+    sendBundles(mOSCSenders, false);
+  } else {
+    std::vector<osc::Send *> oscSenders;
+    for (osc::Send *sender : mOSCSenders) {
+      if (!isStreamListener(sender)) {
+        oscSenders.push_back(sender);
+      }
+    }
+    sendBundles(oscSenders, false);
+    sendBundles(mStreamSenders, true);
+  }
+  mFlushing.clear();
+}
+
+OSCNotifier::PendingNotification &OSCNotifier::pendingNotification(
+    const std::string &address) {
+  auto index = mPendingIndex.find(address);
+  if (index != mPendingIndex.end()) {
+    return mPending[index->second];
+  }
+  mPendingIndex[address] = mPending.size();
+  mPending.emplace_back();
+  mPending.back().address = address;
+  return mPending.back();
+}
+
+bool OSCNotifier::queueFloats(const std::string &address, const float *values,
+                              uint8_t count, bool streamed) {
+  if (mNotificationRate <= 0.0f) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lk(mPendingLock);
+  PendingNotification &pending = pendingNotification(address);
+  pending.type = 'f';
+  pending.streamed = streamed;
+  pending.count = count;
+  std::copy(values, values + count, pending.floats);
+  return true;
+}
+
+void OSCNotifier::flushThread() {
+  std::unique_lock<std::mutex> lk(mPendingLock);
+  while (mFlushRunning) {
+    mFlushCondition.wait_for(
+        lk, std::chrono::duration<double>(1.0 / mNotificationRate));
+    lk.unlock();
+    flushNotifications();
+    lk.lock();
+  }
+}
+
+void OSCNotifier::stopFlushThread() {
+  {
+    std::unique_lock<std::mutex> lk(mPendingLock);
+    mFlushRunning = false;
+  }
+  mFlushCondition.notify_all();
+  if (mFlushThread) {
+    mFlushThread->join();
+    mFlushThread = nullptr;
+  }
+}
+
+osc::Send *OSCNotifier::findListener(const std::string &IPaddress,
+                                     uint16_t oscPort) {
+  for (osc::Send *sender : mOSCSenders) {
+    if (sender->address() == IPaddress && sender->port() == oscPort) {
+      return sender;
+    }
+  }
+  return nullptr;
+}
+
+bool OSCNotifier::isStreamListener(osc::Send *sender) {
+  return std::find(mStreamSenders.begin(), mStreamSenders.end(), sender) !=
+         mStreamSenders.end();
+}
+
+// Binary parameter stream ----------------------------------------------------
+
+// OSC message overhead around a frame: address, type tags and blob size
+static const size_t streamFrameOverhead = 20;
+
+void OSCNotifier::sendStreamKeyFrame(uint32_t session) {
+  std::unique_lock<std::mutex> streamLock(mStreamLock);
+  if (session != mStream.session()) {
+    return;
+  }
+  mStream.keyFrame();
+  sendStreamFrames();
+}
+
+void OSCNotifier::addStreamListener(std::string IPaddress, uint16_t oscPort) {
+  addListener(IPaddress, oscPort);
+  std::unique_lock<std::mutex> streamLock(mStreamLock);
+  osc::Send *sender;
+  {
+    std::unique_lock<std::mutex> lk(mListenerLock);
+    sender = findListener(IPaddress, oscPort);
+    if (!sender) {
+      return;
+    }
+    if (!isStreamListener(sender)) {
+      mStreamSenders.push_back(sender);
+    }
+  }
+  sendStreamParameters(sender, 0);
+  mStream.resynchronize();
+  mStreaming = true;
+}
+
+uint32_t OSCNotifier::addStreamParameter(const ParameterStreamEntry &entry) {
+  std::unique_lock<std::mutex> streamLock(mStreamLock);
+  auto existing = mStreamIds.find(entry.address);
+  if (existing != mStreamIds.end()) {
+    return existing->second;
+  }
+  uint32_t id = mStream.addParameter(entry);
+  mStreamIds[entry.address] = id;
+  std::unique_lock<std::mutex> lk(mListenerLock);
+  for (osc::Send *sender : mStreamSenders) {
+    sendStreamParameters(sender, id);
+  }
+  return id;
+}
+
+void OSCNotifier::setStreamQuantization(const std::string &address,
+                                        float step) {
+  std::unique_lock<std::mutex> streamLock(mStreamLock);
+  auto id = mStreamIds.find(address);
+  if (id == mStreamIds.end()) {
+    std::cerr << "ERROR: " << address << " is not in the parameter stream"
+              << std::endl;
+    return;
+  }
+  sendStreamFrames();
+  mStream.setStep(id->second, step);
+  // Listeners that miss the new description would decode values with the
+  // previous step. Frames of the new session are ignored until they have it,
+  // and request it when it was lost
+  mStream.newSession();
+  {
+    std::unique_lock<std::mutex> lk(mListenerLock);
+    for (osc::Send *sender : mStreamSenders) {
+      sendStreamParameters(sender, 0);
+    }
+  }
+  sendStreamFrames();
+}
+
+bool OSCNotifier::streamValues(const std::string &address,
+                               const float *values) {
+  if (!mStreaming) {
+    return false;
+  }
+  std::unique_lock<std::mutex> streamLock(mStreamLock);
+  auto id = mStreamIds.find(address);
+  if (id == mStreamIds.end() ||
+      mStream.parameter(id->second).type != ParameterStreamEntry::FLOAT) {
+    return false;
+  }
+  mStream.setValue(id->second, values);
+  if (mNotificationRate <= 0.0f) {
+    sendStreamFrames();
+  }
+  return true;
+}
+
+bool OSCNotifier::streamValues(const std::string &address, int32_t value) {
+  if (!mStreaming) {
+    return false;
+  }
+  std::unique_lock<std::mutex> streamLock(mStreamLock);
+  auto id = mStreamIds.find(address);
+  if (id == mStreamIds.end() ||
+      mStream.parameter(id->second).type != ParameterStreamEntry::INT) {
+    return false;
+  }
+  mStream.setValue(id->second, &value);
+  if (mNotificationRate <= 0.0f) {
+    sendStreamFrames();
+  }
+  return true;
+}
+
+void OSCNotifier::sendStreamFrames() {
+  if (!mStream.pending()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lk(mListenerLock);
+  osc::Packet packet(static_cast<int>(mMaxPacketSize));
+  mStream.encode(mMaxPacketSize - streamFrameOverhead,
+                 [&](const char *frame, size_t size) {
+                   packet.clear();
+                   packet.beginMessage("/al/stream");
+                   packet << osc::Blob(frame, size);
+                   packet.endMessage();
+                   for (osc::Send *sender : mStreamSenders) {
+                     sender->send(packet);
+                   }
+                 });
+}
+
+void OSCNotifier::sendStreamParameters(osc::Send *sender, uint32_t firstId) {
+  // Size, address, type tags, five numbers and the parameter address
+  auto messageSize = [](const ParameterStreamEntry &entry) {
+    return 4 + 20 + 8 + 20 + oscStringSize(entry.address.size());
+  };
+  size_t largest = 0;
+  for (uint32_t id = firstId; id < mStream.parameterCount(); id++) {
+    largest = std::max(largest, messageSize(mStream.parameter(id)));
+  }
+  // Messages are sent in bundles, as there can be thousands of them
+  osc::Packet packet(int(std::max(mMaxPacketSize, 16 + largest)));
+  size_t packetSize = 16;
+  packet.beginBundle();
+  for (uint32_t id = firstId; id < mStream.parameterCount(); id++) {
+    const ParameterStreamEntry &entry = mStream.parameter(id);
+    size_t size = messageSize(entry);
+    if (packetSize + size > mMaxPacketSize && packetSize > 16) {
+      packet.endBundle();
+      sender->send(packet);
+      packet.clear();
+      packet.beginBundle();
+      packetSize = 16;
+    }
+    packet.beginMessage("/al/streamParameter");
+    packet << int(mStream.session()) << int(id) << entry.address
+           << int(entry.type) << int(entry.components) << entry.step;
+    packet.endMessage();
+    packetSize += size;
+  }
+  packet.endBundle();
+  if (packetSize > 16) {
+    sender->send(packet);
+  }
+}
+
 // ParameterServer ------------------------------------------------------------
 
+// Setters for the address index. The parameter type is resolved once when the
+// index is built, so these can cast without checking
+
+static bool setFloatParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "f") != 0) {
+    return false;
+  }
+  float val;
+  m >> val;
+  static_cast<Parameter *>(param)->set(val);
+  return true;
+}
+
+static bool setBoolParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "f") != 0) {
+    return false;
+  }
+  float val;
+  m >> val;
+  static_cast<ParameterBool *>(param)->set(val);
+  return true;
+}
+
+static bool setIntParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "i") != 0) {
+    return false;
+  }
+  int32_t val;
+  m >> val;
+  static_cast<ParameterInt *>(param)->set(val);
+  return true;
+}
+
+static bool setStringParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "s") != 0) {
+    return false;
+  }
+  std::string val;
+  m >> val;
+  static_cast<ParameterString *>(param)->set(val);
+  return true;
+}
+
+static bool setMenuParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "i") != 0) {
+    return false;
+  }
+  int val;
+  m >> val;
+  static_cast<ParameterMenu *>(param)->set(val);
+  return true;
+}
+
+static bool setChoiceParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "i") != 0) {
+    return false;
+  }
+  int val;
+  m >> val;
+  static_cast<ParameterChoice *>(param)->set(val);
+  return true;
+}
+
+static bool setVec3Parameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "fff") != 0) {
+    return false;
+  }
+  float x, y, z;
+  m >> x >> y >> z;
+  static_cast<ParameterVec3 *>(param)->set(Vec3f(x, y, z));
+  return true;
+}
+
+static bool setVec4Parameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "ffff") != 0) {
+    return false;
+  }
+  float a, b, c, d;
+  m >> a >> b >> c >> d;
+  static_cast<ParameterVec4 *>(param)->set(Vec4f(a, b, c, d));
+  return true;
+}
+
+static bool setColorParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "ffff") != 0) {
+    return false;
+  }
+  float a, b, c, d;
+  m >> a >> b >> c >> d;
+  static_cast<ParameterColor *>(param)->set(Color(a, b, c, d));
+  return true;
+}
+
+static bool setPoseParameter(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "fffffff") != 0) {
+    return false;
+  }
+  float x, y, z, w, qx, qy, qz;
+  m >> x >> y >> z >> w >> qx >> qy >> qz;
+  static_cast<ParameterPose *>(param)->set(
+      Pose(Vec3d(x, y, z), Quatd(w, qx, qy, qz)));
+  return true;
+}
+
+static bool setPosePosition(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "fff") != 0) {
+    return false;
+  }
+  float x, y, z;
+  m >> x >> y >> z;
+  ParameterPose *p = static_cast<ParameterPose *>(param);
+  Pose currentPose = p->get();
+  currentPose.pos() = Vec3d(x, y, z);
+  p->set(currentPose);
+  return true;
+}
+
+template <int component>
+static bool setPosePositionComponent(ParameterMeta *param, osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "f") != 0) {
+    return false;
+  }
+  float val;
+  m >> val;
+  ParameterPose *p = static_cast<ParameterPose *>(param);
+  Pose currentPose = p->get();
+  currentPose.pos()[component] = val;
+  p->set(currentPose);
+  return true;
+}
+
+static bool setTrigger(ParameterMeta *param, osc::Message &m) {
+  if (m.typeTagsSize() == 0) {
+    static_cast<Trigger *>(param)->trigger();
+    return true;
+  } else if (strcmp(m.typeTagsData(), "f") == 0) {
+    float val;
+    m >> val;
+    if (val == 1.0) {
+      static_cast<Trigger *>(param)->trigger();
+    }
+    return true;
+  }
+  return false;
+}
+
+// Setters for values received in the binary parameter stream. Components
+// match the ParameterStreamEntry the sender registered for each type
+
+static void streamFloatParameter(ParameterMeta *param, const double *values) {
+  static_cast<Parameter *>(param)->set(float(values[0]));
+}
+
+static void streamIntParameter(ParameterMeta *param, const double *values) {
+  static_cast<ParameterInt *>(param)->set(int32_t(values[0]));
+}
+
+static void streamMenuParameter(ParameterMeta *param, const double *values) {
+  static_cast<ParameterMenu *>(param)->set(int(values[0]));
+}
+
+static void streamChoiceParameter(ParameterMeta *param, const double *values) {
+  static_cast<ParameterChoice *>(param)->set(uint16_t(values[0]));
+}
+
+static void streamVec3Parameter(ParameterMeta *param, const double *values) {
+  static_cast<ParameterVec3 *>(param)->set(
+      Vec3f(float(values[0]), float(values[1]), float(values[2])));
+}
+
+static void streamVec4Parameter(ParameterMeta *param, const double *values) {
+  static_cast<ParameterVec4 *>(param)->set(Vec4f(
+      float(values[0]), float(values[1]), float(values[2]), float(values[3])));
+}
+
+static void streamColorParameter(ParameterMeta *param, const double *values) {
+  static_cast<ParameterColor *>(param)->set(Color(
+      float(values[0]), float(values[1]), float(values[2]), float(values[3])));
+}
+
+static void streamPoseParameter(ParameterMeta *param, const double *values) {
+  static_cast<ParameterPose *>(param)->set(
+      Pose(Vec3d(values[0], values[1], values[2]),
+           Quatd(values[3], values[4], values[5], values[6])));
+}
+
 ParameterServer::ParameterServer(std::string oscAddress, int oscPort,
                                  bool autoStart)
     : mServer(nullptr) {
@@ -193,11 +792,16 @@ bool ParameterServer::listen(int oscPort, std::string oscAddress) {
 ParameterServer &ParameterServer::registerParameter(ParameterMeta &param) {
   mParameterLock.lock();
   mParameters.push_back(&param);
+  mAddressIndexDirty = true;
   mParameterLock.unlock();
+  ParameterStreamEntry streamEntry;
+  streamEntry.address = param.getFullAddress();
+  streamEntry.components = 0;  // Not streamed
   mListenerLock.lock();
   if (strcmp(typeid(param).name(), typeid(ParameterBool).name()) ==
       0) {  // ParameterBool
     ParameterBool *p = dynamic_cast<ParameterBool *>(&param);
+    streamEntry.components = 1;
     p->registerChangeCallback([this, p](float value) {
       notifyListeners(p->getFullAddress(), value);
     });
@@ -206,6 +810,7 @@ ParameterServer &ParameterServer::registerParameter(ParameterMeta &param) {
     //        std::cout << "Register parameter " << param.getName() <<
     //        std::endl;
     Parameter *p = dynamic_cast<Parameter *>(&param);
+    streamEntry.components = 1;
     p->registerChangeCallback([this, p](float value) {
       notifyListeners(p->getFullAddress(), value);
     });
@@ -214,29 +819,37 @@ ParameterServer &ParameterServer::registerParameter(ParameterMeta &param) {
     //        std::cout << "Register parameter " << param.getName() <<
     //        std::endl;
     ParameterInt *p = dynamic_cast<ParameterInt *>(&param);
+    streamEntry.type = ParameterStreamEntry::INT;
+    streamEntry.components = 1;
     p->registerChangeCallback([this, p](int32_t value) {
       notifyListeners(p->getFullAddress(), value);
     });
   } else if (strcmp(typeid(param).name(), typeid(ParameterPose).name()) ==
              0) {  // ParameterPose
     ParameterPose *p = dynamic_cast<ParameterPose *>(&param);
+    streamEntry.components = 7;
     p->registerChangeCallback([this, p](al::Pose value) {
       notifyListeners(p->getFullAddress(), value);
     });
   } else if (strcmp(typeid(param).name(), typeid(ParameterMenu).name()) ==
              0) {  // ParameterMenu
     ParameterMenu *p = dynamic_cast<ParameterMenu *>(&param);
+    streamEntry.type = ParameterStreamEntry::INT;
+    streamEntry.components = 1;
     p->registerChangeCallback(
         [this, p](int value) { notifyListeners(p->getFullAddress(), value); });
   } else if (strcmp(typeid(param).name(), typeid(ParameterChoice).name()) ==
              0) {  // ParameterChoice
     ParameterChoice *p = dynamic_cast<ParameterChoice *>(&param);
+    streamEntry.type = ParameterStreamEntry::INT;
+    streamEntry.components = 1;
     p->registerChangeCallback([this, p](uint16_t value) {
       notifyListeners(p->getFullAddress(), (int)value);
     });
   } else if (strcmp(typeid(param).name(), typeid(ParameterVec3).name()) ==
              0) {  // ParameterVec3
     ParameterVec3 *p = dynamic_cast<ParameterVec3 *>(&param);
+    streamEntry.components = 3;
 
     p->registerChangeCallback([this, p](al::Vec3f value) {
       notifyListeners(p->getFullAddress(), value);
@@ -244,12 +857,14 @@ ParameterServer &ParameterServer::registerParameter(ParameterMeta &param) {
   } else if (strcmp(typeid(param).name(), typeid(ParameterVec4).name()) ==
              0) {  // ParameterVec4
     ParameterVec4 *p = dynamic_cast<ParameterVec4 *>(&param);
+    streamEntry.components = 4;
     p->registerChangeCallback([this, p](al::Vec4f value) {
       notifyListeners(p->getFullAddress(), value);
     });
   } else if (strcmp(typeid(param).name(), typeid(ParameterColor).name()) ==
              0) {  // ParameterColor
     ParameterColor *p = dynamic_cast<ParameterColor *>(&param);
+    streamEntry.components = 4;
 
     p->registerChangeCallback([this, p](Color value) {
       Vec4f valueVec(value.r, value.g, value.b, value.a);
@@ -267,29 +882,32 @@ ParameterServer &ParameterServer::registerParameter(ParameterMeta &param) {
   }
 
   mListenerLock.unlock();
+  if (streamEntry.components > 0) {
+    addStreamParameter(streamEntry);
+  }
   return *this;
 }
 
 ParameterServer &ParameterServer::registerParameterBundle(
     ParameterBundle &bundle) {
+  std::unique_lock<std::mutex> lk(mParameterLock);
   if (mCurrentActiveBundle.find(bundle.name()) == mCurrentActiveBundle.end()) {
     mParameterBundles[bundle.name()] = std::vector<ParameterBundle *>();
     mCurrentActiveBundle[bundle.name()] = 0;
   }
   mParameterBundles[bundle.name()].push_back(&bundle);
   bundle.addNotifier(this);
+  mAddressIndexDirty = true;
 
   return *this;
 }
 
 void ParameterServer::unregisterParameter(ParameterMeta &param) {
   std::unique_lock<std::mutex> lk(mParameterLock);
-  auto it = mParameters.begin();
-  for (it = mParameters.begin(); it != mParameters.end(); it++) {
-    if (*it == &param) {
-      mParameters.erase(it);
-    }
-  }
+  mParameters.erase(
+      std::remove(mParameters.begin(), mParameters.end(), &param),
+      mParameters.end());
+  mAddressIndexDirty = true;
 }
 
 void ParameterServer::onMessage(osc::Message &m) {
@@ -297,8 +915,7 @@ void ParameterServer::onMessage(osc::Message &m) {
   if (mVerbose) {
     m.print();
   }
-  std::string requestAddress = "/sendAllParameters";
-  if (m.addressPattern() == requestAddress) {
+  if (strcmp(m.addressPatternData(), "/sendAllParameters") == 0) {
     if (m.typeTags() == "si") {
       std::string address;
       int port;
@@ -315,14 +932,30 @@ void ParameterServer::onMessage(osc::Message &m) {
     return;
   }
   mParameterLock.lock();
-  for (ParameterMeta *param : mParameters) {
-    if (setParameterValueFromMessage(param, m.addressPattern(), m)) {
-      m.resetStream();
+  if (mAddressIndexDirty ||
+      mIndexedBundleVersion != ParameterBundle::structureVersion()) {
+    rebuildAddressIndex();
+  }
+  if (strncmp(m.addressPatternData(), "/al/stream", 10) == 0) {
+    if (m.addressPatternSize() == 10) {
+      onStreamFrame(m);
+      mParameterLock.unlock();
+      return;
+    } else if (strcmp(m.addressPatternData() + 10, "Parameter") == 0) {
+      onStreamParameter(m);
+      mParameterLock.unlock();
+      return;
     }
   }
-  for (auto &bundleGroup : mParameterBundles) {
-    auto oscAddress = m.addressPattern();
-    setValuesForBundleGroup(m, bundleGroup.second, oscAddress);
+  // Reuse the key's storage so lookups don't allocate
+  mLookupAddress.assign(m.addressPatternData(), m.addressPatternSize());
+  auto handlers = mAddressIndex.find(mLookupAddress);
+  if (handlers != mAddressIndex.end()) {
+    for (AddressHandler &handler : handlers->second) {
+      if (handler.setter(handler.parameter, m)) {
+        m.resetStream();
+      }
+    }
   }
   for (osc::PacketHandler *handler : mPacketHandlers) {
     m.resetStream();
@@ -391,6 +1024,11 @@ std::vector<Parameter *> ParameterServer::parameters() {
   return params;
 }
 
+std::vector<ParameterMeta *> ParameterServer::allParameters() {
+  std::unique_lock<std::mutex> lk(mParameterLock);
+  return mParameters;
+}
+
 std::vector<ParameterString *> ParameterServer::stringParameters() {
   std::vector<ParameterString *> params;
   for (auto *p : mParameters) {
@@ -722,3 +1360,213 @@ void ParameterServer::setValuesForBundleGroup(
     }
   }
 }
+
+void ParameterServer::indexParameter(ParameterMeta *param,
+                                     const std::string &prefix) {
+  std::string address = prefix + param->getFullAddress();
+  const std::type_info &type = typeid(*param);
+  if (type == typeid(Parameter)) {
+    mAddressIndex[address].push_back(
+        {param, setFloatParameter, streamFloatParameter});
+  } else if (type == typeid(ParameterBool)) {
+    mAddressIndex[address].push_back(
+        {param, setBoolParameter, streamFloatParameter});
+  } else if (type == typeid(ParameterInt)) {
+    mAddressIndex[address].push_back(
+        {param, setIntParameter, streamIntParameter});
+  } else if (type == typeid(ParameterString)) {
+    mAddressIndex[address].push_back({param, setStringParameter, nullptr});
+  } else if (type == typeid(ParameterMenu)) {
+    mAddressIndex[address].push_back(
+        {param, setMenuParameter, streamMenuParameter});
+  } else if (type == typeid(ParameterChoice)) {
+    mAddressIndex[address].push_back(
+        {param, setChoiceParameter, streamChoiceParameter});
+  } else if (type == typeid(ParameterVec3)) {
+    mAddressIndex[address].push_back(
+        {param, setVec3Parameter, streamVec3Parameter});
+  } else if (type == typeid(ParameterVec4)) {
+    mAddressIndex[address].push_back(
+        {param, setVec4Parameter, streamVec4Parameter});
+  } else if (type == typeid(ParameterColor)) {
+    mAddressIndex[address].push_back(
+        {param, setColorParameter, streamColorParameter});
+  } else if (type == typeid(ParameterPose)) {
+    mAddressIndex[address].push_back(
+        {param, setPoseParameter, streamPoseParameter});
+    mAddressIndex[address + "/pos"].push_back(
+        {param, setPosePosition, nullptr});
+    mAddressIndex[address + "/pos/x"].push_back(
+        {param, setPosePositionComponent<0>, nullptr});
+    mAddressIndex[address + "/pos/y"].push_back(
+        {param, setPosePositionComponent<1>, nullptr});
+    mAddressIndex[address + "/pos/z"].push_back(
+        {param, setPosePositionComponent<2>, nullptr});
+  } else if (type == typeid(Trigger)) {
+    mAddressIndex[address].push_back({param, setTrigger, nullptr});
+  } else {
+    std::cout << "Unsupported registered Parameter on message "
+              << type.name() << std::endl;
+  }
+}
+
+void ParameterServer::indexBundle(ParameterBundle *bundle) {
+  std::string bundlePrefix = bundle->bundlePrefix();
+  for (ParameterMeta *p : bundle->parameters()) {
+    indexParameter(p, bundlePrefix);
+  }
+  for (auto &subBundleGroup : bundle->bundles()) {
+    for (ParameterBundle *subBundle : subBundleGroup.second) {
+      indexBundle(subBundle);
+    }
+  }
+}
+
+void ParameterServer::rebuildAddressIndex() {
+  // Read the version first, so changes made while indexing trigger a rebuild
+  mIndexedBundleVersion = ParameterBundle::structureVersion();
+  mAddressIndex.clear();
+  for (ParameterMeta *param : mParameters) {
+    indexParameter(param, "");
+  }
+  for (auto &bundleGroup : mParameterBundles) {
+    for (ParameterBundle *bundle : bundleGroup.second) {
+      indexBundle(bundle);
+    }
+  }
+  mAddressIndexDirty = false;
+  mAddressIndexVersion++;
+}
+
+// Stream sessions without parameters or frames for this long are dropped
+static const std::chrono::seconds streamSessionTimeout(30);
+
+void ParameterServer::onStreamParameter(osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "iisiif") != 0) {
+    return;
+  }
+  int session, id, type, components;
+  ParameterStreamEntry entry;
+  m >> session >> id >> entry.address >> type >> components >> entry.step;
+  if (id < 0 || components < 1 ||
+      components > ParameterStreamEntry::MAX_COMPONENTS ||
+      (type != ParameterStreamEntry::FLOAT &&
+       type != ParameterStreamEntry::INT)) {
+    return;
+  }
+  entry.type = uint8_t(type);
+  entry.components = uint8_t(components);
+  if (mStreamSessions.find(uint32_t(session)) == mStreamSessions.end()) {
+    expireStreamSessions();
+  }
+  StreamSession &streamSession = mStreamSessions[uint32_t(session)];
+  streamSession.decoder.setParameter(uint32_t(id), entry);
+  streamSession.addressIndexVersion = 0;
+  streamSession.lastActivity = std::chrono::steady_clock::now();
+}
+
+void ParameterServer::onStreamFrame(osc::Message &m) {
+  if (strcmp(m.typeTagsData(), "b") != 0) {
+    return;
+  }
+  osc::Blob frame;
+  m >> frame;
+  uint32_t session;
+  if (!ParameterStreamDecoder::frameSession(
+          static_cast<const char *>(frame.data), frame.size, session)) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  if (now - mLastStreamExpiry >= std::chrono::seconds(1)) {
+    mLastStreamExpiry = now;
+    expireStreamSessions();
+  }
+  auto found = mStreamSessions.find(session);
+  if (found == mStreamSessions.end()) {
+    // The server restarted, or this server missed its parameters. Frames
+    // can't be decoded without them, and don't create sessions, so unknown
+    // or forged sessions can't grow the session table
+    requestStreamParameters(mLastUnknownStreamRequest, m.senderAddress());
+    return;
+  }
+  StreamSession &streamSession = found->second;
+  streamSession.lastActivity = now;
+  if (streamSession.addressIndexVersion != mAddressIndexVersion) {
+    // Resolve the ids to this server's parameters once
+    streamSession.handlers.assign(streamSession.decoder.parameterCount(),
+                                  nullptr);
+    for (uint32_t id = 0; id < streamSession.handlers.size(); id++) {
+      const ParameterStreamEntry *entry = streamSession.decoder.parameter(id);
+      if (entry) {
+        auto handlers = mAddressIndex.find(entry->address);
+        if (handlers != mAddressIndex.end()) {
+          streamSession.handlers[id] = &handlers->second;
+        }
+      }
+    }
+    streamSession.addressIndexVersion = mAddressIndexVersion;
+  }
+  bool decoded = streamSession.decoder.decode(
+      static_cast<const char *>(frame.data), frame.size,
+      [&](uint32_t id, const double *values) {
+        if (id >= streamSession.handlers.size() ||
+            !streamSession.handlers[id]) {
+          return;
+        }
+        for (const AddressHandler &handler : *streamSession.handlers[id]) {
+          if (handler.streamSetter) {
+            handler.streamSetter(handler.parameter, values);
+          }
+        }
+      });
+  if (!decoded) {
+    requestStreamParameters(streamSession.lastTableRequest,
+                            m.senderAddress());
+  } else if (streamSession.decoder.lostFrames() != streamSession.lostFrames) {
+    requestStreamKeyFrame(streamSession, session, m.senderAddress());
+  }
+}
+
+void ParameterServer::requestStreamParameters(
+    std::chrono::steady_clock::time_point &lastRequest,
+    const std::string &serverAddress) {
+  // Parameter descriptions were lost or the server restarted. Register again
+  // to receive them, at most once a second
+  auto now = std::chrono::steady_clock::now();
+  if (now - lastRequest < std::chrono::seconds(1) || !mServer) {
+    return;
+  }
+  lastRequest = now;
+  osc::Send request(handshakeServerPort, serverAddress.c_str());
+  request.send("/registerStreamListener", mServer->port(),
+               parameterStreamVersion);
+}
+
+void ParameterServer::requestStreamKeyFrame(StreamSession &session,
+                                            uint32_t sessionId,
+                                            const std::string &serverAddress) {
+  // Relative values are skipped until their parameters are sent absolute.
+  // Ask for all of them instead of waiting for the periodic absolute values.
+  // Requests are sent at most every 100 ms. Losses in between are requested
+  // on a later frame
+  auto now = std::chrono::steady_clock::now();
+  if (now - session.lastKeyFrameRequest < std::chrono::milliseconds(100)) {
+    return;
+  }
+  session.lastKeyFrameRequest = now;
+  session.lostFrames = session.decoder.lostFrames();
+  osc::Send request(handshakeServerPort, serverAddress.c_str());
+  request.send("/requestStreamKeyFrame", int(sessionId));
+}
+
+void ParameterServer::expireStreamSessions() {
+  auto now = std::chrono::steady_clock::now();
+  for (auto session = mStreamSessions.begin();
+       session != mStreamSessions.end();) {
+    if (now - session->second.lastActivity > streamSessionTimeout) {
+      session = mStreamSessions.erase(session);
+    } else {
+      session++;
+    }
+  }
+}
@@ -0,0 +1,301 @@
+#include "al/ui/al_ParameterStream.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace al;
+
+// Frame primitives ------------------------------------------------------------
+
+static void writeUInt32(std::vector<char> &frame, uint32_t value) {
+  frame.push_back(char(value >> 24));
+  frame.push_back(char(value >> 16));
+  frame.push_back(char(value >> 8));
+  frame.push_back(char(value));
+}
+
+static bool readUInt32(const char *&data, const char *end, uint32_t &value) {
+  if (end - data < 4) {
+    return false;
+  }
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  value = (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) |
+          (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+  data += 4;
+  return true;
+}
+
+static void writeVarint(std::vector<char> &frame, uint64_t value) {
+  while (value >= 0x80) {
+    frame.push_back(char((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  frame.push_back(char(value));
+}
+
+static bool readVarint(const char *&data, const char *end, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && data < end; shift += 7) {
+    uint8_t byte = uint8_t(*data++);
+    value |= uint64_t(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Maps signed values to unsigned so small magnitudes make short varints
+static uint64_t zigzag(int64_t value) {
+  return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+  return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+static int64_t quantize(float value, float step) {
+  if (!std::isfinite(value)) {
+    return 0;
+  }
+  return std::llround(double(value) / step);
+}
+
+// Largest encoded size of an entry: id varint and 64 bit varints
+static const size_t MAX_ENTRY_SIZE =
+    5 + 10 * ParameterStreamEntry::MAX_COMPONENTS;
+
+// ParameterStreamEncoder -----------------------------------------------------
+
+ParameterStreamEncoder::ParameterStreamEncoder() {
+  std::random_device random;
+  mSession = random();
+}
+
+uint32_t ParameterStreamEncoder::addParameter(
+    const ParameterStreamEntry &entry) {
+  mParameters.emplace_back();
+  ParameterState &state = mParameters.back();
+  state.entry = entry;
+  state.entry.components =
+      std::min(entry.components, uint8_t(ParameterStreamEntry::MAX_COMPONENTS));
+  if (state.entry.type == ParameterStreamEntry::INT) {
+    state.entry.step = 0.0f;
+  }
+  return uint32_t(mParameters.size() - 1);
+}
+
+void ParameterStreamEncoder::setStep(uint32_t id, float step) {
+  if (id >= mParameters.size() ||
+      mParameters[id].entry.type != ParameterStreamEntry::FLOAT) {
+    return;
+  }
+  ParameterState &state = mParameters[id];
+  state.entry.step = std::max(0.0f, step);
+  state.hasSent = false;
+  if (state.entry.step > 0.0f) {
+    for (uint8_t i = 0; i < state.entry.components; i++) {
+      state.values[i] = quantize(state.floats[i], state.entry.step);
+    }
+  }
+}
+
+void ParameterStreamEncoder::setValue(uint32_t id, const float *values) {
+  ParameterState &state = mParameters[id];
+  for (uint8_t i = 0; i < state.entry.components; i++) {
+    state.floats[i] = values[i];
+    if (state.entry.step > 0.0f) {
+      state.values[i] = quantize(values[i], state.entry.step);
+    }
+  }
+  state.hasValue = true;
+  markPending(state, id);
+}
+
+void ParameterStreamEncoder::setValue(uint32_t id, const int32_t *values) {
+  ParameterState &state = mParameters[id];
+  for (uint8_t i = 0; i < state.entry.components; i++) {
+    state.values[i] = values[i];
+  }
+  state.hasValue = true;
+  markPending(state, id);
+}
+
+void ParameterStreamEncoder::markPending(ParameterState &state, uint32_t id) {
+  if (!state.pending) {
+    state.pending = true;
+    mPendingIds.push_back(id);
+  }
+}
+
+void ParameterStreamEncoder::resynchronize() {
+  for (auto &state : mParameters) {
+    state.hasSent = false;
+  }
+}
+
+void ParameterStreamEncoder::keyFrame() {
+  for (uint32_t id = 0; id < mParameters.size(); id++) {
+    ParameterState &state = mParameters[id];
+    if (state.hasValue) {
+      state.hasSent = false;
+      markPending(state, id);
+    }
+  }
+}
+
+void ParameterStreamEncoder::newSession() {
+  std::random_device random;
+  uint32_t session = random();
+  while (session == mSession) {
+    session = random();
+  }
+  mSession = session;
+  mSequence = 0;
+  keyFrame();
+}
+
+void ParameterStreamEncoder::encode(
+    size_t maxFrameSize,
+    const std::function<void(const char *, size_t)> &frameFunction) {
+  if (mPendingIds.size() == 0) {
+    return;
+  }
+  maxFrameSize = std::max(maxFrameSize, HEADER_SIZE + MAX_ENTRY_SIZE);
+  std::sort(mPendingIds.begin(), mPendingIds.end());
+  int64_t previousId = -1;
+  mFrame.clear();
+  for (uint32_t id : mPendingIds) {
+    if (mFrame.size() + MAX_ENTRY_SIZE > maxFrameSize) {
+      frameFunction(mFrame.data(), mFrame.size());
+      mFrame.clear();
+    }
+    if (mFrame.size() == 0) {
+      mSequence++;
+      writeUInt32(mFrame, mSession);
+      writeUInt32(mFrame, mSequence);
+      previousId = -1;
+    }
+    ParameterState &state = mParameters[id];
+    bool absolute = !state.hasSent ||
+                    mSequence - state.absoluteSequence >= ABSOLUTE_INTERVAL;
+    writeVarint(mFrame, (uint64_t(id - previousId - 1) << 1) | absolute);
+    previousId = id;
+    for (uint8_t i = 0; i < state.entry.components; i++) {
+      if (state.entry.type == ParameterStreamEntry::FLOAT &&
+          state.entry.step == 0.0f) {
+        uint32_t bits;
+        std::memcpy(&bits, &state.floats[i], sizeof(bits));
+        writeUInt32(mFrame, bits);
+      } else {
+        int64_t base = absolute ? 0 : state.sent[i];
+        writeVarint(mFrame, zigzag(state.values[i] - base));
+        state.sent[i] = state.values[i];
+      }
+    }
+    if (absolute) {
+      state.absoluteSequence = mSequence;
+      state.hasSent = true;
+    }
+    state.pending = false;
+  }
+  frameFunction(mFrame.data(), mFrame.size());
+  mPendingIds.clear();
+}
+
+// ParameterStreamDecoder -----------------------------------------------------
+
+void ParameterStreamDecoder::setParameter(uint32_t id,
+                                          const ParameterStreamEntry &entry) {
+  if (id >= mParameters.size()) {
+    mParameters.resize(id + 1);
+  }
+  ParameterState &state = mParameters[id];
+  state.entry = entry;
+  state.entry.components =
+      std::min(entry.components, uint8_t(ParameterStreamEntry::MAX_COMPONENTS));
+  state.known = true;
+  state.hasBase = false;
+}
+
+const ParameterStreamEntry *ParameterStreamDecoder::parameter(
+    uint32_t id) const {
+  if (id >= mParameters.size() || !mParameters[id].known) {
+    return nullptr;
+  }
+  return &mParameters[id].entry;
+}
+
+bool ParameterStreamDecoder::frameSession(const char *frame, size_t size,
+                                          uint32_t &session) {
+  return readUInt32(frame, frame + size, session);
+}
+
+bool ParameterStreamDecoder::decode(
+    const char *frame, size_t size,
+    const std::function<void(uint32_t, const double *)> &valueFunction) {
+  const char *data = frame;
+  const char *end = frame + size;
+  uint32_t session, sequence;
+  if (!readUInt32(data, end, session) || !readUInt32(data, end, sequence)) {
+    return false;
+  }
+  if (mHasSequence && sequence != mLastSequence + 1) {
+    // A frame was lost or reordered, so relative values have no base
+    for (auto &state : mParameters) {
+      state.hasBase = false;
+    }
+    mLostFrames++;
+  }
+  mLastSequence = sequence;
+  mHasSequence = true;
+
+  double values[ParameterStreamEntry::MAX_COMPONENTS];
+  int64_t previousId = -1;
+  while (data < end) {
+    uint64_t header;
+    if (!readVarint(data, end, header)) {
+      return false;
+    }
+    uint64_t id = uint64_t(previousId + 1) + (header >> 1);
+    bool absolute = header & 1;
+    if (id >= mParameters.size() || !mParameters[id].known) {
+      return false;
+    }
+    previousId = int64_t(id);
+    ParameterState &state = mParameters[id];
+    for (uint8_t i = 0; i < state.entry.components; i++) {
+      if (state.entry.type == ParameterStreamEntry::FLOAT &&
+          state.entry.step == 0.0f) {
+        uint32_t bits;
+        if (!readUInt32(data, end, bits)) {
+          return false;
+        }
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        values[i] = value;
+      } else {
+        uint64_t encoded;
+        if (!readVarint(data, end, encoded)) {
+          return false;
+        }
+        int64_t value = unzigzag(encoded);
+        state.values[i] = absolute ? value : state.values[i] + value;
+        values[i] = state.entry.type == ParameterStreamEntry::INT
+                        ? double(state.values[i])
+                        : double(state.values[i]) * state.entry.step;
+      }
+    }
+    bool floats = state.entry.type == ParameterStreamEntry::FLOAT &&
+                  state.entry.step == 0.0f;
+    if (absolute || floats) {
+      state.hasBase = true;
+    }
+    if (state.hasBase) {
+      valueFunction(uint32_t(id), values);
+    }
+  }
+  return true;
+}
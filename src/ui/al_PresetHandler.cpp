@@ -2,6 +2,7 @@
 #include "al/ui/al_PresetHandler.hpp"
 
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -12,6 +13,39 @@
 
 using namespace al;
 
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define AL_PRESET_MORPH_SSE
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define AL_PRESET_MORPH_NEON
+#endif
+
+// out = start + factor * delta, four values at a time where supported
+static void interpolateMorphValues(const float *start, const float *delta,
+                                   float *out, size_t count, float factor) {
+  size_t i = 0;
+#if defined(AL_PRESET_MORPH_SSE)
+  __m128 f = _mm_set1_ps(factor);
+  for (; i + 4 <= count; i += 4) {
+    __m128 value =
+        _mm_add_ps(_mm_loadu_ps(start + i),
+                   _mm_mul_ps(_mm_loadu_ps(delta + i), f));
+    _mm_storeu_ps(out + i, value);
+  }
+#elif defined(AL_PRESET_MORPH_NEON)
+  float32x4_t f = vdupq_n_f32(factor);
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(out + i,
+              vmlaq_f32(vld1q_f32(start + i), vld1q_f32(delta + i), f));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = start[i] + factor * delta[i];
+  }
+}
+
 // PresetHandler --------------------------------------------------------------
 
 PresetHandler::PresetHandler(std::string rootDirectory, bool verbose)
@@ -38,7 +72,10 @@ PresetHandler::PresetHandler(TimeMasterMode timeMasterMode,
   }
 }
 
-PresetHandler::~PresetHandler() { stopCpuThread(); }
+PresetHandler::~PresetHandler() {
+  stopCpuThread();
+  enablePrefetch(false);
+}
 
 void PresetHandler::setSubDirectory(std::string directory) {
   std::string path = getRootPath();
@@ -76,7 +113,9 @@ void PresetHandler::registerPresetMapCallback(PresetMapCallback cb) {
 std::string PresetHandler::buildMapPath(std::string mapName,
                                         bool useSubDirectory) {
   std::string currentPath = File::conformDirectory(getRootPath());
-  if (useSubDirectory) {
+  // Without a sub directory the path is the same either way, so the cache
+  // sees maps read and written with and without useSubDirectory as one file
+  if (useSubDirectory && mSubDir.size() > 0) {
     currentPath += File::conformDirectory(mSubDir);
   }
   if (!(mapName.size() > 4 && mapName.substr(mapName.size() - 4) == ".txt") &&
@@ -259,6 +298,7 @@ void PresetHandler::recallPreset(std::string name) {
     }
   }
   mCurrentPresetName = name;
+  prefetchAdjacent(index);
   if (mUseCallbacks) {
     for (size_t i = 0; i < mCallbacks.size(); ++i) {
       if (mCallbacks[i]) {
@@ -294,40 +334,7 @@ void PresetHandler::morphTo(ParameterStates &parameterStates, float morphTime) {
   {
     std::lock_guard<std::mutex> lk(mTargetLock);
     mMorphTime.set(morphTime);
-    mTargetValues = parameterStates;
-    for (ParameterMeta *param : mParameters) {
-      if (mTargetValues.find(param->getFullAddress()) != mTargetValues.end()) {
-        std::vector<ParameterField> params;
-        param->get(params);
-        mStartValues[param->getFullAddress()] = params;
-      }
-    }
-
-    std::function<void(std::vector<ParameterBundle *>, std::string)>
-        processBundleGroup = [&](std::vector<ParameterBundle *> bundles,
-                                 std::string prefix) {
-          for (unsigned int i = 0; i < bundles.size(); i++) {
-            std::string bundlePrefix = prefix + std::to_string(i);
-            for (auto *param : bundles.at(i)->parameters()) {
-              if (mTargetValues.find(bundlePrefix + param->getFullAddress()) !=
-                  mTargetValues.end()) {
-                mStartValues[bundlePrefix + param->getFullAddress()] =
-                    std::vector<ParameterField>();
-                param->get(
-                    mStartValues[bundlePrefix + param->getFullAddress()]);
-              }
-            }
-            for (auto bundleGroup : bundles.at(i)->bundles()) {
-              prefix += "/" + bundleGroup.first + "/";
-              processBundleGroup({bundleGroup.second}, prefix);
-            }
-          }
-        };
-
-    for (auto bundleGroup : mBundles) {
-      std::string prefix = "/" + bundleGroup.first + "/";
-      processBundleGroup(bundleGroup.second, prefix);
-    }
+    compileMorph(parameterStates);
 
     mMorphStepCount = 0;
     if (mMorphTime.get() <= 0.0) {
@@ -340,6 +347,148 @@ void PresetHandler::morphTo(ParameterStates &parameterStates, float morphTime) {
   mCurrentPresetName = "";
 }
 
+void PresetHandler::compileMorph(ParameterStates &targetValues) {
+  mMorphParameters.clear();
+  mMorphStart.clear();
+  mMorphDelta.clear();
+  mMorphEnd.clear();
+  mMorphPushed.clear();
+  mMorphExpLanes.clear();
+  mMorphFields.clear();
+  mMorphPlanCurve = mMorphCurve;
+
+  auto addresses = parameterAddresses();
+  for (auto &targetValue : targetValues) {
+    auto address = addresses.find(targetValue.first);
+    if (address == addresses.end() || targetValue.second.size() == 0) {
+      continue;
+    }
+    const std::vector<ParameterField> &endFields = targetValue.second;
+    MorphParameter entry;
+    entry.param = address->second;
+    entry.firstValue = uint32_t(mMorphStart.size());
+    entry.numValues = uint32_t(endFields.size());
+    entry.integer = false;
+    entry.forcePush = false;
+
+    mCaptureFields.clear();
+    entry.param->get(mCaptureFields);
+    if (mCaptureFields.size() != endFields.size()) {
+      if (mVerbose) {
+        std::cout << "Unexpected number of values for " << targetValue.first
+                  << std::endl;
+      }
+      entry.forcePush = true;
+    }
+    bool numeric = true;
+    for (size_t i = 0; i < endFields.size(); i++) {
+      float start = 0.0f;
+      float end = 0.0f;
+      bool captured = i < mCaptureFields.size() &&
+                      mCaptureFields[i].type() == endFields[i].type();
+      if (endFields[i].type() == ParameterField::FLOAT) {
+        end = endFields[i].get<float>();
+        start = captured ? mCaptureFields[i].get<float>() : end;
+      } else if (endFields[i].type() == ParameterField::INT32) {
+        end = float(endFields[i].get<int32_t>());
+        start = captured ? float(mCaptureFields[i].get<int32_t>()) : end;
+        entry.integer = true;
+      } else {
+        // Non numeric values are set to the target when the morph starts
+        numeric = false;
+        entry.forcePush = true;
+      }
+      if (!captured) {
+        entry.forcePush = true;
+      }
+      mMorphPushed.push_back(start);
+      mMorphEnd.push_back(end);
+      if (mMorphPlanCurve == MORPH_EXPONENTIAL && start * end > 0.0f) {
+        mMorphExpLanes.push_back(uint32_t(mMorphStart.size()));
+        start = std::log(std::abs(start));
+        end = std::log(std::abs(end));
+      }
+      mMorphStart.push_back(start);
+      mMorphDelta.push_back(end - start);
+    }
+    entry.scalar =
+        numeric && endFields.size() == 1 && mCaptureFields.size() == 1;
+    mMorphParameters.push_back(entry);
+    mMorphFields.push_back(endFields);
+  }
+  mMorphValues.resize(mMorphStart.size());
+}
+
+void PresetHandler::applyMorph(float phase) {
+  size_t count = mMorphStart.size();
+  if (phase >= 1.0f) {
+    std::copy(mMorphEnd.begin(), mMorphEnd.end(), mMorphValues.begin());
+  } else {
+    if (mMorphPlanCurve == MORPH_SMOOTHSTEP) {
+      phase = phase * phase * (3.0f - 2.0f * phase);
+    }
+    interpolateMorphValues(mMorphStart.data(), mMorphDelta.data(),
+                           mMorphValues.data(), count, phase);
+    for (uint32_t lane : mMorphExpLanes) {
+      float value = std::exp(mMorphValues[lane]);
+      mMorphValues[lane] = mMorphEnd[lane] < 0.0f ? -value : value;
+    }
+  }
+
+  // Queue parameters that changed. They are set by pushMorphValues() once
+  // mTargetLock is released
+  mMorphPushes.clear();
+  size_t numFields = 0;
+  for (uint32_t i = 0; i < mMorphParameters.size(); i++) {
+    MorphParameter &entry = mMorphParameters[i];
+    bool changed = entry.forcePush;
+    const float *values = mMorphValues.data() + entry.firstValue;
+    const float *pushed = mMorphPushed.data() + entry.firstValue;
+    for (uint32_t v = 0; v < entry.numValues && !changed; v++) {
+      if (entry.integer) {
+        changed = int32_t(values[v]) != int32_t(pushed[v]);
+      } else {
+        changed = values[v] != pushed[v];
+      }
+    }
+    if (!changed) {
+      continue;
+    }
+    std::copy(values, values + entry.numValues,
+              mMorphPushed.begin() + entry.firstValue);
+    entry.forcePush = false;
+    if (entry.scalar) {
+      mMorphPushes.push_back({entry.param, values[0], -1});
+      continue;
+    }
+    std::vector<ParameterField> &fields = mMorphFields[i];
+    for (uint32_t v = 0; v < entry.numValues; v++) {
+      if (fields[v].type() == ParameterField::FLOAT) {
+        fields[v].set<float>(values[v]);
+      } else if (fields[v].type() == ParameterField::INT32) {
+        fields[v].set<int32_t>(int32_t(values[v]));
+      }
+    }
+    if (mMorphPushFields.size() == numFields) {
+      mMorphPushFields.emplace_back();
+    }
+    mMorphPushFields[numFields] = fields;
+    mMorphPushes.push_back({entry.param, 0.0f, int32_t(numFields)});
+    numFields++;
+  }
+}
+
+void PresetHandler::pushMorphValues() {
+  for (const MorphPush &push : mMorphPushes) {
+    if (push.fields < 0) {
+      push.param->fromFloat(push.value);
+    } else {
+      push.param->set(mMorphPushFields[push.fields]);
+    }
+  }
+  mMorphPushes.clear();
+}
+
 void PresetHandler::morphTo(std::string presetName, float morphTime) {
   auto parameterStates = loadPresetValues(presetName);
   morphTo(parameterStates, morphTime);
@@ -381,6 +530,7 @@ void PresetHandler::recallPresetSynchronous(std::string name) {
     }
   }
   mCurrentPresetName = name;
+  prefetchAdjacent(index);
   if (mUseCallbacks) {
     for (size_t i = 0; i < mCallbacks.size(); ++i) {
       if (mCallbacks[i]) {
@@ -423,6 +573,9 @@ void PresetHandler::skipParameter(std::string parameterAddr, bool skip) {
       mSkipParameters.erase(position);
     }
   }
+  lk.unlock();
+  // Cached presets were filtered with the previous skip list
+  clearCache();
 }
 
 int PresetHandler::getCurrentPresetIndex() {
@@ -504,15 +657,45 @@ PresetHandler &PresetHandler::registerParameterBundle(ParameterBundle &bundle) {
 }
 
 std::map<int, std::string> PresetHandler::readPresetMap(std::string mapName) {
-  std::map<int, std::string> presetsMap;
   std::string mapFullPath = buildMapPath(mapName, true);
+  if (!mCacheEnabled) {
+    std::map<int, std::string> presetsMap;
+    parsePresetMapFile(mapFullPath, presetsMap);
+    return presetsMap;
+  }
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lk(mCacheLock);
+    auto cached = mMapCache.find(mapFullPath);
+    if (cached != mMapCache.end()) {
+      mCacheHits++;
+      return cached->second;
+    }
+    generation = cacheGeneration(mapFullPath);
+  }
+  mCacheMisses++;
+  // As in loadPresetValues(), a map written after the file is watched is not
+  // cached
+  mCacheWatcher.watch(mapFullPath);
+  std::map<int, std::string> presetsMap;
+  if (parsePresetMapFile(mapFullPath, presetsMap)) {
+    std::lock_guard<std::mutex> lk(mCacheLock);
+    if (cacheGeneration(mapFullPath) == generation) {
+      mMapCache[mapFullPath] = presetsMap;
+    }
+  }
+  return presetsMap;
+}
+
+bool PresetHandler::parsePresetMapFile(const std::string &mapFullPath,
+                                       std::map<int, std::string> &presetsMap) {
   std::ifstream f(mapFullPath);
   if (!f.is_open()) {
     if (mVerbose) {
       std::cout << "Error while opening preset map file for reading: "
                 << mapFullPath << std::endl;
     }
-    return presetsMap;
+    return false;
   }
   std::string line;
   while (getline(f, line)) {
@@ -537,8 +720,9 @@ std::map<int, std::string> PresetHandler::readPresetMap(std::string mapName) {
       std::cout << "Error while opening preset map file for reading: "
                 << mapFullPath << std::endl;
     }
+    return false;
   }
-  return presetsMap;
+  return true;
 }
 
 void PresetHandler::setCurrentPresetMap(std::string mapName, bool autoCreate) {
@@ -763,6 +947,7 @@ void PresetHandler::storeCurrentPresetMap(std::string mapName,
     }
   }
   f.close();
+  Watcher::notify(mapFullPath, "modified");
 }
 
 // void PresetHandler::setParameterValues(ParameterMeta *p,
@@ -1010,7 +1195,12 @@ void PresetHandler::stepMorphing() {
   uint64_t stepCount = mMorphStepCount.fetch_add(1);
   if (stepCount <= totalSteps && totalSteps > 0) {
     double morphPhase = double(stepCount) / totalSteps;
-    setInterpolatedValues(mStartValues, mTargetValues, morphPhase);
+    std::lock_guard<std::mutex> pushLock(mMorphPushLock);
+    {
+      std::lock_guard<std::mutex> lk(mTargetLock);
+      applyMorph(float(morphPhase));
+    }
+    pushMorphValues();
   }
 }
 
@@ -1021,6 +1211,35 @@ void PresetHandler::morphingFunction(al::PresetHandler *handler) {
   }
 }
 
+std::unordered_map<std::string, ParameterMeta *>
+PresetHandler::parameterAddresses() {
+  std::unordered_map<std::string, ParameterMeta *> addresses;
+  for (ParameterMeta *param : mParameters) {
+    addresses.emplace(param->getFullAddress(), param);
+  }
+
+  std::function<void(std::vector<ParameterBundle *>, std::string)>
+      processBundleGroup = [&](std::vector<ParameterBundle *> bundles,
+                               std::string prefix) {
+        for (unsigned int i = 0; i < bundles.size(); i++) {
+          std::string bundlePrefix = prefix + std::to_string(i);
+          for (auto *param : bundles.at(i)->parameters()) {
+            addresses.emplace(bundlePrefix + param->getFullAddress(), param);
+          }
+          for (auto bundleGroup : bundles.at(i)->bundles()) {
+            prefix += "/" + bundleGroup.first + "/";
+            processBundleGroup({bundleGroup.second}, prefix);
+          }
+        }
+      };
+
+  for (auto bundleGroup : mBundles) {
+    std::string prefix = "/" + bundleGroup.first + "/";
+    processBundleGroup(bundleGroup.second, prefix);
+  }
+  return addresses;
+}
+
 PresetHandler::ParameterStates PresetHandler::getBundleStates(
     ParameterBundle *bundle, std::string id) {
   ParameterStates values;
@@ -1042,19 +1261,270 @@ PresetHandler::ParameterStates PresetHandler::getBundleStates(
 
 PresetHandler::ParameterStates PresetHandler::loadPresetValues(
     std::string name) {
+  std::string path = getCurrentPath();
+  if (path.back() != '/') {
+    path += "/";
+  }
+  std::string fileName = path + name + ".preset";
+  if (!mCacheEnabled) {
+    return parsePresetFile(fileName);
+  }
   ParameterStates preset;
-  std::lock_guard<std::mutex> lock(mFileLock);  // Protect loading and saving
-  std::lock_guard<std::mutex> lock2(mSkipParametersLock);  // Protect skip list
+  uint64_t generation;
+  if (findCached(fileName, preset, generation)) {
+    mCacheHits++;
+    return preset;
+  }
+  mCacheMisses++;
+  // Changes notified after the file is watched bump its generation, so a
+  // preset parsed from a file written meanwhile is not cached
+  mCacheWatcher.watch(fileName);
+  preset = parsePresetFile(fileName);
+  if (preset.size() > 0) {
+    insertCached(fileName, preset, generation);
+  }
+  return preset;
+}
+
+bool PresetHandler::findCached(const std::string &fileName,
+                               ParameterStates &values, uint64_t &generation) {
+  std::lock_guard<std::mutex> lk(mCacheLock);
+  auto cached = mCache.find(fileName);
+  if (cached == mCache.end()) {
+    generation = cacheGeneration(fileName);
+    return false;
+  }
+  mCacheOrder.splice(mCacheOrder.begin(), mCacheOrder, cached->second.order);
+  values = cached->second.values;
+  return true;
+}
+
+uint64_t PresetHandler::cacheGeneration(const std::string &fileName) {
+  // Must be called with mCacheLock held
+  auto generation = mCacheGenerations.find(fileName);
+  return mCacheEpoch +
+         (generation != mCacheGenerations.end() ? generation->second : 0);
+}
+
+void PresetHandler::insertCached(const std::string &fileName,
+                                 const ParameterStates &values,
+                                 uint64_t generation) {
+  std::vector<std::string> evicted;
+  {
+    std::lock_guard<std::mutex> lk(mCacheLock);
+    if (cacheGeneration(fileName) != generation) {
+      return;
+    }
+    auto cached = mCache.find(fileName);
+    if (cached != mCache.end()) {
+      cached->second.values = values;
+      mCacheOrder.splice(mCacheOrder.begin(), mCacheOrder,
+                         cached->second.order);
+      return;
+    }
+    mCacheOrder.push_front(fileName);
+    mCache[fileName] = {values, mCacheOrder.begin()};
+    evictCached(evicted);
+  }
+  unwatchEvicted(evicted);
+}
+
+void PresetHandler::evictCached(std::vector<std::string> &evicted) {
+  while (mCacheSize > 0 && mCache.size() > mCacheSize) {
+    evicted.push_back(mCacheOrder.back());
+    mCache.erase(mCacheOrder.back());
+    mCacheOrder.pop_back();
+  }
+}
+
+void PresetHandler::unwatchEvicted(const std::vector<std::string> &evicted) {
+  if (evicted.size() == 0) {
+    return;
+  }
+  // Not done under mCacheLock, as the watcher calls onEvent() with its own
+  // lock held
+  for (auto &fileName : evicted) {
+    mCacheWatcher.unwatch(fileName);
+  }
+  // A file loaded again before it was unwatched is no longer watched. Drop
+  // it from the cache, and drop loads in flight when they finish
+  std::lock_guard<std::mutex> lk(mCacheLock);
+  for (auto &fileName : evicted) {
+    mCacheGenerations[fileName]++;
+    auto cached = mCache.find(fileName);
+    if (cached != mCache.end()) {
+      mCacheOrder.erase(cached->second.order);
+      mCache.erase(cached);
+    }
+  }
+}
+
+void PresetHandler::enableCache(bool enable) {
+  mCacheEnabled = enable;
+  if (!enable) {
+    enablePrefetch(false);
+    clearCache();
+  }
+}
+
+void PresetHandler::preloadCache() {
+  enableCache(true);
+  static const std::string extension = ".preset";
+  FileList presetFiles = filterInDir(getCurrentPath(), [](const FilePath &f) {
+    return al::checkExtension(f, extension);
+  });
+  for (int i = 0; i < presetFiles.count(); i++) {
+    const std::string &name = presetFiles[i].file();
+    loadPresetValues(name.substr(0, name.size() - extension.size()));
+  }
+}
+
+void PresetHandler::clearCache() {
+  mCacheWatcher.unwatch();
+  std::lock_guard<std::mutex> lk(mCacheLock);
+  // Files being loaded were watched before unwatch() and are not anymore
+  mCacheEpoch++;
+  mCache.clear();
+  mCacheOrder.clear();
+  mMapCache.clear();
+}
+
+void PresetHandler::setCacheSize(size_t size) {
+  std::vector<std::string> evicted;
+  {
+    std::lock_guard<std::mutex> lk(mCacheLock);
+    mCacheSize = size;
+    evictCached(evicted);
+  }
+  unwatchEvicted(evicted);
+}
+
+size_t PresetHandler::cachedPresets() {
+  std::lock_guard<std::mutex> lk(mCacheLock);
+  return mCache.size();
+}
+
+void PresetHandler::enablePrefetch(bool enable, int radius) {
+  if (mPrefetchThread) {
+    {
+      std::lock_guard<std::mutex> lk(mPrefetchLock);
+      mPrefetchRunning = false;
+      mPrefetchQueue.clear();
+    }
+    mPrefetchCondition.notify_one();
+    mPrefetchThread->join();
+    mPrefetchThread = nullptr;
+  }
+  mPrefetchRadius = enable ? radius : 0;
+  if (enable && radius > 0) {
+    mCacheEnabled = true;
+    {
+      std::lock_guard<std::mutex> lk(mPrefetchLock);
+      mPrefetchRunning = true;
+    }
+    mPrefetchThread =
+        std::make_unique<std::thread>(PresetHandler::prefetchFunction, this);
+  }
+}
+
+void PresetHandler::prefetchAdjacent(int index) {
+  int radius = mPrefetchRadius;
+  if (radius <= 0) {
+    return;
+  }
+  auto current = mPresetsMap.find(index);
+  if (current == mPresetsMap.end()) {
+    return;
+  }
+  // Paths are resolved here, on the thread that recalls presets, so the
+  // prefetch thread does not read the path while it is being changed
   std::string path = getCurrentPath();
   if (path.back() != '/') {
     path += "/";
   }
+  std::vector<std::string> fileNames;
+  auto next = current;
+  auto previous = current;
+  for (int i = 0; i < radius; i++) {
+    if (next != mPresetsMap.end() && ++next != mPresetsMap.end()) {
+      fileNames.push_back(path + next->second + ".preset");
+    }
+    if (previous != mPresetsMap.begin()) {
+      --previous;
+      fileNames.push_back(path + previous->second + ".preset");
+    }
+  }
+  if (fileNames.size() > 0) {
+    {
+      std::lock_guard<std::mutex> lk(mPrefetchLock);
+      if (!mPrefetchRunning) {
+        return;
+      }
+      mPrefetchQueue.insert(mPrefetchQueue.end(), fileNames.begin(),
+                            fileNames.end());
+    }
+    mPrefetchCondition.notify_one();
+  }
+}
+
+void PresetHandler::prefetchFunction(PresetHandler *handler) {
+  std::vector<std::string> fileNames;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(handler->mPrefetchLock);
+      handler->mPrefetchCondition.wait(lk, [handler]() {
+        return !handler->mPrefetchRunning ||
+               handler->mPrefetchQueue.size() > 0;
+      });
+      if (!handler->mPrefetchRunning) {
+        return;
+      }
+      fileNames.swap(handler->mPrefetchQueue);
+    }
+    for (auto &fileName : fileNames) {
+      // Prefetches are not counted as hits or misses
+      uint64_t generation;
+      {
+        std::lock_guard<std::mutex> lk(handler->mCacheLock);
+        if (handler->mCache.find(fileName) != handler->mCache.end()) {
+          continue;
+        }
+        generation = handler->cacheGeneration(fileName);
+      }
+      handler->mCacheWatcher.watch(fileName);
+      auto values = handler->parsePresetFile(fileName);
+      if (values.size() > 0) {
+        handler->insertCached(fileName, values, generation);
+      }
+    }
+    fileNames.clear();
+  }
+}
+
+void PresetHandler::CacheWatcher::onEvent(std::string resourcename,
+                                          std::string /*eventname*/) {
+  std::lock_guard<std::mutex> lk(mHandler.mCacheLock);
+  // Invalidates values being parsed from the file too
+  mHandler.mCacheGenerations[resourcename]++;
+  auto cached = mHandler.mCache.find(resourcename);
+  if (cached != mHandler.mCache.end()) {
+    mHandler.mCacheOrder.erase(cached->second.order);
+    mHandler.mCache.erase(cached);
+  }
+  mHandler.mMapCache.erase(resourcename);
+}
+
+PresetHandler::ParameterStates PresetHandler::parsePresetFile(
+    std::string fileName) {
+  ParameterStates preset;
+  std::lock_guard<std::mutex> lock(mFileLock);  // Protect loading and saving
+  std::lock_guard<std::mutex> lock2(mSkipParametersLock);  // Protect skip list
   std::string line;
-  std::ifstream f(path + name + ".preset");
+  std::ifstream f(fileName);
   if (!f.is_open()) {
     if (mVerbose) {
-      std::cout << "Error while opening preset file: "
-                << path + name + ".preset" << std::endl;
+      std::cout << "Error while opening preset file: " << fileName
+                << std::endl;
     }
   }
   while (getline(f, line)) {
@@ -1108,8 +1578,8 @@ PresetHandler::ParameterStates PresetHandler::loadPresetValues(
   }
   if (f.bad()) {
     if (mVerbose) {
-      std::cout << "Error while writing preset file: "
-                << path + name + ".preset" << std::endl;
+      std::cout << "Error while writing preset file: " << fileName
+                << std::endl;
     }
   }
   f.close();
@@ -1165,6 +1635,7 @@ bool PresetHandler::savePresetValues(const ParameterStates &values,
     ok = false;
   }
   f.close();
+  Watcher::notify(fileName, "modified");
   return ok;
 }
 
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 #include "al/io/al_File.hpp"
 #include "al/ui/al_Composition.hpp"
@@ -27,28 +28,61 @@ PresetSequencer::~PresetSequencer() { stopCpuThread(); }
 
 void PresetSequencer::playSequence(std::string sequenceName, double timeScale,
                                    double timeOffset) {
-  stopSequence();
+  if (sequenceName.size() > 0) {
+    playSequence(prepareSequence(sequenceName, timeScale), timeOffset);
+    return;
+  }
+  // Replay the current steps. Recompile even if the steps are unchanged, as
+  // presets might have changed. Compiling on this thread keeps preset files
+  // from being read by the sequencer thread.
+  PreparedSequence sequence;
+  sequence.mPlanVersion = mPlanVersion;
   mSequenceLock.lock();
+  sequence.mName = mCurrentSequence;
+  sequence.mSteps = mSteps;
+  mSequenceLock.unlock();
+  compilePlan(sequence.mSteps, sequence.mPlan);
+  playSequence(std::move(sequence), timeOffset);
+}
 
-  if (sequenceName.size() > 0) {
-    auto steps = loadSequence(sequenceName, timeScale);
-    mCurrentSequence = sequenceName;
-    mSteps = steps;
+PresetSequencer::PreparedSequence PresetSequencer::prepareSequence(
+    std::string sequenceName, double timeScale) {
+  PreparedSequence sequence;
+  sequence.mName = sequenceName;
+  sequence.mPlanVersion = mPlanVersion;
+  sequence.mSteps = loadSequence(sequenceName, timeScale);
+  compilePlan(sequence.mSteps, sequence.mPlan);
+  return sequence;
+}
+
+void PresetSequencer::playSequence(PreparedSequence &&sequence,
+                                   double timeOffset) {
+  if (sequence.mPlanVersion != mPlanVersion) {
+    // Registrations changed since the sequence was prepared
+    sequence.mPlanVersion = mPlanVersion;
+    compilePlan(sequence.mSteps, sequence.mPlan);
   }
+  stopSequence();
+  mSequenceLock.lock();
+  mCurrentSequence = sequence.mName;
+  std::swap(mSteps, sequence.mSteps);
+  std::swap(mPlan, sequence.mPlan);
+  // Preset changes after the sequence was compiled bumped the version
+  mPresetsChanged = false;
+  mPlanDirty = sequence.mPlanVersion != mPlanVersion;
+  mLastPresetStep = -1;
+  mMorphStep = -1;
   mSequenceLock.unlock();
 
+  startPlayback(timeOffset);
+}
+
+void PresetSequencer::startPlayback(double timeOffset) {
   // Initialize counters
   mLastTimeUpdate = 0.0;
   mParameterTargetTime = 0.0;
   mStartRunning = true;
   mRunning = false;
-  setTime(0.0);
-  if (mSteps.size() > 0 && mSteps.size() > mCurrentStep) {
-    if (mPresetHandler && mSteps[mCurrentStep].type == PRESET) {
-      mPresetHandler->morphTo(mSteps[mCurrentStep].name,
-                              mSteps[mCurrentStep].morphTime);
-    }
-  }
   setTime(timeOffset);
 
   if (mTimeMasterMode == TimeMasterMode::TIME_MASTER_CPU && mSequencerThread) {
@@ -191,6 +225,8 @@ PresetSequencer &PresetSequencer::registerPresetHandler(
   //  mPresetHandler->setTimeMaster(TimeMasterMode::TIME_MASTER_CPU);
   mDirectory = mPresetHandler->getCurrentPath();
   //		std::cout << "Path set to:" << mDirectory << std::endl;
+  mPlanDirty = true;
+  mPlanVersion++;
   return *this;
 }
 
@@ -263,6 +299,8 @@ void PresetSequencer::registerEventCommand(
   cb.callbackData = data;
 
   mEventCallbacks.push_back(cb);
+  mPlanDirty = true;
+  mPlanVersion++;
 }
 
 void PresetSequencer::registerBeginCallback(
@@ -337,6 +375,7 @@ void PresetSequencer::clearSteps() {
   mSequenceLock.lock();
   mSteps.clear();
   mCurrentSequence = "";
+  mPlanDirty = true;
   mSequenceLock.unlock();
 }
 
@@ -344,6 +383,7 @@ void PresetSequencer::appendStep(PresetSequencer::Step &newStep) {
   mSequenceLock.lock();
   mSteps.push_back(newStep);
   mCurrentSequence = "";
+  mPlanDirty = true;
   mSequenceLock.unlock();
 }
 
@@ -374,14 +414,13 @@ void PresetSequencer::updateTime(double time) {
     mTargetTime = 0;
     mLastPresetTime = 0.0;
     mLastTimeUpdate = 0.0;
-    while (!mParameterList.empty()) {
-      mParameterList.pop();
-    }
+    mNextParameterStep = 0;
+    mLastPresetStep = -1;
+    mMorphStep = -1;
 
     // Queue parameter and event steps before first preset.
     while ((mSteps.size() > mCurrentStep) &&
            (mSteps[mCurrentStep].type != PRESET)) {
-      mParameterList.push(mSteps[mCurrentStep]);
       // Move current time back to accomodate these steps
       mCurrentTime -= mSteps[mCurrentStep].waitTime;
       mLastPresetTime = mCurrentTime;
@@ -391,30 +430,52 @@ void PresetSequencer::updateTime(double time) {
     }
 
     updateSequencer();
-    if (mSteps.size() > (mCurrentStep - 1) && mCurrentStep > 1) {
-      Step step = mSteps[mCurrentStep - 1];
-      std::string previousPreset = mSteps[mCurrentStep - 2].name;
-      if (time > (mTargetTime - step.waitTime)) {
+    if (mLastPresetStep >= 0) {
+      const PlanStep &step = mPlan.steps[mLastPresetStep];
+      if (mCurrentTime > (mTargetTime - step.waitTime)) {
         // We only need to wait, morphing is done
+        mMorphStep = -1;
         if (mPresetHandler) {
-          mPresetHandler->recallPresetSynchronous(step.name);
+          mPresetHandler->recallPresetSynchronous(mSteps[mLastPresetStep].name);
           // Just set morph time so it has the expected last value
           mPresetHandler->setMorphTime(step.morphTime);
         }
       } else {
-        // In the middle of morphing
-        if (mPresetHandler) {
-          double remainingMorphTime =
-              mTargetTime - time - double(step.waitTime);
-          if (previousPreset.size() > 0) {
-            mPresetHandler->setInterpolatedPreset(
-                previousPreset, step.name,
-                1.0 - (remainingMorphTime / step.morphTime));
-          }
-          if (mRunning || mStartRunning) {
-            mPresetHandler->morphTo(step.name, remainingMorphTime);
+        // In the middle of morphing. Morph from the previous preset's values
+        double morphStart = mTargetTime - step.waitTime - step.morphTime;
+        beginMorph(mLastPresetStep, morphStart);
+        int64_t previous = mLastPresetStep - 1;
+        while (previous >= 0 && mPlan.steps[previous].type != PRESET) {
+          previous--;
+        }
+        if (previous >= 0) {
+          const PlanStep &previousStep = mPlan.steps[previous];
+          for (uint32_t i = step.firstParameter;
+               i < step.firstParameter + step.numParameters; i++) {
+            const PlanParameter &entry = mPlan.parameters[i];
+            for (uint32_t j = previousStep.firstParameter;
+                 j < previousStep.firstParameter + previousStep.numParameters;
+                 j++) {
+              const PlanParameter &previousEntry = mPlan.parameters[j];
+              if (previousEntry.param == entry.param &&
+                  previousEntry.numValues == entry.numValues) {
+                std::copy(mPlan.end.begin() + previousEntry.firstValue,
+                          mPlan.end.begin() + previousEntry.firstValue +
+                              previousEntry.numValues,
+                          mPlan.start.begin() + entry.firstValue);
+                break;
+              }
+            }
           }
         }
+        float factor = 1.0f;
+        if (step.morphTime > 0.0f) {
+          factor = float((mCurrentTime - morphStart) / step.morphTime);
+        }
+        applyPlanParameters(step, factor);
+        if (!mRunning && !mStartRunning) {
+          mMorphStep = -1;
+        }
       }
     }
 
@@ -426,63 +487,257 @@ void PresetSequencer::updateTime(double time) {
 
 void PresetSequencer::updateSequencer() {
   mSequenceLock.lock();
+  // Only steps appended, registrations changed or presets written during
+  // playback are compiled here. playSequence() compiles on the caller's thread
+  if (mPresetsChanged.exchange(false) || mPlanDirty) {
+    compilePlan(mSteps, mPlan);
+    mPlanDirty = false;
+    mLastPresetStep = -1;
+    mMorphStep = -1;
+  }
 
-  while (mTargetTime <= mCurrentTime && (mSteps.size() > mCurrentStep)) {
+  while (mTargetTime <= mCurrentTime && (mPlan.steps.size() > mCurrentStep)) {
     // Reached target time. Process step
-    Step step = mSteps[mCurrentStep];
+    const PlanStep &step = mPlan.steps[mCurrentStep];
     assert(step.type == PRESET);
 
-    if (mPresetHandler && (mRunning || mStartRunning)) {
-      mPresetHandler->morphTo(step.name, step.morphTime);
-      //            std::cout << "recalling " << step.presetName <<
-      //            std::endl;
+    if (mRunning || mStartRunning) {
+      beginMorph(mCurrentStep, mTargetTime);
     }
+    mLastPresetStep = mCurrentStep;
     mLastPresetTime = mTargetTime;
     mParameterTargetTime = mTargetTime;
     mTargetTime += step.morphTime + step.waitTime;
     mCurrentStep++;
-    // Now gather all parameter and event steps until next preset
-    while ((mSteps.size() > mCurrentStep) &&
-           mSteps[mCurrentStep].type != PRESET) {
-      mParameterList.push(mSteps[mCurrentStep]);
+    // Now queue all parameter and event steps until next preset
+    while ((mPlan.steps.size() > mCurrentStep) &&
+           mPlan.steps[mCurrentStep].type != PRESET) {
       mCurrentStep++;
     }
   }
-  // Apply pending parameter changes
-  while (!mParameterList.empty()) {
-    auto &step = mParameterList.front();
+  // Interpolate preset being morphed
+  if (mMorphStep >= 0 && (mRunning || mStartRunning)) {
+    const PlanStep &step = mPlan.steps[mMorphStep];
+    float factor = 1.0f;
+    if (step.morphTime > 0.0f) {
+      factor = float((mCurrentTime - mMorphStartTime) / step.morphTime);
+    }
+    if (factor >= 1.0f) {
+      mMorphStep = -1;
+    }
+    applyPlanParameters(step, factor);
+  }
+  // Apply pending parameter changes. Queued steps are all parameter and event
+  // steps from mNextParameterStep up to mCurrentStep
+  while (mNextParameterStep < mCurrentStep &&
+         mPlan.steps[mNextParameterStep].type == PRESET) {
+    mNextParameterStep++;
+  }
+  while (mNextParameterStep < mCurrentStep) {
     if (mParameterTargetTime <= mCurrentTime) {
+      const PlanStep &step = mPlan.steps[mNextParameterStep];
       if (step.type == PARAMETER) {
-        //          std::cout << "set parameter " << step.presetName <<
-        //          std::endl;
-        for (auto *param : mParameters) {
-          if (param->getFullAddress() == step.name) {
-            param->set(step.params);
-            break;
-          }
-        }
+        applyPlanParameters(step, 1.0f);
       } else if (step.type == EVENT) {
-        for (auto &eventCallback : mEventCallbacks) {
-          if (eventCallback.eventName == step.name) {
-            eventCallback.callback(eventCallback.callbackData, step.params);
-          }
-        }
+        triggerPlanEvent(mNextParameterStep);
       }
-      mParameterList.pop();
-      if (!mParameterList.empty()) {
-        mParameterTargetTime += mParameterList.front().waitTime;
+      mNextParameterStep++;
+      while (mNextParameterStep < mCurrentStep &&
+             mPlan.steps[mNextParameterStep].type == PRESET) {
+        mNextParameterStep++;
+      }
+      if (mNextParameterStep < mCurrentStep) {
+        mParameterTargetTime += mPlan.steps[mNextParameterStep].waitTime;
       }
     } else {
       break;
     }
   }
-  if (mTargetTime <= mCurrentTime && mParameterList.empty() &&
-      mParameterTargetTime <= mCurrentTime) {
+  if (mTargetTime <= mCurrentTime && mNextParameterStep == mCurrentStep &&
+      mParameterTargetTime <= mCurrentTime && mMorphStep < 0) {
     mRunning = false;
   }
   mSequenceLock.unlock();
 }
 
+void PresetSequencer::compilePlan(const std::vector<Step> &steps,
+                                  Plan &plan) {
+  plan.steps.clear();
+  plan.parameters.clear();
+  plan.start.clear();
+  plan.end.clear();
+  plan.curves.clear();
+  plan.fields.clear();
+  plan.callbacks.clear();
+
+  std::unordered_map<std::string, ParameterMeta *> presetAddresses;
+  if (mPresetHandler) {
+    presetAddresses = mPresetHandler->parameterAddresses();
+  }
+  std::unordered_map<std::string, ParameterMeta *> sequencerAddresses;
+  for (auto *param : mParameters) {
+    sequencerAddresses.emplace(param->getFullAddress(), param);
+  }
+  std::string presetPath;
+  if (mPresetHandler) {
+    presetPath = File::conformDirectory(mPresetHandler->getCurrentPath());
+  }
+  // Presets used more than once in a sequence share their entries
+  std::unordered_map<std::string, PlanStep> compiledPresets;
+
+  plan.steps.reserve(steps.size());
+  for (auto &step : steps) {
+    PlanStep planStep{step.type, step.morphTime, step.waitTime, 0, 0, 0, 0};
+    planStep.firstParameter = uint32_t(plan.parameters.size());
+    planStep.firstCallback = uint32_t(plan.callbacks.size());
+    if (step.type == PRESET) {
+      auto compiled = compiledPresets.find(step.name);
+      if (compiled != compiledPresets.end()) {
+        planStep.firstParameter = compiled->second.firstParameter;
+        planStep.numParameters = compiled->second.numParameters;
+      } else if (mPresetHandler) {
+        // Watched before reading, so a write while reading is not missed
+        mPresetWatcher.watch(presetPath + step.name + ".preset");
+        auto values = mPresetHandler->loadPresetValues(step.name);
+        for (auto &value : values) {
+          auto param = presetAddresses.find(value.first);
+          if (param != presetAddresses.end() && value.second.size() > 0) {
+            addPlanParameter(plan, param->second, value.second);
+          }
+        }
+        planStep.numParameters =
+            uint32_t(plan.parameters.size()) - planStep.firstParameter;
+        compiledPresets[step.name] = planStep;
+      }
+    } else if (step.type == PARAMETER) {
+      auto param = sequencerAddresses.find(step.name);
+      if (param != sequencerAddresses.end() && step.params.size() > 0) {
+        addPlanParameter(plan, param->second, step.params);
+        planStep.numParameters = 1;
+      }
+    } else if (step.type == EVENT) {
+      for (size_t i = 0; i < mEventCallbacks.size(); i++) {
+        if (mEventCallbacks[i].eventName == step.name) {
+          plan.callbacks.push_back(uint32_t(i));
+        }
+      }
+      planStep.numCallbacks =
+          uint32_t(plan.callbacks.size()) - planStep.firstCallback;
+    }
+    plan.steps.push_back(planStep);
+  }
+}
+
+uint32_t PresetSequencer::addPlanParameter(
+    Plan &plan, ParameterMeta *param,
+    const std::vector<ParameterField> &values) {
+  PlanParameter entry;
+  entry.param = param;
+  entry.firstValue = uint32_t(plan.end.size());
+  entry.numValues = uint32_t(values.size());
+  for (auto &field : values) {
+    float value = 0.0f;
+    uint8_t curve = CURVE_LINEAR;
+    if (field.type() == ParameterField::FLOAT) {
+      value = field.get<float>();
+    } else if (field.type() == ParameterField::INT32) {
+      value = float(field.get<int32_t>());
+    } else {
+      curve = CURVE_STEP;
+    }
+    plan.start.push_back(value);
+    plan.end.push_back(value);
+    plan.curves.push_back(curve);
+  }
+  std::vector<ParameterField> current;
+  param->get(current);
+  entry.scalar = values.size() == 1 && current.size() == 1 &&
+                 current[0].type() == values[0].type() &&
+                 plan.curves.back() == CURVE_LINEAR;
+  plan.parameters.push_back(entry);
+  plan.fields.push_back(values);
+  return uint32_t(plan.parameters.size() - 1);
+}
+
+void PresetSequencer::beginMorph(int64_t stepIndex, double startTime) {
+  const PlanStep &step = mPlan.steps[stepIndex];
+  if (mPresetHandler) {
+    // The sequencer interpolates, make sure the handler is not morphing too
+    mPresetHandler->stopMorphing();
+    mPresetHandler->setMorphTime(step.morphTime);
+  }
+  // Capture start values from the current parameter values
+  for (uint32_t i = step.firstParameter;
+       i < step.firstParameter + step.numParameters; i++) {
+    const PlanParameter &entry = mPlan.parameters[i];
+    if (entry.scalar) {
+      mPlan.start[entry.firstValue] = entry.param->toFloat();
+      continue;
+    }
+    mCaptureFields.clear();
+    entry.param->get(mCaptureFields);
+    for (uint32_t v = 0; v < entry.numValues; v++) {
+      uint32_t index = entry.firstValue + v;
+      mPlan.start[index] = mPlan.end[index];
+      if (v < mCaptureFields.size()) {
+        if (mCaptureFields[v].type() == ParameterField::FLOAT) {
+          mPlan.start[index] = mCaptureFields[v].get<float>();
+        } else if (mCaptureFields[v].type() == ParameterField::INT32) {
+          mPlan.start[index] = float(mCaptureFields[v].get<int32_t>());
+        }
+      }
+    }
+  }
+  mMorphStep = stepIndex;
+  mMorphStartTime = startTime;
+}
+
+void PresetSequencer::applyPlanParameters(const PlanStep &step, float factor) {
+  if (factor < 0.0f) {
+    factor = 0.0f;
+  }
+  bool done = factor >= 1.0f;
+  for (uint32_t i = step.firstParameter;
+       i < step.firstParameter + step.numParameters; i++) {
+    const PlanParameter &entry = mPlan.parameters[i];
+    const float *start = mPlan.start.data() + entry.firstValue;
+    const float *end = mPlan.end.data() + entry.firstValue;
+    if (entry.scalar) {
+      entry.param->fromFloat(done ? *end
+                                  : *start + factor * (*end - *start));
+      continue;
+    }
+    std::vector<ParameterField> &fields = mPlan.fields[i];
+    const uint8_t *curves = mPlan.curves.data() + entry.firstValue;
+    for (uint32_t v = 0; v < entry.numValues; v++) {
+      if (curves[v] == CURVE_LINEAR) {
+        float value = done ? end[v] : start[v] + factor * (end[v] - start[v]);
+        if (fields[v].type() == ParameterField::FLOAT) {
+          fields[v].set<float>(value);
+        } else {
+          fields[v].set<int32_t>(int32_t(value));
+        }
+      }
+    }
+    entry.param->set(fields);
+  }
+}
+
+void PresetSequencer::triggerPlanEvent(uint64_t stepIndex) {
+  const PlanStep &step = mPlan.steps[stepIndex];
+  for (uint32_t i = step.firstCallback;
+       i < step.firstCallback + step.numCallbacks; i++) {
+    auto &eventCallback = mEventCallbacks[mPlan.callbacks[i]];
+    eventCallback.callback(eventCallback.callbackData, mSteps[stepIndex].params);
+  }
+}
+
+void PresetSequencer::PresetWatcher::onEvent(std::string /*resourcename*/,
+                                             std::string /*eventname*/) {
+  mSequencer.mPresetsChanged = true;
+  mSequencer.mPlanVersion++;
+}
+
 void PresetSequencer::stepSequencer(double dt) {
   mCurrentTime += dt;
   if (mRunning) {
@@ -44,61 +44,43 @@ PresetServer::~PresetServer() {
 void PresetServer::onMessage(osc::Message &m) {
   m.resetStream();  // Should be moved to the caller...
   //	std::cout << "PresetServer::onMessage " << std::endl;
-  mPresetChangeLock.lock();
-  mPresetChangeSenderAddr = m.senderAddress();
+  // Preset commands are queued for the worker thread. Store mode is applied
+  // here, so it affects the messages that follow it in order
+  std::string sender = m.senderAddress();
   if (m.addressPattern() == mOSCpath && m.typeTags() == "f") {
     float val;
     m >> val;
-    if (!this->mStoreMode) {
-      for (PresetHandler *handler : mPresetHandlers) {
-        handler->recallPreset(static_cast<int>(val));
-      }
-    } else {
-      for (PresetHandler *handler : mPresetHandlers) {
-        handler->storePreset(static_cast<int>(val));
-      }
-      this->mStoreMode = false;
-    }
+    queuePresetCommand(mStoreMode, static_cast<int>(val), "", sender);
+    this->mStoreMode = false;
   } else if (m.addressPattern() == mOSCpath && m.typeTags() == "s") {
     std::string val;
     m >> val;
-    if (!this->mStoreMode) {
-      for (PresetHandler *handler : mPresetHandlers) {
-        handler->recallPreset(val);
-      }
-    } else {
-      for (PresetHandler *handler : mPresetHandlers) {
-        handler->storePreset(val);
-      }
-      this->mStoreMode = false;
-    }
+    queuePresetCommand(mStoreMode, 0, val, sender);
+    this->mStoreMode = false;
   } else if (m.addressPattern() == mOSCpath && m.typeTags() == "i") {
     int val;
     m >> val;
-    if (!this->mStoreMode) {
-      for (PresetHandler *handler : mPresetHandlers) {
-        handler->recallPreset(val);
-      }
-    } else {
-      for (PresetHandler *handler : mPresetHandlers) {
-        handler->storePreset(val);
-      }
-      this->mStoreMode = false;
-    }
+    queuePresetCommand(mStoreMode, val, "", sender);
+    this->mStoreMode = false;
   } else if (m.addressPattern() == mOSCpath + "/morphTime" &&
              m.typeTags() == "f") {
     float val;
     m >> val;
-    for (PresetHandler *handler : mPresetHandlers) {
-      handler->setMorphTime(val);
-    }
+    mCommands.push(
+        [this, val]() {
+          for (PresetHandler *handler : mPresetHandlers) {
+            handler->setMorphTime(val);
+          }
+          if (mAcknowledge) {
+            notifyListeners(mOSCpath + "/ack/morphTime", val);
+          }
+        },
+        "morphTime");
   } else if (m.addressPattern() == mOSCpath + "/store" && m.typeTags() == "f") {
     float val;
     m >> val;
     if (this->mAllowStore) {
-      for (PresetHandler *handler : mPresetHandlers) {
-        handler->storePreset(static_cast<int>(val));
-      }
+      queuePresetCommand(true, static_cast<int>(val), "", sender);
     }
   } else if (m.addressPattern() == mOSCpath + "/storeMode" &&
              m.typeTags() == "f") {
@@ -110,7 +92,10 @@ void PresetServer::onMessage(osc::Message &m) {
       std::cout << "Remote storing disabled" << std::endl;
     }
   } else if (m.addressPattern() == mOSCpath + "/queryState") {
-    this->mParameterServer->notifyAll();
+    if (mParameterServer) {
+      mCommands.push([this]() { mParameterServer->notifyAll(); },
+                     "queryState");
+    }
   } else if (m.addressPattern().substr(0, mOSCpath.size() + 1) ==
              mOSCpath + "/") {
     int index = std::stoi(m.addressPattern().substr(mOSCpath.size() + 1));
@@ -118,20 +103,11 @@ void PresetServer::onMessage(osc::Message &m) {
       float val;
       m >> val;
       if (static_cast<int>(val) == 1) {
-        if (!this->mStoreMode) {
-          for (PresetHandler *handler : mPresetHandlers) {
-            handler->recallPreset(index);
-          }
-        } else {
-          for (PresetHandler *handler : mPresetHandlers) {
-            handler->storePreset(index);
-          }
-          this->mStoreMode = false;
-        }
+        queuePresetCommand(mStoreMode, index, "", sender);
+        this->mStoreMode = false;
       }
     }
   }
-  mPresetChangeLock.unlock();
   mHandlerLock.lock();
   for (osc::PacketHandler *handler : mHandlers) {
     m.resetStream();
@@ -140,6 +116,39 @@ void PresetServer::onMessage(osc::Message &m) {
   mHandlerLock.unlock();
 }
 
+void PresetServer::queuePresetCommand(bool store, int index,
+                                      std::string name, std::string sender) {
+  // Stores always run. A recall replaces a recall waiting at the end of the
+  // queue, as only the last preset of a burst would remain
+  mCommands.push(
+      [this, store, index, name, sender]() {
+        mPresetChangeLock.lock();
+        mPresetChangeSenderAddr = sender;
+        for (PresetHandler *handler : mPresetHandlers) {
+          if (store && name.size() > 0) {
+            handler->storePreset(name);
+          } else if (store) {
+            handler->storePreset(index);
+          } else if (name.size() > 0) {
+            handler->recallPreset(name);
+          } else {
+            handler->recallPreset(index);
+          }
+        }
+        mPresetChangeLock.unlock();
+        if (mAcknowledge) {
+          std::string ackAddress =
+              mOSCpath + (store ? "/ack/store" : "/ack/recall");
+          if (name.size() > 0) {
+            notifyListeners(ackAddress, name);
+          } else {
+            notifyListeners(ackAddress, index);
+          }
+        }
+      },
+      store ? "" : "recall");
+}
+
 void PresetServer::print() {
   if (mServer) {
     std::cout << "Preset server listening on: " << mServer->address() << ":"
@@ -9,6 +9,7 @@ using namespace al;
 
 SequenceServer::SequenceServer(std::string oscAddress, int oscPort)
     : mServer(nullptr),
+      mSequencer(nullptr),
       mRecorder(nullptr),
       // mParamServer(nullptr),
       mOSCpath("/sequence") {
@@ -24,6 +25,8 @@ SequenceServer::SequenceServer(std::string oscAddress, int oscPort)
 
 SequenceServer::SequenceServer(ParameterServer &paramServer)
     : mServer(nullptr),
+      mSequencer(nullptr),
+      mRecorder(nullptr),
       // mParamServer(&paramServer),
       mOSCpath("/sequence") {
   paramServer.registerOSCListener(this);
@@ -39,6 +42,30 @@ SequenceServer::~SequenceServer() {
 }
 
 void SequenceServer::onMessage(osc::Message &m) {
+  // The message only lives during this call, so its bytes are copied for the
+  // worker thread
+  std::string data(m.data(), m.size());
+  std::string sender = m.senderAddress();
+  osc::TimeTag timeTag = m.timeTag();
+  // Only a burst of play requests is coalesced, as just the last sequence
+  // requested would keep playing. Every other message runs in order
+  std::string key;
+  if (m.addressPattern() == mOSCpath && m.typeTags() == "s") {
+    key = mOSCpath + ",s";
+  }
+  mCommands.push(
+      [this, data, sender, timeTag]() {
+        osc::Message message(data.data(), int(data.size()), timeTag,
+                             sender.c_str());
+        processMessage(message);
+        if (mAcknowledge) {
+          notifyListeners(mOSCpath + "/ack", message.addressPattern());
+        }
+      },
+      key);
+}
+
+void SequenceServer::processMessage(osc::Message &m) {
   if (m.addressPattern() == mOSCpath + "/last") {
     if (mSequencer && mRecorder) {
       std::cout << "start last recorder sequence "
@@ -1,13 +1,171 @@
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <vector>
 
 #include "al/io/al_AudioIO.hpp"
+#include "al/io/al_AudioRoutingGraph.hpp"
+#include "al/io/al_AudioTelemetry.hpp"
 #include "al/math/al_Constants.hpp"
+#include "al/sound/al_Reverb.hpp"
+#include "al/system/al_Denormals.hpp"
 #include "al/system/al_Time.hpp"
 #include "catch.hpp"
 
 using namespace al;
 
+TEST_CASE("AudioIOData Buffer Layout") {
+  AudioIOData io;
+  io.framesPerBuffer(100);
+  io.channelsOut(3);
+  io.channelsBus(2);
+  REQUIRE(io.channelStride() == 112);
+  for (unsigned int i = 0; i < io.channelsOut(); i++) {
+    REQUIRE((uintptr_t)io.outBuffer(i) % AudioIOData::BUFFER_ALIGNMENT == 0);
+  }
+  REQUIRE((uintptr_t)io.busBuffer(1) % AudioIOData::BUFFER_ALIGNMENT == 0);
+  REQUIRE((uintptr_t)io.tempBuffer() % AudioIOData::BUFFER_ALIGNMENT == 0);
+  REQUIRE(&io.out(1, 0) == io.outBuffer(1));
+  REQUIRE(io.outBlock(2).size() == 100);
+  REQUIRE(io.outBlock(2).from(40).size() == 60);
+
+  for (auto &sample : io.outBlock(1)) {
+    sample = 1.0f;
+  }
+  rampGainBlock(io.outBuffer(1), 0.0f, 1.0f, 100);
+  REQUIRE(io.out(1, 0) == 0.0f);
+  REQUIRE(io.out(1, 50) == Approx(0.5f));
+  mixBlock(io.outBuffer(0), io.outBuffer(1), 2.0f, 100);
+  REQUIRE(io.out(0, 50) == Approx(1.0f));
+  REQUIRE(io.out(2, 50) == 0.0f);
+}
+
+TEST_CASE("Audio Routing Graph") {
+  AudioIOData voiceIO;
+  voiceIO.framesPerBuffer(64);
+  voiceIO.channelsOut(2);
+  AudioIOData io;
+  io.framesPerBuffer(64);
+  io.channelsOut(2);
+  io.channelsBus(3);
+
+  for (unsigned int i = 0; i < 64; i++) {
+    voiceIO.outBuffer(0)[i] = 1.0f;
+    voiceIO.outBuffer(1)[i] = 2.0f;
+  }
+  io.zeroOut();
+  io.zeroBus();
+
+  AudioRoutingGraph graph;
+  graph.send(0, 0, 0.5f).send(1, 1);
+  // Declared out of order: bus 2 must be complete before it goes to outputs
+  graph.busToOutput(2, 1);
+  graph.busToBus(1, 2, 1.0f, [](const float *in, float *out, unsigned int n) {
+    for (unsigned int i = 0; i < n; i++) {
+      out[i] = -in[i];
+    }
+  });
+  graph.busToBus(0, 2, 2.0f);
+  graph.busToOutput(0, 0);
+  REQUIRE(!graph.active());
+  REQUIRE(graph.commit());
+  graph.acquire();
+  REQUIRE(graph.active());
+
+  graph.processSends(voiceIO, io, 16);
+  graph.processBuses(io);
+  REQUIRE(io.busBuffer(0)[0] == 0.0f);
+  REQUIRE(io.busBuffer(0)[16] == 0.5f);
+  REQUIRE(io.busBuffer(1)[63] == 2.0f);
+  REQUIRE(io.busBuffer(2)[63] == -1.0f);
+  REQUIRE(io.outBuffer(0)[63] == 0.5f);
+  REQUIRE(io.outBuffer(1)[63] == -1.0f);
+
+  // Cycles are rejected and the previous schedule is kept
+  graph.busToBus(2, 0);
+  REQUIRE(!graph.commit());
+  graph.acquire();
+  REQUIRE(graph.active());
+}
+
+TEST_CASE("Audio Telemetry") {
+  AudioTelemetry telemetry;
+  REQUIRE(telemetry.spanId("voice render") == 0);
+  REQUIRE(telemetry.spanId("spatialize") == 1);
+  REQUIRE(telemetry.spanId(std::string("voice render").c_str()) == 0);
+
+  for (int i = 0; i < 4; i++) {
+    telemetry.beginCallback();
+    {
+      AudioTelemetry::ScopedSpan span(&telemetry, "voice render");
+      al_sleep(0.002);
+    }
+    telemetry.endCallback(i < 3 ? 1.0 : 0.001);
+  }
+  telemetry.reportXrun();
+
+  auto snapshot = telemetry.snapshot();
+  REQUIRE(snapshot.callbacks == 4);
+  REQUIRE(snapshot.xruns == 1);
+  REQUIRE(snapshot.deadlineMisses == 1);
+  REQUIRE(snapshot.maxLoad > 1.0f);
+  REQUIRE(snapshot.histogram[0] == 3);
+  REQUIRE(snapshot.histogram[AudioTelemetry::HISTOGRAM_BINS - 1] == 1);
+  REQUIRE(snapshot.spans.size() == 2);
+  REQUIRE(snapshot.spans[0].maxLoad > 1.0f);
+  REQUIRE(snapshot.spans[1].maxLoad == 0.0f);
+
+  // Reset is applied on the next callback
+  telemetry.reset();
+  telemetry.beginCallback();
+  telemetry.endCallback(1.0);
+  snapshot = telemetry.snapshot();
+  REQUIRE(snapshot.callbacks == 1);
+  REQUIRE(snapshot.xruns == 0);
+  REQUIRE(snapshot.deadlineMisses == 0);
+}
+
+TEST_CASE("Denormal Flush Guard") {
+  if (!ScopedDenormalFlush::supported()) {
+    return;
+  }
+  bool flushingBefore = ScopedDenormalFlush::flushing();
+  {
+    ScopedDenormalFlush guard;
+    REQUIRE(ScopedDenormalFlush::flushing());
+    volatile float tiny = 1.0e-38f;
+    volatile float result = tiny * 0.5f;
+    REQUIRE(result == 0.0f);
+  }
+  REQUIRE(ScopedDenormalFlush::flushing() == flushingBefore);
+
+  // A decaying reverb tail turns denormal within a few blocks. With the guard
+  // installed, blocks at the end of the tail should cost the same as the first
+  ScopedDenormalFlush guard;
+  Reverb<float> reverb;
+  reverb.decay(0.5f);
+  float out1, out2;
+  reverb(1.0e-20f, out1, out2);
+  const int numBlocks = 1000;
+  const int window = 50;
+  std::vector<double> blockTimes;
+  for (int block = 0; block < numBlocks; block++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 256; i++) {
+      reverb(0.0f, out1, out2);
+    }
+    blockTimes.push_back(std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count());
+  }
+  std::vector<double> early(blockTimes.begin(), blockTimes.begin() + window);
+  std::vector<double> late(blockTimes.end() - window, blockTimes.end());
+  std::sort(early.begin(), early.end());
+  std::sort(late.begin(), late.end());
+  REQUIRE(late[window / 2] < early[window / 2] * 3.0);
+}
+
 #ifndef TRAVIS_BUILD
 
 TEST_CASE("Audio Device Enum") { AudioDevice::printAll(); }
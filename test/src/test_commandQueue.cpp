@@ -0,0 +1,81 @@
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "al/ui/al_CommandQueue.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+TEST_CASE("CommandQueue order and coalescing") {
+  CommandQueue queue;
+  std::vector<std::string> calls;  // Only written by the worker thread
+
+  // Hold the worker in the first command so the others wait in the queue
+  std::mutex gateLock;
+  std::condition_variable gateCondition;
+  bool started = false;
+  bool open = false;
+  queue.push([&]() {
+    std::unique_lock<std::mutex> lk(gateLock);
+    started = true;
+    gateCondition.notify_all();
+    gateCondition.wait(lk, [&]() { return open; });
+    calls.push_back("first");
+  });
+  {
+    std::unique_lock<std::mutex> lk(gateLock);
+    gateCondition.wait(lk, [&]() { return started; });
+  }
+
+  queue.push([&]() { calls.push_back("recall 1"); }, "recall");
+  queue.push([&]() { calls.push_back("recall 2"); }, "recall");
+  queue.push([&]() { calls.push_back("recall 3"); }, "recall");
+  queue.push([&]() { calls.push_back("store"); }, "store");
+  // Not at the end of the queue, so not replaced
+  queue.push([&]() { calls.push_back("recall 4"); }, "recall");
+  queue.push([&]() { calls.push_back("unkeyed 1"); });
+  queue.push([&]() { calls.push_back("unkeyed 2"); });
+  REQUIRE(queue.depth() == 5);
+  REQUIRE(queue.maxDepth() == 5);
+  REQUIRE(queue.coalesced() == 2);
+
+  {
+    std::unique_lock<std::mutex> lk(gateLock);
+    open = true;
+  }
+  gateCondition.notify_all();
+  queue.waitForCommands();
+
+  std::vector<std::string> expected{"first",    "recall 3",  "store",
+                                    "recall 4", "unkeyed 1", "unkeyed 2"};
+  REQUIRE(calls == expected);
+  REQUIRE(queue.depth() == 0);
+  REQUIRE(queue.processed() == 6);
+
+  queue.resetCounters();
+  REQUIRE(queue.maxDepth() == 0);
+  REQUIRE(queue.processed() == 0);
+  REQUIRE(queue.coalesced() == 0);
+}
+
+TEST_CASE("CommandQueue waits for commands") {
+  CommandQueue queue;
+  // Nothing pushed, so nothing to wait for
+  queue.waitForCommands();
+
+  int sum = 0;
+  for (int i = 1; i <= 100; i++) {
+    queue.push([&sum, i]() { sum += i; });
+  }
+  queue.waitForCommands();
+  REQUIRE(sum == 5050);
+  REQUIRE(queue.processed() == 100);
+  REQUIRE(queue.coalesced() == 0);
+
+  // Commands can push more commands
+  queue.push([&]() { queue.push([&]() { sum = 0; }); });
+  queue.waitForCommands();
+  REQUIRE(sum == 0);
+}
@@ -0,0 +1,99 @@
+#include <fstream>
+#include <string>
+
+#include "al/io/al_File.hpp"
+#include "al/system/al_Time.hpp"
+#include "al/ui/al_Composition.hpp"
+#include "al/ui/al_PresetHandler.hpp"
+#include "al/ui/al_PresetSequencer.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+const char *directory = "test_composition_presets";
+
+void writeFile(const std::string &fileName, const std::string &contents) {
+  std::ofstream f(fileName);
+  f << contents;
+}
+
+// Plays a composition whose last sequence file is rewritten after playback
+// starts, and returns the value set by the sequence that played
+float playRewrittenComposition(size_t preloadCount) {
+  Parameter value{"value", "", 0.0f};
+  float played = -1.0f;
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    for (int i = 1; i <= 3; i++) {
+      value.set(float(i));
+      handler.storePreset(i, "p" + std::to_string(i));
+    }
+    value.set(0.0f);
+    std::string path = File::conformDirectory(handler.getCurrentPath());
+    writeFile(path + "s0.sequence", "p3:0.0:0.1\n::\n");
+    writeFile(path + "s1.sequence", "p3:0.0:0.1\n::\n");
+    writeFile(path + "s2.sequence", "p1:0.0:0.1\n::\n");
+    writeFile(path + "test.composition", "s0:0.0\ns1:0.6\ns2:0.6\n::\n");
+
+    PresetSequencer sequencer;
+    sequencer << handler;
+    Composition composition("test", path);
+    composition << sequencer;
+    composition.setPreloadCount(preloadCount);
+    composition.play();
+    // Step 0 is playing and step 1 waits for its start time
+    al_sleep(0.3);
+    writeFile(path + "s2.sequence", "p2:0.0:0.1\n::\n");
+    for (int i = 0; i < 300; i++) {
+      al_sleep(0.01);
+      if (value.get() == 1.0f || value.get() == 2.0f) {
+        break;
+      }
+    }
+    played = value.get();
+    composition.stop();
+  }
+  Dir::removeRecursively(directory);
+  return played;
+}
+
+}  // namespace
+
+TEST_CASE("Composition preloads upcoming sequences") {
+  // With two steps preloaded, step 2 is read when step 0 starts
+  REQUIRE(playRewrittenComposition(2) == 1.0f);
+  // Without preloading, step 2 is read when step 1 has played
+  REQUIRE(playRewrittenComposition(0) == 2.0f);
+}
+
+TEST_CASE("Composition stops while preloading") {
+  Parameter value{"value", "", 0.0f};
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    handler.storePreset(0, "p0");
+    std::string path = File::conformDirectory(handler.getCurrentPath());
+    writeFile(path + "s0.sequence", "p0:0.0:0.1\n::\n");
+    std::string steps;
+    for (int i = 0; i < 20; i++) {
+      steps += "s0:1.0\n";
+    }
+    writeFile(path + "test.composition", steps + "::\n");
+
+    PresetSequencer sequencer;
+    sequencer << handler;
+    Composition composition("test", path);
+    composition << sequencer;
+    composition.setPreloadCount(20);
+    composition.play();
+    al_sleep(0.05);
+    composition.stop();
+    // Preloaded sequences are dropped and playback can start again
+    composition.play();
+    composition.stop();
+  }
+  Dir::removeRecursively(directory);
+}
@@ -0,0 +1,267 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "al/ui/al_HtmlInterfaceServer.hpp"
+#include "al/ui/al_Parameter.hpp"
+#include "catch.hpp"
+#include "nlohmann/json.hpp"
+
+using namespace al;
+
+namespace {
+
+// Minimal WebSocket client over loopback
+struct WebClient {
+  int socket{-1};
+  std::string in;
+
+  ~WebClient() {
+    if (socket >= 0) {
+      close(socket);
+    }
+  }
+
+  bool connect(uint16_t port) {
+    socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout{5, 0};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    return ::connect(socket, reinterpret_cast<sockaddr *>(&address),
+                     sizeof(address)) == 0;
+  }
+
+  // Returns the status line of the response
+  std::string upgrade(uint16_t port, const std::string &origin,
+                      std::string host = "") {
+    if (host.empty()) {
+      host = "127.0.0.1:" + std::to_string(port);
+    }
+    std::string request = "GET /ws HTTP/1.1\r\nHost: " + host +
+                          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                          "Sec-WebSocket-Version: 13\r\n";
+    if (origin.size() > 0) {
+      request += "Origin: " + origin + "\r\n";
+    }
+    request += "\r\n";
+    send(socket, request.data(), request.size(), 0);
+    size_t end;
+    while ((end = in.find("\r\n\r\n")) == std::string::npos) {
+      if (!receive()) {
+        return "";
+      }
+    }
+    std::string response = in.substr(0, end);
+    in.erase(0, end + 4);
+    return response.substr(0, response.find("\r\n"));
+  }
+
+  // Reads one unmasked text frame shorter than 64 KiB
+  bool readText(std::string &text) {
+    while (in.size() < 2 || (uint8_t(in[1]) == 126 && in.size() < 4)) {
+      if (!receive()) {
+        return false;
+      }
+    }
+    size_t header = 2;
+    size_t length = uint8_t(in[1]) & 0x7F;
+    if (length == 126) {
+      header = 4;
+      length = size_t(uint8_t(in[2])) << 8 | uint8_t(in[3]);
+    }
+    while (in.size() < header + length) {
+      if (!receive()) {
+        return false;
+      }
+    }
+    if ((in[0] & 0x0F) != 0x1) {
+      return false;
+    }
+    text = in.substr(header, length);
+    in.erase(0, header + length);
+    return true;
+  }
+
+  // Sends a masked frame shorter than 64 KiB, as browsers do
+  void sendFrame(uint8_t opcode, const std::string &payload) {
+    std::string frame;
+    frame.push_back(char(0x80 | opcode));
+    if (payload.size() < 126) {
+      frame.push_back(char(0x80 | payload.size()));
+    } else {
+      frame.push_back(char(0x80 | 126));
+      frame.push_back(char(payload.size() >> 8));
+      frame.push_back(char(payload.size() & 0xFF));
+    }
+    const char mask[4] = {0x12, 0x34, 0x56, 0x78};
+    frame.append(mask, 4);
+    for (size_t i = 0; i < payload.size(); i++) {
+      frame.push_back(payload[i] ^ mask[i % 4]);
+    }
+    send(socket, frame.data(), frame.size(), 0);
+  }
+
+  bool receive() {
+    char buffer[4096];
+    ssize_t bytes = recv(socket, buffer, sizeof(buffer), 0);
+    if (bytes <= 0) {
+      return false;
+    }
+    in.append(buffer, size_t(bytes));
+    return true;
+  }
+};
+
+// Wait for a value set by the server thread
+template <class Condition>
+bool waitUntil(Condition condition) {
+  for (int i = 0; i < 200; i++) {
+    if (condition()) {
+      return true;
+    }
+    usleep(10000);
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST_CASE("HtmlInterfaceServer WebSocket updates") {
+  Parameter gain{"gain", "", 0.5f};
+  HtmlInterfaceServer server("", false);
+  server << gain;
+  server.setPushRate(100.0f);
+  REQUIRE(server.startWebServer(0));
+  uint16_t port = server.webServerPort();
+  REQUIRE(port != 0);
+
+  WebClient client;
+  REQUIRE(client.connect(port));
+  std::string origin = "http://127.0.0.1:" + std::to_string(port);
+  REQUIRE(client.upgrade(port, origin) == "HTTP/1.1 101 Switching Protocols");
+
+  std::string text;
+  REQUIRE(client.readText(text));
+  nlohmann::json message = nlohmann::json::parse(text);
+  REQUIRE(message["type"] == "parameters");
+  REQUIRE(message["parameters"].size() == 1);
+  REQUIRE(message["parameters"][0]["address"] == "/gain");
+  REQUIRE(message["parameters"][0]["kind"] == "float");
+
+  // The first push carries every value
+  REQUIRE(client.readText(text));
+  message = nlohmann::json::parse(text);
+  REQUIRE(message["type"] == "values");
+  REQUIRE(message["values"][0][0] == 0);
+  REQUIRE(message["values"][0][1].get<float>() == 0.5f);
+
+  gain.set(0.75f);
+  REQUIRE(client.readText(text));
+  message = nlohmann::json::parse(text);
+  REQUIRE(message["type"] == "values");
+  REQUIRE(message["values"].size() == 1);
+  REQUIRE(message["values"][0][1].get<float>() == 0.75f);
+  server.stopWebServer();
+}
+
+TEST_CASE("HtmlInterfaceServer rejects foreign origins") {
+  Parameter gain{"gain", "", 0.5f};
+  HtmlInterfaceServer server("", false);
+  server << gain;
+  REQUIRE(server.startWebServer(0));
+  uint16_t port = server.webServerPort();
+
+  WebClient foreign;
+  REQUIRE(foreign.connect(port));
+  REQUIRE(foreign.upgrade(port, "http://example.com") ==
+          "HTTP/1.1 403 Forbidden");
+
+  // Clients that are not browsers send no origin
+  WebClient local;
+  REQUIRE(local.connect(port));
+  REQUIRE(local.upgrade(port, "") == "HTTP/1.1 101 Switching Protocols");
+  server.stopWebServer();
+}
+
+TEST_CASE("HtmlInterfaceServer rejects foreign hosts") {
+  Parameter gain{"gain", "", 0.5f};
+  HtmlInterfaceServer server("", false);
+  server << gain;
+  server.addAllowedHost("Studio.local");
+  REQUIRE(server.startWebServer(0));
+  uint16_t port = server.webServerPort();
+  std::string portText = ":" + std::to_string(port);
+
+  // A page from a domain pointed at this machine passes the origin check
+  WebClient rebound;
+  REQUIRE(rebound.connect(port));
+  REQUIRE(rebound.upgrade(port, "http://attacker.example" + portText,
+                          "attacker.example" + portText) ==
+          "HTTP/1.1 403 Forbidden");
+
+  WebClient localhost;
+  REQUIRE(localhost.connect(port));
+  REQUIRE(localhost.upgrade(port, "http://localhost" + portText,
+                            "localhost" + portText) ==
+          "HTTP/1.1 101 Switching Protocols");
+
+  WebClient ipv6;
+  REQUIRE(ipv6.connect(port));
+  REQUIRE(ipv6.upgrade(port, "http://[::1]" + portText, "[::1]" + portText) ==
+          "HTTP/1.1 101 Switching Protocols");
+
+  WebClient allowed;
+  REQUIRE(allowed.connect(port));
+  REQUIRE(allowed.upgrade(port, "http://studio.local" + portText,
+                          "studio.local" + portText) ==
+          "HTTP/1.1 101 Switching Protocols");
+
+  WebClient noHost;
+  REQUIRE(noHost.connect(port));
+  REQUIRE(noHost.upgrade(port, "", portText) == "HTTP/1.1 403 Forbidden");
+  server.stopWebServer();
+}
+
+TEST_CASE("HtmlInterfaceServer controls from the page") {
+  Parameter gain{"gain", "", 0.5f};
+  ParameterInt count{"count", "", 0, "", -100, 100};
+  // count is dispatched through the server's address index
+  ParameterServer parameterServer("127.0.0.1", 10960);
+  parameterServer << count;
+  HtmlInterfaceServer server("", false);
+  server << gain << parameterServer;
+  REQUIRE(server.startWebServer(0));
+  uint16_t port = server.webServerPort();
+
+  WebClient client;
+  REQUIRE(client.connect(port));
+  REQUIRE(client.upgrade(port, "") == "HTTP/1.1 101 Switching Protocols");
+
+  client.sendFrame(0x1, "[\"/gain\", 0.25]");
+  REQUIRE(waitUntil([&]() { return gain.get() == 0.25f; }));
+
+  // A value out of the int range is clamped before conversion
+  client.sendFrame(0x1, "[\"/count\", 1e300]");
+  REQUIRE(waitUntil([&]() { return count.get() == 100; }));
+  client.sendFrame(0x1, "[\"/count\", -1e300]");
+  REQUIRE(waitUntil([&]() { return count.get() == -100; }));
+  client.sendFrame(0x1, "[\"/gain\", 1e300]");
+  REQUIRE(waitUntil([&]() { return gain.get() == gain.max(); }));
+
+  // A raw OSC message in a binary frame
+  osc::Packet packet;
+  packet.beginMessage("/gain");
+  packet << 0.125f;
+  packet.endMessage();
+  client.sendFrame(0x2, std::string(packet.data(), size_t(packet.size())));
+  REQUIRE(waitUntil([&]() { return gain.get() == 0.125f; }));
+  server.stopWebServer();
+}
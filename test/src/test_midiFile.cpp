@@ -0,0 +1,217 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "al/io/al_MIDIFile.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+const char *fileName = "test_midiFile.mid";
+
+struct Note {
+  uint16_t track;
+  uint64_t tick;
+  bool on;
+  int channel;
+  int noteNumber;
+  int velocity;
+};
+
+// Channel note events of a file, or false if a track is malformed
+bool readNotes(const MIDIFile &file, std::vector<Note> &notes) {
+  notes.clear();
+  return file.read([&](const MIDIFileEvent &event) {
+    if (event.isNoteOn() || event.isNoteOff()) {
+      notes.push_back({event.track, event.tick, event.isNoteOn(),
+                       event.channel(), event.data1, event.data2});
+    }
+  });
+}
+
+std::vector<uint8_t> readBytes(const std::string &name) {
+  std::ifstream in(name, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+
+}  // namespace
+
+TEST_CASE("MIDIFile round trip") {
+  MIDIFileWriter writer(96);
+  int track = writer.addTrack("melody");
+  writer.tempo(track, 0, 120.0);
+  // Added out of order. The note off at 96 goes before the note on
+  writer.noteOn(track, 96, 2, 62, 90);
+  writer.noteOn(track, 0, 2, 60, 100);
+  writer.noteOff(track, 96, 2, 60);
+  writer.noteOff(track, 192, 2, 62);
+  REQUIRE(writer.write(fileName));
+
+  MIDIFile file(fileName);
+  std::remove(fileName);
+  REQUIRE(file.isOpen());
+  REQUIRE(file.format() == 0);
+  REQUIRE(file.numTracks() == 1);
+  REQUIRE(file.ticksPerBeat() == 96);
+  REQUIRE_FALSE(file.isSMPTE());
+
+  std::string name;
+  double tempo = 0.0;
+  bool endOfTrack = false;
+  REQUIRE(file.read([&](const MIDIFileEvent &event) {
+    if (event.isMeta() &&
+        event.metaType() == MIDIFileEvent::META_TRACK_NAME) {
+      name.assign(reinterpret_cast<const char *>(event.data), event.size);
+    } else if (event.isMeta() &&
+               event.metaType() == MIDIFileEvent::META_TEMPO) {
+      tempo = event.tempo();
+    } else if (event.isMeta() &&
+               event.metaType() == MIDIFileEvent::META_END_OF_TRACK) {
+      endOfTrack = true;
+      REQUIRE(event.beat == 2.0);
+    }
+  }));
+  REQUIRE(name == "melody");
+  REQUIRE(tempo == Approx(120.0));
+  REQUIRE(endOfTrack);
+
+  std::vector<Note> notes;
+  REQUIRE(readNotes(file, notes));
+  REQUIRE(notes.size() == 4);
+  REQUIRE(notes[0].tick == 0);
+  REQUIRE(notes[0].on);
+  REQUIRE(notes[0].channel == 2);
+  REQUIRE(notes[0].noteNumber == 60);
+  REQUIRE(notes[0].velocity == 100);
+  REQUIRE(notes[1].tick == 96);
+  REQUIRE_FALSE(notes[1].on);
+  REQUIRE(notes[1].noteNumber == 60);
+  REQUIRE(notes[2].tick == 96);
+  REQUIRE(notes[2].on);
+  REQUIRE(notes[2].noteNumber == 62);
+  REQUIRE(notes[2].velocity == 90);
+  REQUIRE(notes[3].tick == 192);
+  REQUIRE_FALSE(notes[3].on);
+}
+
+TEST_CASE("MIDIFile running status") {
+  // Note on, a second note on and a note on with velocity 0 sharing one
+  // status byte
+  const uint8_t data[] = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96,
+                          'M', 'T', 'r', 'k', 0, 0, 0, 14,
+                          0, 0x91, 60, 100,
+                          10, 62, 80,
+                          0x60, 60, 0,
+                          0, 0xFF, 0x2F, 0};
+  MIDIFile file;
+  REQUIRE(file.open(data, sizeof(data)));
+  std::vector<Note> notes;
+  REQUIRE(readNotes(file, notes));
+  REQUIRE(notes.size() == 3);
+  REQUIRE(notes[1].on);
+  REQUIRE(notes[1].tick == 10);
+  REQUIRE(notes[1].channel == 1);
+  REQUIRE(notes[1].noteNumber == 62);
+  REQUIRE(notes[1].velocity == 80);
+  REQUIRE_FALSE(notes[2].on);
+  REQUIRE(notes[2].tick == 106);
+  REQUIRE(notes[2].noteNumber == 60);
+
+  // A data byte without a previous status
+  const uint8_t noStatus[] = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0,
+                              96, 'M', 'T', 'r', 'k', 0, 0, 0, 4,
+                              0, 60, 100, 0};
+  REQUIRE(file.open(noStatus, sizeof(noStatus)));
+  REQUIRE_FALSE(readNotes(file, notes));
+}
+
+TEST_CASE("MIDIFile format 1") {
+  MIDIFileWriter writer(480);
+  int tempoTrack = writer.addTrack("tempo");
+  int bass = writer.addTrack("bass");
+  int lead = writer.addTrack("lead");
+  writer.tempo(tempoTrack, 0, 90.0);
+  writer.timeSignature(tempoTrack, 0, 3, 4);
+  for (int i = 0; i < 100; i++) {
+    writer.noteOn(bass, writer.ticks(i), 0, 36 + i % 12, 100);
+    writer.noteOff(bass, writer.ticks(i + 1), 0, 36 + i % 12);
+  }
+  writer.noteOn(lead, writer.ticks(0.5), 1, 72, 64);
+  writer.noteOff(lead, writer.ticks(1.5), 1, 72);
+  REQUIRE(writer.numTracks() == 3);
+  REQUIRE(writer.write(fileName));
+
+  MIDIFile file(fileName);
+  std::remove(fileName);
+  REQUIRE(file.format() == 1);
+  REQUIRE(file.numTracks() == 3);
+  std::vector<Note> notes;
+  REQUIRE(readNotes(file, notes));
+  REQUIRE(notes.size() == 202);
+  int bassNotes = 0;
+  uint64_t lastBassTick = 0;
+  bool ordered = true;
+  for (auto &note : notes) {
+    if (note.track == 1) {
+      ordered &= note.tick >= lastBassTick;
+      lastBassTick = note.tick;
+      bassNotes += note.on ? 1 : 0;
+    }
+  }
+  REQUIRE(ordered);
+  REQUIRE(bassNotes == 100);
+  REQUIRE(lastBassTick == 48000);
+  REQUIRE(notes.back().track == 2);
+  REQUIRE(notes.back().tick == 720);
+  REQUIRE(notes.back().channel == 1);
+}
+
+TEST_CASE("MIDIFile truncated files") {
+  MIDIFileWriter writer(96);
+  int track = writer.addTrack();
+  for (int i = 0; i < 8; i++) {
+    writer.noteOn(track, uint64_t(i * 96), 0, 60 + i, 100);
+    writer.noteOff(track, uint64_t(i * 96 + 48), 0, 60 + i);
+  }
+  REQUIRE(writer.write(fileName));
+  std::vector<uint8_t> data = readBytes(fileName);
+  std::remove(fileName);
+
+  MIDIFile file;
+  std::vector<Note> notes;
+  REQUIRE(file.open(data.data(), data.size()));
+  REQUIRE(readNotes(file, notes));
+  REQUIRE(notes.size() == 16);
+
+  // The track chunk claims more bytes than are left. Events before the cut
+  // are read, and an event cut short is an error
+  size_t previousNotes = 0;
+  for (size_t size = 0; size < data.size(); size++) {
+    if (!file.open(data.data(), size)) {
+      REQUIRE(size < 22);  // Header or track chunk header incomplete
+      continue;
+    }
+    file.read([&](const MIDIFileEvent &) {});
+    readNotes(file, notes);
+    REQUIRE(notes.size() >= previousNotes);
+    REQUIRE(notes.size() <= 16);
+    previousNotes = notes.size();
+  }
+  // Cut inside the last note off
+  REQUIRE(file.open(data.data(), data.size() - 5));
+  REQUIRE_FALSE(readNotes(file, notes));
+  REQUIRE(notes.size() == 15);
+
+  // Header longer than the file, and a file that is not MIDI
+  std::vector<uint8_t> longHeader = data;
+  longHeader[4] = 0x7F;
+  REQUIRE_FALSE(file.open(longHeader.data(), longHeader.size()));
+  std::vector<uint8_t> badMagic = data;
+  badMagic[0] = 'X';
+  REQUIRE_FALSE(file.open(badMagic.data(), badMagic.size()));
+}
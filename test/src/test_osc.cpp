@@ -1,6 +1,10 @@
 
 #include "catch.hpp"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #include "al/protocol/al_OSC.hpp"
 
 using namespace al;
@@ -79,4 +83,124 @@ TEST_CASE( "OSC multiple receivers" ) {
     REQUIRE(handler2.inString == "world4");
 }
 
+// Counts messages and remembers the thread they were handled on
+class CountingHandler : public osc::PacketHandler {
+public:
+    virtual void onMessage(osc::Message& m) override {
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            thread = std::this_thread::get_id();
+        }
+        if (delay > 0) {
+            al_sleep(delay);
+        }
+        count++;
+    }
+
+    std::thread::id handlerThread() {
+        std::lock_guard<std::mutex> lk(lock);
+        return thread;
+    }
+
+    std::atomic<int> count{0};
+    double delay{0};
+    std::mutex lock;
+    std::thread::id thread;
+};
+
+static bool waitForCount(CountingHandler& handler, int count) {
+    for (int i = 0; i < 300 && handler.count < count; i++) {
+        al_sleep(0.01);
+    }
+    return handler.count == count;
+}
+
+TEST_CASE( "OSC shared and dedicated receive threads" ) {
+    const int numShared = 4;
+    CountingHandler sharedHandlers[numShared];
+    osc::Recv sharedServers[numShared];
+    for (int i = 0; i < numShared; i++) {
+        REQUIRE(sharedServers[i].open(10830 + i, "127.0.0.1", 0.0));
+        sharedServers[i].handler(sharedHandlers[i]);
+        REQUIRE(sharedServers[i].start());
+    }
+    // A slow handler on its own thread does not hold up the shared sockets
+    CountingHandler slowHandler;
+    slowHandler.delay = 1.0;
+    osc::Recv slowServer;
+    REQUIRE(slowServer.open(10840, "127.0.0.1", 0.0));
+    slowServer.handler(slowHandler);
+    slowServer.sharedThread(false);
+    REQUIRE_FALSE(slowServer.sharedThread());
+    REQUIRE(slowServer.start());
+
+    osc::Send(10840, "127.0.0.1").send("/slow", 1);
+    for (int i = 0; i < numShared; i++) {
+        osc::Send send(10830 + i, "127.0.0.1");
+        for (int j = 0; j < 100; j++) {
+            send.send("/count", j);
+        }
+    }
+    for (int i = 0; i < numShared; i++) {
+        REQUIRE(waitForCount(sharedHandlers[i], 100));
+    }
+    REQUIRE(slowHandler.count == 0);
+    REQUIRE(waitForCount(slowHandler, 1));
+
+    std::thread::id sharedThread = sharedHandlers[0].handlerThread();
+    for (int i = 1; i < numShared; i++) {
+        REQUIRE(sharedHandlers[i].handlerThread() == sharedThread);
+    }
+    REQUIRE(slowHandler.handlerThread() != sharedThread);
+
+    // Stopping one shared socket leaves the others running
+    sharedServers[0].stop();
+    osc::Send(10830, "127.0.0.1").send("/count", 0);
+    osc::Send(10831, "127.0.0.1").send("/count", 0);
+    REQUIRE(waitForCount(sharedHandlers[1], 101));
+    REQUIRE(sharedHandlers[0].count == 100);
+    slowServer.stop();
+}
+
+TEST_CASE( "OSC message parsing" ) {
+    osc::Packet p;
+    int32_t blobData = 0x01020304;
+    p.beginMessage("/parse/test");
+    p << 1.5f << 42 << "text" << 2.25 << osc::Blob(&blobData, 4);
+    p.endMessage();
+
+    osc::Message m(p.data(), p.size());
+    REQUIRE(std::string(m.addressPatternData()) == "/parse/test");
+    REQUIRE(m.addressPatternSize() == 11);
+    REQUIRE(std::string(m.typeTagsData()) == "fisdb");
+    REQUIRE(m.addressPattern() == "/parse/test");
+    REQUIRE(m.typeTags() == "fisdb");
+
+    float f = 0;
+    int i = 0;
+    std::string s;
+    double d = 0;
+    osc::Blob b;
+    m >> i;  // Wrong type, does not advance
+    REQUIRE(i == 0);
+    m >> f >> i >> s >> d >> b;
+    REQUIRE(f == 1.5f);
+    REQUIRE(i == 42);
+    REQUIRE(s == "text");
+    REQUIRE(d == 2.25);
+    REQUIRE(b.size == 4);
+    REQUIRE(*static_cast<const int32_t *>(b.data) == blobData);
+
+    m.resetStream();
+    f = 0;
+    m >> f;
+    REQUIRE(f == 1.5f);
+
+    osc::Packet noArguments;
+    noArguments.addMessage("/empty");
+    osc::Message empty(noArguments.data(), noArguments.size());
+    REQUIRE(empty.typeTagsSize() == 0);
+    REQUIRE(empty.addressPattern() == "/empty");
+}
+
 // #endif
@@ -0,0 +1,212 @@
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "al/io/al_File.hpp"
+#include "al/protocol/al_OSC.hpp"
+#include "al/system/al_Time.hpp"
+#include "al/ui/al_PresetHandler.hpp"
+#include "al/ui/al_PresetServer.hpp"
+#include "al/ui/al_SequenceServer.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+// Holds the first caller of pass() until open(), so the commands sent
+// meanwhile wait in the server's queue
+struct Gate {
+  std::mutex lock;
+  std::condition_variable condition;
+  bool entered{false};
+  bool isOpen{false};
+
+  void pass() {
+    std::unique_lock<std::mutex> lk(lock);
+    if (!entered) {
+      entered = true;
+      condition.notify_all();
+      condition.wait(lk, [this]() { return isOpen; });
+    }
+  }
+  void waitEntered() {
+    std::unique_lock<std::mutex> lk(lock);
+    condition.wait(lk, [this]() { return entered; });
+  }
+  void open() {
+    std::unique_lock<std::mutex> lk(lock);
+    isOpen = true;
+    condition.notify_all();
+  }
+};
+
+// Logs "<address> <first argument>" of the messages received
+struct Listener : public osc::PacketHandler {
+  std::mutex lock;
+  std::vector<std::string> messages;
+
+  void onMessage(osc::Message &m) override {
+    std::string entry = m.addressPattern();
+    if (m.typeTags() == "i") {
+      int value;
+      m >> value;
+      entry += " " + std::to_string(value);
+    } else if (m.typeTags() == "s") {
+      std::string value;
+      m >> value;
+      entry += " " + value;
+    }
+    std::unique_lock<std::mutex> lk(lock);
+    messages.push_back(entry);
+  }
+
+  // Messages starting with prefix, once count of them have arrived
+  std::vector<std::string> waitFor(const std::string &prefix, size_t count) {
+    std::vector<std::string> matching;
+    for (int i = 0; i < 200 && matching.size() < count; i++) {
+      al_sleep(0.01);
+      std::unique_lock<std::mutex> lk(lock);
+      matching.clear();
+      for (auto &message : messages) {
+        if (message.compare(0, prefix.size(), prefix) == 0) {
+          matching.push_back(message);
+        }
+      }
+    }
+    return matching;
+  }
+};
+
+template <class Server>
+bool waitForDepth(Server &server, size_t depth) {
+  for (int i = 0; i < 200; i++) {
+    if (server.queueDepth() == depth) {
+      return true;
+    }
+    al_sleep(0.01);
+  }
+  return false;
+}
+
+// Logs play, stop and other messages, holding the first in gate
+struct SequenceConsumer : public osc::MessageConsumer {
+  Gate gate;
+  std::vector<std::string> calls;  // Only written by the worker thread
+
+  bool consumeMessage(osc::Message &m, std::string rootOSCPath) override {
+    gate.pass();
+    std::string entry = m.addressPattern().substr(rootOSCPath.size());
+    if (m.typeTags() == "s") {
+      std::string value;
+      m >> value;
+      entry += " " + value;
+    } else if (m.typeTags() == "f") {
+      float value;
+      m >> value;
+      entry += " " + std::to_string(int(value));
+    }
+    calls.push_back(entry);
+    return true;
+  }
+};
+
+}  // namespace
+
+TEST_CASE("PresetServer command order over loopback") {
+  std::string directory = "test_oscCommandServers_presets";
+  PresetHandler handler(directory);
+  Parameter value{"value", "", 0.0f};
+  handler << value;
+  for (int i = 1; i <= 8; i++) {
+    value.set(float(i));
+    handler.storePreset(i, "preset" + std::to_string(i));
+  }
+
+  Gate gate;
+  handler.registerPresetCallback(
+      [](int, void *, void *userData) { static_cast<Gate *>(userData)->pass(); },
+      &gate);
+
+  Listener listener;
+  osc::Recv listenerSocket(10941, "127.0.0.1", 0.001);
+  listenerSocket.handler(listener);
+  listenerSocket.start();
+
+  PresetServer server("127.0.0.1", 10940);
+  server << handler;
+  server.acknowledgeCommands(true);
+  server.notifyPresetChange(false);
+  server.addListener("127.0.0.1", 10941);
+
+  osc::Send send(10940, "127.0.0.1");
+  send.send("/preset", 1);
+  gate.waitEntered();
+  // A burst of recalls while the first one runs
+  send.send("/preset", 2);
+  send.send("/preset", 3);
+  send.send("/preset", 4);
+  // Stores keep their place, and store mode only affects the next message
+  send.send("/preset/store", 5.0f);
+  send.send("/preset/storeMode", 1.0f);
+  send.send("/preset", 6);
+  send.send("/preset", 7);
+  REQUIRE(waitForDepth(server, 4));
+  REQUIRE(server.coalescedCommands() == 2);
+  gate.open();
+  server.waitForCommands();
+
+  std::vector<std::string> acks = listener.waitFor("/preset/ack", 5);
+  std::vector<std::string> expected{"/preset/ack/recall 1",
+                                    "/preset/ack/recall 4",
+                                    "/preset/ack/store 5",
+                                    "/preset/ack/store 6",
+                                    "/preset/ack/recall 7"};
+  REQUIRE(acks == expected);
+  REQUIRE(server.processedCommands() == 5);
+
+  server.stopServer();
+  listenerSocket.stop();
+  Dir::removeRecursively(directory);
+}
+
+TEST_CASE("SequenceServer command order over loopback") {
+  SequenceConsumer consumer;
+
+  Listener listener;
+  osc::Recv listenerSocket(10951, "127.0.0.1", 0.001);
+  listenerSocket.handler(listener);
+  listenerSocket.start();
+
+  SequenceServer server("127.0.0.1", 10950);
+  server.registerMessageConsumer(consumer);
+  server.acknowledgeCommands(true);
+  server.addListener("127.0.0.1", 10951);
+
+  osc::Send send(10950, "127.0.0.1");
+  send.send("/sequence", "first");
+  consumer.gate.waitEntered();
+  // Only the play requests waiting at the end of the queue are replaced
+  send.send("/sequence", "second");
+  send.send("/sequence", "third");
+  send.send("/sequence/stop");
+  send.send("/sequence/other", 1.0f);
+  send.send("/sequence/other", 2.0f);
+  send.send("/sequence", "fourth");
+  REQUIRE(waitForDepth(server, 5));
+  REQUIRE(server.coalescedCommands() == 1);
+  consumer.gate.open();
+  server.waitForCommands();
+
+  std::vector<std::string> expected{" first", " third", "/stop", "/other 1",
+                                    "/other 2", " fourth"};
+  REQUIRE(consumer.calls == expected);
+  std::vector<std::string> acks = listener.waitFor("/sequence/ack", 6);
+  REQUIRE(acks.size() == 6);
+  REQUIRE(acks[0] == "/sequence/ack /sequence");
+  REQUIRE(acks[2] == "/sequence/ack /sequence/stop");
+
+  server.stopServer();
+  listenerSocket.stop();
+}
@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "al/ui/al_Parameter.hpp"
+#include "al/ui/al_ParameterJournal.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+void pause() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
+
+}  // namespace
+
+TEST_CASE("ParameterJournal state and restore") {
+  Parameter gain{"gain", "", 0.5f};
+  ParameterInt count{"count", "", 1, "", 0, 100};
+  ParameterJournal journal(64);
+  journal.setSnapshotInterval(0);
+  REQUIRE(journal.registerParameter(gain));
+  REQUIRE(journal.registerParameter(count));
+  REQUIRE(journal.parameters().size() == 2);
+
+  pause();
+  gain.set(0.75f);
+  pause();
+  al_sec first = journal.time();
+  pause();
+  gain.set(1.0f);
+  count.set(7);
+  pause();
+  journal.snapshot();
+  pause();
+  count.set(9);
+  pause();
+  al_sec last = journal.time();
+
+  std::vector<ParameterJournal::Value> values;
+  REQUIRE(journal.stateAt(first, values));
+  REQUIRE(values.size() == 2);
+  REQUIRE(values[0].known);
+  REQUIRE(values[0].floats[0] == 0.75f);
+  REQUIRE(values[1].ints[0] == 1);
+
+  // After the snapshot
+  REQUIRE(journal.stateAt(last, values));
+  REQUIRE(values[0].floats[0] == 1.0f);
+  REQUIRE(values[1].ints[0] == 9);
+
+  std::vector<uint32_t> changedIds;
+  journal.changes(first, last,
+                  [&](al_sec, uint32_t id, const ParameterJournal::Value &) {
+                    changedIds.push_back(id);
+                  });
+  REQUIRE((changedIds == std::vector<uint32_t>{0, 1, 1}));
+
+  REQUIRE(journal.restore(first));
+  REQUIRE(gain.get() == 0.75f);
+  REQUIRE(count.get() == 1);
+  REQUIRE(journal.lostChanges() == 0);
+}
+
+TEST_CASE("ParameterJournal file round trip") {
+  Parameter gain{"gain", "", 0.5f};
+  ParameterInt count{"count", "", 1, "", -100, 100};
+  ParameterJournal journal;
+  journal.setSnapshotInterval(0);
+  journal << gain << count;
+
+  pause();
+  gain.set(0.25f);
+  count.set(-3);
+  pause();
+  al_sec middle = journal.time();
+  pause();
+  count.set(42);
+  pause();
+  al_sec end = journal.time();
+
+  std::string fileName = "test_parameterJournal.journal";
+  REQUIRE(journal.writeFile(fileName));
+
+  ParameterJournal loaded;
+  REQUIRE(loaded.readFile(fileName));
+  // Journals with registered parameters can't be replaced
+  REQUIRE_FALSE(journal.readFile(fileName));
+  std::remove(fileName.c_str());
+  REQUIRE(loaded.parameters().size() == 2);
+  REQUIRE(loaded.parameters()[0].address == gain.getFullAddress());
+  REQUIRE(loaded.parameters()[0].type == 'f');
+  REQUIRE(loaded.parameters()[1].type == 'i');
+  REQUIRE(loaded.parameters()[1].parameter == nullptr);
+
+  std::vector<ParameterJournal::Value> values;
+  REQUIRE(loaded.stateAt(middle, values));
+  REQUIRE(values[0].floats[0] == 0.25f);
+  REQUIRE(values[1].ints[0] == -3);
+  REQUIRE(loaded.stateAt(end, values));
+  REQUIRE(values[0].floats[0] == 0.25f);
+  REQUIRE(values[1].ints[0] == 42);
+}
@@ -0,0 +1,87 @@
+#include <string>
+#include <vector>
+
+#include "al/ui/al_Parameter.hpp"
+#include "al/ui/al_ParameterScheduler.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+TEST_CASE("ParameterScheduler one callback per flush") {
+  Parameter gain{"gain", "", 0.0f};
+  ParameterScheduler scheduler;
+  scheduler << gain;
+
+  std::vector<float> values;
+  gain.registerChangeCallback([&](float value) { values.push_back(value); });
+  gain.set(0.1f);
+  gain.set(0.2f);
+  gain.set(0.3f);
+  REQUIRE(values.empty());
+  REQUIRE(scheduler.flush() == 1);
+  REQUIRE(values.size() == 1);
+  REQUIRE(values[0] == 0.3f);
+  REQUIRE(gain.get() == 0.3f);
+
+  // Nothing changed
+  REQUIRE(scheduler.flush() == 0);
+  REQUIRE(values.size() == 1);
+}
+
+TEST_CASE("ParameterScheduler dependency order") {
+  Parameter gain{"gain", "", 0.0f};
+  Parameter cutoff{"cutoff", "", 0.0f};
+  Parameter morph{"morph", "", 0.0f};
+  ParameterScheduler scheduler;
+  // Registered in the reverse of the dependency order
+  scheduler << gain << cutoff << morph;
+  REQUIRE(scheduler.addDependency(morph, cutoff));
+  REQUIRE(scheduler.addDependency(cutoff, gain));
+  std::vector<ParameterMeta *> order{&morph, &cutoff, &gain};
+  REQUIRE(scheduler.order() == order);
+
+  std::vector<std::string> calls;
+  morph.registerChangeCallback([&](float value) {
+    calls.push_back("morph");
+    cutoff.set(value * 2.0f);
+  });
+  cutoff.registerChangeCallback([&](float value) {
+    calls.push_back("cutoff");
+    gain.set(value + 1.0f);
+  });
+  gain.registerChangeCallback([&](float) { calls.push_back("gain"); });
+
+  gain.set(0.5f);
+  morph.set(1.0f);
+  // Values set by earlier callbacks are processed in the same flush
+  REQUIRE(scheduler.flush() == 3);
+  std::vector<std::string> expected{"morph", "cutoff", "gain"};
+  REQUIRE(calls == expected);
+  REQUIRE(cutoff.get() == 2.0f);
+  REQUIRE(gain.get() == 3.0f);
+  REQUIRE(scheduler.flush() == 0);
+}
+
+TEST_CASE("ParameterScheduler rejects cycles") {
+  Parameter a{"a", "", 0.0f};
+  Parameter b{"b", "", 0.0f};
+  Parameter c{"c", "", 0.0f};
+  ParameterScheduler scheduler;
+  REQUIRE(scheduler.addDependency(a, b));
+  REQUIRE(scheduler.addDependency(b, c));
+  REQUIRE(scheduler.addDependency(a, b));  // Already declared
+  REQUIRE_FALSE(scheduler.addDependency(c, a));
+  REQUIRE_FALSE(scheduler.addDependency(b, b));
+  // The order is unchanged
+  std::vector<ParameterMeta *> order{&a, &b, &c};
+  REQUIRE(scheduler.order() == order);
+
+  std::vector<std::string> calls;
+  a.registerChangeCallback([&](float) { calls.push_back("a"); });
+  c.registerChangeCallback([&](float) { calls.push_back("c"); });
+  c.set(1.0f);
+  a.set(1.0f);
+  REQUIRE(scheduler.flush() == 2);
+  std::vector<std::string> expected{"a", "c"};
+  REQUIRE(calls == expected);
+}
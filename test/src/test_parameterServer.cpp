@@ -0,0 +1,230 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "al/protocol/al_OSC.hpp"
+#include "al/system/al_Time.hpp"
+#include "al/ui/al_Parameter.hpp"
+#include "al/ui/al_ParameterBundle.hpp"
+#include "al/ui/al_ParameterServer.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+// Passes the message in packet to the server as if it had been received
+void dispatch(ParameterServer &server, const osc::Packet &packet) {
+  osc::Message m(packet.data(), int(packet.size()));
+  server.onMessage(m);
+}
+
+template <class... Values>
+void dispatch(ParameterServer &server, const std::string &address,
+              const Values &... values) {
+  osc::Packet packet;
+  packet.addMessage(address, values...);
+  dispatch(server, packet);
+}
+
+// Receives UDP packets over loopback, one at a time, so bundles can be counted
+struct PacketReceiver : public osc::PacketHandler {
+  int socket{-1};
+  std::vector<std::string> messages;  // "<address> <first argument>"
+
+  explicit PacketReceiver(uint16_t port) {
+    socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    timeval timeout{0, 500000};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    bind(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+  }
+  ~PacketReceiver() { close(socket); }
+
+  // Returns the size of the packet received, 0 on timeout
+  size_t receive() {
+    char buffer[2048];
+    ssize_t size = recv(socket, buffer, sizeof(buffer), 0);
+    if (size <= 0) {
+      return 0;
+    }
+    parse(buffer, int(size));
+    return size_t(size);
+  }
+
+  void onMessage(osc::Message &m) override {
+    std::string entry = m.addressPattern();
+    if (m.typeTags()[0] == 'f') {
+      float value;
+      m >> value;
+      entry += " " + std::to_string(int(value));
+    }
+    messages.push_back(entry);
+  }
+};
+
+// Sets source to each value until target receives it. Returns false when it
+// doesn't arrive within a second
+bool setUntilReceived(Parameter &source, Parameter &target, float value,
+                      float margin = 0.0f) {
+  for (int i = 0; i < 100; i++) {
+    source.set(value + 1.0f);
+    source.set(value);
+    al_sleep(0.01);
+    if (std::abs(target.get() - value) <= margin) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST_CASE("ParameterServer dispatches registered addresses") {
+  Parameter gain{"gain", "", 0.0f};
+  ParameterInt count{"count", "group"};
+  ParameterString name{"name"};
+  ParameterPose pose{"pose"};
+  ParameterServer server("127.0.0.1", 9010, false);
+  server << gain << count << name << pose;
+
+  dispatch(server, "/gain", 0.5f);
+  REQUIRE(gain.get() == 0.5f);
+  dispatch(server, "/group/count", 3);
+  REQUIRE(count.get() == 3);
+  dispatch(server, "/name", "text");
+  REQUIRE(name.get() == "text");
+
+  // Messages with other type tags or addresses are ignored
+  dispatch(server, "/gain", "text");
+  dispatch(server, "/gain/x", 0.25f);
+  dispatch(server, "/count", 4);
+  REQUIRE(gain.get() == 0.5f);
+  REQUIRE(count.get() == 3);
+
+  // Pose sub-addresses
+  dispatch(server, "/pose/pos", 1.0f, 2.0f, 3.0f);
+  REQUIRE(pose.get().pos() == Vec3d(1.0, 2.0, 3.0));
+  dispatch(server, "/pose/pos/y", -2.0f);
+  REQUIRE(pose.get().pos() == Vec3d(1.0, -2.0, 3.0));
+  osc::Packet packet;
+  packet.beginMessage("/pose");
+  packet << 4.0f << 5.0f << 6.0f << 0.0f << 1.0f << 0.0f << 0.0f;
+  packet.endMessage();
+  dispatch(server, packet);
+  REQUIRE(pose.get().pos() == Vec3d(4.0, 5.0, 6.0));
+  REQUIRE(pose.get().quat().x == 1.0);
+
+  server.unregisterParameter(gain);
+  dispatch(server, "/gain", 0.75f);
+  REQUIRE(gain.get() == 0.5f);
+}
+
+TEST_CASE("ParameterServer dispatches bundle addresses") {
+  Parameter level{"level", "", 0.0f};
+  Parameter pan{"pan", "", 0.0f};
+  ParameterPose position{"position"};
+  ParameterBundle bundle("voice");
+  bundle << level << position;
+  ParameterServer server("127.0.0.1", 9010, false);
+  server << bundle;
+
+  std::string prefix = bundle.bundlePrefix();
+  dispatch(server, prefix + "/level", 0.5f);
+  REQUIRE(level.get() == 0.5f);
+  dispatch(server, prefix + "/position/pos/z", 2.0f);
+  REQUIRE(position.get().pos().z == 2.0);
+  // Only the bundle prefixed address is registered
+  dispatch(server, "/level", 0.25f);
+  REQUIRE(level.get() == 0.5f);
+
+  // Parameters added to a registered bundle are indexed on the next message
+  dispatch(server, prefix + "/pan", 0.5f);
+  REQUIRE(pan.get() == 0.0f);
+  bundle << pan;
+  dispatch(server, prefix + "/pan", 0.5f);
+  REQUIRE(pan.get() == 0.5f);
+
+  // Also parameters in sub-bundles
+  Parameter depth{"depth", "", 0.0f};
+  ParameterBundle effect("effect");
+  effect << depth;
+  bundle.addBundle(effect);
+  dispatch(server, effect.bundlePrefix() + "/depth", 0.5f);
+  REQUIRE(depth.get() == 0.5f);
+}
+
+TEST_CASE("OSCNotifier coalesces notifications into bundles") {
+  PacketReceiver receiver(10960);
+  OSCNotifier notifier;
+  notifier.addListener("127.0.0.1", 10960);
+  // Slow enough that only flushNotifications() sends
+  notifier.setNotificationRate(0.1f);
+
+  notifier.notifyListeners("/a", 1.0f);
+  notifier.notifyListeners("/b", 5.0f);
+  notifier.notifyListeners("/a", 2.0f);
+  notifier.notifyListeners("/a", 3.0f);
+  notifier.flushNotifications();
+  REQUIRE(receiver.receive() > 0);
+  REQUIRE(receiver.receive() == 0);
+  std::vector<std::string> expected{"/a 3", "/b 5"};
+  REQUIRE(receiver.messages == expected);
+
+  // "#bundle", time tag and three 16 byte messages with their sizes
+  receiver.messages.clear();
+  notifier.setMaxPacketSize(76);
+  for (int i = 0; i < 10; i++) {
+    notifier.notifyListeners("/p" + std::to_string(i), float(i));
+  }
+  notifier.flushNotifications();
+  size_t packets = 0;
+  while (size_t size = receiver.receive()) {
+    REQUIRE(size <= 76);
+    packets++;
+  }
+  REQUIRE(packets == 4);
+  REQUIRE(receiver.messages.size() == 10);
+  REQUIRE(receiver.messages.back() == "/p9 9");
+
+  // Immediate notifications once the rate is 0
+  receiver.messages.clear();
+  notifier.setNotificationRate(0.0f);
+  notifier.notifyListeners("/a", 4.0f);
+  notifier.notifyListeners("/a", 6.0f);
+  REQUIRE(receiver.receive() > 0);
+  REQUIRE(receiver.receive() > 0);
+  expected = {"/a 4", "/a 6"};
+  REQUIRE(receiver.messages == expected);
+}
+
+TEST_CASE("ParameterServer handshake streams parameters") {
+  Parameter gain{"gain", "", 0.0f, "", 0.0f, 10.0f};
+  Parameter receivedGain{"gain", "", 0.0f, "", 0.0f, 10.0f};
+  ParameterServer primary("127.0.0.1", 10970);
+  primary << gain;
+  primary.startHandshakeServer("127.0.0.1");
+  ParameterServer secondary("127.0.0.1", 10971);
+  secondary << receivedGain;
+  secondary.startCommandListener("127.0.0.1");
+
+  REQUIRE(setUntilReceived(gain, receivedGain, 0.5f));
+
+  // Values sent after a change of step are decoded with the new step
+  primary.setStreamQuantization(gain, 0.1f);
+  REQUIRE(setUntilReceived(gain, receivedGain, 3.7f, 0.05f));
+  gain.set(2.31f);
+  for (int i = 0; i < 100 && receivedGain.get() != Approx(2.3f); i++) {
+    al_sleep(0.01);
+  }
+  REQUIRE(receivedGain.get() == Approx(2.3f).margin(0.05f));
+}
@@ -0,0 +1,185 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "al/ui/al_ParameterStream.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+struct StreamPair {
+  ParameterStreamEncoder encoder;
+  ParameterStreamDecoder decoder;
+  std::vector<std::vector<char>> frames;
+  std::vector<std::vector<double>> received;
+
+  uint32_t add(const std::string &address, uint8_t type, uint8_t components,
+               float step = 0.0f) {
+    ParameterStreamEntry entry;
+    entry.address = address;
+    entry.type = type;
+    entry.components = components;
+    entry.step = step;
+    uint32_t id = encoder.addParameter(entry);
+    decoder.setParameter(id, encoder.parameter(id));
+    received.emplace_back();
+    return id;
+  }
+
+  // Encode into frames that are not delivered until decodeFrame()
+  void encode(size_t maxFrameSize = 1024) {
+    encoder.encode(maxFrameSize, [this](const char *data, size_t size) {
+      frames.emplace_back(data, data + size);
+    });
+  }
+
+  bool decodeFrame(size_t index) {
+    const std::vector<char> &frame = frames[index];
+    return decoder.decode(
+        frame.data(), frame.size(), [this](uint32_t id, const double *values) {
+          const double *end = values + encoder.parameter(id).components;
+          received[id].assign(values, end);
+        });
+  }
+};
+
+}  // namespace
+
+TEST_CASE("ParameterStream round trip") {
+  StreamPair stream;
+  uint32_t gain = stream.add("/gain", ParameterStreamEntry::FLOAT, 1);
+  uint32_t position = stream.add("/pos", ParameterStreamEntry::FLOAT, 3, 0.01f);
+  uint32_t count = stream.add("/count", ParameterStreamEntry::INT, 1);
+
+  float gainValue = 0.25f;
+  float positionValues[3] = {1.0f, -2.5f, 0.33f};
+  int32_t countValue = -42;
+  stream.encoder.setValue(gain, &gainValue);
+  stream.encoder.setValue(position, positionValues);
+  stream.encoder.setValue(count, &countValue);
+  REQUIRE(stream.encoder.pending());
+  stream.encode();
+  REQUIRE_FALSE(stream.encoder.pending());
+  REQUIRE(stream.frames.size() == 1);
+
+  uint32_t session;
+  REQUIRE(ParameterStreamDecoder::frameSession(
+      stream.frames[0].data(), stream.frames[0].size(), session));
+  REQUIRE(session == stream.encoder.session());
+
+  REQUIRE(stream.decodeFrame(0));
+  REQUIRE(stream.received[gain][0] == 0.25);
+  REQUIRE(stream.received[position][0] == Approx(1.0));
+  REQUIRE(stream.received[position][1] == Approx(-2.5));
+  REQUIRE(stream.received[position][2] == Approx(0.33).margin(0.005));
+  REQUIRE(stream.received[count][0] == -42.0);
+
+  // Relative values
+  countValue = 1000;
+  positionValues[1] = -2.0f;
+  stream.encoder.setValue(count, &countValue);
+  stream.encoder.setValue(position, positionValues);
+  stream.encode();
+  REQUIRE(stream.decodeFrame(1));
+  REQUIRE(stream.received[count][0] == 1000.0);
+  REQUIRE(stream.received[position][1] == Approx(-2.0));
+  REQUIRE(stream.decoder.lostFrames() == 0);
+}
+
+TEST_CASE("ParameterStream dropped frame") {
+  StreamPair stream;
+  uint32_t count = stream.add("/count", ParameterStreamEntry::INT, 1);
+  uint32_t level = stream.add("/level", ParameterStreamEntry::FLOAT, 1, 0.1f);
+
+  int32_t countValue = 10;
+  float levelValue = 1.0f;
+  stream.encoder.setValue(count, &countValue);
+  stream.encoder.setValue(level, &levelValue);
+  stream.encode();
+  REQUIRE(stream.decodeFrame(0));
+
+  // Frame 1 is lost
+  countValue = 20;
+  stream.encoder.setValue(count, &countValue);
+  stream.encode();
+
+  // Frame 2 is relative to frame 1, so its value can't be applied
+  countValue = 25;
+  stream.encoder.setValue(count, &countValue);
+  stream.encode();
+  REQUIRE(stream.decodeFrame(2));
+  REQUIRE(stream.decoder.lostFrames() == 1);
+  REQUIRE(stream.received[count][0] == 10.0);
+
+  // A key frame sends every value absolute, also values that did not change
+  stream.encoder.keyFrame();
+  stream.encode();
+  REQUIRE(stream.frames.size() == 4);
+  REQUIRE(stream.decodeFrame(3));
+  REQUIRE(stream.received[count][0] == 25.0);
+  REQUIRE(stream.received[level][0] == Approx(1.0));
+
+  // Relative values apply again
+  countValue = 26;
+  stream.encoder.setValue(count, &countValue);
+  stream.encode();
+  REQUIRE(stream.decodeFrame(4));
+  REQUIRE(stream.received[count][0] == 26.0);
+  REQUIRE(stream.decoder.lostFrames() == 1);
+}
+
+TEST_CASE("ParameterStream unknown parameter") {
+  StreamPair stream;
+  uint32_t count = stream.add("/count", ParameterStreamEntry::INT, 1);
+  int32_t countValue = 3;
+  stream.encoder.setValue(count, &countValue);
+  stream.encode();
+
+  ParameterStreamDecoder decoder;
+  const std::vector<char> &frame = stream.frames[0];
+  REQUIRE_FALSE(decoder.decode(frame.data(), frame.size(),
+                               [](uint32_t, const double *) {}));
+  REQUIRE_FALSE(decoder.decode(frame.data(), 4,
+                               [](uint32_t, const double *) {}));
+}
+
+TEST_CASE("ParameterStream new session") {
+  StreamPair stream;
+  uint32_t count = stream.add("/count", ParameterStreamEntry::INT, 1);
+  uint32_t level = stream.add("/level", ParameterStreamEntry::FLOAT, 1);
+
+  int32_t countValue = 3;
+  float levelValue = 0.5f;
+  stream.encoder.setValue(count, &countValue);
+  stream.encoder.setValue(level, &levelValue);
+  stream.encode();
+  REQUIRE(stream.decodeFrame(0));
+
+  // After a change of step, frames are sent in a new session that carries
+  // every value
+  uint32_t previousSession = stream.encoder.session();
+  stream.encoder.setStep(level, 0.1f);
+  stream.encoder.newSession();
+  REQUIRE(stream.encoder.session() != previousSession);
+  stream.encode();
+  REQUIRE(stream.frames.size() == 2);
+  uint32_t session;
+  REQUIRE(ParameterStreamDecoder::frameSession(
+      stream.frames[1].data(), stream.frames[1].size(), session));
+  REQUIRE(session == stream.encoder.session());
+
+  // A decoder for the new session decodes its first frame
+  ParameterStreamDecoder decoder;
+  decoder.setParameter(count, stream.encoder.parameter(count));
+  decoder.setParameter(level, stream.encoder.parameter(level));
+  double received[2] = {0.0, 0.0};
+  REQUIRE(decoder.decode(stream.frames[1].data(), stream.frames[1].size(),
+                         [&](uint32_t id, const double *values) {
+                           received[id] = values[0];
+                         }));
+  REQUIRE(received[count] == 3.0);
+  REQUIRE(received[level] == Approx(0.5));
+  REQUIRE(decoder.lostFrames() == 0);
+}
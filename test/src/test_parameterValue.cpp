@@ -0,0 +1,133 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "al/ui/al_Parameter.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+// Several words, so a torn read shows as words that differ
+struct Words {
+  uint64_t values[4];
+};
+
+const int numWriters = 3;
+const int writesPerThread = 20000;
+
+// Run writers storing values made from (writer, iteration) while the
+// calling thread checks every value it reads
+template <class Write, class Check>
+void writeConcurrently(Write write, Check check) {
+  std::atomic<int> running{numWriters};
+  std::vector<std::thread> writers;
+  for (int w = 0; w < numWriters; w++) {
+    writers.emplace_back([&, w]() {
+      for (int i = 1; i <= writesPerThread; i++) {
+        write(w, i);
+      }
+      running--;
+    });
+  }
+  while (running > 0) {
+    check();
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  check();
+}
+
+}  // namespace
+
+TEST_CASE("ParameterValue arithmetic types") {
+  ParameterValue<int64_t> value(5);
+  REQUIRE(value.load() == 5);
+  ParameterValue<int64_t> copy(value);
+  value.store(7);
+  REQUIRE(copy.load() == 5);
+  copy = value;
+  REQUIRE(copy.load() == 7);
+
+  value.store(0);
+  int64_t last = 0;
+  bool valid = true;
+  writeConcurrently(
+      [&](int w, int i) { value.store(int64_t(i) * numWriters + w); },
+      [&]() {
+        int64_t current = value.load();
+        valid &= current >= 0 &&
+                 current < int64_t(writesPerThread + 1) * numWriters;
+        last = current;
+      });
+  REQUIRE(valid);
+  // The last value read after the writers finished is one of their last
+  REQUIRE(last / numWriters == writesPerThread);
+}
+
+TEST_CASE("ParameterValue plain data types") {
+  Words initial{{1, 1, 1, 1}};
+  ParameterValue<Words> value(initial);
+  REQUIRE(value.load().values[3] == 1);
+  ParameterValue<Words> copy(value);
+  value.store(Words{{2, 2, 2, 2}});
+  REQUIRE(copy.load().values[0] == 1);
+  copy = value;
+  REQUIRE(copy.load().values[0] == 2);
+
+  bool torn = false;
+  Words last{};
+  writeConcurrently(
+      [&](int w, int i) {
+        uint64_t v = uint64_t(i) * numWriters + w;
+        value.store(Words{{v, v, v, v}});
+      },
+      [&]() {
+        last = value.load();
+        for (int j = 1; j < 4; j++) {
+          torn |= last.values[j] != last.values[0];
+        }
+      });
+  REQUIRE_FALSE(torn);
+  REQUIRE(last.values[0] / numWriters == writesPerThread);
+
+  ParameterValue<Vec3f> vec(Vec3f(1, 2, 3));
+  REQUIRE(vec.load() == Vec3f(1, 2, 3));
+}
+
+TEST_CASE("ParameterValue strings") {
+  ParameterValue<std::string> value("start");
+  REQUIRE(value.load() == "start");
+  REQUIRE(*value.snapshot() == "start");
+  ParameterValue<std::string> copy(value);
+  value.store("next");
+  REQUIRE(copy.load() == "start");
+  copy = value;
+  REQUIRE(copy.load() == "next");
+
+  // Snapshots stay valid and unchanged after later writes
+  auto snapshot = value.snapshot();
+  value.store("later");
+  REQUIRE(*snapshot == "next");
+
+  value.store("x");
+  bool torn = false;
+  std::string last;
+  writeConcurrently(
+      [&](int w, int i) {
+        // Strings of a single character with varying length
+        value.store(std::string(size_t(1 + i % 64), char('a' + w)));
+      },
+      [&]() {
+        last = value.load();
+        torn |= last.empty() ||
+                last.find_first_not_of(last[0]) != std::string::npos;
+        auto current = value.snapshot();
+        torn |= current->empty();
+      });
+  REQUIRE_FALSE(torn);
+  REQUIRE(last.size() == size_t(1 + writesPerThread % 64));
+}
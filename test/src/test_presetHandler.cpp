@@ -0,0 +1,226 @@
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "al/io/al_File.hpp"
+#include "al/system/al_Time.hpp"
+#include "al/system/al_Watcher.hpp"
+#include "al/ui/al_PresetHandler.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+const char *directory = "test_presetHandler_presets";
+
+float presetValue(PresetHandler &handler, const std::string &name) {
+  PresetHandler::ParameterStates values = handler.loadPresetValues(name);
+  auto value = values.find("/value");
+  return value != values.end() ? value->second[0].get<float>() : -1.0f;
+}
+
+// Scalar reference for a morph from start to end at phase
+float morphReference(PresetHandler::MorphCurve curve, float start, float end,
+                     float phase) {
+  if (curve == PresetHandler::MORPH_SMOOTHSTEP) {
+    phase = phase * phase * (3.0f - 2.0f * phase);
+  }
+  if (curve == PresetHandler::MORPH_EXPONENTIAL && start * end > 0.0f) {
+    float logStart = std::log(std::abs(start));
+    float value =
+        std::exp(logStart + phase * (std::log(std::abs(end)) - logStart));
+    return end < 0.0f ? -value : value;
+  }
+  return start + phase * (end - start);
+}
+
+}  // namespace
+
+TEST_CASE("PresetHandler cache") {
+  Parameter value{"value", "", 0.0f};
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    value.set(1.0f);
+    handler.storePreset(0, "a");
+    value.set(2.0f);
+    handler.storePreset(1, "b");
+
+    handler.enableCache(true);
+    handler.resetCacheCounters();
+    REQUIRE(presetValue(handler, "a") == 1.0f);
+    REQUIRE(presetValue(handler, "a") == 1.0f);
+    REQUIRE(presetValue(handler, "b") == 2.0f);
+    REQUIRE(handler.cacheMisses() == 2);
+    REQUIRE(handler.cacheHits() == 1);
+
+    // Saving a preset drops it from the cache
+    PresetHandler::ParameterStates values = handler.loadPresetValues("a");
+    values["/value"][0] = ParameterField(5.0f);
+    REQUIRE(handler.savePresetValues(values, "a", true));
+    handler.resetCacheCounters();
+    REQUIRE(presetValue(handler, "a") == 5.0f);
+    REQUIRE(presetValue(handler, "b") == 2.0f);
+    REQUIRE(handler.cacheMisses() == 1);
+    REQUIRE(handler.cacheHits() == 1);
+
+    // Other writers signal changes through the Watcher
+    handler.resetCacheCounters();
+    Watcher::notify(File::conformDirectory(handler.getCurrentPath()) +
+                        "b.preset",
+                    "modified");
+    REQUIRE(presetValue(handler, "b") == 2.0f);
+    REQUIRE(handler.cacheMisses() == 1);
+
+    handler.clearCache();
+    handler.resetCacheCounters();
+    REQUIRE(presetValue(handler, "b") == 2.0f);
+    REQUIRE(handler.cacheMisses() == 1);
+  }
+  Dir::removeRecursively(directory);
+}
+
+TEST_CASE("PresetHandler preset map cache") {
+  Parameter value{"value", "", 0.0f};
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    handler.storePreset(0, "a");
+    handler.storePreset(1, "b");
+    handler.storeCurrentPresetMap("test");
+
+    handler.enableCache(true);
+    handler.resetCacheCounters();
+    REQUIRE(handler.readPresetMap("test").size() == 2);
+    REQUIRE(handler.readPresetMap("test").size() == 2);
+    REQUIRE(handler.cacheMisses() == 1);
+    REQUIRE(handler.cacheHits() == 1);
+
+    // Storing the map drops it from the cache
+    handler.storePreset(2, "c");
+    handler.storeCurrentPresetMap("test");
+    handler.resetCacheCounters();
+    std::map<int, std::string> presets = handler.readPresetMap("test");
+    REQUIRE(presets.size() == 3);
+    REQUIRE(presets[2] == "c");
+    REQUIRE(handler.cacheMisses() == 1);
+    REQUIRE(handler.availablePresets().size() == 3);
+  }
+  Dir::removeRecursively(directory);
+}
+
+TEST_CASE("PresetHandler cache size") {
+  Parameter value{"value", "", 0.0f};
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    for (int i = 0; i < 3; i++) {
+      value.set(float(i));
+      handler.storePreset(i, "p" + std::to_string(i));
+    }
+    handler.enableCache(true);
+    handler.setCacheSize(2);
+    presetValue(handler, "p0");
+    presetValue(handler, "p1");
+    presetValue(handler, "p2");
+    REQUIRE(handler.cachedPresets() == 2);
+
+    // p0 was the least recently used. Using p1 leaves p2 to be dropped next
+    handler.resetCacheCounters();
+    REQUIRE(presetValue(handler, "p1") == 1.0f);
+    REQUIRE(presetValue(handler, "p0") == 0.0f);
+    REQUIRE(handler.cacheHits() == 1);
+    REQUIRE(handler.cacheMisses() == 1);
+    REQUIRE(presetValue(handler, "p1") == 1.0f);
+    REQUIRE(presetValue(handler, "p0") == 0.0f);
+    REQUIRE(presetValue(handler, "p2") == 2.0f);
+    REQUIRE(handler.cacheHits() == 3);
+    REQUIRE(handler.cacheMisses() == 2);
+
+    // Shrinking drops the least recently used presets
+    handler.setCacheSize(1);
+    REQUIRE(handler.cachedPresets() == 1);
+    handler.resetCacheCounters();
+    presetValue(handler, "p2");
+    presetValue(handler, "p0");
+    REQUIRE(handler.cacheHits() == 1);
+    REQUIRE(handler.cacheMisses() == 1);
+  }
+  Dir::removeRecursively(directory);
+}
+
+TEST_CASE("PresetHandler prefetch") {
+  Parameter value{"value", "", 0.0f};
+  {
+    PresetHandler handler(TimeMasterMode::TIME_MASTER_FREE, directory);
+    handler << value;
+    for (int i = 0; i < 5; i++) {
+      value.set(float(i));
+      handler.storePreset(i, "p" + std::to_string(i));
+    }
+    handler.enablePrefetch(true, 1);
+    REQUIRE(handler.cacheEnabled());
+    handler.resetCacheCounters();
+    handler.recallPresetSynchronous("p2");
+    // p1 and p3 are read on the prefetch thread
+    for (int i = 0; i < 200 && handler.cachedPresets() < 3; i++) {
+      al_sleep(0.01);
+    }
+    REQUIRE(handler.cachedPresets() == 3);
+    // Prefetches are not counted
+    REQUIRE(handler.cacheMisses() == 1);
+
+    handler.resetCacheCounters();
+    REQUIRE(presetValue(handler, "p1") == 1.0f);
+    REQUIRE(presetValue(handler, "p3") == 3.0f);
+    REQUIRE(handler.cacheHits() == 2);
+    REQUIRE(presetValue(handler, "p0") == 0.0f);
+    REQUIRE(handler.cacheMisses() == 1);
+
+    handler.enablePrefetch(false);
+    REQUIRE(handler.cacheEnabled());
+  }
+  Dir::removeRecursively(directory);
+}
+
+TEST_CASE("PresetHandler morph curves") {
+  const PresetHandler::MorphCurve curves[] = {
+      PresetHandler::MORPH_LINEAR, PresetHandler::MORPH_EXPONENTIAL,
+      PresetHandler::MORPH_SMOOTHSTEP};
+  // Counts below, at and above the interpolation vector width
+  for (size_t count : {3, 4, 7, 9}) {
+    for (auto curve : curves) {
+      std::vector<std::unique_ptr<Parameter>> params;
+      std::vector<float> start, end;
+      PresetHandler handler(TimeMasterMode::TIME_MASTER_FREE, directory);
+      PresetHandler::ParameterStates target;
+      for (size_t i = 0; i < count; i++) {
+        // Alternate signs. The last lane crosses zero, so exponential morphs
+        // fall back to linear for it
+        float sign = i % 2 ? -1.0f : 1.0f;
+        start.push_back(sign * (0.5f + i));
+        end.push_back(i == count - 1 ? -start.back() : sign * (4.0f + 3 * i));
+        params.push_back(std::make_unique<Parameter>(
+            "p" + std::to_string(i), "", start.back(), "", -100.0f, 100.0f));
+        handler << *params.back();
+        target[params.back()->getFullAddress()] = {ParameterField(end.back())};
+      }
+      handler.setMorphCurve(curve);
+      handler.setMorphStepTime(0.1f);
+      handler.morphTo(target, 1.0f);
+      for (int step = 0; step <= 10; step++) {
+        handler.stepMorphing();
+        for (size_t i = 0; i < count; i++) {
+          float expected =
+              morphReference(curve, start[i], end[i], step / 10.0f);
+          INFO("count " << count << " curve " << curve << " step " << step
+                        << " lane " << i);
+          REQUIRE(params[i]->get() == Approx(expected).epsilon(1e-5));
+        }
+      }
+    }
+  }
+  Dir::removeRecursively(directory);
+}
@@ -0,0 +1,139 @@
+#include <fstream>
+#include <string>
+
+#include "al/io/al_File.hpp"
+#include "al/ui/al_PresetHandler.hpp"
+#include "al/ui/al_PresetSequencer.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+const char *directory = "test_presetSequencer_presets";
+
+void writeSequence(PresetHandler &handler, const std::string &name,
+                   const std::string &contents) {
+  std::ofstream f(File::conformDirectory(handler.getCurrentPath()) + name +
+                  ".sequence");
+  f << contents;
+}
+
+// Steps the sequencer by dt until time seconds have passed
+void advance(PresetSequencer &sequencer, double time, double dt = 0.01) {
+  for (double t = 0.0; t < time; t += dt) {
+    sequencer.stepSequencer(dt);
+  }
+}
+
+}  // namespace
+
+TEST_CASE("PresetSequencer plays compiled plans") {
+  Parameter value{"value", "", 0.0f, "", 0.0f, 10.0f};
+  Parameter x{"x", "", 0.0f};
+  int events = 0;
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    value.set(1.0f);
+    handler.storePreset(0, "a");
+    value.set(3.0f);
+    handler.storePreset(1, "b");
+    value.set(0.0f);
+    writeSequence(handler, "seq",
+                  "a:0.0:1.0\n+0.0:/x:0.5\n+0.5:/x:0.7\n@count:0.0:0.0:1\n"
+                  "b:1.0:1.0\na:0.0:0.5\n::\n");
+
+    PresetSequencer sequencer(TimeMasterMode::TIME_MASTER_FREE);
+    sequencer << handler << x;
+    sequencer.registerEventCommand(
+        "count",
+        [](void *data, std::vector<ParameterField> &) {
+          (*static_cast<int *>(data))++;
+        },
+        &events);
+    sequencer.playSequence("seq");
+    advance(sequencer, 0.1);
+    REQUIRE(value.get() == 1.0f);
+    REQUIRE(x.get() == 0.5f);
+    advance(sequencer, 0.5);
+    REQUIRE(x.get() == 0.7f);
+    REQUIRE(events == 1);
+    // Halfway through the morph to b
+    advance(sequencer, 0.9);
+    REQUIRE(value.get() == Approx(2.0f).margin(0.05f));
+    advance(sequencer, 0.6);
+    REQUIRE(value.get() == 3.0f);
+    // Presets used twice share their compiled values
+    advance(sequencer, 1.0);
+    REQUIRE(value.get() == 1.0f);
+    REQUIRE(events == 1);
+    advance(sequencer, 1.0);
+    REQUIRE_FALSE(sequencer.running());
+  }
+  Dir::removeRecursively(directory);
+}
+
+TEST_CASE("PresetSequencer recompiles prepared sequences") {
+  Parameter value{"value", "", 0.0f, "", 0.0f, 10.0f};
+  Parameter x{"x", "", 0.0f};
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    value.set(1.0f);
+    handler.storePreset(0, "a");
+    value.set(0.0f);
+    writeSequence(handler, "seq", "a:0.0:0.5\n+0.1:/x:0.5\n::\n");
+
+    PresetSequencer sequencer(TimeMasterMode::TIME_MASTER_FREE);
+    sequencer << handler;
+    PresetSequencer::PreparedSequence sequence =
+        sequencer.prepareSequence("seq");
+    REQUIRE(sequence.name() == "seq");
+    REQUIRE_FALSE(sequence.empty());
+
+    // Presets written after preparing are read again
+    value.set(4.0f);
+    handler.storePreset(0, "a");
+    value.set(0.0f);
+    sequencer.playSequence(std::move(sequence));
+    advance(sequencer, 0.3);
+    REQUIRE(value.get() == 4.0f);
+    REQUIRE(x.get() == 0.0f);
+
+    // Parameters registered after preparing are resolved
+    sequence = sequencer.prepareSequence("seq");
+    sequencer << x;
+    sequencer.playSequence(std::move(sequence));
+    advance(sequencer, 0.3);
+    REQUIRE(x.get() == 0.5f);
+  }
+  Dir::removeRecursively(directory);
+}
+
+TEST_CASE("PresetSequencer reads presets written during playback") {
+  Parameter value{"value", "", 0.0f, "", 0.0f, 10.0f};
+  {
+    PresetHandler handler(directory);
+    handler << value;
+    value.set(1.0f);
+    handler.storePreset(0, "a");
+    value.set(2.0f);
+    handler.storePreset(1, "b");
+    value.set(0.0f);
+    writeSequence(handler, "seq", "a:0.0:0.5\nb:0.0:0.5\n::\n");
+
+    PresetSequencer sequencer(TimeMasterMode::TIME_MASTER_FREE);
+    sequencer << handler;
+    sequencer.playSequence("seq");
+    advance(sequencer, 0.2);
+    REQUIRE(value.get() == 1.0f);
+
+    value.set(5.0f);
+    handler.storePreset(1, "b");
+    value.set(1.0f);
+    advance(sequencer, 0.5);
+    REQUIRE(value.get() == 5.0f);
+  }
+  Dir::removeRecursively(directory);
+}
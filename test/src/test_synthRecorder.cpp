@@ -0,0 +1,171 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "al/io/al_MIDIFile.hpp"
+#include "al/scene/al_PolySynth.hpp"
+#include "al/scene/al_SynthRecorder.hpp"
+#include "al/scene/al_SynthSequenceFile.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+struct RecorderVoice : public SynthVoice {
+  Parameter frequency{"frequency", "", 440.0f};
+  ParameterString label{"label"};
+  ParameterMenu shape{"shape"};
+
+  void init() override {
+    shape.setElements({"sine", "square", "saw"});
+    registerTriggerParameters(frequency, label, shape);
+  }
+  void onTriggerOff() override { free(); }
+};
+
+TEST_CASE("SynthRecorder records triggers through the event log") {
+  PolySynth synth;
+  synth.allocatePolyphony<RecorderVoice>(4);
+  SynthRecorder recorder(SynthRecorder::BINARY_SEQUENCE);
+  recorder << synth;
+  recorder.setDirectory(".");
+
+  recorder.startRecord("test_synthRecorder", true);
+  auto *voice = synth.getVoice<RecorderVoice>();
+  voice->frequency.set(220.0f);
+  voice->label.set("first");
+  voice->shape.set(1);
+  synth.triggerOn(voice, 0, 10);
+  synth.triggerOff(10);
+
+  // The menu value is taken when triggered, even if the voice is reused
+  // before the writer thread drains the log
+  voice = synth.getVoice<RecorderVoice>();
+  voice->frequency.set(330.0f);
+  voice->label.set("second");
+  voice->shape.set(2);
+  synth.triggerOn(voice, 0, 11);
+  voice->shape.set(0);
+  synth.triggerOff(11);
+  recorder.stopRecord();
+  REQUIRE(recorder.droppedEvents() == 0);
+
+  SynthSequenceFile file("./test_synthRecorder.synthSequenceBin");
+  REQUIRE(file.isOpen());
+  REQUIRE(file.size() == 4);
+
+  const SynthSequenceFile::Event &first = file.event(0);
+  REQUIRE(first.type == SynthSequenceFile::TRIGGER_ON);
+  REQUIRE(first.id == 10);
+  // Time starts at the first trigger
+  REQUIRE(first.time == 0.0);
+  REQUIRE(std::string(file.synthName(first)) == "RecorderVoice");
+  REQUIRE(first.numFields == 3);
+  REQUIRE(file.fieldFloat(first, 0) == 220.0f);
+  REQUIRE(std::string(file.fieldString(first, 1)) == "first");
+  REQUIRE(std::string(file.fieldString(first, 2)) == "square");
+
+  REQUIRE(file.event(1).type == SynthSequenceFile::TRIGGER_OFF);
+  REQUIRE(file.event(1).id == 10);
+
+  const SynthSequenceFile::Event &second = file.event(2);
+  REQUIRE(second.type == SynthSequenceFile::TRIGGER_ON);
+  REQUIRE(second.id == 11);
+  REQUIRE(second.time >= first.time);
+  REQUIRE(file.fieldFloat(second, 0) == 330.0f);
+  REQUIRE(std::string(file.fieldString(second, 1)) == "second");
+  REQUIRE(std::string(file.fieldString(second, 2)) == "saw");
+  REQUIRE(file.event(3).id == 11);
+  file.close();
+  std::remove("./test_synthRecorder.synthSequenceBin");
+}
+
+TEST_CASE("SynthRecorder writes the text sequence at stop") {
+  PolySynth synth;
+  synth.allocatePolyphony<RecorderVoice>(4);
+  synth.registerSynthClass<RecorderVoice>("RecorderVoice");
+  SynthRecorder recorder(SynthRecorder::SEQUENCER_TRIGGERS);
+  recorder << synth;
+  recorder.setDirectory(".");
+
+  recorder.startRecord("test_synthRecorder", true);
+  // More events than the writer thread drains between two sleeps
+  const int numNotes = 1000;
+  for (int i = 0; i < numNotes; i++) {
+    auto *voice = synth.getVoice<RecorderVoice>();
+    voice->frequency.set(float(i));
+    synth.triggerOn(voice, 0, i);
+    synth.triggerOff(i);
+  }
+  recorder.stopRecord();
+  REQUIRE(recorder.droppedEvents() == 0);
+
+  std::ifstream f("./test_synthRecorder.synthSequence");
+  REQUIRE(f.is_open());
+  std::string line;
+  int triggerOns = 0;
+  int triggerOffs = 0;
+  while (std::getline(f, line)) {
+    if (line.substr(0, 2) == "+ ") {
+      std::string name;
+      double time;
+      int id;
+      float frequency;
+      std::istringstream ss(line.substr(2));
+      ss >> time >> id >> name >> frequency;
+      REQUIRE(id == triggerOns);
+      REQUIRE(name == "RecorderVoice");
+      REQUIRE(frequency == float(triggerOns));
+      triggerOns++;
+    } else if (line.substr(0, 2) == "- ") {
+      triggerOffs++;
+    }
+  }
+  REQUIRE(triggerOns == numNotes);
+  REQUIRE(triggerOffs == numNotes);
+  f.close();
+  std::remove("./test_synthRecorder.synthSequence");
+}
+
+TEST_CASE("SynthRecorder ends held notes in MIDI files") {
+  PolySynth synth;
+  synth.allocatePolyphony<RecorderVoice>(4);
+  SynthRecorder recorder(SynthRecorder::MIDI_FILE);
+  recorder << synth;
+  recorder.setDirectory(".");
+
+  recorder.startRecord("test_synthRecorder", true);
+  auto *voice = synth.getVoice<RecorderVoice>();
+  voice->frequency.set(440.0f);
+  synth.triggerOn(voice, 0, 1);
+  al_sleep(0.05);
+  voice = synth.getVoice<RecorderVoice>();
+  voice->frequency.set(880.0f);
+  synth.triggerOn(voice, 0, 2);
+  al_sleep(0.05);
+  synth.triggerOff(2);
+  // Note 1 is still held when recording stops
+  recorder.stopRecord();
+
+  MIDIFile file("./test_synthRecorder.mid");
+  REQUIRE(file.isOpen());
+  std::map<int, uint64_t> noteOns;
+  std::map<int, uint64_t> noteOffs;
+  REQUIRE(file.read([&](const MIDIFileEvent &event) {
+    if (event.isNoteOn()) {
+      noteOns[event.data1] = event.tick;
+    } else if (event.isNoteOff()) {
+      noteOffs[event.data1] = event.tick;
+    }
+  }));
+  REQUIRE(noteOns.size() == 2);
+  REQUIRE(noteOffs.size() == 2);
+  // A4 and A5 from the frequencies
+  REQUIRE(noteOns.count(69) == 1);
+  REQUIRE(noteOns.count(81) == 1);
+  // The held note ends with the last recorded event
+  REQUIRE(noteOffs[69] == noteOffs[81]);
+  REQUIRE(noteOffs[69] > noteOns[81]);
+  std::remove("./test_synthRecorder.mid");
+}
@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "al/scene/al_SynthSequenceFile.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+const char *fileName = "test_synthSequenceFile.synthSequenceBin";
+const char *patchedName = "test_synthSequenceFile_patched.synthSequenceBin";
+
+std::string readAll(const std::string &name) {
+  std::ifstream in(name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+// Write data as a file and try to open it
+bool openData(const std::string &data) {
+  {
+    std::ofstream out(patchedName, std::ios::binary);
+    out.write(data.data(), data.size());
+  }
+  SynthSequenceFile file;
+  bool opened = file.open(patchedName);
+  std::remove(patchedName);
+  return opened;
+}
+
+SynthSequenceFile::Header &header(std::string &data) {
+  return *reinterpret_cast<SynthSequenceFile::Header *>(&data[0]);
+}
+
+// Offset of the string offset table
+size_t stringOffsetsOffset(std::string &data) {
+  const SynthSequenceFile::Header &h = header(data);
+  return sizeof(SynthSequenceFile::Header) +
+         h.numEvents * sizeof(SynthSequenceFile::Event) + h.numFields * 4 +
+         ((h.numFields + 3) / 4) * 4;
+}
+
+std::string writeSample() {
+  SynthSequenceFileWriter writer;
+  writer.addEvent(2.0, 1.0, "Sine", {440.0f, int32_t(3), "hello"});
+  writer.addTriggerOn(0.5, 7, "Sine", {220.0f});
+  writer.addTriggerOff(1.5, 7);
+  writer.addEvent(2.0, 0.5, "Other", {});
+  REQUIRE(writer.size() == 4);
+  REQUIRE(writer.write(fileName));
+  std::string data = readAll(fileName);
+  std::remove(fileName);
+  return data;
+}
+
+}  // namespace
+
+TEST_CASE("SynthSequenceFile round trip") {
+  SynthSequenceFileWriter writer;
+  writer.addEvent(2.0, 1.0, "Sine", {440.0f, int32_t(3), "hello"});
+  writer.addTriggerOn(0.5, 7, "Sine", {220.0f});
+  writer.addTriggerOff(1.5, 7);
+  writer.addEvent(2.0, 0.5, "Other", {});
+  REQUIRE(writer.write(fileName));
+
+  SynthSequenceFile file(fileName);
+  REQUIRE(file.isOpen());
+  REQUIRE(file.size() == 4);
+
+  // Sorted by time, keeping the order of equal times
+  const SynthSequenceFile::Event &on = file.event(0);
+  REQUIRE(on.type == SynthSequenceFile::TRIGGER_ON);
+  REQUIRE(on.time == 0.5);
+  REQUIRE(on.id == 7);
+  REQUIRE(std::string(file.synthName(on)) == "Sine");
+  REQUIRE(file.fieldFloat(on, 0) == 220.0f);
+
+  const SynthSequenceFile::Event &off = file.event(1);
+  REQUIRE(off.type == SynthSequenceFile::TRIGGER_OFF);
+  REQUIRE(off.time == 1.5);
+  REQUIRE(off.id == 7);
+
+  const SynthSequenceFile::Event &event = file.event(2);
+  REQUIRE(event.type == SynthSequenceFile::EVENT);
+  REQUIRE(event.time == 2.0);
+  REQUIRE(event.duration == 1.0);
+  REQUIRE(event.numFields == 3);
+  REQUIRE(file.fieldType(event, 0) == SynthSequenceFile::FIELD_FLOAT);
+  REQUIRE(file.fieldType(event, 1) == SynthSequenceFile::FIELD_INT32);
+  REQUIRE(file.fieldType(event, 2) == SynthSequenceFile::FIELD_STRING);
+  REQUIRE(file.fieldFloat(event, 0) == 440.0f);
+  REQUIRE(file.fieldFloat(event, 1) == 3.0f);
+  REQUIRE(file.fieldString(event, 0) == nullptr);
+  REQUIRE(std::string(file.fieldString(event, 2)) == "hello");
+  std::vector<ParameterField> fields = file.fields(event);
+  REQUIRE(fields.size() == 3);
+  REQUIRE(fields[1].get<int32_t>() == 3);
+  REQUIRE(fields[2].get<std::string>() == "hello");
+
+  REQUIRE(std::string(file.synthName(file.event(3))) == "Other");
+  REQUIRE(file.event(3).duration == 0.5);
+  REQUIRE(file.string(1000) == nullptr);
+
+  file.close();
+  REQUIRE_FALSE(file.isOpen());
+  REQUIRE(file.size() == 0);
+  std::remove(fileName);
+
+  REQUIRE(SynthSequenceFile::isCompiledSequence("a.synthSequenceBin"));
+  REQUIRE_FALSE(SynthSequenceFile::isCompiledSequence("a.synthSequence"));
+}
+
+TEST_CASE("SynthSequenceFile rejects invalid files") {
+  std::string data = writeSample();
+  REQUIRE(openData(data));
+
+  SynthSequenceFile missing;
+  REQUIRE_FALSE(missing.open("test_synthSequenceFile_missing.bin"));
+  REQUIRE_FALSE(openData(""));
+
+  // The file may end with padding after the string data
+  size_t stringsEnd = stringOffsetsOffset(data) +
+                      (header(data).numStrings + 1) * 4 +
+                      header(data).stringDataSize;
+  SECTION("truncated") {
+    for (size_t size = 1; size < stringsEnd; size++) {
+      REQUIRE_FALSE(openData(data.substr(0, size)));
+    }
+  }
+  SECTION("bad magic") {
+    data[0] = 'X';
+    REQUIRE_FALSE(openData(data));
+  }
+  SECTION("bad version") {
+    header(data).version = SynthSequenceFile::VERSION + 1;
+    REQUIRE_FALSE(openData(data));
+  }
+  SECTION("event fields past the field table") {
+    auto *events = reinterpret_cast<SynthSequenceFile::Event *>(
+        &data[sizeof(SynthSequenceFile::Header)]);
+    events[0].firstField = header(data).numFields;
+    REQUIRE_FALSE(openData(data));
+  }
+  SECTION("string offset past the string data") {
+    uint32_t *offsets =
+        reinterpret_cast<uint32_t *>(&data[stringOffsetsOffset(data)]);
+    offsets[1] = 1000;
+    REQUIRE_FALSE(openData(data));
+  }
+  SECTION("strings out of order") {
+    uint32_t *offsets =
+        reinterpret_cast<uint32_t *>(&data[stringOffsetsOffset(data)]);
+    offsets[1] = 0;
+    REQUIRE_FALSE(openData(data));
+  }
+  SECTION("string without terminator") {
+    uint32_t *offsets =
+        reinterpret_cast<uint32_t *>(&data[stringOffsetsOffset(data)]);
+    size_t strings =
+        stringOffsetsOffset(data) + (header(data).numStrings + 1) * 4;
+    data[strings + offsets[1] - 1] = 'x';
+    REQUIRE_FALSE(openData(data));
+  }
+  SECTION("string table larger than the file") {
+    header(data).stringDataSize += uint32_t(data.size() - stringsEnd + 1);
+    REQUIRE_FALSE(openData(data));
+  }
+}
@@ -0,0 +1,215 @@
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "al/io/al_AudioIOData.hpp"
+#include "al/scene/al_PolySynth.hpp"
+#include "al/scene/al_SynthSequencer.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+namespace {
+
+SynthSequencerEvent eventAt(double startTime, double duration = -1) {
+  SynthSequencerEvent event;
+  event.startTime = startTime;
+  event.duration = duration;
+  return event;
+}
+
+// Logs the first frame it renders, counted from the start of playback
+struct LoggingVoice : public SynthVoice {
+  static int64_t blockStart;
+  static std::vector<int64_t> starts;
+  bool started{false};
+
+  void onProcess(AudioIOData &io) override {
+    if (!started) {
+      started = true;
+      // frame(n) leaves the frame one before n, for the io() loop
+      starts.push_back(blockStart + unsigned(io.frame() + 1));
+    }
+  }
+  void onTriggerOn() override { started = false; }
+  void onTriggerOff() override { free(); }
+};
+
+int64_t LoggingVoice::blockStart = 0;
+std::vector<int64_t> LoggingVoice::starts;
+
+struct AudioSequencer {
+  SynthSequencer sequencer{TimeMasterMode::TIME_MASTER_AUDIO};
+  AudioIOData io;
+
+  AudioSequencer() {
+    io.framesPerBuffer(64);
+    io.framesPerSecond(48000);
+    io.channelsOut(2);
+    LoggingVoice::blockStart = 0;
+    LoggingVoice::starts.clear();
+  }
+
+  void render(int blocks) {
+    for (int i = 0; i < blocks; i++) {
+      io.zeroOut();
+      sequencer.render(io);
+      LoggingVoice::blockStart += io.framesPerBuffer();
+    }
+  }
+};
+
+}  // namespace
+
+TEST_CASE("SynthSequencerTimeline sorted insert") {
+  SynthSequencerTimeline timeline;
+  for (double time : {3.0, 1.0, 2.0, 1.0, 0.5}) {
+    timeline.insert(eventAt(time, time * 10.0));
+  }
+  // Events with the same start time stay in insertion order
+  SynthSequencerEvent later = eventAt(1.0, 99.0);
+  timeline.insert(later);
+  REQUIRE(timeline.size() == 6);
+
+  REQUIRE(timeline.acquire());
+  REQUIRE_FALSE(timeline.acquire());
+  const SynthSequencerTimeline::Events &events = timeline.active();
+  REQUIRE(events.size() == 6);
+  for (size_t i = 1; i < events.size(); i++) {
+    REQUIRE(events[i - 1].startTime <= events[i].startTime);
+  }
+  REQUIRE(events[3].startTime == 1.0);
+  REQUIRE(events[3].duration == 99.0);
+
+  std::vector<SynthSequencerEvent> batch{eventAt(2.5), eventAt(0.0),
+                                         eventAt(2.5, 7.0)};
+  timeline.insert(batch);
+  REQUIRE(timeline.acquire());
+  REQUIRE(timeline.active().size() == 9);
+  REQUIRE(timeline.active()[0].startTime == 0.0);
+  REQUIRE(timeline.active()[7].duration == 7.0);
+}
+
+TEST_CASE("SynthSequencerTimeline seek") {
+  SynthSequencerTimeline timeline;
+  timeline.assign({eventAt(4.0), eventAt(1.0), eventAt(2.0), eventAt(2.0)});
+  REQUIRE(timeline.acquire());
+  REQUIRE(timeline.seek(0.0) == 0);
+  REQUIRE(timeline.seek(1.0) == 0);
+  REQUIRE(timeline.seek(1.5) == 1);
+  REQUIRE(timeline.seek(2.0) == 1);
+  REQUIRE(timeline.seekAfter(2.0) == 3);
+  REQUIRE(timeline.seek(4.0) == 3);
+  REQUIRE(timeline.seekAfter(4.0) == 4);
+  REQUIRE(timeline.seek(10.0) == 4);
+}
+
+TEST_CASE("SynthSequencerTimeline edits while playing") {
+  SynthSequencerTimeline timeline;
+  timeline.assign({eventAt(0.0), eventAt(1.0)});
+  REQUIRE(timeline.acquire());
+  const SynthSequencerTimeline::Events *active = &timeline.active();
+
+  // Edits are not visible until acquired
+  timeline.insert(eventAt(0.5), false);
+  timeline.insert(eventAt(1.5), false);
+  REQUIRE(timeline.size() == 4);
+  REQUIRE_FALSE(timeline.acquire());
+  REQUIRE(timeline.active().size() == 2);
+  timeline.publish();
+  REQUIRE(active->size() == 2);  // Still valid until the next acquire()
+  REQUIRE(timeline.acquire());
+  REQUIRE(timeline.active().size() == 4);
+
+  // Swapping in a new sequence
+  timeline.assign({eventAt(5.0)});
+  REQUIRE(timeline.events().size() == 1);
+  REQUIRE(timeline.acquire());
+  REQUIRE(timeline.active().size() == 1);
+  SynthSequencerTimeline::Events removed = timeline.clear();
+  REQUIRE(removed.size() == 1);
+  REQUIRE(timeline.acquire());
+  REQUIRE(timeline.active().empty());
+
+  // A rendering thread acquiring while events are inserted
+  std::atomic<bool> done{false};
+  std::atomic<size_t> lastSize{0};
+  std::thread renderer([&]() {
+    while (!done) {
+      timeline.acquire();
+      const SynthSequencerTimeline::Events &events = timeline.active();
+      for (size_t i = 1; i < events.size(); i++) {
+        if (events[i - 1].startTime > events[i].startTime) {
+          lastSize = size_t(-1);
+          return;
+        }
+      }
+      lastSize = events.size();
+    }
+  });
+  for (int i = 0; i < 2000; i++) {
+    timeline.insert(eventAt(double((i * 7919) % 2000)));
+  }
+  while (lastSize != 2000 && lastSize != size_t(-1)) {
+    std::this_thread::yield();
+  }
+  done = true;
+  renderer.join();
+  REQUIRE(lastSize == 2000);
+}
+
+TEST_CASE("SynthSequencer events while playing") {
+  AudioSequencer audio;
+  SynthSequencer &sequencer = audio.sequencer;
+  sequencer.synth().allocatePolyphony<LoggingVoice>(4);
+  sequencer.add<LoggingVoice>(0.0, 0.5);
+  audio.render(1);
+  REQUIRE(LoggingVoice::starts.size() == 1);
+
+  // Added while playing, at 1 beat (48000 frames at 60 bpm)
+  sequencer.add<LoggingVoice>(1.0, 0.5);
+  audio.render(760);
+  REQUIRE(LoggingVoice::starts.size() == 2);
+  REQUIRE(LoggingVoice::starts[1] == 48000);
+  REQUIRE(sequencer.evictedNotes() == 0);
+}
+
+TEST_CASE("SynthSequencer counts evicted notes") {
+  AudioSequencer audio;
+  SynthSequencer &sequencer = audio.sequencer;
+  size_t notes = SynthSequencer::MAX_SOUNDING_EVENTS + 10;
+  sequencer.synth().allocatePolyphony<LoggingVoice>(int(notes));
+  std::vector<SynthSequencerEvent> events;
+  for (size_t i = 0; i < notes; i++) {
+    SynthSequencerEvent event = eventAt(0.0, 10.0 + i);
+    event.setVoice(sequencer.synth().getVoice<LoggingVoice>());
+    events.push_back(event);
+  }
+  sequencer.addEvents(events);
+  audio.render(1);
+  REQUIRE(sequencer.evictedNotes() == 10);
+}
+
+TEST_CASE("SynthSequencer sample accurate events with a tempo map") {
+  AudioSequencer audio;
+  SynthSequencer &sequencer = audio.sequencer;
+  sequencer.synth().allocatePolyphony<LoggingVoice>(8);
+  TempoMap map(120.0);
+  map.addTempo(4.0, 120.0, TempoMap::LINEAR);
+  map.addTempo(8.0, 180.0);
+  sequencer.setTempoMap(map);
+
+  // Off block boundaries, on the ramp and after it
+  std::vector<double> beats{0.25, 1.3, 5.5, 7.99, 9.0};
+  for (double beat : beats) {
+    sequencer.add<LoggingVoice>(beat, 0.1);
+  }
+  audio.render(int(map.seconds(10.0) * 48000 / 64));
+  REQUIRE(LoggingVoice::starts.size() == beats.size());
+  for (size_t i = 0; i < beats.size(); i++) {
+    REQUIRE(LoggingVoice::starts[i] ==
+            std::llround(map.seconds(beats[i]) * 48000));
+  }
+  REQUIRE(LoggingVoice::starts[0] == 6000);
+}
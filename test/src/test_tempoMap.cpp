@@ -0,0 +1,83 @@
+#include <cmath>
+
+#include "al/scene/al_TempoMap.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+TEST_CASE("TempoMap constant tempo") {
+  TempoMap map;
+  REQUIRE(map.numTempoPoints() == 1);
+  REQUIRE(map.tempo(0.0) == 60.0);
+  REQUIRE(map.seconds(10.0) == Approx(10.0));
+  REQUIRE(map.beats(7.5) == Approx(7.5));
+
+  map.reset(120.0);
+  REQUIRE(map.seconds(8.0) == Approx(4.0));
+  REQUIRE(map.beats(4.0) == Approx(8.0));
+  // Negative positions extend the first tempo
+  REQUIRE(map.seconds(-2.0) == Approx(-1.0));
+
+  // A tempo that is not positive falls back to 60 bpm
+  map.reset(0.0);
+  REQUIRE(map.tempo(0.0) == 60.0);
+
+  // Conversions of an hour long piece do not drift
+  TempoMap odd(97.0);
+  REQUIRE(std::abs(odd.seconds(odd.beats(3600.0)) - 3600.0) < 1e-9);
+}
+
+TEST_CASE("TempoMap steps and ramps") {
+  TempoMap map(120.0);
+  map.addTempo(16.0, 90.0);
+  map.addTempo(32.0, 120.0, TempoMap::LINEAR);
+  map.addTempo(48.0, 160.0);
+  REQUIRE(map.numTempoPoints() == 4);
+
+  REQUIRE(map.tempo(8.0) == Approx(120.0));
+  REQUIRE(map.tempo(20.0) == Approx(90.0));
+  REQUIRE(map.tempo(40.0) == Approx(140.0));
+  REQUIRE(map.tempo(60.0) == Approx(160.0));
+
+  REQUIRE(map.seconds(16.0) == Approx(8.0));
+  REQUIRE(map.seconds(32.0) == Approx(8.0 + 16.0 * 60.0 / 90.0));
+  // The ramp against a numerical integral of 60 / bpm over beats
+  double rampSeconds = 0.0;
+  const int steps = 100000;
+  for (int i = 0; i < steps; i++) {
+    double beat = 32.0 + 16.0 * (i + 0.5) / steps;
+    double bpm = 120.0 + 40.0 * (beat - 32.0) / 16.0;
+    rampSeconds += (16.0 / steps) * 60.0 / bpm;
+  }
+  REQUIRE(map.seconds(48.0) - map.seconds(32.0) ==
+          Approx(rampSeconds).epsilon(1e-9));
+  REQUIRE(map.seconds(52.0) - map.seconds(48.0) == Approx(1.5));
+
+  // Round trips across held and ramped segments
+  for (double beat = -3.0; beat < 100.0; beat += 0.37) {
+    REQUIRE(std::abs(map.beats(map.seconds(beat)) - beat) < 1e-9);
+  }
+  for (double seconds = 0.0; seconds < 60.0; seconds += 0.29) {
+    REQUIRE(std::abs(map.seconds(map.beats(seconds)) - seconds) < 1e-9);
+  }
+
+  // A point at the same beat replaces the previous one
+  map.addTempo(16.0, 60.0);
+  REQUIRE(map.numTempoPoints() == 4);
+  REQUIRE(map.tempo(20.0) == Approx(60.0));
+  REQUIRE(map.seconds(32.0) == Approx(8.0 + 16.0));
+}
+
+TEST_CASE("TempoMap bars") {
+  TempoMap map;
+  map.addTimeSignature(0.0, 3, 4);
+  map.addTimeSignature(12.0, 6, 8);
+  TempoMap::BarPosition position = map.barPosition(13.5);
+  REQUIRE(position.bar == 4);
+  REQUIRE(position.beat == Approx(1.5));
+  position = map.barPosition(7.0);
+  REQUIRE(position.bar == 2);
+  REQUIRE(position.beat == Approx(1.0));
+  REQUIRE(map.beat(5) == Approx(15.0));
+  REQUIRE(map.beat(2, 1.0) == Approx(7.0));
+}
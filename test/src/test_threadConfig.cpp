@@ -0,0 +1,68 @@
+#include <thread>
+#include <vector>
+
+#include "al/system/al_Thread.hpp"
+#include "catch.hpp"
+
+using namespace al;
+
+TEST_CASE("ThreadConfig defaults") {
+  ThreadConfig config;
+  REQUIRE(config.isDefault());
+  // Nothing to apply, so nothing can fail
+  REQUIRE(config.applyThreadSettingsToCurrentThread());
+
+  ThreadConfig denormals;
+  denormals.flushDenormals = true;
+  REQUIRE_FALSE(denormals.isDefault());
+
+  ThreadConfig memory;
+  memory.lockMemory = true;
+  REQUIRE_FALSE(memory.isDefault());
+
+  ThreadConfig pinned;
+  pinned.cpus = {0};
+  REQUIRE_FALSE(pinned.isDefault());
+
+  ThreadConfig realtime = ThreadConfig::realtime(70, 2);
+  REQUIRE_FALSE(realtime.isDefault());
+  REQUIRE(realtime.policy == ThreadConfig::POLICY_FIFO);
+  REQUIRE(realtime.priority == 70);
+  REQUIRE(realtime.cpus == std::vector<int>{2});
+  REQUIRE(realtime.flushDenormals);
+  REQUIRE(ThreadConfig::realtime().cpus.empty());
+}
+
+TEST_CASE("ThreadConfig forWorker") {
+  ThreadConfig config = ThreadConfig::realtime();
+  config.cpus = {1, 3, 5};
+  REQUIRE(config.forWorker(0).cpus == std::vector<int>{1});
+  REQUIRE(config.forWorker(1).cpus == std::vector<int>{3});
+  REQUIRE(config.forWorker(2).cpus == std::vector<int>{5});
+  REQUIRE(config.forWorker(3).cpus == std::vector<int>{1});
+  ThreadConfig worker = config.forWorker(4);
+  REQUIRE(worker.policy == config.policy);
+  REQUIRE(worker.priority == config.priority);
+  REQUIRE(worker.flushDenormals == config.flushDenormals);
+
+  // A single CPU or none is shared by every worker
+  config.cpus = {2};
+  REQUIRE(config.forWorker(7).cpus == std::vector<int>{2});
+  config.cpus.clear();
+  REQUIRE(config.forWorker(7).cpus.empty());
+}
+
+TEST_CASE("ThreadConfig affinity") {
+  // Pinning to CPU 0 works without privileges
+  ThreadConfig config;
+  config.cpus = {0};
+  bool applied = false;
+  std::thread thread(
+      [&]() { applied = config.applyThreadSettingsToCurrentThread(); });
+  thread.join();
+#ifdef AL_LINUX
+  REQUIRE(applied);
+#else
+  (void)applied;
+#endif
+}